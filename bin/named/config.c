@@ -87,7 +87,9 @@ options {\n\
 	reuseport no;\n"
 #endif
 			    "\
-	tls-port 853;\n"
+	tls-port 853;\n\
+#	tls-session-ticket-file <none>\n\
+	tls-session-ticket-rotation 1h;\n"
 #if HAVE_LIBNGHTTP2
 			    "\
 	http-port 80;\n\
@@ -98,6 +100,7 @@ options {\n\
 			    "\
 	prefetch 2 9;\n\
 	recursing-file \"named.recursing\";\n\
+	recursions-per-zone 0;\n\
 	recursive-clients 1000;\n\
 	request-nsid false;\n\
 	resolver-query-timeout 10;\n\
@@ -128,6 +131,7 @@ options {\n\
 	trust-anchor-telemetry yes;\n\
 	udp-receive-buffer 0;\n\
 	udp-send-buffer 0;\n\
+	udp-socket-reuse 0;\n\
 	update-quota 100;\n\
 \n\
 	/* view */\n\
@@ -139,6 +143,7 @@ options {\n\
 	allow-recursion-on { any; };\n\
 	allow-update-forwarding {none;};\n\
 	auth-nxdomain false;\n\
+	cache-snapshot-max-age 3600; /* 1 hour */\n\
 	check-dup-records warn;\n\
 	check-mx warn;\n\
 	check-names primary fail;\n\
@@ -188,6 +193,7 @@ options {\n\
 	request-expire true;\n\
 	request-ixfr true;\n\
 	require-server-cookie no;\n\
+	resolver-hedge-queries 0%;\n\
 	resolver-nonbackoff-tries 3;\n\
 	resolver-retry-interval 800; /* in milliseconds */\n\
 	root-key-sentinel yes;\n\
@@ -235,6 +241,7 @@ options {\n\
 	notify yes;\n\
 	notify-delay 5;\n\
 	notify-to-soa no;\n\
+	rendered-answer-cache 0;\n\
 	serial-update-method increment;\n\
 	sig-signing-nodes 100;\n\
 	sig-signing-signatures 10;\n\
@@ -72,9 +72,11 @@ struct named_server {
 	isc_timer_t *heartbeat_timer;
 	isc_timer_t *pps_timer;
 	isc_timer_t *tat_timer;
+	isc_timer_t *tls_ticketkey_timer;
 
 	uint32_t interface_interval;
 	uint32_t heartbeat_interval;
+	uint32_t tls_ticketkey_rotation;
 
 	atomic_int reload_status;
 
@@ -108,6 +110,11 @@ struct named_server {
 	isc_tlsctx_cache_t *tlsctx_server_cache;
 	isc_tlsctx_cache_t *tlsctx_client_cache;
 
+	isc_tlsctx_ticketkeys_t *tls_ticketkeys; /*%< TLS session ticket
+						  * keys, kept across
+						  * reconfigurations */
+	char *tls_ticketkey_file;
+
 	isc_signal_t *sighup;
 };
 
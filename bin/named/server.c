@@ -244,6 +244,7 @@ struct named_cache {
 	bool needflush;
 	bool adbsizeadjusted;
 	dns_rdataclass_t rdclass;
+	char *snapshot;
 	ISC_LINK(named_cache_t) link;
 };
 
@@ -4008,6 +4009,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	uint32_t lame_ttl, fail_ttl;
 	uint32_t max_stale_ttl = 0;
 	uint32_t stale_refresh_time = 0;
+	bool loadsnapshot = false;
 	dns_tsigkeyring_t *ring = NULL;
 	dns_transport_list_t *transports = NULL;
 	dns_view_t *pview = NULL; /* Production view */
@@ -4645,6 +4647,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 			 */
 			CHECK(dns_cache_create(named_g_loopmgr, view->rdclass,
 					       cachename, &cache));
+			loadsnapshot = true;
 		}
 		nsc = isc_mem_get(mctx, sizeof(*nsc));
 		nsc->cache = NULL;
@@ -4653,6 +4656,13 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		nsc->needflush = false;
 		nsc->adbsizeadjusted = false;
 		nsc->rdclass = view->rdclass;
+		nsc->snapshot = NULL;
+		obj = NULL;
+		result = named_config_get(maps, "cache-snapshot-file", &obj);
+		if (result == ISC_R_SUCCESS) {
+			nsc->snapshot = isc_mem_strdup(mctx,
+						       cfg_obj_asstring(obj));
+		}
 		ISC_LINK_INIT(nsc, link);
 		ISC_LIST_APPEND(*cachelist, nsc, link);
 	}
@@ -4662,6 +4672,32 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_cache_setservestalettl(cache, max_stale_ttl);
 	dns_cache_setservestalerefresh(cache, stale_refresh_time);
 
+	/*
+	 * Warm up a newly created cache from the snapshot written when
+	 * the server was last shut down.  Failing to do so is not fatal;
+	 * the reason has been logged.  The load holds up the rest of the
+	 * configuration, so log how long it took.
+	 */
+	if (loadsnapshot && nsc->snapshot != NULL) {
+		isc_time_t start, end;
+
+		obj = NULL;
+		result = named_config_get(maps, "cache-snapshot-max-age", &obj);
+		INSIST(result == ISC_R_SUCCESS);
+		start = isc_time_now();
+		result = dns_cache_loadsnapshot(cache, nsc->snapshot,
+						cfg_obj_asduration(obj));
+		end = isc_time_now();
+		if (result != ISC_R_FILENOTFOUND) {
+			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+				      "view '%s': loading cache snapshot "
+				      "'%s' took %" PRIu64 " ms",
+				      view->name, nsc->snapshot,
+				      isc_time_microdiff(&end, &start) / 1000);
+		}
+	}
+
 	dns_cache_detach(&cache);
 
 	obj = NULL;
@@ -4908,6 +4944,10 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		dns_resolver_setnonbackofftries(view->resolver, resolver_param);
 	}
 
+	obj = NULL;
+	CHECK(named_config_get(maps, "resolver-hedge-queries", &obj));
+	dns_resolver_sethedgepercent(view->resolver, cfg_obj_aspercentage(obj));
+
 	/*
 	 * Set supported DNSSEC algorithms.
 	 */
@@ -7014,6 +7054,76 @@ interface_timer_tick(void *arg) {
 	(void)ns_interfacemgr_scan(server->interfacemgr, false, false);
 }
 
+static void
+save_tls_ticketkeys(named_server_t *server) {
+	isc_result_t result;
+
+	if (server->tls_ticketkey_file == NULL) {
+		return;
+	}
+
+	result = isc_tlsctx_ticketkeys_save(server->tls_ticketkeys,
+					    server->tls_ticketkey_file);
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+			      "could not save TLS session ticket keys to "
+			      "'%s': %s",
+			      server->tls_ticketkey_file,
+			      isc_result_totext(result));
+	}
+}
+
+/*
+ * Load the TLS session ticket keys from 'filename'; if the file does not
+ * exist, it gets created from the keys currently in use.
+ */
+static void
+configure_tls_ticketkeys_file(named_server_t *server, const char *filename) {
+	isc_result_t result;
+
+	if (server->tls_ticketkey_file != NULL) {
+		isc_mem_free(server->mctx, server->tls_ticketkey_file);
+	}
+	server->tls_ticketkey_file = isc_mem_strdup(server->mctx, filename);
+
+	result = isc_tlsctx_ticketkeys_load(server->tls_ticketkeys, filename);
+	switch (result) {
+	case ISC_R_SUCCESS:
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+			      "loaded TLS session ticket keys from '%s'",
+			      filename);
+		break;
+	case ISC_R_FILENOTFOUND:
+		save_tls_ticketkeys(server);
+		break;
+	default:
+		/*
+		 * Keep using the keys from memory, but do not overwrite the
+		 * file: it might be shared with other servers.
+		 */
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+			      "could not load TLS session ticket keys from "
+			      "'%s': %s",
+			      filename, isc_result_totext(result));
+		break;
+	}
+}
+
+static void
+tls_ticketkey_timer_tick(void *arg) {
+	named_server_t *server = (named_server_t *)arg;
+
+	isc_tlsctx_ticketkeys_rotate(server->tls_ticketkeys);
+	save_tls_ticketkeys(server);
+
+	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+		      NAMED_LOGMODULE_SERVER, ISC_LOG_DEBUG(1),
+		      "rotated TLS session ticket keys");
+}
+
 static void
 heartbeat_timer_tick(void *arg) {
 	named_server_t *server = (named_server_t *)arg;
@@ -8244,6 +8354,7 @@ load_configuration(const char *filename, named_server_t *server,
 	isc_result_t result;
 	uint32_t heartbeat_interval;
 	uint32_t interface_interval;
+	uint32_t tls_ticketkey_rotation;
 	uint32_t udpsize;
 	uint32_t transfer_message_size;
 	uint32_t recv_tcp_buffer_size;
@@ -8343,6 +8454,8 @@ load_configuration(const char *filename, named_server_t *server,
 	}
 
 	isc_tlsctx_cache_create(named_g_mctx, &server->tlsctx_server_cache);
+	isc_tlsctx_cache_set_ticketkeys(server->tlsctx_server_cache,
+					server->tls_ticketkeys);
 
 	if (server->tlsctx_client_cache != NULL) {
 		isc_tlsctx_cache_detach(&server->tlsctx_client_cache);
@@ -8489,6 +8602,11 @@ load_configuration(const char *filename, named_server_t *server,
 
 	isc_quota_soft(&server->sctx->recursionquota, softquota);
 
+	obj = NULL;
+	result = named_config_get(maps, "recursions-per-zone", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	server->sctx->recursionsperzone = cfg_obj_asuint32(obj);
+
 	/*
 	 * Set "blackhole". Only legal at options level; there is
 	 * no default.
@@ -8713,6 +8831,11 @@ load_configuration(const char *filename, named_server_t *server,
 	dns_dispatchmgr_setavailports(named_g_dispatchmgr, v4portset,
 				      v6portset);
 
+	obj = NULL;
+	result = named_config_get(maps, "udp-socket-reuse", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_dispatchmgr_setudpreuse(named_g_dispatchmgr, cfg_obj_asuint32(obj));
+
 	/*
 	 * Set the EDNS UDP size when we don't match a view.
 	 */
@@ -8815,6 +8938,31 @@ load_configuration(const char *filename, named_server_t *server,
 	}
 #endif
 
+	/*
+	 * Configure the TLS session ticket key ring. It must be done
+	 * before the TLS listeners are (re)created.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "tls-session-ticket-file", &obj);
+	if (result == ISC_R_SUCCESS && !cfg_obj_isvoid(obj)) {
+		configure_tls_ticketkeys_file(server, cfg_obj_asstring(obj));
+	} else if (server->tls_ticketkey_file != NULL) {
+		isc_mem_free(server->mctx, server->tls_ticketkey_file);
+	}
+
+	obj = NULL;
+	result = named_config_get(maps, "tls-session-ticket-rotation", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	tls_ticketkey_rotation = cfg_obj_asduration(obj);
+	if (tls_ticketkey_rotation == 0) {
+		isc_timer_stop(server->tls_ticketkey_timer);
+	} else if (server->tls_ticketkey_rotation != tls_ticketkey_rotation) {
+		isc_interval_set(&interval, tls_ticketkey_rotation, 0);
+		isc_timer_start(server->tls_ticketkey_timer,
+				isc_timertype_ticker, &interval);
+	}
+	server->tls_ticketkey_rotation = tls_ticketkey_rotation;
+
 	/*
 	 * Configure the interface manager according to the "listen-on"
 	 * statement.
@@ -9681,6 +9829,9 @@ cleanup_cachelist:
 	while ((nsc = ISC_LIST_HEAD(cachelist)) != NULL) {
 		ISC_LIST_UNLINK(cachelist, nsc, link);
 		dns_cache_detach(&nsc->cache);
+		if (nsc->snapshot != NULL) {
+			isc_mem_free(server->mctx, nsc->snapshot);
+		}
 		isc_mem_put(server->mctx, nsc, sizeof(*nsc));
 	}
 
@@ -9942,6 +10093,9 @@ run_server(void *arg) {
 	isc_timer_create(named_g_mainloop, pps_timer_tick, server,
 			 &server->pps_timer);
 
+	isc_timer_create(named_g_mainloop, tls_ticketkey_timer_tick, server,
+			 &server->tls_ticketkey_timer);
+
 	CHECKFATAL(
 		cfg_parser_create(named_g_mctx, named_g_lctx, &named_g_parser),
 		"creating default configuration parser");
@@ -10009,6 +10163,14 @@ shutdown_server(void *arg) {
 
 	(void)named_server_saventa(server);
 
+	for (nsc = ISC_LIST_HEAD(server->cachelist); nsc != NULL;
+	     nsc = ISC_LIST_NEXT(nsc, link))
+	{
+		if (nsc->snapshot != NULL) {
+			(void)dns_cache_dumpsnapshot(nsc->cache, nsc->snapshot);
+		}
+	}
+
 	for (kasp = ISC_LIST_HEAD(server->kasplist); kasp != NULL;
 	     kasp = kasp_next)
 	{
@@ -10034,6 +10196,9 @@ shutdown_server(void *arg) {
 	while ((nsc = ISC_LIST_HEAD(server->cachelist)) != NULL) {
 		ISC_LIST_UNLINK(server->cachelist, nsc, link);
 		dns_cache_detach(&nsc->cache);
+		if (nsc->snapshot != NULL) {
+			isc_mem_free(server->mctx, nsc->snapshot);
+		}
 		isc_mem_put(server->mctx, nsc, sizeof(*nsc));
 	}
 
@@ -10043,6 +10208,7 @@ shutdown_server(void *arg) {
 	isc_timer_destroy(&server->heartbeat_timer);
 	isc_timer_destroy(&server->pps_timer);
 	isc_timer_destroy(&server->tat_timer);
+	isc_timer_destroy(&server->tls_ticketkey_timer);
 
 	ns_interfacemgr_detach(&server->interfacemgr);
 
@@ -10177,6 +10343,8 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 
 	ISC_LIST_INIT(server->cachelist);
 
+	isc_tlsctx_ticketkeys_create(mctx, &server->tls_ticketkeys);
+
 	server->magic = NAMED_SERVER_MAGIC;
 
 	*serverp = server;
@@ -10245,6 +10413,11 @@ named_server_destroy(named_server_t **serverp) {
 		isc_tlsctx_cache_detach(&server->tlsctx_client_cache);
 	}
 
+	isc_tlsctx_ticketkeys_detach(&server->tls_ticketkeys);
+	if (server->tls_ticketkey_file != NULL) {
+		isc_mem_free(server->mctx, server->tls_ticketkey_file);
+	}
+
 	server->magic = 0;
 	isc_mem_put(server->mctx, server, sizeof(*server));
 	*serverp = NULL;
@@ -11125,6 +11298,7 @@ listenelt_http(const cfg_obj_t *http, const uint16_t family, bool tls,
 	size_t len = 1, i = 0;
 	uint32_t max_clients = named_g_http_listener_clients;
 	uint32_t max_streams = named_g_http_streams_per_conn;
+	uint32_t response_cache_size = 0;
 
 	REQUIRE(target != NULL && *target == NULL);
 
@@ -11144,6 +11318,7 @@ listenelt_http(const cfg_obj_t *http, const uint16_t family, bool tls,
 	if (http != NULL) {
 		const cfg_obj_t *cfg_max_clients = NULL;
 		const cfg_obj_t *cfg_max_streams = NULL;
+		const cfg_obj_t *cfg_response_cache_size = NULL;
 
 		if (cfg_map_get(http, "endpoints", &eplist) == ISC_R_SUCCESS) {
 			INSIST(eplist != NULL);
@@ -11163,6 +11338,14 @@ listenelt_http(const cfg_obj_t *http, const uint16_t family, bool tls,
 			INSIST(cfg_max_streams != NULL);
 			max_streams = cfg_obj_asuint32(cfg_max_streams);
 		}
+
+		if (cfg_map_get(http, "response-cache-size",
+				&cfg_response_cache_size) == ISC_R_SUCCESS)
+		{
+			INSIST(cfg_response_cache_size != NULL);
+			response_cache_size =
+				cfg_obj_asuint32(cfg_response_cache_size);
+		}
 	}
 
 	endpoints = isc_mem_allocate(mctx, sizeof(endpoints[0]) * len);
@@ -11183,7 +11366,8 @@ listenelt_http(const cfg_obj_t *http, const uint16_t family, bool tls,
 
 	result = ns_listenelt_create_http(mctx, port, NULL, family, tls,
 					  tls_params, tlsctx_cache, endpoints,
-					  len, max_clients, max_streams, &delt);
+					  len, max_clients, max_streams,
+					  response_cache_size, &delt);
 	if (result != ISC_R_SUCCESS) {
 		goto error;
 	}
@@ -12088,6 +12272,7 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 	char configtime[ISC_FORMATHTTPTIMESTAMP_SIZE];
 	char line[1024], hostname[256];
 	named_reload_t reload_status;
+	uint64_t tlsfull, tlsresumed;
 
 	REQUIRE(text != NULL);
 
@@ -12191,6 +12376,13 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 			 server->sctx->nsstats, ns_statscounter_tcphighwater));
 	CHECK(putstr(text, line));
 
+	isc_tlsctx_ticketkeys_getstats(server->tls_ticketkeys, &tlsfull,
+				       &tlsresumed);
+	snprintf(line, sizeof(line),
+		 "TLS handshakes: %" PRIu64 " full, %" PRIu64 " resumed\n",
+		 tlsfull, tlsresumed);
+	CHECK(putstr(text, line));
+
 	reload_status = atomic_load(&server->reload_status);
 	if (reload_status != NAMED_RELOAD_DONE) {
 		snprintf(line, sizeof(line), "reload/reconfig %s\n",
@@ -16307,6 +16499,34 @@ named_server_fetchlimit(named_server_t *server, isc_lex_t *lex,
 		}
 		dns_adb_detach(&adb);
 	}
+
+	if (viewname == NULL && server->sctx->recursionsperzone > 0) {
+		char tbuf[100];
+		unsigned int used;
+		int s;
+
+		if (!first) {
+			CHECK(putstr(text, "\n"));
+		}
+		s = snprintf(tbuf, sizeof(tbuf),
+			     "Rate limited zones (recursions-per-zone %u):",
+			     server->sctx->recursionsperzone);
+		if (s < 0 || (unsigned int)s > sizeof(tbuf)) {
+			CHECK(ISC_R_NOSPACE);
+		}
+		CHECK(putstr(text, tbuf));
+		used = isc_buffer_usedlength(*text);
+
+		/* the hot zone tables belong to the loops */
+		isc_loopmgr_pause(named_g_loopmgr);
+		result = ns_interfacemgr_dumphotzones(server->interfacemgr,
+						      text);
+		isc_loopmgr_resume(named_g_loopmgr);
+		CHECK(result);
+		if (used == isc_buffer_usedlength(*text)) {
+			CHECK(putstr(text, "\n  None."));
+		}
+	}
 cleanup:
 	if (adb != NULL) {
 		dns_adb_detach(&adb);
@@ -375,6 +375,39 @@ init_desc(void) {
 		       "queries dropped due to recursive client limit",
 		       "RecLimitDropped");
 	SET_NSSTATDESC(updatequota, "Update quota exceeded", "UpdateQuota");
+	SET_NSSTATDESC(rendercachehit,
+		       "queries answered from the rendered answer cache",
+		       "RenderCacheHit");
+	SET_NSSTATDESC(rendercachemiss,
+		       "queries not found in the rendered answer cache",
+		       "RenderCacheMiss");
+	SET_NSSTATDESC(recurstime0,
+		       "recursions completed < " DNS_RESOLVER_QRYRTTCLASS0STR
+		       "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS0STR);
+	SET_NSSTATDESC(recurstime1,
+		       "recursions completed " DNS_RESOLVER_QRYRTTCLASS0STR
+		       "-" DNS_RESOLVER_QRYRTTCLASS1STR "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS1STR);
+	SET_NSSTATDESC(recurstime2,
+		       "recursions completed " DNS_RESOLVER_QRYRTTCLASS1STR
+		       "-" DNS_RESOLVER_QRYRTTCLASS2STR "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS2STR);
+	SET_NSSTATDESC(recurstime3,
+		       "recursions completed " DNS_RESOLVER_QRYRTTCLASS2STR
+		       "-" DNS_RESOLVER_QRYRTTCLASS3STR "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS3STR);
+	SET_NSSTATDESC(recurstime4,
+		       "recursions completed " DNS_RESOLVER_QRYRTTCLASS3STR
+		       "-" DNS_RESOLVER_QRYRTTCLASS4STR "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS4STR);
+	SET_NSSTATDESC(recurstime5,
+		       "recursions completed > " DNS_RESOLVER_QRYRTTCLASS4STR
+		       "ms after the query",
+		       "RecursTime" DNS_RESOLVER_QRYRTTCLASS4STR "+");
+	SET_NSSTATDESC(reczonelimited,
+		       "recursions refused due to recursions-per-zone",
+		       "RecZoneLimited");
 
 	INSIST(i == ns_statscounter_max);
 
@@ -414,6 +447,21 @@ init_desc(void) {
 			"QueryAbort");
 	SET_RESSTATDESC(dispsockfail, "failures in opening query sockets",
 			"QuerySockFail");
+	SET_RESSTATDESC(dispsockreuse, "query sockets reused",
+			"QuerySockReuse");
+	SET_RESSTATDESC(hedge, "hedged queries sent", "QueryHedge");
+	SET_RESSTATDESC(hedgewin, "hedged queries answered first",
+			"QueryHedgeWin");
+	SET_RESSTATDESC(stalerefresh, "stale RRset refreshes",
+			"StaleRefresh");
+	SET_RESSTATDESC(stalerefreshdup, "stale RRset refreshes deduplicated",
+			"StaleRefreshDup");
+	SET_RESSTATDESC(qminskip,
+			"QNAME minimization queries skipped for known non-cuts",
+			"QryMinSkip");
+	SET_RESSTATDESC(stalerefreshquota,
+			"stale RRset refreshes skipped due to quota",
+			"StaleRefreshQuota");
 	SET_RESSTATDESC(disprequdp, "UDP queries in progress", "QueryCurUDP");
 	SET_RESSTATDESC(dispreqtcp, "TCP queries in progress", "QueryCurTCP");
 	SET_RESSTATDESC(querytimeout, "query timeouts", "QueryTimeout");
@@ -492,6 +540,8 @@ init_desc(void) {
 	SET_ADBSTATDESC(entriescnt, "Addresses in hash table", "entriescnt");
 	SET_ADBSTATDESC(nnames, "Name hash table size", "nnames");
 	SET_ADBSTATDESC(namescnt, "Names in hash table", "namescnt");
+	SET_ADBSTATDESC(unhealthy, "Addresses with frequent timeouts",
+			"unhealthy");
 
 	INSIST(i == dns_adbstats_max);
 
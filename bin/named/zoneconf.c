@@ -1074,6 +1074,15 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 		dns_zone_setmaxrecords(zone, 0);
 	}
 
+	/*
+	 * Only the zone answering the queries caches rendered answers;
+	 * for inline-signing, that is the signed zone.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "rendered-answer-cache", &obj);
+	INSIST(result == ISC_R_SUCCESS && obj != NULL);
+	dns_zone_setrendercachesize(zone, cfg_obj_asuint32(obj));
+
 	if (raw != NULL && filename != NULL) {
 #define SIGNED ".signed"
 		size_t signedlen = strlen(filename) + sizeof(SIGNED);
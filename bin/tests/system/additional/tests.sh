@@ -375,5 +375,20 @@ if [ $ret -eq 1 ] ; then
     echo_i "failed"; status=$((status+1))
 fi
 
+n=$((n + 1))
+echo_i "testing that answers with cached additional data are not rendered from the cache ($n)"
+ret=0
+$DIG $DIGOPTS +rec -t A glue.example @10.53.0.3 > dig.out.$n.1 || ret=1
+grep "glue\.example\..*A.10\.53\.0\.4" dig.out.$n.1 > /dev/null || ret=1
+$DIG $DIGOPTS +norec -t NS ex3 @10.53.0.3 > dig.out.$n.2 || ret=1
+grep "glue\.example\..*A.10\.53\.0\.4" dig.out.$n.2 > /dev/null || ret=1
+$RNDCCMD 10.53.0.3 flushname glue.example 2>&1 | sed 's/^/ns3 /' | cat_i
+$DIG $DIGOPTS +norec -t NS ex3 @10.53.0.3 > dig.out.$n.3 || ret=1
+grep "NS.glue\.example\." dig.out.$n.3 > /dev/null || ret=1
+grep "glue\.example\..*A.10\.53\.0\.4" dig.out.$n.3 > /dev/null && ret=1
+if [ $ret -eq 1 ] ; then
+    echo_i "failed"; status=$((status+1))
+fi
+
 echo_i "exit status: $status"
 [ $status -eq 0 ] || exit 1
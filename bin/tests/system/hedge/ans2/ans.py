@@ -0,0 +1,112 @@
+# Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+#
+# SPDX-License-Identifier: MPL-2.0
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0.  If a copy of the MPL was not distributed with this
+# file, you can obtain one at https://mozilla.org/MPL/2.0/.
+#
+# See the COPYRIGHT file distributed with this work for additional
+# information regarding copyright ownership.
+
+from __future__ import print_function
+import os
+import sys
+import signal
+import socket
+import select
+
+import dns, dns.message, dns.flags, dns.rrset
+from dns.rdatatype import *
+from dns.rdataclass import *
+from dns.rcode import *
+
+
+############################################################################
+# Serve the "hedge." zone from both 10.53.0.2 and 10.53.0.3.  Each address
+# answers TXT queries with its own address, except that queries for names
+# under "drop2.hedge." are never answered on 10.53.0.2, and those for
+# names under "drop3.hedge." never on 10.53.0.3: the resolver has to get
+# the answer from the other address.
+############################################################################
+def create_response(msg, ip):
+    m = dns.message.from_wire(msg)
+    qname = m.question[0].name.to_text().lower()
+    rrtype = m.question[0].rdtype
+    drop = "drop%s.hedge." % ip.split(".")[-1]
+
+    with open("query.log", "a") as f:
+        f.write("%s %s %s\n" % (ip, dns.rdatatype.to_text(rrtype), qname))
+
+    if qname.endswith("." + drop):
+        return None
+
+    r = dns.message.make_response(m)
+    r.flags |= dns.flags.AA
+    r.set_rcode(NOERROR)
+    if not qname.endswith("hedge."):
+        r.set_rcode(REFUSED)
+    elif rrtype == TXT and qname != "hedge.":
+        r.answer.append(dns.rrset.from_text(qname, 1, IN, TXT, '"%s"' % ip))
+    elif rrtype == NS and qname == "hedge.":
+        r.answer.append(dns.rrset.from_text(qname, 300, IN, NS, "ns2.hedge."))
+        r.answer.append(dns.rrset.from_text(qname, 300, IN, NS, "ns3.hedge."))
+    elif rrtype == A and qname in ("ns2.hedge.", "ns3.hedge."):
+        addr = "10.53.0.%s" % qname[2]
+        r.answer.append(dns.rrset.from_text(qname, 300, IN, A, addr))
+    else:
+        soa = "ns2.hedge. hostmaster.hedge. 1 3600 1200 604800 1"
+        r.authority.append(dns.rrset.from_text("hedge.", 1, IN, SOA, soa))
+    return r
+
+
+def sigterm(signum, frame):
+    print("Shutting down now...")
+    os.remove("ans.pid")
+    running = False
+    sys.exit(0)
+
+
+############################################################################
+# Main
+############################################################################
+ips = ["10.53.0.2", "10.53.0.3"]
+
+try:
+    port = int(os.environ["PORT"])
+except:
+    port = 5300
+
+sockets = {}
+for ip in ips:
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.bind((ip, port))
+    sockets[s] = ip
+    print("Listening on %s port %d" % (ip, port))
+
+signal.signal(signal.SIGTERM, sigterm)
+
+f = open("ans.pid", "w")
+pid = os.getpid()
+print(pid, file=f)
+f.close()
+
+running = True
+
+while running:
+    try:
+        inputready, outputready, exceptready = select.select(
+            list(sockets.keys()), [], []
+        )
+    except select.error as e:
+        break
+    except socket.error as e:
+        break
+    except KeyboardInterrupt:
+        break
+
+    for s in inputready:
+        msg = s.recvfrom(65535)
+        rsp = create_response(msg[0], sockets[s])
+        if rsp:
+            s.sendto(rsp.to_wire(), msg[1])
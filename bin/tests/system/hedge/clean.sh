@@ -0,0 +1,19 @@
+#!/bin/sh
+
+# Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+#
+# SPDX-License-Identifier: MPL-2.0
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0.  If a copy of the MPL was not distributed with this
+# file, you can obtain one at https://mozilla.org/MPL/2.0/.
+#
+# See the COPYRIGHT file distributed with this work for additional
+# information regarding copyright ownership.
+
+
+rm -f */named.conf */named.memstats */named.run */named.run.prev
+rm -f */named.stats */named_dump.db
+rm -f */ans.run */query.log
+rm -f ns*/named.lock ns*/managed-keys.bind*
+rm -f adb.out.* dig.out.* named.stats.* named_dump.db.*
@@ -0,0 +1,89 @@
+#!/bin/sh
+
+# Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+#
+# SPDX-License-Identifier: MPL-2.0
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0.  If a copy of the MPL was not distributed with this
+# file, you can obtain one at https://mozilla.org/MPL/2.0/.
+#
+# See the COPYRIGHT file distributed with this work for additional
+# information regarding copyright ownership.
+
+
+set -e
+
+. ../conf.sh
+
+DIGOPTS="-p ${PORT} +tries=1 +time=5"
+RNDCCMD="$RNDC -c ../common/rndc.conf -p ${CONTROLPORT} -s"
+
+status=0
+n=0
+
+# Print the value of the counter described by $2 in the statistics of ns$1
+# (0 if it is not listed).
+getstat() {
+    rm -f ns$1/named.stats
+    $RNDCCMD 10.53.0.$1 stats > /dev/null 2>&1 || return 1
+    cp ns$1/named.stats named.stats.ns$1.$n
+    value=$(awk -v desc="$2" '$0 ~ desc { print $1 }' ns$1/named.stats)
+    echo ${value:-0}
+}
+
+# Query ns$1 for TXT records under drop2.hedge. and drop3.hedge.: the
+# first is only answered by 10.53.0.3, and the second by 10.53.0.2.
+query() {
+    ret=0
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+	for drop in 2 3; do
+	    other=$((5 - drop))
+	    $DIG $DIGOPTS @10.53.0.$1 txt q$i.drop$drop.hedge > dig.out.ns$1.$n.$i.$drop || ret=1
+	    grep "status: NOERROR" dig.out.ns$1.$n.$i.$drop > /dev/null || ret=1
+	    grep "\"10.53.0.$other\"" dig.out.ns$1.$n.$i.$drop > /dev/null || ret=1
+	done
+    done
+    return $ret
+}
+
+n=$((n + 1))
+echo_i "checking that a server that does not answer is hedged around ($n)"
+ret=0
+query 4 || ret=1
+hedge=$(getstat 4 "hedged queries sent")
+win=$(getstat 4 "hedged queries answered first")
+echo_i "hedged queries sent: $hedge, answered first: $win"
+[ "$hedge" -gt 0 ] || ret=1
+[ "$win" -gt 0 ] || ret=1
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+n=$((n + 1))
+echo_i "checking that the losers of the hedges are not counted as timeouts ($n)"
+ret=0
+rm -f ns4/named_dump.db
+$RNDCCMD 10.53.0.4 dumpdb -adb > /dev/null 2>&1 || ret=1
+retry_quiet 5 test -s ns4/named_dump.db || ret=1
+cp ns4/named_dump.db named_dump.db.ns4.$n
+for ip in 10.53.0.2 10.53.0.3; do
+    grep "$ip \[srtt" ns4/named_dump.db > adb.out.ns4.$n.$ip || ret=1
+    grep "\[edns [0-9]*/0\] \[plain 0/0\]" adb.out.ns4.$n.$ip > /dev/null || ret=1
+    grep "\[fail" adb.out.ns4.$n.$ip > /dev/null && ret=1
+done
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+n=$((n + 1))
+echo_i "checking that hedged queries are limited by the credit ($n)"
+ret=0
+# With 1%, the resolver earns one hedged query per 100 queries sent, so
+# the answers come from the retries to the other server instead.
+query 5 || ret=1
+hedge=$(getstat 5 "hedged queries sent")
+[ "$hedge" -eq 0 ] || ret=1
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+echo_i "exit status: $status"
+[ $status -eq 0 ] || exit 1
@@ -62,6 +62,10 @@ def endswith(domain, labels):
 # ns.a.b.stale. IN A 10.53.0.3
 # b. NS ns.b.stale.
 # ns.b.stale. IN A 10.53.0.4
+#
+# For ent. it serves, with long TTLs:
+# *.y.ent. IN A 192.0.2.1 (y.ent. is an empty non-terminal)
+# *.nx.ent. IN A 192.0.2.1, but returns NXDOMAIN to nx.ent. itself
 ############################################################################
 def create_response(msg):
     m = dns.message.from_wire(msg)
@@ -221,6 +225,36 @@ def create_response(msg):
             )
             r.set_rcode(NXDOMAIN)
         return r
+    elif endswith(lqname, "ent."):
+        if lqname == "ent." and rrtype == NS:
+            # NS query at the apex.
+            r.answer.append(dns.rrset.from_text("ent.", 300, IN, NS, "ns2.ent."))
+            r.flags |= dns.flags.AA
+        elif lqname == "ns2.ent." and rrtype == A:
+            r.answer.append(dns.rrset.from_text("ns2.ent.", 300, IN, A, "10.53.0.2"))
+            r.flags |= dns.flags.AA
+        elif (
+            len(labels) == 4
+            and labels[1] in ("y", "nx")
+            and labels[0] != ""
+            and rrtype == A
+        ):
+            r.answer.append(dns.rrset.from_text(lqname, 300, IN, A, "192.0.2.1"))
+            r.flags |= dns.flags.AA
+        else:
+            r.authority.append(
+                dns.rrset.from_text(
+                    "ent.", 300, IN, SOA, "ns2.ent. hostmaster.arpa. 1 2 3 4 300"
+                )
+            )
+            r.flags |= dns.flags.AA
+            if not (
+                lqname in ("ent.", "ns2.ent.", "y.ent.")
+                or (len(labels) == 4 and labels[1] == "y")
+            ):
+                # NXDOMAIN
+                r.set_rcode(NXDOMAIN)
+        return r
     elif endswith(lqname, "bad."):
         bad = True
         suffix = "bad."
@@ -15,6 +15,7 @@ rm -f ns*/named.conf
 rm -f */named.memstats
 rm -f */named.run */named.run.prev
 rm -f dig.out.*
+rm -f ns*/named.stats named.stats.*
 rm -f ns*/named.lock
 rm -f ans*/query.log*
 rm -f query*.log
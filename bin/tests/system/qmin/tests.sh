@@ -21,6 +21,16 @@ CLEANQL="rm -f ans*/query.log"
 status=0
 n=0
 
+# Print the number of QNAME minimization queries ns$1 skipped for known
+# non-cuts.
+getskip() {
+    rm -f ns$1/named.stats
+    $RNDCCMD 10.53.0.$1 stats > /dev/null 2>&1 || return 1
+    cp ns$1/named.stats named.stats.ns$1.$n
+    value=$(awk '/QNAME minimization queries skipped/ { print $1 }' ns$1/named.stats)
+    echo ${value:-0}
+}
+
 n=$((n+1))
 echo_i "query for .good is not minimized when qname-minimization is off ($n)"
 ret=0
@@ -533,5 +543,79 @@ for ans in ans2 ans3 ans4; do mv -f $ans/query.log query-$ans-$n.log 2>/dev/null
 if [ $ret != 0 ]; then echo_i "failed"; fi
 status=$((status+ret))
 
+n=$((n+1))
+echo_i "query below a known empty non-terminal sends no NS query for it ($n)"
+ret=0
+$CLEANQL
+$RNDCCMD 10.53.0.7 flush
+$DIG $DIGOPTS a.y.ent. @10.53.0.7 > dig.out.test$n.a
+grep "status: NOERROR" dig.out.test$n.a > /dev/null || ret=1
+grep "^NS y.ent.$" ans2/query.log > /dev/null || ret=1
+skip1=$(getskip 7)
+$CLEANQL
+$DIG $DIGOPTS b.y.ent. @10.53.0.7 > dig.out.test$n.b
+grep "status: NOERROR" dig.out.test$n.b > /dev/null || ret=1
+grep "b.y.ent.*IN.*A.*192.0.2.1" dig.out.test$n.b > /dev/null || ret=1
+grep "^NS y.ent.$" ans2/query.log > /dev/null && ret=1
+grep "^ADDR b.y.ent.$" ans2/query.log > /dev/null || ret=1
+skip2=$(getskip 7)
+[ "$skip2" -gt "$skip1" ] || ret=1
+for ans in ans2; do mv -f $ans/query.log query-$ans-$n.log 2>/dev/null || true; done
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status+ret))
+
+for flush in "flush" "flushtree ent"; do
+n=$((n+1))
+echo_i "rndc $flush forgets the known empty non-terminals ($n)"
+ret=0
+$CLEANQL
+$RNDCCMD 10.53.0.7 $flush
+skip1=$(getskip 7)
+$DIG $DIGOPTS c.y.ent. @10.53.0.7 > dig.out.test$n
+grep "status: NOERROR" dig.out.test$n > /dev/null || ret=1
+grep "^NS y.ent.$" ans2/query.log > /dev/null || ret=1
+skip2=$(getskip 7)
+[ "$skip2" -eq "$skip1" ] || ret=1
+for ans in ans2; do mv -f $ans/query.log query-$ans-$n.log 2>/dev/null || true; done
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status+ret))
+done
+
+n=$((n+1))
+echo_i "query below a known NXDOMAIN asks for the full name in relaxed mode ($n)"
+ret=0
+$CLEANQL
+$RNDCCMD 10.53.0.7 flush
+$DIG $DIGOPTS a.nx.ent. @10.53.0.7 > dig.out.test$n.a
+grep "status: NOERROR" dig.out.test$n.a > /dev/null || ret=1
+grep "^NS nx.ent.$" ans2/query.log > /dev/null || ret=1
+skip1=$(getskip 7)
+$CLEANQL
+$DIG $DIGOPTS b.nx.ent. @10.53.0.7 > dig.out.test$n.b
+grep "status: NOERROR" dig.out.test$n.b > /dev/null || ret=1
+grep "^NS nx.ent.$" ans2/query.log > /dev/null && ret=1
+grep "^ADDR b.nx.ent.$" ans2/query.log > /dev/null || ret=1
+skip2=$(getskip 7)
+[ "$skip2" -gt "$skip1" ] || ret=1
+for ans in ans2; do mv -f $ans/query.log query-$ans-$n.log 2>/dev/null || true; done
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status+ret))
+
+n=$((n+1))
+echo_i "query below a known NXDOMAIN is not short-cut in strict mode ($n)"
+ret=0
+$CLEANQL
+$RNDCCMD 10.53.0.6 flush
+$DIG $DIGOPTS a.nx.ent. @10.53.0.6 > dig.out.test$n.a
+grep "status: NXDOMAIN" dig.out.test$n.a > /dev/null || ret=1
+grep "^NS nx.ent.$" ans2/query.log > /dev/null || ret=1
+skip1=$(getskip 6)
+$DIG $DIGOPTS b.nx.ent. @10.53.0.6 > dig.out.test$n.b
+skip2=$(getskip 6)
+[ "$skip2" -eq "$skip1" ] || ret=1
+for ans in ans2; do mv -f $ans/query.log query-$ans-$n.log 2>/dev/null || true; done
+if [ $ret != 0 ]; then echo_i "failed"; fi
+status=$((status+ret))
+
 echo_i "exit status: $status"
 [ $status -eq 0 ] || exit 1
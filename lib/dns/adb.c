@@ -20,6 +20,7 @@
 #include <isc/async.h>
 #include <isc/atomic.h>
 #include <isc/hashmap.h>
+#include <isc/histo.h>
 #include <isc/list.h>
 #include <isc/loop.h>
 #include <isc/mutex.h>
@@ -83,6 +84,33 @@
 
 #define DNS_ADB_MINADBSIZE (1024U * 1024U) /*%< 1 Megabyte */
 
+/*%
+ * Each address keeps a histogram of the round trip times of the responses
+ * it sent, from which the 90th percentile is recalculated every
+ * ADB_RTT_UPDATE samples.  When the histogram holds ADB_RTT_WINDOW
+ * samples, the counts are halved, so that old samples fade out.
+ *
+ * The histogram ages together with the SRTT and the 90th percentile: it
+ * is kept in units of rttscale/ADB_SCALE_ONE microseconds, and aging
+ * shrinks the scale rather than the samples.  It is rebuilt in
+ * microseconds when the counts are halved, or when the scale has halved.
+ *
+ * Timeouts are tracked as a moving average of the failure rate, in
+ * units of 1/ADB_FAIL_ONE.  The score that servers are sorted by is the
+ * 90th percentile RTT or the SRTT, whichever is larger (the SRTT jumps
+ * on every timeout), plus ADB_FAIL_PENALTY microseconds scaled by the
+ * failure rate.  An address whose failure rate is ADB_UNHEALTHY or more
+ * is counted as unhealthy.
+ */
+#define ADB_RTT_SIGBITS	 2
+#define ADB_RTT_UPDATE	 16
+#define ADB_RTT_WINDOW	 256
+#define ADB_SCALE_ONE	 65536U
+#define ADB_FAIL_SHIFT	 4
+#define ADB_FAIL_ONE	 65536U
+#define ADB_FAIL_PENALTY 800000U /*%< microseconds */
+#define ADB_UNHEALTHY	 (ADB_FAIL_ONE / 2)
+
 typedef ISC_LIST(dns_adbname_t) dns_adbnamelist_t;
 typedef struct dns_adbnamehook dns_adbnamehook_t;
 typedef ISC_LIST(dns_adbnamehook_t) dns_adbnamehooklist_t;
@@ -254,6 +282,12 @@ struct dns_adbentry {
 
 	unsigned int flags;
 	unsigned int srtt;
+	unsigned int rttp90;
+	unsigned int rttsamples;
+	uint32_t rttscale;
+	uint32_t failrate;
+	bool unhealthy;
+	isc_histo_t *rtthisto;
 	unsigned int completed;
 	unsigned int timeouts;
 	unsigned char plain;
@@ -383,8 +417,12 @@ water(void *, int);
 static void
 dump_entry(FILE *, dns_adb_t *, dns_adbentry_t *, bool, isc_stdtime_t);
 static void
-adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
-	   isc_stdtime_t now);
+adjustsrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt,
+	   unsigned int factor, isc_stdtime_t now);
+static void
+rebuild_rtthisto(dns_adb_t *adb, dns_adbentry_t *entry, bool halve);
+static unsigned int
+entry_score(dns_adbentry_t *entry);
 static void
 log_quota(dns_adbentry_t *entry, const char *fmt, ...) ISC_FORMAT_PRINTF(2, 3);
 
@@ -1132,6 +1170,7 @@ new_adbentry(dns_adb_t *adb, const isc_sockaddr_t *addr) {
 	entry = isc_mem_get(adb->mctx, sizeof(*entry));
 	*entry = (dns_adbentry_t){
 		.srtt = isc_random_uniform(0x1f) + 1,
+		.rttscale = ADB_SCALE_ONE,
 		.sockaddr = *addr,
 		.lameinfo = ISC_LIST_INITIALIZER,
 		.link = ISC_LINK_INITIALIZER,
@@ -1176,6 +1215,14 @@ destroy_adbentry(dns_adbentry_t *entry) {
 		isc_mem_put(adb->mctx, entry->cookie, entry->cookielen);
 	}
 
+	if (entry->rtthisto != NULL) {
+		isc_histo_destroy(&entry->rtthisto);
+	}
+
+	if (entry->unhealthy) {
+		dec_adbstats(adb, dns_adbstats_unhealthy);
+	}
+
 	li = ISC_LIST_HEAD(entry->lameinfo);
 	while (li != NULL) {
 		ISC_LIST_UNLINK(entry->lameinfo, li, plink);
@@ -1287,6 +1334,7 @@ new_adbaddrinfo(dns_adb_t *adb, dns_adbentry_t *entry, in_port_t port) {
 	ai = isc_mem_get(adb->mctx, sizeof(*ai));
 	*ai = (dns_adbaddrinfo_t){
 		.srtt = entry->srtt,
+		.score = entry_score(entry),
 		.flags = entry->flags,
 		.publink = ISC_LINK_INITIALIZER,
 		.sockaddr = entry->sockaddr,
@@ -2568,6 +2616,14 @@ dump_entry(FILE *f, dns_adb_t *adb, dns_adbentry_t *entry, bool debug,
 		"[plain %u/%u]",
 		addrbuf, entry->srtt, entry->flags, entry->edns, entry->ednsto,
 		entry->plain, entry->plainto);
+	if (entry->rttp90 != 0U) {
+		fprintf(f, " [p90 %u]", entry->rttp90);
+	}
+	if (entry->failrate != 0U) {
+		fprintf(f, " [fail %0.2f]",
+			(double)entry->failrate / ADB_FAIL_ONE);
+	}
+	fprintf(f, " [score %u]", entry_score(entry));
 	if (entry->udpsize != 0U) {
 		fprintf(f, " [udpsize %u]", entry->udpsize);
 	}
@@ -2646,8 +2702,8 @@ dumpfind(dns_adbfind_t *find, FILE *f) {
 
 		fprintf(f,
 			"\t\tentry %p, flags %08x"
-			" srtt %u addr %s\n",
-			ai->entry, ai->flags, ai->srtt, tmpp);
+			" srtt %u score %u addr %s\n",
+			ai->entry, ai->flags, ai->srtt, ai->score, tmpp);
 
 		ai = ISC_LIST_NEXT(ai, publink);
 	}
@@ -3196,7 +3252,7 @@ dns_adb_adjustsrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt,
 	if (entry->expires == 0 || factor == DNS_ADB_RTTADJAGE) {
 		now = isc_stdtime_now();
 	}
-	adjustsrtt(addr, rtt, factor, now);
+	adjustsrtt(adb, addr, rtt, factor, now);
 
 	UNLOCK(&entry->lock);
 }
@@ -3209,14 +3265,14 @@ dns_adb_agesrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, isc_stdtime_t now) {
 	dns_adbentry_t *entry = addr->entry;
 	LOCK(&entry->lock);
 
-	adjustsrtt(addr, 0, DNS_ADB_RTTADJAGE, now);
+	adjustsrtt(adb, addr, 0, DNS_ADB_RTTADJAGE, now);
 
 	UNLOCK(&entry->lock);
 }
 
 static void
-adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
-	   isc_stdtime_t now) {
+adjustsrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt,
+	   unsigned int factor, isc_stdtime_t now) {
 	uint64_t new_srtt;
 
 	if (factor == DNS_ADB_RTTADJAGE) {
@@ -3225,6 +3281,14 @@ adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
 			new_srtt <<= 9;
 			new_srtt -= addr->entry->srtt;
 			new_srtt >>= 9;
+			addr->entry->rttp90 -= addr->entry->rttp90 >> 9;
+			addr->entry->rttscale -= addr->entry->rttscale >> 9;
+			if (addr->entry->rtthisto != NULL &&
+			    addr->entry->rttscale < ADB_SCALE_ONE / 2)
+			{
+				rebuild_rtthisto(adb, addr->entry, false);
+			}
+			addr->entry->failrate -= addr->entry->failrate >> 9;
 			addr->entry->lastage = now;
 		} else {
 			new_srtt = addr->entry->srtt;
@@ -3236,12 +3300,115 @@ adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
 
 	addr->entry->srtt = (unsigned int)new_srtt;
 	addr->srtt = (unsigned int)new_srtt;
+	addr->score = entry_score(addr->entry);
 
 	if (addr->entry->expires == 0) {
 		addr->entry->expires = now + ADB_ENTRY_WINDOW;
 	}
 }
 
+static unsigned int
+entry_score(dns_adbentry_t *entry) {
+	uint64_t score = ISC_MAX(entry->rttp90, entry->srtt);
+
+	score += (uint64_t)entry->failrate * ADB_FAIL_PENALTY / ADB_FAIL_ONE;
+
+	return ((unsigned int)ISC_MIN(score, UINT_MAX));
+}
+
+/*
+ * Rebuild the RTT histogram of 'entry' in microseconds, halving the
+ * counts if 'halve' is true.  The entry must be locked.
+ */
+static void
+rebuild_rtthisto(dns_adb_t *adb, dns_adbentry_t *entry, bool halve) {
+	isc_histo_t *hg = NULL;
+	uint64_t min, max, count;
+	uint64_t scale = entry->rttscale;
+
+	isc_histo_create(adb->mctx, ADB_RTT_SIGBITS, &hg);
+
+	entry->rttsamples = 0;
+	for (unsigned int key = 0;
+	     isc_histo_get(entry->rtthisto, key, &min, &max, &count) ==
+	     ISC_R_SUCCESS;
+	     isc_histo_next(entry->rtthisto, &key))
+	{
+		if (halve) {
+			count /= 2;
+		}
+		if (count != 0) {
+			isc_histo_put(hg, min * scale / ADB_SCALE_ONE,
+				      max * scale / ADB_SCALE_ONE, count);
+			entry->rttsamples += count;
+		}
+	}
+
+	isc_histo_destroy(&entry->rtthisto);
+	entry->rtthisto = hg;
+	entry->rttscale = ADB_SCALE_ONE;
+}
+
+/*
+ * Fold a response (timeout == false) or a timeout into the failure
+ * rate of 'addr'.  The entry must be locked.
+ */
+static void
+adjustfailrate(dns_adb_t *adb, dns_adbaddrinfo_t *addr, bool timeout) {
+	dns_adbentry_t *entry = addr->entry;
+
+	entry->failrate -= entry->failrate >> ADB_FAIL_SHIFT;
+	if (timeout) {
+		entry->failrate += ADB_FAIL_ONE >> ADB_FAIL_SHIFT;
+	}
+
+	if (!entry->unhealthy && entry->failrate >= ADB_UNHEALTHY) {
+		entry->unhealthy = true;
+		inc_adbstats(adb, dns_adbstats_unhealthy);
+	} else if (entry->unhealthy && entry->failrate < ADB_UNHEALTHY) {
+		entry->unhealthy = false;
+		dec_adbstats(adb, dns_adbstats_unhealthy);
+	}
+
+	addr->score = entry_score(entry);
+}
+
+void
+dns_adb_rttsample(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt) {
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(DNS_ADBADDRINFO_VALID(addr));
+
+	dns_adbentry_t *entry = addr->entry;
+	LOCK(&entry->lock);
+
+	if (entry->rtthisto == NULL) {
+		isc_histo_create(adb->mctx, ADB_RTT_SIGBITS, &entry->rtthisto);
+		entry->rttscale = ADB_SCALE_ONE;
+	}
+	isc_histo_inc(entry->rtthisto,
+		      (uint64_t)rtt * ADB_SCALE_ONE / entry->rttscale);
+
+	if (++entry->rttsamples % ADB_RTT_UPDATE == 0) {
+		const double fraction[] = { 0.9 };
+		uint64_t value[1];
+
+		if (isc_histo_quantiles(entry->rtthisto, 1, fraction,
+					value) == ISC_R_SUCCESS)
+		{
+			value[0] = value[0] * entry->rttscale / ADB_SCALE_ONE;
+			entry->rttp90 = ISC_MAX(
+				(unsigned int)ISC_MIN(value[0], UINT_MAX), 1);
+		}
+		if (entry->rttsamples >= ADB_RTT_WINDOW) {
+			rebuild_rtthisto(adb, entry, true);
+		}
+	}
+
+	adjustfailrate(adb, addr, false);
+
+	UNLOCK(&entry->lock);
+}
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask) {
@@ -3376,6 +3543,7 @@ dns_adb_timeout(dns_adb_t *adb, dns_adbaddrinfo_t *addr) {
 	LOCK(&entry->lock);
 
 	maybe_adjust_quota(adb, addr, true);
+	adjustfailrate(adb, addr, true);
 
 	addr->entry->plainto++;
 	if (addr->entry->plainto == 0xff) {
@@ -3396,6 +3564,7 @@ dns_adb_ednsto(dns_adb_t *adb, dns_adbaddrinfo_t *addr) {
 	LOCK(&entry->lock);
 
 	maybe_adjust_quota(adb, addr, true);
+	adjustfailrate(adb, addr, true);
 
 	entry->ednsto++;
 	if (addr->entry->ednsto == 0xff) {
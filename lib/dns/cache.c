@@ -16,11 +16,15 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/buffer.h>
+#include <isc/file.h>
 #include <isc/loop.h>
 #include <isc/mem.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
 #include <isc/stats.h>
+#include <isc/stdio.h>
+#include <isc/stdtime.h>
 #include <isc/string.h>
 #include <isc/time.h>
 #include <isc/timer.h>
@@ -29,9 +33,12 @@
 #include <dns/cache.h>
 #include <dns/db.h>
 #include <dns/dbiterator.h>
+#include <dns/fixedname.h>
 #include <dns/log.h>
 #include <dns/masterdump.h>
+#include <dns/name.h>
 #include <dns/rdata.h>
+#include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatasetiter.h>
 #include <dns/stats.h>
@@ -54,6 +61,38 @@
  */
 #define DNS_CACHE_MINSIZE 2097152U /*%< Bytes.  2097152 = 2 MB */
 
+/*
+ * The cache snapshot format.  All the integers are in network byte
+ * order.  The file starts with:
+ *
+ *	magic			32 bits, SNAPSHOT_MAGIC
+ *	version			32 bits, SNAPSHOT_VERSION
+ *	dump time		32 bits
+ *	class			16 bits
+ *
+ * followed by one record per RRset:
+ *
+ *	owner name length	8 bits
+ *	owner name		uncompressed wire format
+ *	type			16 bits
+ *	covers			16 bits
+ *	expiry time		32 bits
+ *	trust			8 bits
+ *	flags			8 bits, SNAPSHOT_*
+ *	rdata count		16 bits
+ *	rdata length		16 bits		These two occur 'rdata
+ *	rdata						count' times.
+ *
+ * The rdata of a negative cache entry is in the ncache format.
+ */
+#define SNAPSHOT_MAGIC	 0x424e4453 /* "BNDS" */
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HDRLEN	 14
+
+#define SNAPSHOT_NEGATIVE 0x01
+#define SNAPSHOT_NXDOMAIN 0x02
+#define SNAPSHOT_OPTOUT	  0x04
+
 /***
  ***	Types
  ***/
@@ -491,6 +530,512 @@ cleanup_db:
 	return (result);
 }
 
+static isc_result_t
+snapshot_rdataset(dns_rdataset_t *rdataset, const dns_name_t *name,
+		  isc_stdtime_t now, isc_buffer_t *buffer, FILE *fp) {
+	isc_result_t result;
+	isc_region_t r;
+	uint8_t flags = 0;
+
+	if ((rdataset->attributes & (DNS_RDATASETATTR_STALE |
+				     DNS_RDATASETATTR_ANCIENT)) != 0 ||
+	    rdataset->ttl == 0)
+	{
+		return (ISC_R_SUCCESS);
+	}
+
+	if ((rdataset->attributes & DNS_RDATASETATTR_NEGATIVE) != 0) {
+		flags |= SNAPSHOT_NEGATIVE;
+	}
+	if ((rdataset->attributes & DNS_RDATASETATTR_NXDOMAIN) != 0) {
+		flags |= SNAPSHOT_NXDOMAIN;
+	}
+	if ((rdataset->attributes & DNS_RDATASETATTR_OPTOUT) != 0) {
+		flags |= SNAPSHOT_OPTOUT;
+	}
+
+	isc_buffer_clear(buffer);
+	dns_name_toregion(name, &r);
+	isc_buffer_putuint8(buffer, (uint8_t)r.length);
+	isc_buffer_putmem(buffer, r.base, r.length);
+	isc_buffer_putuint16(buffer, rdataset->type);
+	isc_buffer_putuint16(buffer, rdataset->covers);
+	isc_buffer_putuint32(buffer, now + rdataset->ttl);
+	isc_buffer_putuint8(buffer, (uint8_t)rdataset->trust);
+	isc_buffer_putuint8(buffer, flags);
+	isc_buffer_putuint16(buffer, (uint16_t)dns_rdataset_count(rdataset));
+
+	for (result = dns_rdataset_first(rdataset); result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(rdataset))
+	{
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+
+		dns_rdataset_current(rdataset, &rdata);
+		dns_rdata_toregion(&rdata, &r);
+		isc_buffer_putuint16(buffer, (uint16_t)r.length);
+		isc_buffer_putmem(buffer, r.base, r.length);
+	}
+	if (result != ISC_R_NOMORE) {
+		return (result);
+	}
+
+	isc_buffer_usedregion(buffer, &r);
+	return (isc_stdio_write(r.base, 1, r.length, fp, NULL));
+}
+
+static isc_result_t
+snapshot_node(dns_db_t *db, dns_dbnode_t *node, const dns_name_t *name,
+	      isc_stdtime_t now, isc_buffer_t *buffer, FILE *fp) {
+	isc_result_t result;
+	dns_rdatasetiter_t *iter = NULL;
+
+	result = dns_db_allrdatasets(db, node, NULL, 0, now, &iter);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	for (result = dns_rdatasetiter_first(iter); result == ISC_R_SUCCESS;
+	     result = dns_rdatasetiter_next(iter))
+	{
+		dns_rdataset_t rdataset;
+
+		dns_rdataset_init(&rdataset);
+		dns_rdatasetiter_current(iter, &rdataset);
+		result = snapshot_rdataset(&rdataset, name, now, buffer, fp);
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+
+	dns_rdatasetiter_destroy(&iter);
+	return (result);
+}
+
+isc_result_t
+dns_cache_dumpsnapshot(dns_cache_t *cache, const char *filename) {
+	isc_result_t result, tresult;
+	dns_db_t *db = NULL;
+	dns_dbiterator_t *dbiter = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	isc_buffer_t *buffer = NULL;
+	isc_buffer_t b;
+	unsigned char header[SNAPSHOT_HDRLEN];
+	isc_stdtime_t now = isc_stdtime_now();
+	char *tempname = NULL;
+	size_t tempnamelen;
+	FILE *fp = NULL;
+
+	REQUIRE(VALID_CACHE(cache));
+	REQUIRE(filename != NULL);
+
+	tempnamelen = strlen(filename) + 20;
+	tempname = isc_mem_allocate(cache->mctx, tempnamelen);
+	result = isc_file_mktemplate(filename, tempname, tempnamelen);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+	result = isc_file_openunique(tempname, &fp);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	isc_buffer_init(&b, header, sizeof(header));
+	isc_buffer_putuint32(&b, SNAPSHOT_MAGIC);
+	isc_buffer_putuint32(&b, SNAPSHOT_VERSION);
+	isc_buffer_putuint32(&b, now);
+	isc_buffer_putuint16(&b, cache->rdclass);
+	result = isc_stdio_write(header, 1, sizeof(header), fp, NULL);
+	if (result != ISC_R_SUCCESS) {
+		goto close;
+	}
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_createiterator(db, 0, &dbiter);
+	if (result != ISC_R_SUCCESS) {
+		goto detach;
+	}
+
+	isc_buffer_allocate(cache->mctx, &buffer, 4096);
+	for (result = dns_dbiterator_first(dbiter); result == ISC_R_SUCCESS;
+	     result = dns_dbiterator_next(dbiter))
+	{
+		dns_dbnode_t *node = NULL;
+
+		result = dns_dbiterator_current(dbiter, &node, name);
+		if (result != ISC_R_SUCCESS && result != DNS_R_NEWORIGIN) {
+			break;
+		}
+
+		/*
+		 * Don't hold the tree lock while the node is written out.
+		 */
+		(void)dns_dbiterator_pause(dbiter);
+		result = snapshot_node(db, node, name, now, buffer, fp);
+		dns_db_detachnode(db, &node);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+	isc_buffer_free(&buffer);
+	dns_dbiterator_destroy(&dbiter);
+
+detach:
+	dns_db_detach(&db);
+
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_flush(fp);
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_sync(fp);
+	}
+
+close:
+	tresult = isc_stdio_close(fp);
+	if (result == ISC_R_SUCCESS) {
+		result = tresult;
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_file_rename(tempname, filename);
+	} else {
+		(void)isc_file_remove(tempname);
+	}
+
+cleanup:
+	isc_mem_free(cache->mctx, tempname);
+
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE, DNS_LOGMODULE_CACHE,
+		      result == ISC_R_SUCCESS ? ISC_LOG_INFO : ISC_LOG_ERROR,
+		      "cache '%s': dumping snapshot to '%s': %s", cache->name,
+		      filename, isc_result_totext(result));
+
+	return (result);
+}
+
+/*
+ * Read 'len' more bytes into 'buffer'.
+ */
+static isc_result_t
+snapshot_read(FILE *fp, isc_buffer_t *buffer, size_t len) {
+	isc_result_t result;
+
+	result = isc_buffer_reserve(buffer, (unsigned int)len);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	result = isc_stdio_read(isc_buffer_used(buffer), 1, len, fp, NULL);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	isc_buffer_add(buffer, (unsigned int)len);
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Check that the rdata of a negative cache entry is a well formed
+ * sequence of records in the ncache format.
+ */
+static isc_result_t
+snapshot_checkncache(isc_region_t *region) {
+	isc_buffer_t source;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+
+	isc_buffer_init(&source, region->base, region->length);
+	isc_buffer_add(&source, region->length);
+
+	while (isc_buffer_remaininglength(&source) > 0) {
+		isc_result_t result;
+		unsigned int count;
+
+		result = dns_name_fromwire(name, &source, DNS_DECOMPRESS_NEVER,
+					   NULL);
+		if (result != ISC_R_SUCCESS) {
+			return (DNS_R_FORMERR);
+		}
+		if (isc_buffer_remaininglength(&source) < 5) {
+			return (DNS_R_FORMERR);
+		}
+		isc_buffer_forward(&source, 3); /* type, trust */
+		count = isc_buffer_getuint16(&source);
+		while (count-- > 0) {
+			unsigned int length;
+
+			if (isc_buffer_remaininglength(&source) < 2) {
+				return (DNS_R_FORMERR);
+			}
+			length = isc_buffer_getuint16(&source);
+			if (isc_buffer_remaininglength(&source) < length) {
+				return (DNS_R_FORMERR);
+			}
+			isc_buffer_forward(&source, length);
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Parse the 'count' rdata of a record from 'source' into 'rdata', and
+ * link them to 'rdatalist'.
+ */
+static isc_result_t
+snapshot_rdata(isc_buffer_t *source, unsigned int count, bool negative,
+	       dns_rdata_t *rdata, dns_rdatalist_t *rdatalist) {
+	for (unsigned int i = 0; i < count; i++) {
+		isc_result_t result;
+		isc_buffer_t target;
+		isc_region_t r;
+		unsigned int length = isc_buffer_getuint16(source);
+
+		dns_rdata_init(&rdata[i]);
+		if (negative) {
+			isc_buffer_remainingregion(source, &r);
+			r.length = length;
+			result = snapshot_checkncache(&r);
+			if (result != ISC_R_SUCCESS) {
+				return (result);
+			}
+			dns_rdata_fromregion(&rdata[i], rdatalist->rdclass,
+					     rdatalist->type, &r);
+			isc_buffer_forward(source, length);
+		} else {
+			/*
+			 * The names are not compressed, so the rdata can be
+			 * checked in place.
+			 */
+			isc_buffer_init(&target, isc_buffer_current(source),
+					length);
+			isc_buffer_setactive(source, length);
+			result = dns_rdata_fromwire(
+				&rdata[i], rdatalist->rdclass, rdatalist->type,
+				source, DNS_DECOMPRESS_NEVER, &target);
+			if (result != ISC_R_SUCCESS) {
+				return (DNS_R_FORMERR);
+			}
+		}
+		ISC_LIST_APPEND(rdatalist->rdata, &rdata[i], link);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+isc_result_t
+dns_cache_loadsnapshot(dns_cache_t *cache, const char *filename,
+		       dns_ttl_t maxage) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	isc_buffer_t *buffer = NULL;
+	isc_buffer_t b;
+	unsigned char header[SNAPSHOT_HDRLEN];
+	isc_stdtime_t now = isc_stdtime_now();
+	isc_stdtime_t dumptime;
+	dns_rdata_t *rdata = NULL;
+	unsigned int rdatasize = 0;
+	unsigned int loaded = 0;
+	FILE *fp = NULL;
+
+	REQUIRE(VALID_CACHE(cache));
+	REQUIRE(filename != NULL);
+
+	result = isc_stdio_open(filename, "rb", &fp);
+	if (result != ISC_R_SUCCESS) {
+		if (result != ISC_R_FILENOTFOUND) {
+			goto log;
+		}
+		return (result);
+	}
+
+	result = isc_stdio_read(header, 1, sizeof(header), fp, NULL);
+	if (result == ISC_R_EOF) {
+		result = DNS_R_FORMERR;
+	}
+	if (result != ISC_R_SUCCESS) {
+		goto close;
+	}
+	isc_buffer_init(&b, header, sizeof(header));
+	isc_buffer_add(&b, sizeof(header));
+	if (isc_buffer_getuint32(&b) != SNAPSHOT_MAGIC ||
+	    isc_buffer_getuint32(&b) != SNAPSHOT_VERSION)
+	{
+		result = DNS_R_FORMERR;
+		goto close;
+	}
+	dumptime = isc_buffer_getuint32(&b);
+	if (isc_buffer_getuint16(&b) != cache->rdclass) {
+		result = DNS_R_BADCLASS;
+		goto close;
+	}
+	if (dumptime > now || now - dumptime > maxage) {
+		result = DNS_R_EXPIRED;
+		goto close;
+	}
+
+	dns_cache_attachdb(cache, &db);
+	isc_buffer_allocate(cache->mctx, &buffer, 4096);
+
+	for (;;) {
+		dns_rdatalist_t rdatalist;
+		dns_rdataset_t rdataset;
+		dns_dbnode_t *node = NULL;
+		isc_buffer_t source;
+		isc_stdtime_t expire;
+		unsigned int namelen, trust, flags, count, start;
+
+		/*
+		 * Read the whole record before parsing it, as the buffer
+		 * may move while it grows.
+		 */
+		isc_buffer_clear(buffer);
+		result = snapshot_read(fp, buffer, 1);
+		if (result == ISC_R_EOF) {
+			result = ISC_R_SUCCESS;
+			break;
+		}
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		namelen = isc_buffer_getuint8(buffer);
+		result = snapshot_read(fp, buffer, namelen + 12);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		isc_buffer_forward(buffer, namelen + 10);
+		count = isc_buffer_getuint16(buffer);
+		start = isc_buffer_consumedlength(buffer);
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int length;
+
+			result = snapshot_read(fp, buffer, 2);
+			if (result != ISC_R_SUCCESS) {
+				break;
+			}
+			length = isc_buffer_getuint16(buffer);
+			result = snapshot_read(fp, buffer, length);
+			if (result != ISC_R_SUCCESS) {
+				break;
+			}
+			isc_buffer_forward(buffer, length);
+		}
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+
+		isc_buffer_init(&source, isc_buffer_base(buffer),
+				isc_buffer_usedlength(buffer));
+		isc_buffer_add(&source, isc_buffer_usedlength(buffer));
+		isc_buffer_forward(&source, 1);
+		result = dns_name_fromwire(name, &source, DNS_DECOMPRESS_NEVER,
+					   NULL);
+		if (result != ISC_R_SUCCESS ||
+		    isc_buffer_consumedlength(&source) != namelen + 1)
+		{
+			result = DNS_R_FORMERR;
+			break;
+		}
+
+		dns_rdatalist_init(&rdatalist);
+		rdatalist.rdclass = cache->rdclass;
+		rdatalist.type = isc_buffer_getuint16(&source);
+		rdatalist.covers = isc_buffer_getuint16(&source);
+		expire = isc_buffer_getuint32(&source);
+		trust = isc_buffer_getuint8(&source);
+		flags = isc_buffer_getuint8(&source);
+		if (count == 0 || trust > dns_trust_ultimate ||
+		    (rdatalist.type == dns_rdatatype_none) !=
+			    ((flags & SNAPSHOT_NEGATIVE) != 0))
+		{
+			result = DNS_R_FORMERR;
+			break;
+		}
+		if (expire <= now) {
+			continue;
+		}
+		rdatalist.ttl = expire - now;
+
+		if (count > rdatasize) {
+			rdata = isc_mem_creget(cache->mctx, rdata, rdatasize,
+					       count, sizeof(rdata[0]));
+			rdatasize = count;
+		}
+		isc_buffer_first(&source);
+		isc_buffer_forward(&source, start);
+		result = snapshot_rdata(&source, count,
+					(flags & SNAPSHOT_NEGATIVE) != 0, rdata,
+					&rdatalist);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+
+		dns_rdataset_init(&rdataset);
+		dns_rdatalist_tordataset(&rdatalist, &rdataset);
+		rdataset.trust = trust;
+		if ((flags & SNAPSHOT_NEGATIVE) != 0) {
+			rdataset.attributes |= DNS_RDATASETATTR_NEGATIVE;
+		}
+		if ((flags & SNAPSHOT_NXDOMAIN) != 0) {
+			rdataset.attributes |= DNS_RDATASETATTR_NXDOMAIN;
+		}
+		if ((flags & SNAPSHOT_OPTOUT) != 0) {
+			rdataset.attributes |= DNS_RDATASETATTR_OPTOUT;
+		}
+
+		result = dns_db_findnode(db, name, true, &node);
+		if (result == ISC_R_SUCCESS) {
+			result = dns_db_addrdataset(db, node, NULL, now,
+						    &rdataset, 0, NULL);
+			dns_db_detachnode(db, &node);
+		}
+		dns_rdataset_disassociate(&rdataset);
+		if (result == DNS_R_UNCHANGED) {
+			result = ISC_R_SUCCESS;
+		}
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		loaded++;
+	}
+	if (result == ISC_R_EOF) {
+		result = DNS_R_FORMERR;
+	}
+
+	if (rdata != NULL) {
+		isc_mem_cput(cache->mctx, rdata, rdatasize, sizeof(rdata[0]));
+	}
+	isc_buffer_free(&buffer);
+	dns_db_detach(&db);
+
+close:
+	(void)isc_stdio_close(fp);
+
+log:
+	if (result == ISC_R_SUCCESS) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE,
+			      DNS_LOGMODULE_CACHE, ISC_LOG_INFO,
+			      "cache '%s': loaded %u RRsets from snapshot "
+			      "'%s'",
+			      cache->name, loaded, filename);
+	} else {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE,
+			      DNS_LOGMODULE_CACHE, ISC_LOG_WARNING,
+			      "cache '%s': loading snapshot from '%s': %s",
+			      cache->name, filename,
+			      isc_result_totext(result));
+	}
+
+	return (result);
+}
+
 isc_stats_t *
 dns_cache_getstats(dns_cache_t *cache) {
 	REQUIRE(VALID_CACHE(cache));
@@ -585,6 +1130,15 @@ dns_cache_dumpstats(dns_cache_t *cache, FILE *fp) {
 	fprintf(fp, "%20" PRIu64 " %s\n",
 		values[dns_cachestatscounter_deletettl],
 		"cache records deleted due to TTL expiration");
+	fprintf(fp, "%20" PRIu64 " %s\n",
+		values[dns_cachestatscounter_reclaimttl],
+		"cache memory reclaimed by TTL expiration (bytes)");
+	fprintf(fp, "%20" PRIu64 " %s\n",
+		values[dns_cachestatscounter_prefetched],
+		"cache records refreshed by prefetch");
+	fprintf(fp, "%20" PRIu64 " %s\n",
+		values[dns_cachestatscounter_prefetchused],
+		"prefetched cache records used");
 	fprintf(fp, "%20" PRIu64 " %s\n",
 		values[dns_cachestatscounter_coveringnsec],
 		"covering nsec returned");
@@ -646,6 +1200,12 @@ dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 			writer));
 	TRY0(renderstat("DeleteTTL", values[dns_cachestatscounter_deletettl],
 			writer));
+	TRY0(renderstat("ReclaimTTL", values[dns_cachestatscounter_reclaimttl],
+			writer));
+	TRY0(renderstat("Prefetched", values[dns_cachestatscounter_prefetched],
+			writer));
+	TRY0(renderstat("PrefetchUsed",
+			values[dns_cachestatscounter_prefetchused], writer));
 	TRY0(renderstat("CoveringNSEC",
 			values[dns_cachestatscounter_coveringnsec], writer));
 
@@ -709,6 +1269,19 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "DeleteTTL", obj);
 
+	obj = json_object_new_int64(values[dns_cachestatscounter_reclaimttl]);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "ReclaimTTL", obj);
+
+	obj = json_object_new_int64(values[dns_cachestatscounter_prefetched]);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "Prefetched", obj);
+
+	obj = json_object_new_int64(
+		values[dns_cachestatscounter_prefetchused]);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "PrefetchUsed", obj);
+
 	obj = json_object_new_int64(values[dns_cachestatscounter_coveringnsec]);
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "CoveringNSEC", obj);
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <isc/async.h>
 #include <isc/atomic.h>
 #include <isc/loop.h>
 #include <isc/mem.h>
@@ -28,6 +29,7 @@
 #include <isc/portset.h>
 #include <isc/random.h>
 #include <isc/stats.h>
+#include <isc/stdtime.h>
 #include <isc/string.h>
 #include <isc/tid.h>
 #include <isc/time.h>
@@ -42,14 +44,65 @@
 #include <dns/transport.h>
 #include <dns/types.h>
 
+/*%
+ * Limits for the connected UDP sockets kept for reuse: the number of
+ * hash buckets and sockets per loop, how long (in milliseconds) a socket
+ * may stay unused in the pool, and how long (in seconds) it may be used.
+ */
+#define DNS_UDPPOOL_BUCKETS  251
+#define DNS_UDPPOOL_SIZE     1024
+#define DNS_UDPPOOL_IDLE     2000
+#define DNS_UDPPOOL_LIFETIME 30
+
 typedef ISC_LIST(dns_dispentry_t) dns_displist_t;
 
+/*%
+ * A connected UDP socket kept for reuse by a later query to the same
+ * server, see dns_dispatchmgr_setudpreuse().  While it is in the pool,
+ * the socket is read from with the idle timeout, so that it is closed
+ * when it times out, when a stray packet arrives, or on shutdown.
+ */
+typedef struct dns_udpsock dns_udpsock_t;
+typedef ISC_LIST(dns_udpsock_t) dns_udpsocklist_t;
+
+struct dns_udpsock {
+	dns_dispatchmgr_t *mgr;
+	isc_nmhandle_t *handle;
+	isc_sockaddr_t local;
+	isc_sockaddr_t peer;
+	unsigned int uses;
+	isc_stdtime_t expire;
+	uint32_t tid;
+	ISC_LINK(dns_udpsock_t) link;
+	ISC_LINK(dns_udpsock_t) lru;
+};
+
+/*%
+ * The pooled sockets of one loop, only accessed from that loop.
+ */
+typedef struct dns_udppool {
+	dns_udpsocklist_t lru;
+	unsigned int count;
+	dns_udpsocklist_t table[DNS_UDPPOOL_BUCKETS];
+} dns_udppool_t;
+
+/*%
+ * The query IDs in use by the entries added on one loop, in an open
+ * addressing hash table with linear probing.  The responses arrive on
+ * the loop that sent the queries, so each table is only accessed from
+ * its own loop and needs no locking.
+ */
+typedef struct dns_qidslot {
+	uint32_t hash; /*%< or QID_EMPTY/QID_DELETED if no 'resp' */
+	dns_dispentry_t *resp;
+} dns_qidslot_t;
+
 typedef struct dns_qid {
 	unsigned int magic;
-	isc_mutex_t lock;
-	unsigned int qid_nbuckets;  /*%< hash table size */
-	unsigned int qid_increment; /*%< id increment on collision */
-	dns_displist_t *qid_table;  /*%< the table itself */
+	unsigned int bits;	/*%< log2 of the table size */
+	unsigned int count;	/*%< entries in the table */
+	unsigned int used;	/*%< entries and deleted slots */
+	dns_qidslot_t *table; /*%< the table itself */
 } dns_qid_t;
 
 struct dns_dispatchmgr {
@@ -65,12 +118,19 @@ struct dns_dispatchmgr {
 	isc_mutex_t lock;
 	ISC_LIST(dns_dispatch_t) list;
 
-	dns_qid_t *qid;
+	/* Set once, then only accessed from the owning loops. */
+	dns_qid_t *qids; /*%< query ID tables, one per loop */
+	uint32_t nqids;
 
 	in_port_t *v4ports;    /*%< available ports for IPv4 */
 	unsigned int nv4ports; /*%< # of available ports for IPv4 */
 	in_port_t *v6ports;    /*%< available ports for IPv4 */
 	unsigned int nv6ports; /*%< # of available ports for IPv4 */
+
+	/* Set once, then only accessed from the owning loops. */
+	atomic_uint_fast32_t udpreuse; /*%< max queries per UDP socket */
+	dns_udppool_t *udppools;
+	uint32_t nudppools;
 };
 
 typedef enum {
@@ -89,7 +149,8 @@ struct dns_dispentry {
 	dns_dispatchstate_t state;
 	dns_transport_t *transport;
 	isc_tlsctx_cache_t *tlsctx_cache;
-	unsigned int bucket;
+	uint32_t hash;
+	bool inqid; /*%< in the query ID table of 'tid' */
 	unsigned int retries;
 	unsigned int timeout;
 	isc_time_t start;
@@ -102,8 +163,11 @@ struct dns_dispentry {
 	dispatch_cb_t response;
 	void *arg;
 	bool reading;
+	bool reuse;	     /*%< socket can be kept for another query */
+	uint32_t tid;	     /*%< loop the entry was added on */
+	unsigned int uses;   /*%< queries sent on the UDP socket before */
+	isc_stdtime_t expire; /*%< when the UDP socket must be closed */
 	isc_result_t result;
-	ISC_LINK(dns_dispentry_t) link;
 	ISC_LINK(dns_dispentry_t) alink;
 	ISC_LINK(dns_dispentry_t) plink;
 	ISC_LINK(dns_dispentry_t) rlink;
@@ -154,14 +218,13 @@ struct dns_dispatch {
 #define VALID_DISPATCHMGR(e)  ISC_MAGIC_VALID((e), DNS_DISPATCHMGR_MAGIC)
 
 /*%
- * Number of buckets in the QID hash table, and the value to
- * increment the QID by when attempting to avoid collisions.
- * The number of buckets should be prime, and the increment
- * should be the next higher prime number.
+ * Initial number of slots (log2) in each QID hash table, and the value to
+ * increment the QID by when attempting to avoid collisions.  The tables
+ * grow when they are three quarters full.
  */
-#ifndef DNS_QID_BUCKETS
-#define DNS_QID_BUCKETS 16411
-#endif /* ifndef DNS_QID_BUCKETS */
+#ifndef DNS_QID_BITS
+#define DNS_QID_BITS 10
+#endif /* ifndef DNS_QID_BITS */
 #ifndef DNS_QID_INCREMENT
 #define DNS_QID_INCREMENT 16433
 #endif /* ifndef DNS_QID_INCREMENT */
@@ -188,7 +251,7 @@ dispatchmgr_destroy(dns_dispatchmgr_t *mgr);
 
 static dns_dispentry_t *
 entry_search(dns_qid_t *, const isc_sockaddr_t *, dns_messageid_t, in_port_t,
-	     unsigned int);
+	     uint32_t);
 static void
 udp_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
 	 void *arg);
@@ -196,16 +259,16 @@ static void
 tcp_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
 	 void *arg);
 static uint32_t
-dns_hash(dns_qid_t *, const isc_sockaddr_t *, dns_messageid_t, in_port_t);
+dns_hash(const isc_sockaddr_t *, dns_messageid_t, in_port_t);
 static void
 dispentry_cancel(dns_dispentry_t *resp, isc_result_t result);
 static isc_result_t
 dispatch_createudp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
 		   dns_dispatch_t **dispp);
 static void
-qid_allocate(dns_dispatchmgr_t *mgr, dns_qid_t **qidp);
+qid_init(isc_mem_t *mctx, dns_qid_t *qid);
 static void
-qid_destroy(isc_mem_t *mctx, dns_qid_t **qidp);
+qid_free(isc_mem_t *mctx, dns_qid_t *qid);
 static void
 udp_startrecv(isc_nmhandle_t *handle, dns_dispentry_t *resp);
 static void
@@ -361,19 +424,141 @@ dispentry_log(dns_dispentry_t *resp, int level, const char *fmt, ...) {
  * Return a hash of the destination and message id.
  */
 static uint32_t
-dns_hash(dns_qid_t *qid, const isc_sockaddr_t *dest, dns_messageid_t id,
-	 in_port_t port) {
+dns_hash(const isc_sockaddr_t *dest, dns_messageid_t id, in_port_t port) {
 	uint32_t ret;
 
 	ret = isc_sockaddr_hash(dest, true);
 	ret ^= ((uint32_t)id << 16) | port;
-	ret %= qid->qid_nbuckets;
-
-	INSIST(ret < qid->qid_nbuckets);
 
 	return (ret);
 }
 
+/*
+ * An empty slot has a NULL 'resp' and QID_EMPTY as its hash; a slot
+ * whose entry has been removed keeps QID_DELETED, so that the probe
+ * sequences going through it are not cut short.
+ */
+#define QID_EMPTY   0
+#define QID_DELETED 1
+
+static unsigned int
+qid_slot(dns_qid_t *qid, uint32_t hash) {
+	/* Fibonacci hashing, the low bits of 'hash' are the port */
+	return ((hash * 0x9e3779b1U) >> (32 - qid->bits));
+}
+
+/*
+ * Return the query ID table of loop 'tid'.  Before the loops are
+ * running, the first table is used.
+ */
+static dns_qid_t *
+qid_get(dns_dispatchmgr_t *mgr, uint32_t tid) {
+	if (tid == ISC_TID_UNKNOWN) {
+		tid = 0;
+	}
+
+	INSIST(tid < mgr->nqids);
+	INSIST(VALID_QID(&mgr->qids[tid]));
+
+	return (&mgr->qids[tid]);
+}
+
+static void
+qid_resize(isc_mem_t *mctx, dns_qid_t *qid, unsigned int bits) {
+	dns_qidslot_t *old = qid->table;
+	size_t oldsize = (size_t)1 << qid->bits;
+
+	qid->bits = bits;
+	qid->used = qid->count;
+	qid->table = isc_mem_cget(mctx, (size_t)1 << bits,
+				  sizeof(qid->table[0]));
+
+	for (size_t i = 0; i < oldsize; i++) {
+		unsigned int slot, mask = (1U << bits) - 1;
+
+		if (old[i].resp == NULL) {
+			continue;
+		}
+		slot = qid_slot(qid, old[i].hash);
+		while (qid->table[slot].resp != NULL) {
+			slot = (slot + 1) & mask;
+		}
+		qid->table[slot] = old[i];
+	}
+
+	isc_mem_cput(mctx, old, oldsize, sizeof(old[0]));
+}
+
+/*
+ * Add 'resp' to the query ID table 'qid', under its 'hash'.
+ */
+static void
+qid_insert(isc_mem_t *mctx, dns_qid_t *qid, dns_dispentry_t *resp) {
+	unsigned int size = 1U << qid->bits;
+	unsigned int slot;
+
+	REQUIRE(!resp->inqid);
+
+	/*
+	 * Keep at least a quarter of the slots empty; grow the table if
+	 * it is half full of live entries, otherwise only clean out the
+	 * deleted slots.
+	 */
+	if (qid->used + 1 > size / 2 + size / 4) {
+		qid_resize(mctx, qid,
+			   qid->count + 1 > size / 2 ? qid->bits + 1
+						     : qid->bits);
+		size = 1U << qid->bits;
+	}
+
+	slot = qid_slot(qid, resp->hash);
+	while (qid->table[slot].resp != NULL) {
+		slot = (slot + 1) & (size - 1);
+	}
+	if (qid->table[slot].hash != QID_DELETED) {
+		qid->used++;
+	}
+	qid->table[slot] = (dns_qidslot_t){ .hash = resp->hash, .resp = resp };
+	qid->count++;
+	resp->inqid = true;
+}
+
+/*
+ * Remove 'resp' from the query ID table of its loop.
+ */
+static void
+qid_remove(dns_dispatchmgr_t *mgr, dns_dispentry_t *resp) {
+	dns_qid_t *qid = NULL;
+	unsigned int mask, slot;
+
+	if (!resp->inqid) {
+		return;
+	}
+
+	REQUIRE(resp->tid == isc_tid());
+
+	qid = qid_get(mgr, resp->tid);
+	mask = (1U << qid->bits) - 1;
+	slot = qid_slot(qid, resp->hash);
+	while (qid->table[slot].resp != resp) {
+		INSIST(qid->table[slot].resp != NULL ||
+		       qid->table[slot].hash == QID_DELETED);
+		slot = (slot + 1) & mask;
+	}
+
+	/* No probe sequence goes on past an empty slot */
+	if (qid->table[(slot + 1) & mask].resp == NULL &&
+	    qid->table[(slot + 1) & mask].hash == QID_EMPTY)
+	{
+		qid->table[slot] = (dns_qidslot_t){ .hash = QID_EMPTY };
+		qid->used--;
+	} else {
+		qid->table[slot] = (dns_qidslot_t){ .hash = QID_DELETED };
+	}
+	qid->count--;
+	resp->inqid = false;
+}
+
 /*%
  * Choose a random port number for a dispatch entry.
  * The caller must hold the disp->lock
@@ -416,31 +601,204 @@ setup_socket(dns_dispatch_t *disp, dns_dispentry_t *resp,
 
 /*
  * Find an entry for query ID 'id', socket address 'dest', and port number
- * 'port'.
+ * 'port', whose hash is 'hash'.
  * Return NULL if no such entry exists.
  */
 static dns_dispentry_t *
 entry_search(dns_qid_t *qid, const isc_sockaddr_t *dest, dns_messageid_t id,
-	     in_port_t port, unsigned int bucket) {
-	dns_dispentry_t *res = NULL;
+	     in_port_t port, uint32_t hash) {
+	unsigned int mask, slot;
 
 	REQUIRE(VALID_QID(qid));
-	REQUIRE(bucket < qid->qid_nbuckets);
 
-	res = ISC_LIST_HEAD(qid->qid_table[bucket]);
+	mask = (1U << qid->bits) - 1;
+	for (slot = qid_slot(qid, hash);
+	     qid->table[slot].resp != NULL ||
+	     qid->table[slot].hash == QID_DELETED;
+	     slot = (slot + 1) & mask)
+	{
+		dns_dispentry_t *res = qid->table[slot].resp;
 
-	while (res != NULL) {
-		if (res->id == id && isc_sockaddr_equal(dest, &res->peer) &&
-		    res->port == port)
+		if (res != NULL && qid->table[slot].hash == hash &&
+		    res->id == id && res->port == port &&
+		    isc_sockaddr_equal(dest, &res->peer))
 		{
 			return (res);
 		}
-		res = ISC_LIST_NEXT(res, link);
 	}
 
 	return (NULL);
 }
 
+static dns_udpsocklist_t *
+udppool_bucket(dns_udppool_t *pool, const isc_sockaddr_t *peer) {
+	return (&pool->table[isc_sockaddr_hash(peer, false) %
+			     DNS_UDPPOOL_BUCKETS]);
+}
+
+static void
+udppool_unlink(dns_udppool_t *pool, dns_udpsock_t *sock) {
+	ISC_LIST_UNLINK(*udppool_bucket(pool, &sock->peer), sock, link);
+	ISC_LIST_UNLINK(pool->lru, sock, lru);
+	pool->count--;
+}
+
+static void
+udpsock_destroy(dns_udpsock_t *sock) {
+	dns_dispatchmgr_t *mgr = sock->mgr;
+
+	if (sock->handle != NULL) {
+		isc_nmhandle_detach(&sock->handle);
+	}
+	isc_mem_put(mgr->mctx, sock, sizeof(*sock));
+	dns_dispatchmgr_detach(&mgr);
+}
+
+/*
+ * The idle read on a pooled socket has finished: it has either timed out,
+ * been canceled, or got a packet that nobody asked for.  In all cases the
+ * socket is closed.
+ */
+static void
+udppool_recv(isc_nmhandle_t *handle, isc_result_t eresult,
+	     isc_region_t *region, void *arg) {
+	dns_udpsock_t *sock = arg;
+
+	UNUSED(handle);
+	UNUSED(region);
+
+	mgr_log(sock->mgr, LVL(90), "closing pooled UDP socket %p: %s",
+		sock->handle, isc_result_totext(eresult));
+
+	if (ISC_LINK_LINKED(sock, link)) {
+		udppool_unlink(&sock->mgr->udppools[sock->tid], sock);
+	}
+	udpsock_destroy(sock);
+}
+
+/*
+ * Keep the connected UDP socket of a finished query, if its last read
+ * got the response and it may still be used for more queries.  Returns
+ * true if the pool took over the handle.
+ */
+static bool
+udppool_put(dns_dispentry_t *resp) {
+	dns_dispatchmgr_t *mgr = resp->disp->mgr;
+	uint_fast32_t maxuses = atomic_load_acquire(&mgr->udpreuse);
+	dns_udppool_t *pool = NULL;
+	dns_udpsock_t *sock = NULL;
+
+	if (!resp->reuse || resp->tid != isc_tid() ||
+	    resp->tid >= mgr->nudppools || resp->uses + 1 >= maxuses ||
+	    resp->expire <= isc_stdtime_now())
+	{
+		return (false);
+	}
+
+	pool = &mgr->udppools[resp->tid];
+	if (pool->count >= DNS_UDPPOOL_SIZE) {
+		/* The idle read callback will free it */
+		sock = ISC_LIST_HEAD(pool->lru);
+		udppool_unlink(pool, sock);
+		isc_nm_cancelread(sock->handle);
+	}
+
+	sock = isc_mem_get(mgr->mctx, sizeof(*sock));
+	*sock = (dns_udpsock_t){
+		.local = resp->local,
+		.peer = resp->peer,
+		.uses = resp->uses + 1,
+		.expire = resp->expire,
+		.tid = resp->tid,
+		.link = ISC_LINK_INITIALIZER,
+		.lru = ISC_LINK_INITIALIZER,
+	};
+	dns_dispatchmgr_attach(mgr, &sock->mgr);
+	sock->handle = resp->handle;
+	resp->handle = NULL;
+
+	ISC_LIST_APPEND(*udppool_bucket(pool, &sock->peer), sock, link);
+	ISC_LIST_APPEND(pool->lru, sock, lru);
+	pool->count++;
+
+	isc_nmhandle_settimeout(sock->handle, DNS_UDPPOOL_IDLE);
+	isc_nm_read(sock->handle, udppool_recv, sock);
+
+	return (true);
+}
+
+/*
+ * Find a pooled UDP socket connected to the peer of 'resp', and move the
+ * entry in the query ID table to the socket's local port.  The
+ * caller must hold the disp->lock.
+ */
+static isc_nmhandle_t *
+udppool_get(dns_dispatch_t *disp, dns_dispentry_t *resp) {
+	dns_dispatchmgr_t *mgr = disp->mgr;
+	in_port_t localport = isc_sockaddr_getport(&disp->local);
+	in_port_t port = 0;
+	dns_udpsocklist_t *bucket = NULL;
+	dns_udpsock_t *sock = NULL;
+	isc_nmhandle_t *handle = NULL;
+
+	if (atomic_load_acquire(&mgr->udpreuse) == 0 ||
+	    isc_tid() >= mgr->nudppools || resp->tid != isc_tid())
+	{
+		return (NULL);
+	}
+
+	/*
+	 * Sockets whose idle read has already failed are skipped, their
+	 * read callback is on its way to free them.
+	 */
+	bucket = udppool_bucket(&mgr->udppools[isc_tid()], &resp->peer);
+	for (sock = ISC_LIST_HEAD(*bucket); sock != NULL;
+	     sock = ISC_LIST_NEXT(sock, link))
+	{
+		port = isc_sockaddr_getport(&sock->local);
+		if (isc_sockaddr_equal(&sock->peer, &resp->peer) &&
+		    isc_sockaddr_eqaddr(&sock->local, &disp->local) &&
+		    (localport == 0 || port == localport) &&
+		    isc_nmhandle_timer_running(sock->handle))
+		{
+			break;
+		}
+	}
+	if (sock == NULL) {
+		return (NULL);
+	}
+
+	/*
+	 * The query ID has already been handed out, so give up on the
+	 * socket if it clashes with another query on the same port.
+	 */
+	if (port != resp->port) {
+		dns_qid_t *qid = qid_get(mgr, resp->tid);
+		uint32_t hash = dns_hash(&resp->peer, resp->id, port);
+
+		if (entry_search(qid, &resp->peer, resp->id, port, hash) !=
+		    NULL)
+		{
+			return (NULL);
+		}
+		qid_remove(mgr, resp);
+		resp->hash = hash;
+		resp->port = port;
+		qid_insert(mgr->mctx, qid, resp);
+	}
+
+	udppool_unlink(&mgr->udppools[isc_tid()], sock);
+
+	resp->local = sock->local;
+	resp->uses = sock->uses;
+	resp->expire = sock->expire;
+	handle = sock->handle;
+	sock->handle = NULL;
+	udpsock_destroy(sock);
+
+	return (handle);
+}
+
 static void
 dispentry_destroy(dns_dispentry_t *resp) {
 	dns_dispatch_t *disp = resp->disp;
@@ -460,13 +818,19 @@ dispentry_destroy(dns_dispentry_t *resp) {
 
 	resp->magic = 0;
 
-	INSIST(!ISC_LINK_LINKED(resp, link));
+	INSIST(!resp->inqid);
 	INSIST(!ISC_LINK_LINKED(resp, plink));
 	INSIST(!ISC_LINK_LINKED(resp, alink));
 	INSIST(!ISC_LINK_LINKED(resp, rlink));
 
 	dispentry_log(resp, LVL(90), "destroying");
 
+	if (resp->handle != NULL && disp->socktype == isc_socktype_udp &&
+	    udppool_put(resp))
+	{
+		dispentry_log(resp, LVL(90), "keeping UDP socket for reuse");
+	}
+
 	if (resp->handle != NULL) {
 		dispentry_log(resp, LVL(90), "detaching handle %p from %p",
 			      resp->handle, &resp->handle);
@@ -623,8 +987,11 @@ udp_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
 	}
 
 	/*
-	 * We have the right resp, so call the caller back.
+	 * We have the right resp, so call the caller back.  The socket
+	 * can be reused unless the caller goes on reading from it, or it
+	 * belongs to another loop than the entry.
 	 */
+	resp->reuse = (resp->tid == isc_tid());
 	goto done;
 
 next:
@@ -683,7 +1050,7 @@ tcp_recv_success(dns_dispatch_t *disp, isc_region_t *region, dns_qid_t *qid,
 	isc_buffer_t source;
 	dns_messageid_t id;
 	unsigned int flags;
-	unsigned int bucket;
+	uint32_t hash;
 	isc_result_t result = ISC_R_SUCCESS;
 	dns_dispentry_t *resp = NULL;
 
@@ -718,9 +1085,8 @@ tcp_recv_success(dns_dispatch_t *disp, isc_region_t *region, dns_qid_t *qid,
 	 * We have a valid response; find the associated dispentry object
 	 * and call the caller back.
 	 */
-	bucket = dns_hash(qid, peer, id, disp->localport);
-	LOCK(&qid->lock);
-	resp = entry_search(qid, peer, id, disp->localport, bucket);
+	hash = dns_hash(peer, id, disp->localport);
+	resp = entry_search(qid, peer, id, disp->localport, hash);
 	if (resp != NULL) {
 		if (resp->reading) {
 			*respp = resp;
@@ -735,9 +1101,8 @@ tcp_recv_success(dns_dispatch_t *disp, isc_region_t *region, dns_qid_t *qid,
 		/* We are not expecting this DNS message */
 		result = ISC_R_NOTFOUND;
 	}
-	dispatch_log(disp, LVL(90), "search for response in bucket %d: %s",
-		     bucket, isc_result_totext(result));
-	UNLOCK(&qid->lock);
+	dispatch_log(disp, LVL(90), "search for response: %s",
+		     isc_result_totext(result));
 
 	return (result);
 }
@@ -810,7 +1175,9 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 
 	REQUIRE(VALID_DISPATCH(disp));
 
-	qid = disp->mgr->qid;
+	REQUIRE(disp->tid == isc_tid());
+
+	qid = qid_get(disp->mgr, disp->tid);
 
 	LOCK(&disp->lock);
 	INSIST(disp->reading);
@@ -1027,7 +1394,15 @@ dns_dispatchmgr_create(isc_mem_t *mctx, isc_nm_t *nm,
 	isc_portset_destroy(mctx, &v4portset);
 	isc_portset_destroy(mctx, &v6portset);
 
-	qid_allocate(mgr, &mgr->qid);
+	/*
+	 * Outside of the loops (before they run), the first table is used.
+	 */
+	mgr->nqids = ISC_MAX(isc_tid_count(), 1);
+	mgr->qids = isc_mem_cget(mctx, mgr->nqids, sizeof(mgr->qids[0]));
+	for (uint32_t i = 0; i < mgr->nqids; i++) {
+		qid_init(mctx, &mgr->qids[i]);
+	}
+
 	mgr->magic = DNS_DISPATCHMGR_MAGIC;
 
 	*mgrp = mgr;
@@ -1062,6 +1437,42 @@ dns_dispatchmgr_setavailports(dns_dispatchmgr_t *mgr, isc_portset_t *v4portset,
 	return (setavailports(mgr, v4portset, v6portset));
 }
 
+static unsigned int
+portbits(unsigned int nports) {
+	unsigned int bits = 0;
+
+	while (nports > 1) {
+		nports >>= 1;
+		bits++;
+	}
+	return (bits);
+}
+
+void
+dns_dispatchmgr_setudpreuse(dns_dispatchmgr_t *mgr, unsigned int maxuses) {
+	REQUIRE(VALID_DISPATCHMGR(mgr));
+	REQUIRE(maxuses <= 1 || isc_tid_count() > 0);
+
+	LOCK(&mgr->lock);
+	if (maxuses > 1 && mgr->udppools == NULL) {
+		mgr->nudppools = isc_tid_count();
+		mgr->udppools = isc_mem_cget(mgr->mctx, mgr->nudppools,
+					     sizeof(mgr->udppools[0]));
+	}
+	atomic_store_release(&mgr->udpreuse, maxuses > 1 ? maxuses : 0);
+
+	if (maxuses > 1) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DISPATCH,
+			      DNS_LOGMODULE_DISPATCH, ISC_LOG_INFO,
+			      "reusing UDP query sockets for up to %u queries "
+			      "to the same server; %u IPv4 ports (%u bits), "
+			      "%u IPv6 ports (%u bits) available",
+			      maxuses, mgr->nv4ports, portbits(mgr->nv4ports),
+			      mgr->nv6ports, portbits(mgr->nv6ports));
+	}
+	UNLOCK(&mgr->lock);
+}
+
 static void
 dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 	REQUIRE(VALID_DISPATCHMGR(mgr));
@@ -1071,7 +1482,10 @@ dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 	mgr->magic = 0;
 	isc_mutex_destroy(&mgr->lock);
 
-	qid_destroy(mgr->mctx, &mgr->qid);
+	for (uint32_t i = 0; i < mgr->nqids; i++) {
+		qid_free(mgr->mctx, &mgr->qids[i]);
+	}
+	isc_mem_cput(mgr->mctx, mgr->qids, mgr->nqids, sizeof(mgr->qids[0]));
 
 	if (mgr->blackhole != NULL) {
 		dns_acl_detach(&mgr->blackhole);
@@ -1090,6 +1504,15 @@ dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 			     sizeof(in_port_t));
 	}
 
+	/* Every pooled socket holds a reference to the manager */
+	if (mgr->udppools != NULL) {
+		for (uint32_t i = 0; i < mgr->nudppools; i++) {
+			INSIST(mgr->udppools[i].count == 0);
+		}
+		isc_mem_cput(mgr->mctx, mgr->udppools, mgr->nudppools,
+			     sizeof(mgr->udppools[0]));
+	}
+
 	isc_nm_detach(&mgr->nm);
 
 	isc_mem_putanddetach(&mgr->mctx, mgr, sizeof(dns_dispatchmgr_t));
@@ -1105,42 +1528,22 @@ dns_dispatchmgr_setstats(dns_dispatchmgr_t *mgr, isc_stats_t *stats) {
 }
 
 static void
-qid_allocate(dns_dispatchmgr_t *mgr, dns_qid_t **qidp) {
-	dns_qid_t *qid = NULL;
-	unsigned int i;
-
-	REQUIRE(qidp != NULL && *qidp == NULL);
+qid_init(isc_mem_t *mctx, dns_qid_t *qid) {
+	*qid = (dns_qid_t){ .bits = DNS_QID_BITS };
 
-	qid = isc_mem_get(mgr->mctx, sizeof(*qid));
-	*qid = (dns_qid_t){ .qid_nbuckets = DNS_QID_BUCKETS,
-			    .qid_increment = DNS_QID_INCREMENT };
-
-	qid->qid_table = isc_mem_cget(mgr->mctx, DNS_QID_BUCKETS,
-				      sizeof(dns_displist_t));
-	for (i = 0; i < qid->qid_nbuckets; i++) {
-		ISC_LIST_INIT(qid->qid_table[i]);
-	}
-
-	isc_mutex_init(&qid->lock);
+	qid->table = isc_mem_cget(mctx, (size_t)1 << qid->bits,
+				  sizeof(qid->table[0]));
 	qid->magic = QID_MAGIC;
-	*qidp = qid;
 }
 
 static void
-qid_destroy(isc_mem_t *mctx, dns_qid_t **qidp) {
-	dns_qid_t *qid = NULL;
-
-	REQUIRE(qidp != NULL);
-	qid = *qidp;
-	*qidp = NULL;
-
+qid_free(isc_mem_t *mctx, dns_qid_t *qid) {
 	REQUIRE(VALID_QID(qid));
+	INSIST(qid->count == 0);
 
 	qid->magic = 0;
-	isc_mem_cput(mctx, qid->qid_table, qid->qid_nbuckets,
-		     sizeof(dns_displist_t));
-	isc_mutex_destroy(&qid->lock);
-	isc_mem_put(mctx, qid, sizeof(*qid));
+	isc_mem_cput(mctx, qid->table, (size_t)1 << qid->bits,
+		     sizeof(qid->table[0]));
 }
 
 /*
@@ -1454,7 +1857,7 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 	dns_qid_t *qid = NULL;
 	in_port_t localport;
 	dns_messageid_t id;
-	unsigned int bucket;
+	uint32_t hash;
 	bool ok = false;
 	int i = 0;
 
@@ -1468,6 +1871,8 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 	REQUIRE(response != NULL);
 	REQUIRE(sent != NULL);
 	REQUIRE(loop != NULL);
+	/* TCP responses are looked up on the loop of the connection */
+	REQUIRE(disp->socktype == isc_socktype_udp || disp->tid == isc_tid());
 
 	LOCK(&disp->lock);
 
@@ -1476,7 +1881,7 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 		return (ISC_R_CANCELED);
 	}
 
-	qid = disp->mgr->qid;
+	qid = qid_get(disp->mgr, isc_tid());
 
 	localport = isc_sockaddr_getport(&disp->local);
 
@@ -1490,7 +1895,7 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 		.sent = sent,
 		.response = response,
 		.arg = arg,
-		.link = ISC_LINK_INITIALIZER,
+		.tid = isc_tid(),
 		.alink = ISC_LINK_INITIALIZER,
 		.plink = ISC_LINK_INITIALIZER,
 		.rlink = ISC_LINK_INITIALIZER,
@@ -1525,11 +1930,10 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 		id = (dns_messageid_t)isc_random16();
 	}
 
-	LOCK(&qid->lock);
 	do {
 		dns_dispentry_t *entry = NULL;
-		bucket = dns_hash(qid, dest, id, localport);
-		entry = entry_search(qid, dest, id, localport, bucket);
+		hash = dns_hash(dest, id, localport);
+		entry = entry_search(qid, dest, id, localport, hash);
 		if (entry == NULL) {
 			ok = true;
 			break;
@@ -1538,16 +1942,15 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop, unsigned int options,
 			/* When using fixed ID, we either must use it or fail */
 			break;
 		}
-		id += qid->qid_increment;
+		id += DNS_QID_INCREMENT;
 		id &= 0x0000ffff;
 	} while (i++ < 64);
 
 	if (ok) {
 		resp->id = id;
-		resp->bucket = bucket;
-		ISC_LIST_APPEND(qid->qid_table[bucket], resp, link);
+		resp->hash = hash;
+		qid_insert(disp->mgr->mctx, qid, resp);
 	}
-	UNLOCK(&qid->lock);
 
 	if (!ok) {
 		isc_mem_put(disp->mgr->mctx, resp, sizeof(*resp));
@@ -1620,7 +2023,6 @@ udp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 	dns_dispatch_t *disp = resp->disp;
 	dns_dispatchmgr_t *mgr = disp->mgr;
-	dns_qid_t *qid = mgr->qid;
 	bool respond = false;
 
 	LOCK(&disp->lock);
@@ -1662,9 +2064,7 @@ udp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 	dec_stats(disp->mgr, dns_resstatscounter_disprequdp);
 
-	LOCK(&qid->lock);
-	ISC_LIST_UNLINK(qid->qid_table[resp->bucket], resp, link);
-	UNLOCK(&qid->lock);
+	qid_remove(mgr, resp);
 	resp->state = DNS_DISPATCHSTATE_CANCELED;
 
 unlock:
@@ -1685,7 +2085,6 @@ tcp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 	dns_dispatch_t *disp = resp->disp;
 	dns_dispatchmgr_t *mgr = disp->mgr;
-	dns_qid_t *qid = mgr->qid;
 	dns_displist_t resps = ISC_LIST_INITIALIZER;
 
 	LOCK(&disp->lock);
@@ -1761,9 +2160,7 @@ tcp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 	dec_stats(disp->mgr, dns_resstatscounter_dispreqtcp);
 
-	LOCK(&qid->lock);
-	ISC_LIST_UNLINK(qid->qid_table[resp->bucket], resp, link);
-	UNLOCK(&qid->lock);
+	qid_remove(mgr, resp);
 	resp->state = DNS_DISPATCHSTATE_CANCELED;
 
 unlock:
@@ -1948,6 +2345,7 @@ udp_connected(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
 		break;
 	case ISC_R_SUCCESS:
 		resp->state = DNS_DISPATCHSTATE_CONNECTED;
+		resp->expire = isc_stdtime_now() + DNS_UDPPOOL_LIFETIME;
 		udp_startrecv(handle, resp);
 		break;
 	case ISC_R_NOPERM:
@@ -1980,13 +2378,63 @@ detach:
 	dns_dispentry_detach(&resp); /* DISPENTRY004 */
 }
 
+/*
+ * The connect callback for a query that got a pooled UDP socket.  The read
+ * on the socket has already been started, and must be canceled if the
+ * query was canceled in the meantime.
+ */
+static void
+udp_reconnected(void *arg) {
+	dns_dispentry_t *resp = (dns_dispentry_t *)arg;
+	dns_dispatch_t *disp = resp->disp;
+	isc_result_t eresult = ISC_R_SUCCESS;
+
+	LOCK(&disp->lock);
+	ISC_LIST_UNLINK(disp->pending, resp, plink);
+	switch (resp->state) {
+	case DNS_DISPATCHSTATE_CANCELED:
+		eresult = ISC_R_CANCELED;
+		if (resp->reading) {
+			isc_nm_cancelread(resp->handle);
+		}
+		break;
+	case DNS_DISPATCHSTATE_CONNECTING:
+		resp->state = DNS_DISPATCHSTATE_CONNECTED;
+		break;
+	default:
+		UNREACHABLE();
+	}
+	UNLOCK(&disp->lock);
+
+	dispentry_log(resp, LVL(90), "connect callback: %s",
+		      isc_result_totext(eresult));
+	resp->connected(eresult, NULL, resp->arg);
+
+	dns_dispentry_detach(&resp); /* DISPENTRY004 */
+}
+
 static void
 udp_dispatch_connect(dns_dispatch_t *disp, dns_dispentry_t *resp) {
+	isc_nmhandle_t *handle = NULL;
+
 	LOCK(&disp->lock);
 	resp->state = DNS_DISPATCHSTATE_CONNECTING;
 	resp->start = isc_loop_now(resp->loop);
 	dns_dispentry_ref(resp); /* DISPENTRY004 */
 	ISC_LIST_APPEND(disp->pending, resp, plink);
+
+	handle = udppool_get(disp, resp);
+	if (handle != NULL) {
+		dispentry_log(resp, LVL(90), "reusing UDP socket %p", handle);
+		inc_stats(disp->mgr, dns_resstatscounter_dispsockreuse);
+		isc_nmhandle_settimeout(handle, resp->timeout);
+		udp_startrecv(handle, resp);
+		isc_nmhandle_detach(&handle);
+		UNLOCK(&disp->lock);
+
+		isc_async_run(resp->loop, udp_reconnected, resp);
+		return;
+	}
 	UNLOCK(&disp->lock);
 
 	isc_nm_udpconnect(disp->mgr->nm, &resp->local, &resp->peer,
@@ -2154,6 +2602,8 @@ static void
 udp_dispatch_getnext(dns_dispentry_t *resp, int32_t timeout) {
 	REQUIRE(timeout <= INT16_MAX);
 
+	resp->reuse = false;
+
 	if (resp->reading) {
 		return;
 	}
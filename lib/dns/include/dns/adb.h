@@ -219,6 +219,7 @@ struct dns_adbaddrinfo {
 
 	isc_sockaddr_t	 sockaddr; /*%< [rw] */
 	unsigned int	 srtt;	   /*%< [rw] microsecs */
+	unsigned int	 score;	   /*%< [rw] microsecs */
 	dns_transport_t *transport;
 
 	unsigned int	flags; /*%< [rw] */
@@ -514,6 +515,25 @@ dns_adb_agesrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, isc_stdtime_t now);
  *	srtt value.  This may include changes made by others.
  */
 
+void
+dns_adb_rttsample(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt);
+/*%<
+ * Record the round trip time of a response from the server, in
+ * microseconds, in its RTT histogram, and count the response towards
+ * its failure rate (see dns_adb_timeout() and dns_adb_ednsto()).
+ *
+ * Requires:
+ *
+ *\li	adb be valid.
+ *
+ *\li	addr be valid.
+ *
+ * Note:
+ *
+ *\li	The score in addr will be updated to reflect the new 90th
+ *	percentile RTT and failure rate of the server.
+ */
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask);
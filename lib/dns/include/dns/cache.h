@@ -243,6 +243,49 @@ dns_cache_flushname(dns_cache_t *cache, const dns_name_t *name);
  *\li	other error returns.
  */
 
+isc_result_t
+dns_cache_dumpsnapshot(dns_cache_t *cache, const char *filename);
+/*%<
+ * Write the unexpired contents of the cache to 'filename' in a binary
+ * snapshot format, which can be read back by dns_cache_loadsnapshot().
+ * The expiry time and trust level of each RRset are recorded, as well
+ * as whether it is a negative cache entry.  The cache database is not
+ * locked for longer than it takes to dump one node, so the cache can
+ * still be used while the snapshot is written.  The snapshot is written
+ * to a temporary file which is renamed to 'filename' when complete.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ *\li	'filename' to be a valid path.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	file errors
+ */
+
+isc_result_t
+dns_cache_loadsnapshot(dns_cache_t *cache, const char *filename,
+		       dns_ttl_t maxage);
+/*%<
+ * Add the contents of a snapshot written by dns_cache_dumpsnapshot()
+ * to the cache.  The TTLs are reduced by the time elapsed since the
+ * snapshot was written, and the RRsets that have expired in the meantime
+ * are skipped.  A snapshot written more than 'maxage' seconds ago is not
+ * loaded at all.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ *\li	'filename' to be a valid path.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_FILENOTFOUND	'filename' does not exist
+ *\li	#DNS_R_EXPIRED		the snapshot is older than 'maxage'
+ *\li	#DNS_R_FORMERR		the file is not a valid snapshot
+ *\li	#DNS_R_BADCLASS		the snapshot is for another class
+ *\li	other errors
+ */
+
 isc_stats_t *
 dns_cache_getstats(dns_cache_t *cache);
 /*
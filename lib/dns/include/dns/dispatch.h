@@ -150,6 +150,23 @@ dns_dispatchmgr_setavailports(dns_dispatchmgr_t *mgr, isc_portset_t *v4portset,
  *\li	v6portset is NULL or a valid port set
  */
 
+void
+dns_dispatchmgr_setudpreuse(dns_dispatchmgr_t *mgr, unsigned int maxuses);
+/*%<
+ * Keep the connected UDP socket of a query that got its response, and use
+ * it again for a later query to the same server from the same loop, for
+ * up to 'maxuses' queries in all.  This saves creating, binding and
+ * connecting a socket for every query, at the cost of sending several
+ * queries from the same randomly chosen source port.  A socket is closed
+ * when it has been unused for a short while, when an unexpected packet
+ * arrives on it, or when it has been used for too long.
+ *
+ * If 'maxuses' is 0 or 1, every query uses a new socket (the default).
+ *
+ * Requires:
+ *\li	mgr is a valid dispatchmgr
+ */
+
 void
 dns_dispatchmgr_setstats(dns_dispatchmgr_t *mgr, isc_stats_t *stats);
 /*%<
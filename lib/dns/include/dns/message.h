@@ -336,6 +336,9 @@ struct dns_message {
 	dns_indent_t indent;
 
 	dns_minttl_t minttl[DNS_SECTION_MAX];
+
+	dns_messagepool_t *pool;
+	ISC_LINK(dns_message_t) link;
 };
 
 struct dns_ednsopt {
@@ -376,6 +379,60 @@ dns_message_create(isc_mem_t *mctx, unsigned int intent, dns_message_t **msgp);
  *\li	#ISC_R_SUCCESS		-- success
  */
 
+void
+dns_messagepool_create(isc_mem_t *mctx, uint32_t tid, unsigned int maxfree,
+		       dns_messagepool_t **poolp);
+/*%<
+ * Create a pool of recyclable messages owned by the loop 'tid'.
+ *
+ * Messages created with dns_message_createpooled() are not freed when
+ * their last reference is detached on the owning loop; instead, they
+ * are reset and kept on the free list of the pool, together with their
+ * first rdata, rdatalist and offsets blocks, their scratchpad buffer
+ * and the name and rdataset pools, so that the next message created
+ * from the pool needs no memory allocation.  At most 'maxfree' messages
+ * are kept on the free list.
+ *
+ * The pool is not locked; only the owning loop can use the free list.
+ * Messages detached on another loop are destroyed.
+ *
+ * Requires:
+ *\li	'mctx' be a valid memory context.
+ *
+ *\li	'poolp' be non-null and '*poolp' be NULL.
+ */
+
+void
+dns_messagepool_destroy(dns_messagepool_t **poolp);
+/*%<
+ * Stop recycling messages in '*poolp' and release the caller's
+ * reference to it.  The messages on the free list are freed when the
+ * last message created from the pool is detached.
+ *
+ * Requires:
+ *\li	'*poolp' be a valid message pool.
+ *
+ *\li	No message created from the pool is being detached on the
+ *	owning loop concurrently.
+ */
+
+void
+dns_message_createpooled(dns_messagepool_t *pool, unsigned int intent,
+			 dns_message_t **msgp);
+/*%<
+ * Like dns_message_create(), but take the message from the free list of
+ * 'pool' if possible.  The message is returned to the pool when it is
+ * detached for the last time on the loop owning 'pool'.
+ *
+ * Requires:
+ *\li	'pool' be a valid message pool owned by the current loop.
+ *
+ *\li	'msgp' be non-null and '*msg' be NULL.
+ *
+ *\li	'intent' must be one of DNS_MESSAGE_INTENTPARSE or
+ *	#DNS_MESSAGE_INTENTRENDER.
+ */
+
 void
 dns_message_reset(dns_message_t *msg, unsigned int intent);
 /*%<
@@ -412,6 +469,10 @@ dns_message_detach(dns_message_t **messagep);
  * Detach *messagep from its message.
  * list.
  *
+ * If this was the last reference and the message was created from a
+ * message pool, the message is recycled into the pool as described for
+ * dns_messagepool_create().
+ *
  * Requires:
  *\li	'*messagep' to be a valid message.
  */
@@ -691,6 +752,30 @@ dns_message_rendersection(dns_message_t *msg, dns_section_t section,
  *				   are records remaining for this section.
  */
 
+isc_result_t
+dns_message_renderanswer(dns_message_t *msg,
+			 const dns_renderedanswer_t *answer);
+/*%<
+ * Append the answer, authority and additional sections of 'answer',
+ * taken from a dns_rendercache_t, to the message.  The question section
+ * must have been rendered already, and must be the same as the one of
+ * the message the sections were rendered in.  The flags and rcode of
+ * the message are not changed.
+ *
+ * Requires:
+ *\li	'msg' be valid.
+ *
+ *\li	'answer' be a valid rendered answer.
+ *
+ *\li	dns_message_renderbegin() was called, and no other section than
+ *	the question section was rendered.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS		-- the sections were written.
+ *\li	#ISC_R_NOSPACE		-- Not enough room in the buffer; nothing
+ *				   was written.
+ */
+
 void
 dns_message_renderheader(dns_message_t *msg, isc_buffer_t *target);
 /*%<
@@ -407,8 +407,7 @@ dns_qpmulti_memusage(dns_qpmulti_t *multi);
 /*
  * XXXFANF todo, based on what we discover BIND needs
  *
- * more fancy searches: lexicographic predecessor (for NSEC),
- * successor (for modification-safe iteration), etc.
+ * more fancy searches: successor (for modification-safe iteration), etc.
  *
  * do we need specific lookup functions to find out if the
  * returned value is readonly or mutable?
@@ -490,6 +489,28 @@ dns_qp_findname_ancestor(dns_qpreadable_t qpr, const dns_name_t *name,
  * \li  ISC_R_NOTFOUND if no match was found
  */
 
+isc_result_t
+dns_qp_findname_predecessor(dns_qpreadable_t qpr, const dns_name_t *name,
+			    void **pval_r, uint32_t *ival_r);
+/*%<
+ * Find the leaf in a qp-trie whose key is equal to the given DNS name,
+ * or failing that, the leaf that immediately precedes the name in DNS
+ * order. This is what is needed to find the NSEC record that covers a
+ * name.
+ *
+ * The leaf values are assigned to whichever of `*pval_r` and `*ival_r`
+ * are not null, unless the return value is ISC_R_NOTFOUND.
+ *
+ * Requires:
+ * \li  `qpr` is a pointer to a readable qp-trie
+ * \li  `name` is a pointer to a valid `dns_name_t`
+ *
+ * Returns:
+ * \li  ISC_R_SUCCESS if an exact match was found
+ * \li  DNS_R_PARTIALMATCH if a predecessor was found
+ * \li  ISC_R_NOTFOUND if every name in the trie is greater than `name`
+ */
+
 isc_result_t
 dns_qp_insert(dns_qp_t *qp, void *pval, uint32_t ival);
 /*%<
@@ -64,9 +64,62 @@ enum {
 	DNS_RBT_NSEC_NSEC3 = 3	   /* in nsec3 tree */
 };
 struct dns_rbtnode {
+	/*
+	 * The fields are ordered so that there is no padding on LP64
+	 * systems, with the fields only used by the RBT DB implementation
+	 * first, and the fields needed to search the tree last, so that
+	 * they share cache lines with the name that is appended to the
+	 * node (see NAME() in rbt.c).
+	 */
 #if DNS_RBT_USEMAGIC
 	unsigned int magic;
 #endif /* if DNS_RBT_USEMAGIC */
+
+	/*@{*/
+	/*!
+	 * These values are used in the RBT DB implementation.  The appropriate
+	 * node lock must be held before accessing them.
+	 *
+	 * Note: The two "unsigned int :0;" unnamed bitfields on either
+	 * side of the bitfields below are scaffolding that border the
+	 * set of bitfields which are accessed after acquiring the node
+	 * lock. Please don't insert any other bitfield members between
+	 * the unnamed bitfields unless they should also be accessed
+	 * after acquiring the node lock.
+	 *
+	 * NOTE: Do not merge these fields into the bitfields below, as
+	 * they'll all be put in the same qword that could be accessed
+	 * without the node lock as it shares the qword with other
+	 * members. Leave these members here so that they occupy a
+	 * separate region of memory.
+	 */
+	uint16_t locknum; /* note that this is not in the bitfield */
+	uint8_t	      : 0; /* start of bitfields c/o node lock */
+	uint8_t dirty : 1;
+	uint8_t wild  : 1;
+	uint8_t	      : 0; /* end of bitfields c/o node lock */
+	isc_refcount_t references;
+	void	      *data;
+	/*@}*/
+
+	/*%
+	 * Used for LRU cache.  This linked list is used to mark nodes which
+	 * have no data any longer, but we cannot unlink at that exact moment
+	 * because we did not or could not obtain a write lock on the tree.
+	 */
+	ISC_LINK(dns_rbtnode_t) deadlink;
+
+	dns_rbtnode_t *parent;
+
+	/*%
+	 * These are needed for hashing. The 'uppernode' points to the
+	 * node's superdomain node in the parent subtree, so that it can
+	 * be reached from a child that was found by a hash lookup.
+	 */
+	dns_rbtnode_t *uppernode;
+	dns_rbtnode_t *hashnext;
+	unsigned int   hashval;
+
 	/*@{*/
 	/*!
 	 * The following bitfields add up to a total bitwidth of 32.
@@ -97,53 +150,9 @@ struct dns_rbtnode {
 	unsigned int		   : 0; /* end of bitfields c/o tree lock */
 	/*@}*/
 
-	/*%
-	 * These are needed for hashing. The 'uppernode' points to the
-	 * node's superdomain node in the parent subtree, so that it can
-	 * be reached from a child that was found by a hash lookup.
-	 */
-	unsigned int   hashval;
-	dns_rbtnode_t *uppernode;
-	dns_rbtnode_t *hashnext;
-
-	dns_rbtnode_t *parent;
 	dns_rbtnode_t *left;
 	dns_rbtnode_t *right;
 	dns_rbtnode_t *down;
-
-	/*%
-	 * Used for LRU cache.  This linked list is used to mark nodes which
-	 * have no data any longer, but we cannot unlink at that exact moment
-	 * because we did not or could not obtain a write lock on the tree.
-	 */
-	ISC_LINK(dns_rbtnode_t) deadlink;
-
-	/*@{*/
-	/*!
-	 * These values are used in the RBT DB implementation.  The appropriate
-	 * node lock must be held before accessing them.
-	 *
-	 * Note: The two "unsigned int :0;" unnamed bitfields on either
-	 * side of the bitfields below are scaffolding that border the
-	 * set of bitfields which are accessed after acquiring the node
-	 * lock. Please don't insert any other bitfield members between
-	 * the unnamed bitfields unless they should also be accessed
-	 * after acquiring the node lock.
-	 *
-	 * NOTE: Do not merge these fields into bitfields above, as
-	 * they'll all be put in the same qword that could be accessed
-	 * without the node lock as it shares the qword with other
-	 * members. Leave these members here so that they occupy a
-	 * separate region of memory.
-	 */
-	void *data;
-	uint8_t	      : 0; /* start of bitfields c/o node lock */
-	uint8_t dirty : 1;
-	uint8_t wild  : 1;
-	uint8_t	      : 0;	/* end of bitfields c/o node lock */
-	uint16_t       locknum; /* note that this is not in the bitfield */
-	isc_refcount_t references;
-	/*@}*/
 };
 
 typedef isc_result_t (*dns_rbtfindcallback_t)(dns_rbtnode_t	*node,
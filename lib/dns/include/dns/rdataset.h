@@ -140,6 +140,12 @@ struct dns_rdataset {
 	 */
 	uint32_t count;
 
+	/*%
+	 * The number of times the RRset was found in the cache before
+	 * this lookup, or zero if it did not come from a cache.
+	 */
+	uint32_t hits;
+
 	/*
 	 * This RRSIG RRset should be re-generated around this time.
 	 * Only valid if DNS_RDATASETATTR_RESIGN is set in attributes.
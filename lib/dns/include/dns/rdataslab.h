@@ -79,7 +79,8 @@ struct dns_slabheader {
 
 	unsigned int heap_index;
 	/*%<
-	 * Used for TTL-based cache cleaning.
+	 * Position in the zone's resigning heap, or (plus one) the slot
+	 * of the cache bucket's expiry wheel holding this header.
 	 */
 
 	isc_stdtime_t resign;
@@ -94,6 +95,12 @@ struct dns_slabheader {
 
 	atomic_uint_fast32_t last_refresh_fail_ts;
 
+	atomic_uint_fast16_t hits;
+	/*%<
+	 * The number of times a cached rdataset has been found by a
+	 * lookup, saturating at DNS_SLABHEADER_MAXHITS.
+	 */
+
 	dns_proof_t *noqname;
 	dns_proof_t *closest;
 	/*%<
@@ -122,8 +129,8 @@ struct dns_slabheader {
 	 * this rdataset, if any.
 	 */
 
-	isc_stdtime_t last_used;
 	ISC_LINK(struct dns_slabheader) link;
+	ISC_LINK(struct dns_slabheader) expirelink;
 
 	/*%
 	 * Case vector.  If the bit is set then the corresponding
@@ -152,8 +159,12 @@ enum {
 	DNS_SLABHEADERATTR_CASEFULLYLOWER = 1 << 11,
 	DNS_SLABHEADERATTR_ANCIENT = 1 << 12,
 	DNS_SLABHEADERATTR_STALE_WINDOW = 1 << 13,
+	DNS_SLABHEADERATTR_VISITED = 1 << 14,
+	DNS_SLABHEADERATTR_PREFETCHED = 1 << 15,
 };
 
+#define DNS_SLABHEADER_MAXHITS 255
+
 #define DNS_SLABHEADER_GETATTR(header, attribute) \
 	(atomic_load_acquire(&(header)->attributes) & attribute)
 #define DNS_SLABHEADER_SETATTR(header, attribute) \
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/rendercache.h
+ * \brief
+ * Defines dns_rendercache_t, a cache of the answer, authority and
+ * additional sections of responses in wire format, for the answers
+ * given from a zone.
+ *
+ * Notes:
+ *\li	The sections of a response are stored exactly as they were
+ *	rendered, including the compression pointers, which may point
+ *	into the header and the question section.  They can thus only be
+ *	reused after a header and a question section of the same length,
+ *	i.e. for a question with the same name (compared case-sensitively
+ *	if the question name was used for compression), type and class.
+ *	The rest of the key identifying a cached answer (anything that
+ *	changes the rendered response, e.g. the DO bit or the size of the
+ *	client buffer) is opaque to the cache and is built by the caller.
+ *
+ *\li	The cached answers are only valid for one version of one zone
+ *	database.  Looking up a different version misses, and adding an
+ *	answer for a different version flushes the cache, so that the
+ *	answers are invalidated as soon as a new version of the zone is
+ *	committed and used to answer queries.
+ *
+ *\li	The cache is a fixed size table with one answer per slot; an
+ *	answer is replaced by any later answer hashed to the same slot.
+ *
+ * MP:
+ *\li	The cache is internally locked; the answers are reference
+ *	counted and read-only.
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <inttypes.h>
+
+#include <isc/refcount.h>
+
+#include <dns/message.h>
+#include <dns/types.h>
+
+/***
+ ***	Types
+ ***/
+
+/*%
+ * The sections of a rendered response.
+ */
+struct dns_renderedanswer {
+	unsigned int	 magic;
+	isc_refcount_t	 references;
+	isc_mem_t	*mctx;
+	uint32_t	 hashval;
+	uint16_t	 flags;
+	dns_rcode_t	 rcode;
+	uint16_t	 counts[DNS_SECTION_MAX];
+	unsigned int	 keylen;
+	unsigned char	*key;
+	isc_region_t	 wire;
+};
+
+ISC_LANG_BEGINDECLS
+
+/***
+ ***	Functions
+ ***/
+
+void
+dns_rendercache_create(isc_mem_t *mctx, unsigned int size,
+		       dns_rendercache_t **rcp);
+/*%<
+ * Create a cache holding at most 'size' answers.  The size is rounded up
+ * to a power of two.
+ *
+ * Requires:
+ *\li	'mctx' is a valid memory context.
+ *\li	'size' is not zero.
+ *\li	'rcp' is not NULL and '*rcp' is NULL.
+ */
+
+void
+dns_rendercache_setsize(dns_rendercache_t *rc, unsigned int size);
+/*%<
+ * Resize 'rc' to hold at most 'size' answers, rounded up to a power of
+ * two.  The cache is flushed if its size changes.  Zero disables the
+ * cache.
+ *
+ * Requires:
+ *\li	'rc' is a valid cache.
+ */
+
+unsigned int
+dns_rendercache_getsize(dns_rendercache_t *rc);
+/*%<
+ * Return the number of slots of 'rc'.
+ *
+ * Requires:
+ *\li	'rc' is a valid cache.
+ */
+
+isc_result_t
+dns_rendercache_find(dns_rendercache_t *rc, dns_db_t *db,
+		     dns_dbversion_t *version, const isc_region_t *key,
+		     dns_renderedanswer_t **answerp);
+/*%<
+ * Find the answer cached for 'key' in version 'version' of 'db'.
+ *
+ * Requires:
+ *\li	'rc' is a valid cache.
+ *\li	'db' is a valid database and 'version' is one of its versions.
+ *\li	'key' is not NULL.
+ *\li	'answerp' is not NULL and '*answerp' is NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS	'*answerp' is attached to the answer.
+ *\li	#ISC_R_NOTFOUND
+ *\li	#ISC_R_DISABLED	the size of the cache is zero.
+ */
+
+void
+dns_rendercache_add(dns_rendercache_t *rc, dns_db_t *db,
+		    dns_dbversion_t *version, const isc_region_t *key,
+		    dns_message_t *msg, const isc_region_t *wire);
+/*%<
+ * Cache the sections in 'wire', rendered from version 'version' of 'db'
+ * into 'msg', under 'key'.  The flags, rcode and section counts of the
+ * answer are taken from 'msg', which must not have an OPT, TSIG or
+ * SIG(0) record rendered yet.  The RA flag is not stored.
+ *
+ * If the cache holds answers for another database or version, they are
+ * flushed first.  Nothing is done if the size of the cache is zero.
+ *
+ * Requires:
+ *\li	'rc' is a valid cache.
+ *\li	'db' is a valid database and 'version' is one of its versions.
+ *\li	'key' and 'wire' are not NULL.
+ *\li	'msg' is a valid message being rendered.
+ */
+
+void
+dns_rendercache_flush(dns_rendercache_t *rc);
+/*%<
+ * Flush all the answers of 'rc' and release the database version it
+ * refers to.
+ *
+ * Requires:
+ *\li	'rc' is a valid cache.
+ */
+
+ISC_REFCOUNT_DECL(dns_rendercache);
+ISC_REFCOUNT_DECL(dns_renderedanswer);
+
+ISC_LANG_ENDDECLS
@@ -370,6 +370,39 @@ dns_resolver_destroyfetch(dns_fetch_t **fetchp);
  *\li	*fetchp == NULL.
  */
 
+isc_result_t
+dns_resolver_refresh(dns_resolver_t *res, const dns_name_t *name,
+		     dns_rdatatype_t type, unsigned int options,
+		     isc_quota_t *quota, isc_loop_t *loop);
+/*%<
+ * Refresh the stale RRset 'name'/'type' in the view's cache in the
+ * background, after a stale answer was given for it.  The fetch is
+ * run on 'loop' with 'options', and is not tied to any client.
+ *
+ * At most one refresh of an RRset (with the same 'options') is running
+ * at any time.  If the refresh fails, the stale-refresh-time window is
+ * started for the RRset.
+ *
+ * If 'quota' is not NULL, a unit of it is held while the refresh runs,
+ * and the refresh is not started if the soft limit of 'quota' has been
+ * reached.
+ *
+ * Requires:
+ *
+ *\li	'res' is a valid, frozen resolver.
+ *
+ *\li	'name' is a valid name.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS			the refresh was started
+ *\li	#ISC_R_EXISTS			a refresh of the RRset is running
+ *\li	#ISC_R_QUOTA			'quota' is exhausted
+ *\li	#ISC_R_SHUTTINGDOWN		the resolver is shutting down
+ *
+ *\li	Other results from dns_resolver_createfetch() are possible.
+ */
+
 void
 dns_resolver_logfetch(dns_fetch_t *fetch, isc_log_t *lctx,
 		      isc_logcategory_t *category, isc_logmodule_t *module,
@@ -553,6 +586,23 @@ dns_resolver_setnonbackofftries(dns_resolver_t *resolver, unsigned int tries);
  * \li  tries > 0.
  */
 
+unsigned int
+dns_resolver_gethedgepercent(dns_resolver_t *resolver);
+
+void
+dns_resolver_sethedgepercent(dns_resolver_t *resolver, unsigned int percent);
+/*%<
+ * Sets how many hedged queries, as a percentage of all the queries
+ * sent, the resolver may send.  A hedged query is sent to the next
+ * server of a fetch when the server queried first has not answered
+ * within its smoothed round-trip time, and the first answer to either
+ * query is used.  Defaults to 0, which disables hedged queries.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ * \li  percent <= 100.
+ */
+
 unsigned int
 dns_resolver_getoptions(dns_resolver_t *resolver);
 /*%<
@@ -589,7 +639,8 @@ void
 dns_resolver_flushbadcache(dns_resolver_t *resolver, const dns_name_t *name);
 /*%<
  * Flush the bad cache of all entries at 'name' if 'name' is non NULL.
- * Flush the entire bad cache if 'name' is NULL.
+ * Flush the entire bad cache if 'name' is NULL.  The names known not
+ * to be zone cuts for QNAME minimization are flushed likewise.
  *
  * Requires:
  * \li	resolver to be valid.
@@ -598,7 +649,8 @@ dns_resolver_flushbadcache(dns_resolver_t *resolver, const dns_name_t *name);
 void
 dns_resolver_flushbadnames(dns_resolver_t *resolver, const dns_name_t *name);
 /*%<
- * Flush the bad cache of all entries at or below 'name'.
+ * Flush the bad cache, and the names known not to be zone cuts for
+ * QNAME minimization, of all entries at or below 'name'.
  *
  * Requires:
  * \li	resolver to be valid.
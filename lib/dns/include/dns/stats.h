@@ -74,7 +74,14 @@ enum {
 	dns_resstatscounter_clientquota = 43,
 	dns_resstatscounter_nextitem = 44,
 	dns_resstatscounter_priming = 45,
-	dns_resstatscounter_max = 46,
+	dns_resstatscounter_dispsockreuse = 46,
+	dns_resstatscounter_hedge = 47,
+	dns_resstatscounter_hedgewin = 48,
+	dns_resstatscounter_stalerefresh = 49,
+	dns_resstatscounter_stalerefreshdup = 50,
+	dns_resstatscounter_qminskip = 51,
+	dns_resstatscounter_stalerefreshquota = 52,
+	dns_resstatscounter_max = 53,
 
 	/*
 	 * DNSSEC stats.
@@ -112,8 +119,9 @@ enum {
 	dns_adbstats_entriescnt = 1,
 	dns_adbstats_nnames = 2,
 	dns_adbstats_namescnt = 3,
+	dns_adbstats_unhealthy = 4,
 
-	dns_adbstats_max = 4,
+	dns_adbstats_max = 5,
 
 	/*
 	 * Cache statistics values.
@@ -125,8 +133,11 @@ enum {
 	dns_cachestatscounter_deletelru = 5,
 	dns_cachestatscounter_deletettl = 6,
 	dns_cachestatscounter_coveringnsec = 7,
+	dns_cachestatscounter_reclaimttl = 8,
+	dns_cachestatscounter_prefetched = 9,
+	dns_cachestatscounter_prefetchused = 10,
 
-	dns_cachestatscounter_max = 8,
+	dns_cachestatscounter_max = 11,
 
 	/*%
 	 * Query statistics counters (obsolete).
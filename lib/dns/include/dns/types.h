@@ -114,6 +114,7 @@ typedef struct dns_masterrawheader dns_masterrawheader_t;
 typedef uint64_t		   dns_masterstyle_flags_t;
 typedef struct dns_message	   dns_message_t;
 typedef uint16_t		   dns_messageid_t;
+typedef struct dns_messagepool	   dns_messagepool_t;
 typedef isc_region_t		   dns_label_t;
 typedef struct dns_name		   dns_name_t;
 typedef struct dns_nametree	   dns_nametree_t;
@@ -140,6 +141,8 @@ typedef ISC_LIST(dns_rdataset_t) dns_rdatasetlist_t;
 typedef struct dns_rdatasetiter dns_rdatasetiter_t;
 typedef uint16_t		dns_rdatatype_t;
 typedef struct dns_remote	dns_remote_t;
+typedef struct dns_rendercache	dns_rendercache_t;
+typedef struct dns_renderedanswer dns_renderedanswer_t;
 typedef struct dns_request	dns_request_t;
 typedef struct dns_requestmgr	dns_requestmgr_t;
 typedef struct dns_resolver	dns_resolver_t;
@@ -334,6 +334,27 @@ dns_zone_setmaxrecords(dns_zone_t *zone, uint32_t records);
  *\li	void
  */
 
+void
+dns_zone_setrendercachesize(dns_zone_t *zone, uint32_t size);
+/*%<
+ * 	Sets the maximum number of rendered answers cached for 'zone',
+ *	and flushes the answers already cached.  0 disables the cache.
+ *
+ * Requires:
+ *\li	'zone' to be valid initialised zone.
+ */
+
+dns_rendercache_t *
+dns_zone_getrendercache(dns_zone_t *zone);
+/*%<
+ * 	Gets the cache of the rendered answers of 'zone', or NULL if
+ *	dns_zone_setrendercachesize() was never called with a non-zero
+ *	size.  The cache stays valid as long as 'zone' does.
+ *
+ * Requires:
+ *\li	'zone' to be valid initialised zone.
+ */
+
 uint32_t
 dns_zone_getmaxrecords(dns_zone_t *zone);
 /*%<
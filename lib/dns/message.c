@@ -21,10 +21,12 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/mem.h>
 #include <isc/result.h>
 #include <isc/string.h>
+#include <isc/tid.h>
 #include <isc/utf8.h>
 #include <isc/util.h>
 
@@ -39,6 +41,7 @@
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatastruct.h>
+#include <dns/rendercache.h>
 #include <dns/soa.h>
 #include <dns/tsig.h>
 #include <dns/ttl.h>
@@ -118,6 +121,25 @@ hexdump(const char *msg, const char *msg2, void *base, size_t len) {
 #define RDATASET_FILLCOUNT 4
 #define RDATASET_FREEMAX   8 * RDATASET_FILLCOUNT
 
+#define MESSAGEPOOL_MAGIC    ISC_MAGIC('M', 's', 'g', 'P')
+#define VALID_MESSAGEPOOL(p) ISC_MAGIC_VALID(p, MESSAGEPOOL_MAGIC)
+
+/*%
+ * A per-loop free list of reset messages.  The owner of the pool and
+ * every message created from it that is not on the free list hold a
+ * reference to the pool.
+ */
+struct dns_messagepool {
+	unsigned int magic;
+	isc_refcount_t references;
+	isc_mem_t *mctx;
+	uint32_t tid;
+	unsigned int maxfree;
+	unsigned int nfree;
+	atomic_bool exiting;
+	ISC_LIST(dns_message_t) free;
+};
+
 /*%
  * Text representation of the different items, for message_totext
  * functions.
@@ -730,6 +752,7 @@ dns_message_create(isc_mem_t *mctx, unsigned int intent, dns_message_t **msgp) {
 	ISC_LIST_INIT(m->offsets);
 	ISC_LIST_INIT(m->freerdata);
 	ISC_LIST_INIT(m->freerdatalist);
+	ISC_LINK_INIT(m, link);
 
 	isc_mempool_create(m->mctx, sizeof(dns_fixedname_t), &m->namepool);
 	isc_mempool_setfillcount(m->namepool, NAME_FILLCOUNT);
@@ -760,6 +783,9 @@ dns_message_reset(dns_message_t *msg, unsigned int intent) {
 	msg->from_to_wire = intent;
 }
 
+static void
+messagepool_detach(dns_messagepool_t **poolp);
+
 static void
 dns__message_destroy(dns_message_t *msg) {
 	REQUIRE(msg != NULL);
@@ -770,9 +796,123 @@ dns__message_destroy(dns_message_t *msg) {
 	isc_mempool_destroy(&msg->rdspool);
 	isc_refcount_destroy(&msg->refcount);
 	msg->magic = 0;
+	if (msg->pool != NULL) {
+		messagepool_detach(&msg->pool);
+	}
 	isc_mem_putanddetach(&msg->mctx, msg, sizeof(dns_message_t));
 }
 
+/*
+ * Put a message whose last reference has just been released back on
+ * the free list of its pool, if possible.
+ */
+static bool
+message_recycle(dns_message_t *msg) {
+	dns_messagepool_t *pool = msg->pool;
+
+	if (pool->tid != isc_tid() || pool->nfree >= pool->maxfree ||
+	    atomic_load_acquire(&pool->exiting))
+	{
+		return (false);
+	}
+
+	msgreset(msg, false);
+
+	/*
+	 * Clear what dns_message_reset() leaves to the caller.
+	 */
+	msg->cctx = NULL;
+	msg->cc_echoed = 0;
+	msg->fuzzing = 0;
+	msg->fuzztime = 0;
+	memset(msg->minttl, 0, sizeof(msg->minttl));
+
+	ISC_LIST_PREPEND(pool->free, msg, link);
+	pool->nfree++;
+	msg->pool = NULL;
+	messagepool_detach(&pool);
+
+	return (true);
+}
+
+void
+dns_messagepool_create(isc_mem_t *mctx, uint32_t tid, unsigned int maxfree,
+		       dns_messagepool_t **poolp) {
+	dns_messagepool_t *pool = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(poolp != NULL && *poolp == NULL);
+
+	pool = isc_mem_get(mctx, sizeof(*pool));
+	*pool = (dns_messagepool_t){
+		.tid = tid,
+		.maxfree = maxfree,
+		.free = ISC_LIST_INITIALIZER,
+	};
+	isc_mem_attach(mctx, &pool->mctx);
+	isc_refcount_init(&pool->references, 1);
+	pool->magic = MESSAGEPOOL_MAGIC;
+
+	*poolp = pool;
+}
+
+static void
+messagepool_detach(dns_messagepool_t **poolp) {
+	dns_messagepool_t *pool = *poolp;
+	dns_message_t *msg = NULL;
+
+	*poolp = NULL;
+
+	if (isc_refcount_decrement(&pool->references) > 1) {
+		return;
+	}
+
+	isc_refcount_destroy(&pool->references);
+	pool->magic = 0;
+	while ((msg = ISC_LIST_HEAD(pool->free)) != NULL) {
+		ISC_LIST_UNLINK(pool->free, msg, link);
+		pool->nfree--;
+		dns__message_destroy(msg);
+	}
+	INSIST(pool->nfree == 0);
+	isc_mem_putanddetach(&pool->mctx, pool, sizeof(*pool));
+}
+
+void
+dns_messagepool_destroy(dns_messagepool_t **poolp) {
+	REQUIRE(poolp != NULL && VALID_MESSAGEPOOL(*poolp));
+
+	atomic_store_release(&(*poolp)->exiting, true);
+	messagepool_detach(poolp);
+}
+
+void
+dns_message_createpooled(dns_messagepool_t *pool, unsigned int intent,
+			 dns_message_t **msgp) {
+	dns_message_t *msg = NULL;
+
+	REQUIRE(VALID_MESSAGEPOOL(pool));
+	REQUIRE(pool->tid == isc_tid());
+	REQUIRE(msgp != NULL && *msgp == NULL);
+	REQUIRE(intent == DNS_MESSAGE_INTENTPARSE ||
+		intent == DNS_MESSAGE_INTENTRENDER);
+
+	msg = ISC_LIST_HEAD(pool->free);
+	if (msg != NULL) {
+		ISC_LIST_UNLINK(pool->free, msg, link);
+		pool->nfree--;
+		msg->from_to_wire = intent;
+		isc_refcount_init(&msg->refcount, 1);
+	} else {
+		dns_message_create(pool->mctx, intent, &msg);
+	}
+
+	isc_refcount_increment(&pool->references);
+	msg->pool = pool;
+
+	*msgp = msg;
+}
+
 void
 dns_message_attach(dns_message_t *source, dns_message_t **target) {
 	REQUIRE(DNS_MESSAGE_VALID(source));
@@ -788,6 +928,9 @@ dns_message_detach(dns_message_t **messagep) {
 	*messagep = NULL;
 
 	if (isc_refcount_decrement(&msg->refcount) == 1) {
+		if (msg->pool != NULL && message_recycle(msg)) {
+			return;
+		}
 		dns__message_destroy(msg);
 	}
 }
@@ -1631,6 +1774,163 @@ cleanup:
 	return (result);
 }
 
+/*
+ * Parse the question and the optional OPT record of a message that has
+ * the shape of a plain query: a single question and nothing else but an
+ * OPT record in the additional section.  This is what almost every
+ * query received by a server looks like, and it does not need most of
+ * the work done by getquestions() and getsection(): the question name
+ * cannot be compressed, so it is validated and copied into the buffer
+ * of its dns_fixedname_t in a single pass, which also fills in its
+ * offsets, and the lists of a section with a single entry need no
+ * duplicate checks.
+ *
+ * If the message does not have this shape, or is malformed in any way
+ * that would be detected before the OPT rdata, DNS_R_CONTINUE is
+ * returned without any change to 'source' or 'msg', and the message
+ * must be parsed by the general code, which reports the errors.
+ */
+static isc_result_t
+getquery(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t dctx) {
+	isc_region_t r;
+	unsigned int namelen = 0, labels = 0, rdatalen = 0;
+	unsigned char offsets[DNS_NAME_MAXLABELS];
+	dns_rdatatype_t rdtype;
+	dns_rdataclass_t rdclass;
+	dns_rdatatype_t opttype;
+	dns_rdataclass_t optclass = 0;
+	dns_ttl_t optttl = 0;
+	dns_name_t *name = NULL;
+	dns_rdataset_t *rdataset = NULL;
+	dns_rdatalist_t *rdatalist = NULL;
+	dns_rdata_t *rdata = NULL;
+	isc_result_t result;
+
+	if (msg->opcode != dns_opcode_query ||
+	    (msg->flags & DNS_MESSAGEFLAG_QR) != 0 ||
+	    msg->counts[DNS_SECTION_QUESTION] != 1 ||
+	    msg->counts[DNS_SECTION_ANSWER] != 0 ||
+	    msg->counts[DNS_SECTION_AUTHORITY] != 0 ||
+	    msg->counts[DNS_SECTION_ADDITIONAL] > 1)
+	{
+		return (DNS_R_CONTINUE);
+	}
+
+	isc_buffer_remainingregion(source, &r);
+
+	/*
+	 * Walk the labels of the question name; anything but ordinary
+	 * labels (a compression pointer, in particular) is left to the
+	 * general code.
+	 */
+	for (;;) {
+		unsigned int len;
+
+		if (namelen >= r.length) {
+			return (DNS_R_CONTINUE);
+		}
+		len = r.base[namelen];
+		if (len > DNS_NAME_LABELLEN) {
+			return (DNS_R_CONTINUE);
+		}
+		offsets[labels++] = namelen;
+		namelen += len + 1;
+		if (namelen > DNS_NAME_MAXWIRE) {
+			return (DNS_R_CONTINUE);
+		}
+		if (len == 0) {
+			break;
+		}
+	}
+
+	if (r.length - namelen < 4) {
+		return (DNS_R_CONTINUE);
+	}
+	rdtype = (r.base[namelen] << 8) | r.base[namelen + 1];
+	rdclass = (r.base[namelen + 2] << 8) | r.base[namelen + 3];
+
+	if (msg->counts[DNS_SECTION_ADDITIONAL] == 1) {
+		unsigned char *opt = r.base + namelen + 4;
+		unsigned int optlen = r.length - namelen - 4;
+
+		if (optlen < 11 || opt[0] != 0) {
+			return (DNS_R_CONTINUE);
+		}
+		opttype = (opt[1] << 8) | opt[2];
+		optclass = (opt[3] << 8) | opt[4];
+		optttl = ((dns_ttl_t)opt[5] << 24) | (opt[6] << 16) |
+			 (opt[7] << 8) | opt[8];
+		rdatalen = (opt[9] << 8) | opt[10];
+		if (opttype != dns_rdatatype_opt || optlen - 11 < rdatalen) {
+			return (DNS_R_CONTINUE);
+		}
+	}
+
+	/*
+	 * The question.
+	 */
+	dns_message_gettempname(msg, &name);
+	isc_buffer_clear(name->buffer);
+	name->ndata = isc_buffer_base(name->buffer);
+	memmove(name->ndata, r.base, namelen);
+	isc_buffer_add(name->buffer, namelen);
+	name->length = namelen;
+	name->labels = labels;
+	name->attributes.absolute = true;
+	memmove(name->offsets, offsets, labels);
+	ISC_LIST_APPEND(msg->sections[DNS_SECTION_QUESTION], name, link);
+	isc_buffer_forward(source, namelen + 4);
+
+	msg->rdclass = rdclass;
+	msg->rdclass_set = 1;
+	if (rdtype == dns_rdatatype_tkey) {
+		msg->tkey = 1;
+	}
+
+	rdatalist = newrdatalist(msg);
+	rdatalist->type = rdtype;
+	rdatalist->rdclass = rdclass;
+	rdataset = isc_mempool_get(msg->rdspool);
+	dns_rdataset_init(rdataset);
+	dns_rdatalist_tordataset(rdatalist, rdataset);
+	rdataset->attributes |= DNS_RDATASETATTR_QUESTION;
+	ISC_LIST_APPEND(name->list, rdataset, link);
+
+	msg->question_ok = 1;
+
+	if (msg->counts[DNS_SECTION_ADDITIONAL] == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	/*
+	 * The OPT record.  Its rdata is checked by dns_rdata_fromwire()
+	 * as usual.
+	 */
+	isc_buffer_forward(source, 11);
+	rdata = newrdata(msg);
+	result = getrdata(source, msg, dctx, optclass, dns_rdatatype_opt,
+			  rdatalen, rdata);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	rdata->rdclass = optclass;
+
+	rdatalist = newrdatalist(msg);
+	rdatalist->type = dns_rdatatype_opt;
+	rdatalist->rdclass = optclass;
+	rdatalist->ttl = optttl;
+	ISC_LIST_APPEND(rdatalist->rdata, rdata, link);
+	rdataset = isc_mempool_get(msg->rdspool);
+	dns_rdataset_init(rdataset);
+	dns_rdatalist_tordataset(rdatalist, rdataset);
+
+	msg->opt = rdataset;
+	msg->rcode |= (dns_rcode_t)((optttl & DNS_MESSAGE_EDNSRCODE_MASK) >>
+				    20);
+
+	return (ISC_R_SUCCESS);
+}
+
 isc_result_t
 dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 		  unsigned int options) {
@@ -1685,6 +1985,17 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 
 	dctx = DNS_DECOMPRESS_ALWAYS;
 
+	ret = getquery(source, msg, dctx);
+	if (ret == ISC_R_UNEXPECTEDEND && ignore_tc) {
+		goto truncated;
+	}
+	if (ret == ISC_R_SUCCESS) {
+		goto done;
+	}
+	if (ret != DNS_R_CONTINUE) {
+		return (ret);
+	}
+
 	ret = getquestions(source, msg, dctx, options);
 	if (ret == ISC_R_UNEXPECTEDEND && ignore_tc) {
 		goto truncated;
@@ -1734,6 +2045,7 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 		return (ret);
 	}
 
+done:
 	isc_buffer_remainingregion(source, &r);
 	if (r.length != 0) {
 		isc_log_write(dns_lctx, ISC_LOGCATEGORY_GENERAL,
@@ -2143,6 +2455,32 @@ dns_message_rendersection(dns_message_t *msg, dns_section_t sectionid,
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+dns_message_renderanswer(dns_message_t *msg,
+			 const dns_renderedanswer_t *answer) {
+	REQUIRE(DNS_MESSAGE_VALID(msg));
+	REQUIRE(msg->buffer != NULL);
+	REQUIRE(answer != NULL);
+	REQUIRE(msg->counts[DNS_SECTION_ANSWER] == 0 &&
+		msg->counts[DNS_SECTION_AUTHORITY] == 0 &&
+		msg->counts[DNS_SECTION_ADDITIONAL] == 0);
+
+	if (msg->buffer->length - msg->buffer->used <
+	    msg->reserved + answer->wire.length)
+	{
+		return (ISC_R_NOSPACE);
+	}
+
+	isc_buffer_putmem(msg->buffer, answer->wire.base, answer->wire.length);
+	msg->counts[DNS_SECTION_ANSWER] = answer->counts[DNS_SECTION_ANSWER];
+	msg->counts[DNS_SECTION_AUTHORITY] =
+		answer->counts[DNS_SECTION_AUTHORITY];
+	msg->counts[DNS_SECTION_ADDITIONAL] =
+		answer->counts[DNS_SECTION_ADDITIONAL];
+
+	return (ISC_R_SUCCESS);
+}
+
 void
 dns_message_renderheader(dns_message_t *msg, isc_buffer_t *target) {
 	uint16_t tmp;
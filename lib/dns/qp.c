@@ -1905,4 +1905,95 @@ dns_qp_findname_ancestor(dns_qpreadable_t qpr, const dns_name_t *name,
 	return (ISC_R_NOTFOUND);
 }
 
+isc_result_t
+dns_qp_findname_predecessor(dns_qpreadable_t qpr, const dns_name_t *name,
+			    void **pval_r, uint32_t *ival_r) {
+	dns_qpreader_t *qp = dns_qpreader(qpr);
+	dns_qpkey_t search, found;
+	size_t searchlen, foundlen;
+	size_t offset;
+	qp_shift_t bit;
+	qp_weight_t pos;
+	qp_node_t *n = NULL, *twigs = NULL, *left = NULL;
+
+	REQUIRE(QP_VALID(qp));
+
+	searchlen = dns_qpkey_fromname(search, name);
+
+	n = get_root(qp);
+	if (n == NULL) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	/*
+	 * Like `dns_qp_insert()`, first find a leaf that matches as much of
+	 * the search key as possible, to discover the offset where the
+	 * search key differs from the keys in the trie.
+	 */
+	while (is_branch(n)) {
+		prefetch_twigs(qp, n);
+		bit = branch_keybit(n, search, searchlen);
+		if (branch_has_twig(n, bit)) {
+			n = branch_twig_ptr(qp, n, bit);
+		} else {
+			/* any twig will do */
+			n = branch_twigs_vector(qp, n);
+		}
+	}
+
+	foundlen = leaf_qpkey(qp, n, found);
+	offset = qpkey_compare(search, searchlen, found, foundlen);
+	if (offset == QPKEY_EQUAL) {
+		SET_IF_NOT_NULL(pval_r, leaf_pval(n));
+		SET_IF_NOT_NULL(ival_r, leaf_ival(n));
+		return (ISC_R_SUCCESS);
+	}
+
+	/*
+	 * Then walk down again through the branches that test the common
+	 * prefix, remembering the nearest twig to the left of the path:
+	 * all the keys under that twig are less than the search key.
+	 */
+	n = get_root(qp);
+	while (is_branch(n) && branch_key_offset(n) < offset) {
+		bit = branch_keybit(n, search, searchlen);
+		INSIST(branch_has_twig(n, bit));
+		twigs = branch_twigs_vector(qp, n);
+		pos = branch_twig_pos(n, bit);
+		if (pos > 0) {
+			left = &twigs[pos - 1];
+		}
+		n = &twigs[pos];
+	}
+
+	if (is_branch(n) && branch_key_offset(n) == offset) {
+		/* the search key falls between the twigs of this branch */
+		bit = branch_keybit(n, search, searchlen);
+		pos = branch_twig_pos(n, bit);
+		if (pos > 0) {
+			left = &branch_twigs_vector(qp, n)[pos - 1];
+		}
+	} else if (qpkey_bit(search, searchlen, offset) >
+		   qpkey_bit(found, foundlen, offset))
+	{
+		/* the search key is greater than every key below here */
+		left = n;
+	}
+
+	if (left == NULL) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	/* the predecessor is the greatest leaf under the left twig */
+	n = left;
+	while (is_branch(n)) {
+		twigs = branch_twigs_vector(qp, n);
+		n = &twigs[branch_twigs_size(n) - 1];
+	}
+
+	SET_IF_NOT_NULL(pval_r, leaf_pval(n));
+	SET_IF_NOT_NULL(ival_r, leaf_ival(n));
+	return (DNS_R_PARTIALMATCH);
+}
+
 /**********************************************************************/
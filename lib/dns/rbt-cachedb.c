@@ -70,20 +70,6 @@
 			goto failure;        \
 	} while (0)
 
-/*%
- * Whether to rate-limit updating the LRU to avoid possible thread contention.
- * Updating LRU requires write locking, so we don't do it every time the
- * record is touched - only after some time passes.
- */
-#ifndef DNS_RBTDB_LIMITLRUUPDATE
-#define DNS_RBTDB_LIMITLRUUPDATE 1
-#endif
-
-/*% Time after which we update LRU for glue records, 5 minutes */
-#define DNS_RBTDB_LRUUPDATE_GLUE 300
-/*% Time after which we update LRU for all other records, 10 minutes */
-#define DNS_RBTDB_LRUUPDATE_REGULAR 600
-
 #define EXISTS(header)                                 \
 	((atomic_load_acquire(&(header)->attributes) & \
 	  DNS_SLABHEADERATTR_NONEXISTENT) == 0)
@@ -117,79 +103,60 @@
 
 #define KEEPSTALE(rbtdb) ((rbtdb)->common.serve_stale_ttl > 0)
 
+/*
+ * The NSEC index holds the owner names of the NSEC records in the cache,
+ * so that aggressive negative caching (RFC 8198) can find the NSEC that
+ * covers a name without taking the tree lock.
+ */
+typedef struct nsecname {
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	dns_name_t name;
+} nsecname_t;
+
 /*%
  * Routines for LRU-based cache management.
+ *
+ * The LRU lists are managed with the SIEVE algorithm: headers are added
+ * at the head of the list of their bucket and never moved; using a
+ * header only sets its VISITED attribute.  When memory is needed,
+ * expire_lru_headers() moves the hand of the bucket from the tail
+ * towards the head, clearing the VISITED attribute of the headers it
+ * passes and expiring the first header that was not visited.  Recently
+ * used headers thus survive for one more pass of the hand, without
+ * requiring a write lock on the node to be taken when they are used.
  */
 
 /*%
- * See if a given cache entry that is being reused needs to be updated
- * in the LRU-list.  From the LRU management point of view, this function is
- * expected to return true for almost all cases.  When used with threads,
- * however, this may cause a non-negligible performance penalty because a
- * writer lock will have to be acquired before updating the list.
- * If DNS_RBTDB_LIMITLRUUPDATE is defined to be non 0 at compilation time, this
- * function returns true if the entry has not been updated for some period of
- * time.  We differentiate the NS or glue address case and the others since
- * experiments have shown that the former tends to be accessed relatively
- * infrequently and the cost of cache miss is higher (e.g., a missing NS records
- * may cause external queries at a higher level zone, involving more
- * transactions).
+ * Mark a cache entry that is being reused as visited, and count the hit.
+ * The attribute is only set if it isn't set yet, and the hit count stops
+ * at DNS_SLABHEADER_MAXHITS, to avoid writing to the header on every use
+ * of a popular entry.  The first use of an entry that was refreshed by
+ * a prefetch is counted in the cache statistics.
  *
  * Caller must hold the node (read or write) lock.
  */
-static bool
-need_headerupdate(dns_slabheader_t *header, isc_stdtime_t now) {
-	if (DNS_SLABHEADER_GETATTR(header, (DNS_SLABHEADERATTR_NONEXISTENT |
+static void
+mark_used(dns_rbtdb_t *rbtdb, dns_slabheader_t *header) {
+	if (DNS_SLABHEADER_GETATTR(header, (DNS_SLABHEADERATTR_VISITED |
+					    DNS_SLABHEADERATTR_NONEXISTENT |
 					    DNS_SLABHEADERATTR_ANCIENT |
-					    DNS_SLABHEADERATTR_ZEROTTL)) != 0)
+					    DNS_SLABHEADERATTR_ZEROTTL)) == 0)
 	{
-		return (false);
+		DNS_SLABHEADER_SETATTR(header, DNS_SLABHEADERATTR_VISITED);
 	}
-
-#if DNS_RBTDB_LIMITLRUUPDATE
-	if (header->type == dns_rdatatype_ns ||
-	    (header->trust == dns_trust_glue &&
-	     (header->type == dns_rdatatype_a ||
-	      header->type == dns_rdatatype_aaaa)))
+	if (atomic_load_relaxed(&header->hits) < DNS_SLABHEADER_MAXHITS) {
+		atomic_fetch_add_relaxed(&header->hits, 1);
+	}
+	if (DNS_SLABHEADER_GETATTR(header, DNS_SLABHEADERATTR_PREFETCHED) !=
+		    0 &&
+	    (DNS_SLABHEADER_CLRATTR(header, DNS_SLABHEADERATTR_PREFETCHED) &
+	     DNS_SLABHEADERATTR_PREFETCHED) != 0 &&
+	    rbtdb->cachestats != NULL)
 	{
-		/*
-		 * Glue records are updated if at least DNS_RBTDB_LRUUPDATE_GLUE
-		 * seconds have passed since the previous update time.
-		 */
-		return (header->last_used + DNS_RBTDB_LRUUPDATE_GLUE <= now);
+		isc_stats_increment(rbtdb->cachestats,
+				    dns_cachestatscounter_prefetchused);
 	}
-
-	/*
-	 * Other records are updated if DNS_RBTDB_LRUUPDATE_REGULAR seconds
-	 * have passed.
-	 */
-	return (header->last_used + DNS_RBTDB_LRUUPDATE_REGULAR <= now);
-#else
-	UNUSED(now);
-
-	return (true);
-#endif /* if DNS_RBTDB_LIMITLRUUPDATE */
-}
-
-/*%
- * Update the timestamp of a given cache entry and move it to the head
- * of the corresponding LRU list.
- *
- * Caller must hold the node (write) lock.
- *
- * Note that the we do NOT touch the heap here, as the TTL has not changed.
- */
-static void
-update_header(dns_rbtdb_t *rbtdb, dns_slabheader_t *header, isc_stdtime_t now) {
-	INSIST(IS_CACHE(rbtdb));
-
-	/* To be checked: can we really assume this? XXXMLG */
-	INSIST(ISC_LINK_LINKED(header, link));
-
-	ISC_LIST_UNLINK(rbtdb->lru[HEADER_NODE(header)->locknum], header, link);
-	header->last_used = now;
-	ISC_LIST_PREPEND(rbtdb->lru[HEADER_NODE(header)->locknum], header,
-			 link);
 }
 
 /*
@@ -602,24 +569,9 @@ find_deepest_zonecut(rbtdb_search_t *search, dns_rbtnode_t *node,
 					search->now, nlocktype,
 					sigrdataset DNS__DB_FLARG_PASS);
 			}
-			if (need_headerupdate(found, search->now) ||
-			    (foundsig != NULL &&
-			     need_headerupdate(foundsig, search->now)))
-			{
-				if (nlocktype != isc_rwlocktype_write) {
-					NODE_FORCEUPGRADE(lock, &nlocktype);
-					POST(nlocktype);
-				}
-				if (need_headerupdate(found, search->now)) {
-					update_header(search->rbtdb, found,
-						      search->now);
-				}
-				if (foundsig != NULL &&
-				    need_headerupdate(foundsig, search->now))
-				{
-					update_header(search->rbtdb, foundsig,
-						      search->now);
-				}
+			mark_used(search->rbtdb, found);
+			if (foundsig != NULL) {
+				mark_used(search->rbtdb, foundsig);
 			}
 		}
 
@@ -639,8 +591,8 @@ find_deepest_zonecut(rbtdb_search_t *search, dns_rbtnode_t *node,
 
 /*
  * Look for a potentially covering NSEC in the cache where `name`
- * is known not to exist.  This uses the auxiliary NSEC tree to find
- * the potential NSEC owner. If found, we update 'foundname', 'nodep',
+ * is known not to exist.  This uses the NSEC index to find the
+ * potential NSEC owner. If found, we update 'foundname', 'nodep',
  * 'rdataset' and 'sigrdataset', and return DNS_R_COVERINGNSEC.
  * Otherwise, return ISC_R_NOTFOUND.
  */
@@ -649,11 +601,11 @@ find_coveringnsec(rbtdb_search_t *search, const dns_name_t *name,
 		  dns_dbnode_t **nodep, isc_stdtime_t now,
 		  dns_name_t *foundname, dns_rdataset_t *rdataset,
 		  dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
-	dns_fixedname_t fprefix, forigin, ftarget, fixed;
-	dns_name_t *prefix = NULL, *origin = NULL;
+	dns_fixedname_t ftarget, fixed;
 	dns_name_t *target = NULL, *fname = NULL;
 	dns_rbtnode_t *node = NULL;
-	dns_rbtnodechain_t chain;
+	dns_qpread_t qpr;
+	void *pval = NULL;
 	isc_result_t result;
 	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
 	isc_rwlock_t *lock = NULL;
@@ -663,44 +615,31 @@ find_coveringnsec(rbtdb_search_t *search, const dns_name_t *name,
 	dns_slabheader_t *header_next = NULL, *header_prev = NULL;
 
 	/*
-	 * Look for the node in the auxilary tree.
+	 * Look for the predecessor in the NSEC index.  This does not need
+	 * the tree lock; the name is copied out before the snapshot of
+	 * the index is released.
 	 */
-	dns_rbtnodechain_init(&chain);
 	target = dns_fixedname_initname(&ftarget);
-	result = dns_rbt_findnode(search->rbtdb->nsec, name, target, &node,
-				  &chain, DNS_RBTFIND_EMPTYDATA, NULL, NULL);
+	dns_qpmulti_query(search->rbtdb->nsecindex, &qpr);
+	result = dns_qp_findname_predecessor(&qpr, name, &pval, NULL);
+	if (result == DNS_R_PARTIALMATCH) {
+		nsecname_t *nsecname = pval;
+		dns_name_copy(&nsecname->name, target);
+	}
+	dns_qpread_destroy(search->rbtdb->nsecindex, &qpr);
 	if (result != DNS_R_PARTIALMATCH) {
-		dns_rbtnodechain_reset(&chain);
 		return (ISC_R_NOTFOUND);
 	}
 
-	prefix = dns_fixedname_initname(&fprefix);
-	origin = dns_fixedname_initname(&forigin);
-	target = dns_fixedname_initname(&ftarget);
 	fname = dns_fixedname_initname(&fixed);
 
 	matchtype = DNS_TYPEPAIR_VALUE(dns_rdatatype_nsec, 0);
 	sigmatchtype = DNS_TYPEPAIR_VALUE(dns_rdatatype_rrsig,
 					  dns_rdatatype_nsec);
 
-	/*
-	 * Extract predecessor from chain.
-	 */
-	result = dns_rbtnodechain_current(&chain, prefix, origin, NULL);
-	dns_rbtnodechain_reset(&chain);
-	if (result != ISC_R_SUCCESS && result != DNS_R_NEWORIGIN) {
-		return (ISC_R_NOTFOUND);
-	}
-
-	result = dns_name_concatenate(prefix, origin, target, NULL);
-	if (result != ISC_R_SUCCESS) {
-		return (ISC_R_NOTFOUND);
-	}
-
 	/*
 	 * Lookup the predecessor in the main tree.
 	 */
-	node = NULL;
 	result = dns_rbt_findnode(search->rbtdb->tree, target, fname, &node,
 				  NULL, DNS_RBTFIND_EMPTYDATA, NULL, NULL);
 	if (result != ISC_R_SUCCESS) {
@@ -776,7 +715,6 @@ cache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 	dns_slabheader_t *header_prev = NULL, *header_next = NULL;
 	dns_slabheader_t *found = NULL, *nsheader = NULL;
 	dns_slabheader_t *foundsig = NULL, *nssig = NULL, *cnamesig = NULL;
-	dns_slabheader_t *update = NULL, *updatesig = NULL;
 	dns_slabheader_t *nsecheader = NULL, *nsecsig = NULL;
 	dns_typepair_t sigtype, negtype;
 
@@ -1005,17 +943,13 @@ cache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 			dns__rbtdb_bindrdataset(search.rbtdb, node, nsecheader,
 						search.now, nlocktype,
 						rdataset DNS__DB_FLARG_PASS);
-			if (need_headerupdate(nsecheader, search.now)) {
-				update = nsecheader;
-			}
+			mark_used(search.rbtdb, nsecheader);
 			if (nsecsig != NULL) {
 				dns__rbtdb_bindrdataset(
 					search.rbtdb, node, nsecsig, search.now,
 					nlocktype,
 					sigrdataset DNS__DB_FLARG_PASS);
-				if (need_headerupdate(nsecsig, search.now)) {
-					updatesig = nsecsig;
-				}
+				mark_used(search.rbtdb, nsecsig);
 			}
 			result = DNS_R_COVERINGNSEC;
 			goto node_exit;
@@ -1050,17 +984,13 @@ cache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 			dns__rbtdb_bindrdataset(search.rbtdb, node, nsheader,
 						search.now, nlocktype,
 						rdataset DNS__DB_FLARG_PASS);
-			if (need_headerupdate(nsheader, search.now)) {
-				update = nsheader;
-			}
+			mark_used(search.rbtdb, nsheader);
 			if (nssig != NULL) {
 				dns__rbtdb_bindrdataset(
 					search.rbtdb, node, nssig, search.now,
 					nlocktype,
 					sigrdataset DNS__DB_FLARG_PASS);
-				if (need_headerupdate(nssig, search.now)) {
-					updatesig = nssig;
-				}
+				mark_used(search.rbtdb, nssig);
 			}
 			result = DNS_R_DELEGATION;
 			goto node_exit;
@@ -1113,33 +1043,16 @@ cache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 	{
 		dns__rbtdb_bindrdataset(search.rbtdb, node, found, search.now,
 					nlocktype, rdataset DNS__DB_FLARG_PASS);
-		if (need_headerupdate(found, search.now)) {
-			update = found;
-		}
+		mark_used(search.rbtdb, found);
 		if (!NEGATIVE(found) && foundsig != NULL) {
 			dns__rbtdb_bindrdataset(search.rbtdb, node, foundsig,
 						search.now, nlocktype,
 						sigrdataset DNS__DB_FLARG_PASS);
-			if (need_headerupdate(foundsig, search.now)) {
-				updatesig = foundsig;
-			}
+			mark_used(search.rbtdb, foundsig);
 		}
 	}
 
 node_exit:
-	if ((update != NULL || updatesig != NULL) &&
-	    nlocktype != isc_rwlocktype_write)
-	{
-		NODE_FORCEUPGRADE(lock, &nlocktype);
-		POST(nlocktype);
-	}
-	if (update != NULL && need_headerupdate(update, search.now)) {
-		update_header(search.rbtdb, update, search.now);
-	}
-	if (updatesig != NULL && need_headerupdate(updatesig, search.now)) {
-		update_header(search.rbtdb, updatesig, search.now);
-	}
-
 	NODE_UNLOCK(lock, &nlocktype);
 
 tree_exit:
@@ -1305,20 +1218,9 @@ cache_findzonecut(dns_db_t *db, const dns_name_t *name, unsigned int options,
 					sigrdataset DNS__DB_FLARG_PASS);
 	}
 
-	if (need_headerupdate(found, search.now) ||
-	    (foundsig != NULL && need_headerupdate(foundsig, search.now)))
-	{
-		if (nlocktype != isc_rwlocktype_write) {
-			NODE_FORCEUPGRADE(lock, &nlocktype);
-			POST(nlocktype);
-		}
-		if (need_headerupdate(found, search.now)) {
-			update_header(search.rbtdb, found, search.now);
-		}
-		if (foundsig != NULL && need_headerupdate(foundsig, search.now))
-		{
-			update_header(search.rbtdb, foundsig, search.now);
-		}
+	mark_used(search.rbtdb, found);
+	if (foundsig != NULL) {
+		mark_used(search.rbtdb, foundsig);
 	}
 
 	NODE_UNLOCK(lock, &nlocktype);
@@ -1573,6 +1475,16 @@ dns_dbmethods_t dns__rbtdb_cachemethods = {
 	.deletedata = dns__rbtdb_deletedata,
 };
 
+static size_t
+rdataset_size(dns_slabheader_t *header) {
+	if (!NONEXISTENT(header)) {
+		return (dns_rdataslab_size((unsigned char *)header,
+					   sizeof(*header)));
+	}
+
+	return (sizeof(*header));
+}
+
 /*
  * Caller must hold the node (write) lock.
  */
@@ -1587,6 +1499,7 @@ dns__cachedb_expireheader(dns_slabheader_t *header,
 	if (isc_refcount_current(&HEADER_NODE(header)->references) == 0) {
 		isc_rwlocktype_t nlocktype = isc_rwlocktype_write;
 		dns_rbtdb_t *rbtdb = (dns_rbtdb_t *)header->db;
+		size_t size = rdataset_size(header);
 
 		/*
 		 * If no one else is using the node, we can clean it up now.
@@ -1606,6 +1519,8 @@ dns__cachedb_expireheader(dns_slabheader_t *header,
 		case dns_expire_ttl:
 			isc_stats_increment(rbtdb->cachestats,
 					    dns_cachestatscounter_deletettl);
+			isc_stats_add(rbtdb->cachestats,
+				      dns_cachestatscounter_reclaimttl, size);
 			break;
 		case dns_expire_lru:
 			isc_stats_increment(rbtdb->cachestats,
@@ -1617,28 +1532,40 @@ dns__cachedb_expireheader(dns_slabheader_t *header,
 	}
 }
 
-static size_t
-rdataset_size(dns_slabheader_t *header) {
-	if (!NONEXISTENT(header)) {
-		return (dns_rdataslab_size((unsigned char *)header,
-					   sizeof(*header)));
-	}
-
-	return (sizeof(*header));
-}
-
 static size_t
 expire_lru_headers(dns_rbtdb_t *rbtdb, unsigned int locknum,
 		   isc_rwlocktype_t *tlocktypep,
 		   size_t purgesize DNS__DB_FLARG) {
-	dns_slabheader_t *header = NULL, *header_prev = NULL;
+	dns_slabheader_t **handp = &rbtdb->lru_hand[locknum];
 	size_t purged = 0;
 
-	for (header = ISC_LIST_TAIL(rbtdb->lru[locknum]);
-	     header != NULL && purged <= purgesize; header = header_prev)
-	{
-		size_t header_size = rdataset_size(header);
-		header_prev = ISC_LIST_PREV(header, link);
+	/*
+	 * Every header is either expired, or loses its VISITED attribute
+	 * and is expired when the hand comes back to it, so this ends.
+	 * The hand is kept in 'rbtdb' while expiring a header, so that it
+	 * is moved by dns__rbtdb_deletedata() if the header it points to
+	 * is freed at the same time.
+	 */
+	while (purged <= purgesize) {
+		dns_slabheader_t *header = *handp;
+		size_t header_size;
+
+		if (header == NULL) {
+			header = ISC_LIST_TAIL(rbtdb->lru[locknum]);
+			if (header == NULL) {
+				break;
+			}
+		}
+
+		*handp = ISC_LIST_PREV(header, link);
+
+		if (DNS_SLABHEADER_GETATTR(header,
+					   DNS_SLABHEADERATTR_VISITED) != 0)
+		{
+			DNS_SLABHEADER_CLRATTR(header,
+					       DNS_SLABHEADERATTR_VISITED);
+			continue;
+		}
 
 		/*
 		 * Unlink the entry at this point to avoid checking it
@@ -1647,6 +1574,7 @@ expire_lru_headers(dns_rbtdb_t *rbtdb, unsigned int locknum,
 		 * referenced any more (so unlinking is safe) since the
 		 * TTL was reset to 0.
 		 */
+		header_size = rdataset_size(header);
 		ISC_LIST_UNLINK(rbtdb->lru[locknum], header, link);
 		dns__cachedb_expireheader(header, tlocktypep,
 					  dns_expire_lru DNS__DB_FLARG_PASS);
@@ -1691,3 +1619,324 @@ dns__cachedb_overmem(dns_rbtdb_t *rbtdb, dns_slabheader_t *newheader,
 		NODE_UNLOCK(&rbtdb->node_locks[locknum].lock, &nlocktype);
 	}
 }
+
+/*
+ * The TTL expiry wheels.  A header is placed on the lowest level whose
+ * range covers the time until it expires, in the slot for its expiry
+ * time; whenever the time of the wheel reaches the start of a period of
+ * a higher level, the slot of that period is cascaded down, so that the
+ * level 0 slot for the current second holds exactly the headers due in
+ * it.  Inserting, moving and removing a header are constant time.
+ */
+static isc_stdtime_t
+expire_time(dns_rbtdb_t *rbtdb, dns_slabheader_t *header) {
+	uint64_t when = (uint64_t)header->ttl + STALE_TTL(header, rbtdb) +
+			RBTDB_VIRTUAL + 1;
+
+	return ((when > UINT32_MAX) ? UINT32_MAX : (isc_stdtime_t)when);
+}
+
+void
+dns__cachedb_expireinsert(dns_rbtdb_t *rbtdb, dns_slabheader_t *header,
+			  isc_stdtime_t now) {
+	rbtdb_expirewheel_t *wheel =
+		&rbtdb->expire[HEADER_NODE(header)->locknum];
+	isc_stdtime_t when = expire_time(rbtdb, header);
+	unsigned int level = 0, slot;
+
+	REQUIRE(header->heap_index == 0);
+
+	if (wheel->count == 0 && now > wheel->now) {
+		wheel->now = now;
+	}
+	if (when < wheel->now) {
+		when = wheel->now;
+	}
+
+	while (level < RBTDB_EXPIRE_LEVELS - 1 &&
+	       (uint64_t)(when - wheel->now) >=
+		       (UINT64_C(1) << (RBTDB_EXPIRE_BITS * (level + 1))))
+	{
+		level++;
+	}
+
+	slot = level * RBTDB_EXPIRE_SLOTS +
+	       ((when >> (RBTDB_EXPIRE_BITS * level)) &
+		(RBTDB_EXPIRE_SLOTS - 1));
+	ISC_LIST_APPEND(wheel->slots[slot], header, expirelink);
+	header->heap_index = slot + 1;
+	wheel->levelcount[level]++;
+	wheel->count++;
+}
+
+void
+dns__cachedb_expireunlink(dns_rbtdb_t *rbtdb, dns_slabheader_t *header) {
+	rbtdb_expirewheel_t *wheel =
+		&rbtdb->expire[HEADER_NODE(header)->locknum];
+
+	REQUIRE(header->heap_index != 0);
+	INSIST(wheel->count > 0);
+
+	ISC_LIST_UNLINK(wheel->slots[header->heap_index - 1], header,
+			expirelink);
+	wheel->levelcount[(header->heap_index - 1) / RBTDB_EXPIRE_SLOTS]--;
+	header->heap_index = 0;
+	wheel->count--;
+}
+
+/*
+ * Move the headers in the slot of the current period of 'level' to the
+ * lower levels.
+ */
+static void
+expire_cascade(dns_rbtdb_t *rbtdb, rbtdb_expirewheel_t *wheel,
+	       unsigned int level) {
+	unsigned int slot = level * RBTDB_EXPIRE_SLOTS +
+			    ((wheel->now >> (RBTDB_EXPIRE_BITS * level)) &
+			     (RBTDB_EXPIRE_SLOTS - 1));
+	dns_slabheaderlist_t list = ISC_LIST_INITIALIZER;
+	dns_slabheader_t *header = NULL;
+
+	ISC_LIST_MOVE(list, wheel->slots[slot]);
+	while ((header = ISC_LIST_HEAD(list)) != NULL) {
+		ISC_LIST_UNLINK(list, header, expirelink);
+		header->heap_index = 0;
+		wheel->levelcount[level]--;
+		wheel->count--;
+		dns__cachedb_expireinsert(rbtdb, header, 0);
+	}
+}
+
+bool
+dns__cachedb_expirettl(dns_rbtdb_t *rbtdb, unsigned int locknum,
+		       isc_stdtime_t now, unsigned int limit,
+		       isc_rwlocktype_t *tlocktypep DNS__DB_FLARG) {
+	rbtdb_expirewheel_t *wheel = &rbtdb->expire[locknum];
+	unsigned int expired = 0;
+	bool more = false;
+
+	while (wheel->now <= now) {
+		dns_slabheaderlist_t *list = NULL;
+		dns_slabheader_t *header = NULL;
+		unsigned int level;
+
+		if (wheel->count == 0) {
+			wheel->now = now;
+			break;
+		}
+
+		for (level = 1; level < RBTDB_EXPIRE_LEVELS; level++) {
+			isc_stdtime_t mask = (1U << (RBTDB_EXPIRE_BITS *
+						     level)) - 1;
+			if ((wheel->now & mask) != 0) {
+				break;
+			}
+			expire_cascade(rbtdb, wheel, level);
+		}
+
+		if (wheel->levelcount[0] == 0) {
+			/*
+			 * Nothing is due until the next period of the lowest
+			 * level in use is cascaded down; skip to it.
+			 */
+			uint64_t next;
+
+			level = 1;
+			while (level < RBTDB_EXPIRE_LEVELS - 1 &&
+			       wheel->levelcount[level] == 0)
+			{
+				level++;
+			}
+			next = ((uint64_t)wheel->now |
+				((UINT64_C(1) << (RBTDB_EXPIRE_BITS * level)) -
+				 1)) +
+			       1;
+			if (next > now) {
+				wheel->now = now;
+				break;
+			}
+			wheel->now = (isc_stdtime_t)next;
+			continue;
+		}
+
+		list = &wheel->slots[wheel->now & (RBTDB_EXPIRE_SLOTS - 1)];
+		while ((header = ISC_LIST_HEAD(*list)) != NULL) {
+			if (expired == limit) {
+				more = true;
+				goto done;
+			}
+
+			/*
+			 * The stale TTL may have been changed since the
+			 * header was placed on the wheel.
+			 */
+			dns__cachedb_expireunlink(rbtdb, header);
+			if (expire_time(rbtdb, header) > now) {
+				dns__cachedb_expireinsert(rbtdb, header, 0);
+				continue;
+			}
+
+			dns__cachedb_expireheader(
+				header, tlocktypep,
+				dns_expire_ttl DNS__DB_FLARG_PASS);
+			expired++;
+		}
+
+		if (wheel->now == UINT32_MAX) {
+			break;
+		}
+		wheel->now++;
+	}
+
+done:
+	return (more);
+}
+
+static void
+sweep_cb(void *arg) {
+	dns_rbtdb_t *rbtdb = (dns_rbtdb_t *)arg;
+	isc_stdtime_t now = isc_stdtime_now();
+	bool again = false;
+
+	/*
+	 * The tree lock is not held, so the nodes emptied here are only
+	 * deleted when the tree can be write locked without waiting; the
+	 * others are left on the dead node lists.
+	 */
+	for (unsigned int locknum = 0; locknum < rbtdb->node_lock_count;
+	     locknum++)
+	{
+		isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
+		isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+
+		NODE_WRLOCK(&rbtdb->node_locks[locknum].lock, &nlocktype);
+		if (dns__cachedb_expirettl(rbtdb, locknum, now,
+					   RBTDB_EXPIRE_BATCH,
+					   &tlocktype DNS__DB_FILELINE))
+		{
+			again = true;
+		}
+		NODE_UNLOCK(&rbtdb->node_locks[locknum].lock, &nlocktype);
+		INSIST(tlocktype == isc_rwlocktype_none);
+	}
+
+	if (again) {
+		isc_async_run(rbtdb->loop, sweep_cb, rbtdb);
+	} else {
+		atomic_store_release(&rbtdb->sweep_next, now + 1);
+		dns_db_detach((dns_db_t **)&rbtdb);
+	}
+}
+
+void
+dns__cachedb_sweep(dns_rbtdb_t *rbtdb, isc_stdtime_t now) {
+	uint_fast32_t next = atomic_load_acquire(&rbtdb->sweep_next);
+
+	if (now < next || !atomic_compare_exchange_strong_acq_rel(
+				  &rbtdb->sweep_next, &next, UINT32_MAX))
+	{
+		return;
+	}
+
+	isc_refcount_increment(&rbtdb->common.references);
+	isc_async_run(rbtdb->loop, sweep_cb, rbtdb);
+}
+
+static void
+nsecname_destroy(nsecname_t *nsecname) {
+	isc_refcount_destroy(&nsecname->references);
+	dns_name_free(&nsecname->name, nsecname->mctx);
+	isc_mem_putanddetach(&nsecname->mctx, nsecname, sizeof(*nsecname));
+}
+
+static void
+nsecindex_attach(void *uctx ISC_ATTR_UNUSED, void *pval,
+		 uint32_t ival ISC_ATTR_UNUSED) {
+	nsecname_t *nsecname = pval;
+	isc_refcount_increment(&nsecname->references);
+}
+
+static void
+nsecindex_detach(void *uctx ISC_ATTR_UNUSED, void *pval,
+		 uint32_t ival ISC_ATTR_UNUSED) {
+	nsecname_t *nsecname = pval;
+	if (isc_refcount_decrement(&nsecname->references) == 1) {
+		nsecname_destroy(nsecname);
+	}
+}
+
+static size_t
+nsecindex_makekey(dns_qpkey_t key, void *uctx ISC_ATTR_UNUSED, void *pval,
+		  uint32_t ival ISC_ATTR_UNUSED) {
+	nsecname_t *nsecname = pval;
+	return (dns_qpkey_fromname(key, &nsecname->name));
+}
+
+static void
+nsecindex_triename(void *uctx ISC_ATTR_UNUSED, char *buf, size_t size) {
+	/* the database may be gone when the trie is reclaimed */
+	snprintf(buf, size, "cache NSEC index");
+}
+
+static dns_qpmethods_t nsecindex_methods = {
+	nsecindex_attach,
+	nsecindex_detach,
+	nsecindex_makekey,
+	nsecindex_triename,
+};
+
+void
+dns__cachedb_nsecindex_create(dns_rbtdb_t *rbtdb) {
+	REQUIRE(IS_CACHE(rbtdb));
+	REQUIRE(rbtdb->nsecindex == NULL);
+
+	dns_qpmulti_create(rbtdb->common.mctx, &nsecindex_methods, rbtdb,
+			   &rbtdb->nsecindex);
+}
+
+void
+dns__cachedb_nsecindex_destroy(dns_rbtdb_t *rbtdb) {
+	if (rbtdb->nsecindex != NULL) {
+		dns_qpmulti_destroy(&rbtdb->nsecindex);
+	}
+}
+
+isc_result_t
+dns__cachedb_nsecindex_add(dns_rbtdb_t *rbtdb, const dns_name_t *name) {
+	nsecname_t *nsecname = NULL;
+	dns_qp_t *qp = NULL;
+	isc_result_t result;
+
+	nsecname = isc_mem_get(rbtdb->common.mctx, sizeof(*nsecname));
+	*nsecname = (nsecname_t){ .name = DNS_NAME_INITEMPTY };
+	isc_mem_attach(rbtdb->common.mctx, &nsecname->mctx);
+	isc_refcount_init(&nsecname->references, 1);
+	dns_name_dup(name, nsecname->mctx, &nsecname->name);
+
+	dns_qpmulti_write(rbtdb->nsecindex, &qp);
+	result = dns_qp_insert(qp, nsecname, 0);
+	dns_qp_compact(qp, DNS_QPGC_MAYBE);
+	dns_qpmulti_commit(rbtdb->nsecindex, &qp);
+
+	nsecindex_detach(NULL, nsecname, 0);
+
+	return (result);
+}
+
+isc_result_t
+dns__cachedb_nsecindex_delete(dns_rbtdb_t *rbtdb, const dns_name_t *name) {
+	dns_qp_t *qp = NULL;
+	isc_result_t result;
+
+	dns_qpmulti_write(rbtdb->nsecindex, &qp);
+	result = dns_qp_deletename(qp, name, NULL, NULL);
+	dns_qp_compact(qp, DNS_QPGC_MAYBE);
+	dns_qpmulti_commit(rbtdb->nsecindex, &qp);
+
+	return (result);
+}
+
+unsigned int
+dns__cachedb_nsecindex_count(dns_rbtdb_t *rbtdb) {
+	return (dns_qpmulti_memusage(rbtdb->nsecindex).leaves);
+}
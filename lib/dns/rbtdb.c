@@ -130,7 +130,7 @@
 #define KEEPSTALE(rbtdb) ((rbtdb)->common.serve_stale_ttl > 0)
 
 /*%
- * Number of buckets for cache DB entries (locks, LRU lists, TTL heaps).
+ * Number of buckets for cache DB entries (locks, LRU lists, TTL wheels).
  * There is a tradeoff issue about configuring this value: if this is too
  * small, it may cause heavier contention between threads; if this is too large,
  * LRU purge algorithm won't work well (entries tend to be purged prematurely).
@@ -321,35 +321,20 @@ dns__rbtdb_setttl(dns_slabheader_t *header, dns_ttl_t newttl) {
 	}
 
 	/*
-	 * This is a cache. Adjust the heaps if necessary.
+	 * This is a cache. Move the header on the expiry wheel if necessary.
 	 */
-	if (header->heap == NULL || header->heap_index == 0 || newttl == oldttl)
-	{
+	if (header->heap_index == 0 || newttl == oldttl) {
 		return;
 	}
 
-	if (newttl < oldttl) {
-		isc_heap_increased(header->heap, header->heap_index);
-	} else {
-		isc_heap_decreased(header->heap, header->heap_index);
-	}
+	dns__cachedb_expireunlink((dns_rbtdb_t *)header->db, header);
+	dns__cachedb_expireinsert((dns_rbtdb_t *)header->db, header, 0);
 }
 
 /*%
- * These functions allow the heap code to rank the priority of each
- * element.  It returns true if v1 happens "sooner" than v2.
- */
-static bool
-ttl_sooner(void *v1, void *v2) {
-	dns_slabheader_t *h1 = v1;
-	dns_slabheader_t *h2 = v2;
-
-	return (h1->ttl < h2->ttl);
-}
-
-/*%
- * Return which RRset should be resigned sooner.  If the RRsets have the
- * same signing time, prefer the other RRset over the SOA RRset.
+ * This function allows the heap code to rank the priority of each
+ * element: return which RRset should be resigned sooner.  If the RRsets
+ * have the same signing time, prefer the other RRset over the SOA RRset.
  */
 static bool
 resign_sooner(void *v1, void *v2) {
@@ -515,6 +500,7 @@ free_rbtdb(dns_rbtdb_t *rbtdb, bool log) {
 			      DNS_LOGMODULE_CACHE, ISC_LOG_DEBUG(1),
 			      "done free_rbtdb(%s)", buf);
 	}
+	dns__cachedb_nsecindex_destroy(rbtdb);
 	if (dns_name_dynamic(&rbtdb->common.origin)) {
 		dns_name_free(&rbtdb->common.origin, rbtdb->common.mctx);
 	}
@@ -533,6 +519,9 @@ free_rbtdb(dns_rbtdb_t *rbtdb, bool log) {
 		isc_mem_cput(rbtdb->common.mctx, rbtdb->lru,
 			     rbtdb->node_lock_count,
 			     sizeof(dns_slabheaderlist_t));
+		isc_mem_cput(rbtdb->common.mctx, rbtdb->lru_hand,
+			     rbtdb->node_lock_count,
+			     sizeof(dns_slabheader_t *));
 	}
 	/*
 	 * Clean up dead node buckets.
@@ -545,8 +534,15 @@ free_rbtdb(dns_rbtdb_t *rbtdb, bool log) {
 			     rbtdb->node_lock_count, sizeof(dns_rbtnodelist_t));
 	}
 	/*
-	 * Clean up heap objects.
+	 * Clean up heap objects and expiry wheels.
 	 */
+	if (rbtdb->expire != NULL) {
+		for (i = 0; i < rbtdb->node_lock_count; i++) {
+			INSIST(rbtdb->expire[i].count == 0);
+		}
+		isc_mem_cput(rbtdb->hmctx, rbtdb->expire, rbtdb->node_lock_count,
+			     sizeof(rbtdb_expirewheel_t));
+	}
 	if (rbtdb->heaps != NULL) {
 		for (i = 0; i < rbtdb->node_lock_count; i++) {
 			isc_heap_destroy(&rbtdb->heaps[i]);
@@ -1059,8 +1055,23 @@ delete_node(dns_rbtdb_t *rbtdb, dns_rbtnode_t *node) {
 		dns_rbt_fullnamefromnode(node, name);
 		/*
 		 * Delete the corresponding node from the auxiliary NSEC
-		 * tree before deleting from the main tree.
+		 * tree (or the NSEC index of a cache) before deleting
+		 * from the main tree.
 		 */
+		if (IS_CACHE(rbtdb)) {
+			result = dns__cachedb_nsecindex_delete(rbtdb, name);
+			if (result != ISC_R_SUCCESS) {
+				isc_log_write(dns_lctx,
+					      DNS_LOGCATEGORY_DATABASE,
+					      DNS_LOGMODULE_CACHE,
+					      ISC_LOG_WARNING,
+					      "delete_node(): "
+					      "nsecindex_delete: %s",
+					      isc_result_totext(result));
+			}
+			result = dns_rbt_deletenode(rbtdb->tree, node, false);
+			break;
+		}
 		nsecnode = NULL;
 		result = dns_rbt_findnode(rbtdb->nsec, name, NULL, &nsecnode,
 					  NULL, DNS_RBTFIND_EMPTYDATA, NULL,
@@ -2136,6 +2147,7 @@ dns__rbtdb_bindrdataset(dns_rbtdb_t *rbtdb, dns_rbtnode_t *node,
 	rdataset->covers = DNS_TYPEPAIR_COVERS(header->type);
 	rdataset->ttl = header->ttl - now;
 	rdataset->trust = header->trust;
+	rdataset->hits = atomic_load_relaxed(&header->hits);
 
 	if (NEGATIVE(header)) {
 		rdataset->attributes |= DNS_RDATASETATTR_NEGATIVE;
@@ -2845,9 +2857,8 @@ find_header:
 					ISC_LIST_PREPEND(rbtdb->lru[idx],
 							 newheader, link);
 				}
-				INSIST(rbtdb->heaps != NULL);
-				isc_heap_insert(rbtdb->heaps[idx], newheader);
-				newheader->heap = rbtdb->heaps[idx];
+				dns__cachedb_expireinsert(rbtdb, newheader,
+							  now);
 			} else if (RESIGN(newheader)) {
 				dns__zonedb_resigninsert(rbtdb, idx, newheader);
 				/*
@@ -2878,9 +2889,17 @@ find_header:
 		} else {
 			idx = HEADER_NODE(newheader)->locknum;
 			if (IS_CACHE(rbtdb)) {
-				INSIST(rbtdb->heaps != NULL);
-				isc_heap_insert(rbtdb->heaps[idx], newheader);
-				newheader->heap = rbtdb->heaps[idx];
+				/*
+				 * Carry half of the hits over to the new
+				 * header, so that a popular RRset stays
+				 * popular when it is refreshed, but not
+				 * forever once it is no longer used.
+				 */
+				atomic_store_relaxed(
+					&newheader->hits,
+					atomic_load_relaxed(&header->hits) / 2);
+				dns__cachedb_expireinsert(rbtdb, newheader,
+							  now);
 				if (ZEROTTL(newheader)) {
 					ISC_LIST_APPEND(rbtdb->lru[idx],
 							newheader, link);
@@ -2934,8 +2953,7 @@ find_header:
 
 		idx = HEADER_NODE(newheader)->locknum;
 		if (IS_CACHE(rbtdb)) {
-			isc_heap_insert(rbtdb->heaps[idx], newheader);
-			newheader->heap = rbtdb->heaps[idx];
+			dns__cachedb_expireinsert(rbtdb, newheader, now);
 			if (ZEROTTL(newheader)) {
 				ISC_LIST_APPEND(rbtdb->lru[idx], newheader,
 						link);
@@ -3110,7 +3128,6 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 	dns_rbtdb_version_t *rbtversion = version;
 	isc_region_t region;
 	dns_slabheader_t *newheader = NULL;
-	dns_slabheader_t *header = NULL;
 	isc_result_t result;
 	bool delegating;
 	bool newnsec;
@@ -3164,7 +3181,6 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 	*newheader = (dns_slabheader_t){
 		.type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers),
 		.trust = rdataset->trust,
-		.last_used = now,
 		.node = rbtnode,
 	};
 
@@ -3194,6 +3210,10 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 			DNS_SLABHEADER_SETATTR(newheader,
 					       DNS_SLABHEADERATTR_PREFETCH);
 		}
+		if ((options & DNS_DBADD_PREFETCH) != 0) {
+			DNS_SLABHEADER_SETATTR(newheader,
+					       DNS_SLABHEADERATTR_PREFETCHED);
+		}
 		if ((rdataset->attributes & DNS_RDATASETATTR_NEGATIVE) != 0) {
 			DNS_SLABHEADER_SETATTR(newheader,
 					       DNS_SLABHEADERATTR_NEGATIVE);
@@ -3282,13 +3302,17 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 					   rbtnode->locknum DNS__DB_FLARG_PASS);
 		}
 
-		header = isc_heap_element(rbtdb->heaps[rbtnode->locknum], 1);
-		if (header != NULL && header->ttl + STALE_TTL(header, rbtdb) <
-					      now - RBTDB_VIRTUAL)
-		{
-			dns__cachedb_expireheader(
-				header, &tlocktype,
-				dns_expire_ttl DNS__DB_FLARG_PASS);
+		/*
+		 * Headers past their TTL are expired by the sweeper on the
+		 * database loop.  Without a loop, expire at most one header
+		 * from this bucket's wheel, as the cost of the addition.
+		 */
+		if (rbtdb->loop != NULL) {
+			dns__cachedb_sweep(rbtdb, now);
+		} else {
+			(void)dns__cachedb_expirettl(rbtdb, rbtnode->locknum,
+						     now, 1,
+						     &tlocktype DNS__DB_FLARG_PASS);
 		}
 
 		/*
@@ -3304,7 +3328,13 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 	}
 
 	result = ISC_R_SUCCESS;
-	if (newnsec) {
+	if (newnsec && IS_CACHE(rbtdb)) {
+		result = dns__cachedb_nsecindex_add(rbtdb, name);
+		if (result == ISC_R_SUCCESS || result == ISC_R_EXISTS) {
+			rbtnode->nsec = DNS_RBT_NSEC_HAS_NSEC;
+			result = ISC_R_SUCCESS;
+		}
+	} else if (newnsec) {
 		dns_rbtnode_t *nsecnode = NULL;
 
 		result = dns_rbt_addnode(rbtdb->nsec, name, &nsecnode);
@@ -3322,6 +3352,12 @@ dns__rbtdb_addrdataset(dns_db_t *db, dns_dbnode_t *node,
 					newheader, options, false,
 					addedrdataset, now DNS__DB_FLARG_PASS);
 	}
+	if (result == ISC_R_SUCCESS && (options & DNS_DBADD_PREFETCH) != 0 &&
+	    IS_CACHE(rbtdb) && rbtdb->cachestats != NULL)
+	{
+		isc_stats_increment(rbtdb->cachestats,
+				    dns_cachestatscounter_prefetched);
+	}
 	if (result == ISC_R_SUCCESS && delegating) {
 		rbtnode->find_callback = 1;
 	}
@@ -3396,7 +3432,6 @@ dns__rbtdb_subtractrdataset(dns_db_t *db, dns_dbnode_t *node,
 	newheader->closest = NULL;
 	atomic_init(&newheader->count,
 		    atomic_fetch_add_relaxed(&init_count, 1));
-	newheader->last_used = 0;
 	newheader->node = rbtnode;
 	newheader->db = (dns_db_t *)rbtdb;
 	if ((rdataset->attributes & DNS_RDATASETATTR_RESIGN) != 0) {
@@ -3650,7 +3685,11 @@ dns__rbtdb_nodecount(dns_db_t *db, dns_dbtree_t tree) {
 		count = dns_rbt_nodecount(rbtdb->tree);
 		break;
 	case dns_dbtree_nsec:
-		count = dns_rbt_nodecount(rbtdb->nsec);
+		if (IS_CACHE(rbtdb)) {
+			count = dns__cachedb_nsecindex_count(rbtdb);
+		} else {
+			count = dns_rbt_nodecount(rbtdb->nsec);
+		}
 		break;
 	case dns_dbtree_nsec3:
 		count = dns_rbt_nodecount(rbtdb->nsec3);
@@ -3810,21 +3849,36 @@ dns__rbtdb_create(isc_mem_t *mctx, const dns_name_t *origin, dns_dbtype_t type,
 		for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
 			ISC_LIST_INIT(rbtdb->lru[i]);
 		}
+		rbtdb->lru_hand = isc_mem_cget(mctx, rbtdb->node_lock_count,
+					       sizeof(dns_slabheader_t *));
 	}
 
 	/*
-	 * Create the heaps.
+	 * Create the heaps for resigning in a zone, or the TTL expiry
+	 * wheels in a cache.
 	 */
-	rbtdb->heaps = isc_mem_get(hmctx, rbtdb->node_lock_count *
-						  sizeof(isc_heap_t *));
-	for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
-		rbtdb->heaps[i] = NULL;
-	}
+	if (IS_CACHE(rbtdb)) {
+		rbtdb->expire = isc_mem_cget(hmctx, rbtdb->node_lock_count,
+					     sizeof(rbtdb_expirewheel_t));
+		for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
+			for (size_t j = 0; j < ARRAY_SIZE(rbtdb->expire[i].slots);
+			     j++)
+			{
+				ISC_LIST_INIT(rbtdb->expire[i].slots[j]);
+			}
+		}
+	} else {
+		rbtdb->heaps = isc_mem_get(hmctx, rbtdb->node_lock_count *
+							  sizeof(isc_heap_t *));
+		for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
+			rbtdb->heaps[i] = NULL;
+		}
 
-	rbtdb->sooner = IS_CACHE(rbtdb) ? ttl_sooner : resign_sooner;
-	for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
-		isc_heap_create(hmctx, rbtdb->sooner, set_index, 0,
-				&rbtdb->heaps[i]);
+		rbtdb->sooner = resign_sooner;
+		for (i = 0; i < (int)rbtdb->node_lock_count; i++) {
+			isc_heap_create(hmctx, rbtdb->sooner, set_index, 0,
+					&rbtdb->heaps[i]);
+		}
 	}
 
 	/*
@@ -3882,6 +3936,10 @@ dns__rbtdb_create(isc_mem_t *mctx, const dns_name_t *origin, dns_dbtype_t type,
 		return (result);
 	}
 
+	if (IS_CACHE(rbtdb)) {
+		dns__cachedb_nsecindex_create(rbtdb);
+	}
+
 	/*
 	 * In order to set the node callback bit correctly in zone databases,
 	 * we need to know if the node has the origin name of the zone.
@@ -4705,7 +4763,11 @@ dns__rbtdb_deletedata(dns_db_t *db ISC_ATTR_UNUSED,
 	dns_slabheader_t *header = data;
 	dns_rbtdb_t *rbtdb = (dns_rbtdb_t *)header->db;
 
-	if (header->heap != NULL && header->heap_index != 0) {
+	if (IS_CACHE(rbtdb)) {
+		if (header->heap_index != 0) {
+			dns__cachedb_expireunlink(rbtdb, header);
+		}
+	} else if (header->heap != NULL && header->heap_index != 0) {
 		isc_heap_delete(header->heap, header->heap_index);
 	}
 	header->heap_index = 0;
@@ -4718,6 +4780,10 @@ dns__rbtdb_deletedata(dns_db_t *db ISC_ATTR_UNUSED,
 		if (ISC_LINK_LINKED(header, link)) {
 			int idx = HEADER_NODE(header)->locknum;
 			INSIST(IS_CACHE(rbtdb));
+			if (rbtdb->lru_hand[idx] == header) {
+				rbtdb->lru_hand[idx] = ISC_LIST_PREV(header,
+								     link);
+			}
 			ISC_LIST_UNLINK(rbtdb->lru[idx], header, link);
 		}
 
@@ -13,11 +13,13 @@
 
 #pragma once
 
+#include <isc/atomic.h>
 #include <isc/heap.h>
 #include <isc/lang.h>
 #include <isc/urcu.h>
 
 #include <dns/nsec3.h>
+#include <dns/qp.h>
 #include <dns/rbt.h>
 #include <dns/types.h>
 
@@ -154,6 +156,21 @@
  */
 #define RBTDB_VIRTUAL 300
 
+/*
+ * Geometry of the TTL expiry wheels of a cache database: six levels of
+ * 64 slots each cover the whole range of isc_stdtime_t.  A slot on level
+ * N holds the headers expiring within one period of 64^N seconds.
+ */
+#define RBTDB_EXPIRE_BITS   6
+#define RBTDB_EXPIRE_SLOTS  (1 << RBTDB_EXPIRE_BITS)
+#define RBTDB_EXPIRE_LEVELS 6
+
+/*
+ * Maximum number of headers expired in a bucket by one pass of the
+ * TTL sweeper, before it yields to the other events on the loop.
+ */
+#define RBTDB_EXPIRE_BATCH 100
+
 /*****
 ***** Module Info
 *****/
@@ -237,6 +254,20 @@ struct dns_rbtdb_version {
 
 typedef ISC_LIST(dns_rbtdb_version_t) rbtdb_versionlist_t;
 
+/*%
+ * A hierarchical timing wheel holding the headers of one cache bucket,
+ * keyed by the second at which they become eligible for TTL expiry.
+ * All the headers due before 'now' have been expired; 'count' is the
+ * number of headers on the wheel, and 'levelcount' the number on each
+ * level.  Locked by the bucket's node lock.
+ */
+typedef struct rbtdb_expirewheel {
+	isc_stdtime_t now;
+	unsigned int count;
+	unsigned int levelcount[RBTDB_EXPIRE_LEVELS];
+	dns_slabheaderlist_t slots[RBTDB_EXPIRE_LEVELS * RBTDB_EXPIRE_SLOTS];
+} rbtdb_expirewheel_t;
+
 struct dns_rbtdb {
 	/* Unlocked. */
 	dns_db_t common;
@@ -275,9 +306,12 @@ struct dns_rbtdb {
 	/*
 	 * This is a linked list used to implement the LRU cache.  There will
 	 * be node_lock_count linked lists here.  Nodes in bucket 1 will be
-	 * placed on the linked list lru[1].
+	 * placed on the linked list lru[1].  New headers are added at the
+	 * head of the list; 'lru_hand[1]' is where the SIEVE eviction of
+	 * bucket 1 resumes, going from the tail towards the head.
 	 */
 	dns_slabheaderlist_t *lru;
+	dns_slabheader_t    **lru_hand;
 
 	/*%
 	 * Temporary storage for stale cache nodes and dynamically deleted
@@ -286,20 +320,28 @@ struct dns_rbtdb {
 	dns_rbtnodelist_t *deadnodes;
 
 	/*
-	 * Heaps.  These are used for TTL based expiry in a cache,
-	 * or for zone resigning in a zone DB.  hmctx is the memory
-	 * context to use for the heap (which differs from the main
-	 * database memory context in the case of a cache).
+	 * Heaps.  These are used for zone resigning in a zone DB.  In a
+	 * cache, TTL based expiry uses a timing wheel per bucket instead,
+	 * which is drained by a sweeper running on 'loop' at most once a
+	 * second; 'sweep_next' is the time from which the next sweep may
+	 * be scheduled, or UINT32_MAX while one is pending.  hmctx is the
+	 * memory context to use for the heaps and wheels (which differs
+	 * from the main database memory context in the case of a cache).
 	 */
 	isc_mem_t *hmctx;
 	isc_heap_t **heaps;
 	isc_heapcompare_t sooner;
+	rbtdb_expirewheel_t *expire;
+	atomic_uint_fast32_t sweep_next;
 
 	/* Locked by tree_lock. */
 	dns_rbt_t *tree;
 	dns_rbt_t *nsec;
 	dns_rbt_t *nsec3;
 
+	/* Cache only, replaces 'nsec'; has its own lock. */
+	dns_qpmulti_t *nsecindex;
+
 	/* Unlocked */
 	unsigned int quantum;
 };
@@ -557,7 +599,7 @@ void
 dns__rbtdb_setttl(dns_slabheader_t *header, dns_ttl_t newttl);
 /*%<
  * Set the TTL in a slab header 'header'. In a cache database,
- * also update the TTL heap accordingly.
+ * also move the header on its bucket's expiry wheel accordingly.
  */
 
 /*
@@ -606,8 +648,66 @@ dns__cachedb_expireheader(dns_slabheader_t *header,
 			  isc_rwlocktype_t *tlocktypep,
 			  dns_expire_t reason DNS__DB_FLARG);
 void
+dns__cachedb_expireinsert(dns_rbtdb_t *rbtdb, dns_slabheader_t *header,
+			  isc_stdtime_t now);
+void
+dns__cachedb_expireunlink(dns_rbtdb_t *rbtdb, dns_slabheader_t *header);
+/*%<
+ * Add a header to, or remove it from, the expiry wheel of its bucket.
+ * An empty wheel is first moved forward to 'now', if that is later
+ * than the time of the wheel.
+ *
+ * Caller must hold the node (write) lock.
+ */
+
+bool
+dns__cachedb_expirettl(dns_rbtdb_t *rbtdb, unsigned int locknum,
+		       isc_stdtime_t now, unsigned int limit,
+		       isc_rwlocktype_t *tlocktypep DNS__DB_FLARG);
+/*%<
+ * Advance the expiry wheel of bucket 'locknum' to 'now', expiring at
+ * most 'limit' headers whose TTL (plus the stale TTL) has passed.
+ * Returns true if the limit was reached before the wheel caught up.
+ *
+ * Caller must hold the node (write) lock.
+ */
+
+void
+dns__cachedb_sweep(dns_rbtdb_t *rbtdb, isc_stdtime_t now);
+/*%<
+ * Schedule a pass of the TTL sweeper on the database loop, unless one
+ * is already pending or has run during the second 'now'.
+ */
+
+void
 dns__cachedb_overmem(dns_rbtdb_t *rbtdb, dns_slabheader_t *newheader,
 		     unsigned int locknum_start,
 		     isc_rwlocktype_t *tlocktypep DNS__DB_FLARG);
 
+void
+dns__cachedb_nsecindex_create(dns_rbtdb_t *rbtdb);
+void
+dns__cachedb_nsecindex_destroy(dns_rbtdb_t *rbtdb);
+/*%<
+ * Create or destroy the index of NSEC owner names of a cache database.
+ * Readers use it without the tree lock, via a qp-trie snapshot.
+ */
+
+isc_result_t
+dns__cachedb_nsecindex_add(dns_rbtdb_t *rbtdb, const dns_name_t *name);
+isc_result_t
+dns__cachedb_nsecindex_delete(dns_rbtdb_t *rbtdb, const dns_name_t *name);
+/*%<
+ * Add 'name' to, or remove it from, the NSEC index.  These are called
+ * when the DNS_RBT_NSEC_HAS_NSEC flag of the node is set or cleared,
+ * so the caller must hold the tree write lock.  Returns ISC_R_EXISTS
+ * or ISC_R_NOTFOUND if the name is already in, or missing from, the index.
+ */
+
+unsigned int
+dns__cachedb_nsecindex_count(dns_rbtdb_t *rbtdb);
+/*%<
+ * Return the number of names in the NSEC index.
+ */
+
 ISC_LANG_ENDDECLS
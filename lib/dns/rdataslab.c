@@ -1111,6 +1111,7 @@ dns_slabheader_copycase(dns_slabheader_t *dest, dns_slabheader_t *src) {
 void
 dns_slabheader_reset(dns_slabheader_t *h, dns_db_t *db, dns_dbnode_t *node) {
 	ISC_LINK_INIT(h, link);
+	ISC_LINK_INIT(h, expirelink);
 	h->heap_index = 0;
 	h->heap = NULL;
 	h->glue_list = NULL;
@@ -1119,6 +1120,7 @@ dns_slabheader_reset(dns_slabheader_t *h, dns_db_t *db, dns_dbnode_t *node) {
 
 	atomic_init(&h->attributes, 0);
 	atomic_init(&h->last_refresh_fail_ts, 0);
+	atomic_init(&h->hits, 0);
 
 	cds_wfs_node_init(&h->wfs_node);
 
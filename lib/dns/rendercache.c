@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <isc/hash.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/refcount.h>
+#include <isc/rwlock.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/message.h>
+#include <dns/rendercache.h>
+
+#define RENDERCACHE_MAGIC    ISC_MAGIC('R', 'n', 'd', 'C')
+#define VALID_RENDERCACHE(r) ISC_MAGIC_VALID(r, RENDERCACHE_MAGIC)
+
+#define RENDEREDANSWER_MAGIC	ISC_MAGIC('R', 'n', 'd', 'A')
+#define VALID_RENDEREDANSWER(a) ISC_MAGIC_VALID(a, RENDEREDANSWER_MAGIC)
+
+struct dns_rendercache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	isc_rwlock_t lock;
+
+	/* Locked by 'lock'. */
+	dns_db_t *db;
+	dns_dbversion_t *version;
+	unsigned int size;
+	dns_renderedanswer_t **table;
+};
+
+static void
+renderedanswer_destroy(dns_renderedanswer_t *answer) {
+	REQUIRE(VALID_RENDEREDANSWER(answer));
+
+	answer->magic = 0;
+	isc_mem_putanddetach(&answer->mctx, answer,
+			     sizeof(*answer) + answer->keylen +
+				     answer->wire.length);
+}
+
+ISC_REFCOUNT_IMPL(dns_renderedanswer, renderedanswer_destroy);
+
+/*
+ * Drop all the answers and the version.  The cache must be write locked.
+ */
+static void
+flush(dns_rendercache_t *rc) {
+	for (unsigned int i = 0; i < rc->size; i++) {
+		if (rc->table[i] != NULL) {
+			dns_renderedanswer_detach(&rc->table[i]);
+		}
+	}
+	if (rc->version != NULL) {
+		dns_db_closeversion(rc->db, &rc->version, false);
+	}
+	if (rc->db != NULL) {
+		dns_db_detach(&rc->db);
+	}
+}
+
+static unsigned int
+roundsize(unsigned int size) {
+	unsigned int slots = 1;
+
+	if (size == 0) {
+		return (0);
+	}
+	while (slots < size && slots < (1U << 31)) {
+		slots <<= 1;
+	}
+	return (slots);
+}
+
+void
+dns_rendercache_create(isc_mem_t *mctx, unsigned int size,
+		       dns_rendercache_t **rcp) {
+	dns_rendercache_t *rc = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(size > 0);
+	REQUIRE(rcp != NULL && *rcp == NULL);
+
+	rc = isc_mem_get(mctx, sizeof(*rc));
+	*rc = (dns_rendercache_t){
+		.size = roundsize(size),
+	};
+	isc_refcount_init(&rc->references, 1);
+	rc->table = isc_mem_cget(mctx, rc->size, sizeof(rc->table[0]));
+	isc_rwlock_init(&rc->lock);
+	isc_mem_attach(mctx, &rc->mctx);
+	rc->magic = RENDERCACHE_MAGIC;
+
+	*rcp = rc;
+}
+
+static void
+rendercache_destroy(dns_rendercache_t *rc) {
+	rc->magic = 0;
+
+	flush(rc);
+	isc_rwlock_destroy(&rc->lock);
+	if (rc->table != NULL) {
+		isc_mem_cput(rc->mctx, rc->table, rc->size,
+			     sizeof(rc->table[0]));
+	}
+	isc_mem_putanddetach(&rc->mctx, rc, sizeof(*rc));
+}
+
+ISC_REFCOUNT_IMPL(dns_rendercache, rendercache_destroy);
+
+void
+dns_rendercache_setsize(dns_rendercache_t *rc, unsigned int size) {
+	REQUIRE(VALID_RENDERCACHE(rc));
+
+	size = roundsize(size);
+
+	RWLOCK(&rc->lock, isc_rwlocktype_write);
+	if (size != rc->size) {
+		flush(rc);
+		if (rc->table != NULL) {
+			isc_mem_cput(rc->mctx, rc->table, rc->size,
+				     sizeof(rc->table[0]));
+			rc->table = NULL;
+		}
+		rc->size = size;
+		if (size > 0) {
+			rc->table = isc_mem_cget(rc->mctx, size,
+						 sizeof(rc->table[0]));
+		}
+	}
+	RWUNLOCK(&rc->lock, isc_rwlocktype_write);
+}
+
+unsigned int
+dns_rendercache_getsize(dns_rendercache_t *rc) {
+	unsigned int size;
+
+	REQUIRE(VALID_RENDERCACHE(rc));
+
+	RWLOCK(&rc->lock, isc_rwlocktype_read);
+	size = rc->size;
+	RWUNLOCK(&rc->lock, isc_rwlocktype_read);
+
+	return (size);
+}
+
+isc_result_t
+dns_rendercache_find(dns_rendercache_t *rc, dns_db_t *db,
+		     dns_dbversion_t *version, const isc_region_t *key,
+		     dns_renderedanswer_t **answerp) {
+	isc_result_t result = ISC_R_NOTFOUND;
+	dns_renderedanswer_t *answer = NULL;
+	uint32_t hashval;
+
+	REQUIRE(VALID_RENDERCACHE(rc));
+	REQUIRE(db != NULL && version != NULL);
+	REQUIRE(key != NULL);
+	REQUIRE(answerp != NULL && *answerp == NULL);
+
+	hashval = isc_hash32(key->base, key->length, true);
+
+	RWLOCK(&rc->lock, isc_rwlocktype_read);
+	if (rc->size == 0) {
+		result = ISC_R_DISABLED;
+	} else if (rc->db == db && rc->version == version) {
+		answer = rc->table[hashval & (rc->size - 1)];
+		if (answer != NULL && answer->hashval == hashval &&
+		    answer->keylen == key->length &&
+		    memcmp(answer->key, key->base, key->length) == 0)
+		{
+			dns_renderedanswer_attach(answer, answerp);
+			result = ISC_R_SUCCESS;
+		}
+	}
+	RWUNLOCK(&rc->lock, isc_rwlocktype_read);
+
+	return (result);
+}
+
+void
+dns_rendercache_add(dns_rendercache_t *rc, dns_db_t *db,
+		    dns_dbversion_t *version, const isc_region_t *key,
+		    dns_message_t *msg, const isc_region_t *wire) {
+	dns_renderedanswer_t *answer = NULL;
+	dns_renderedanswer_t **slot = NULL;
+
+	REQUIRE(VALID_RENDERCACHE(rc));
+	REQUIRE(db != NULL && version != NULL);
+	REQUIRE(key != NULL && wire != NULL);
+	REQUIRE(DNS_MESSAGE_VALID(msg));
+
+	answer = isc_mem_get(rc->mctx,
+			     sizeof(*answer) + key->length + wire->length);
+	*answer = (dns_renderedanswer_t){
+		.hashval = isc_hash32(key->base, key->length, true),
+		.flags = msg->flags & ~DNS_MESSAGEFLAG_RA,
+		.rcode = msg->rcode,
+		.keylen = key->length,
+		.key = (unsigned char *)(answer + 1),
+		.magic = RENDEREDANSWER_MAGIC,
+	};
+	isc_refcount_init(&answer->references, 1);
+	for (size_t i = 0; i < DNS_SECTION_MAX; i++) {
+		INSIST(msg->counts[i] < 65536);
+		answer->counts[i] = msg->counts[i];
+	}
+	answer->counts[DNS_SECTION_QUESTION] = 0;
+	memmove(answer->key, key->base, key->length);
+	answer->wire.base = answer->key + key->length;
+	answer->wire.length = wire->length;
+	memmove(answer->wire.base, wire->base, wire->length);
+	isc_mem_attach(rc->mctx, &answer->mctx);
+
+	RWLOCK(&rc->lock, isc_rwlocktype_write);
+	if (rc->size == 0) {
+		RWUNLOCK(&rc->lock, isc_rwlocktype_write);
+		dns_renderedanswer_detach(&answer);
+		return;
+	}
+	if (rc->db != db || rc->version != version) {
+		flush(rc);
+		dns_db_attach(db, &rc->db);
+		dns_db_attachversion(db, version, &rc->version);
+	}
+	slot = &rc->table[answer->hashval & (rc->size - 1)];
+	if (*slot != NULL) {
+		dns_renderedanswer_detach(slot);
+	}
+	*slot = answer;
+	RWUNLOCK(&rc->lock, isc_rwlocktype_write);
+}
+
+void
+dns_rendercache_flush(dns_rendercache_t *rc) {
+	REQUIRE(VALID_RENDERCACHE(rc));
+
+	RWLOCK(&rc->lock, isc_rwlocktype_write);
+	flush(rc);
+	RWUNLOCK(&rc->lock, isc_rwlocktype_write);
+}
@@ -26,6 +26,7 @@
 #include <isc/log.h>
 #include <isc/loop.h>
 #include <isc/mutex.h>
+#include <isc/quota.h>
 #include <isc/random.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
@@ -227,6 +228,36 @@ STATIC_ASSERT(NS_PROCESSING_LIMIT > NS_RR_LIMIT,
 #define RES_DOMAIN_HASH_BITS 12
 #endif /* ifndef RES_DOMAIN_HASH_BITS */
 
+/*%
+ * The number of reset query and response messages kept for reuse on
+ * each loop.
+ */
+#ifndef RES_MESSAGEPOOL_SIZE
+#define RES_MESSAGEPOOL_SIZE 128
+#endif /* ifndef RES_MESSAGEPOOL_SIZE */
+
+/*%
+ * The maximum number of names known not to be zone cuts that are kept
+ * for QNAME minimization; the oldest are dropped first.
+ */
+#ifndef RES_NONCUTS_MAX
+#define RES_NONCUTS_MAX 4096
+#endif /* ifndef RES_NONCUTS_MAX */
+
+/*%
+ * A hedged query is sent to the next server when the best one has not
+ * answered within its SRTT, but never sooner than HEDGE_MIN_DELAY
+ * (in microseconds).  Each query sent earns the resolver 'hedgepercent'
+ * hundredths of a hedged query, and up to HEDGE_BURST hedged queries
+ * can be saved up.
+ */
+#ifndef HEDGE_MIN_DELAY
+#define HEDGE_MIN_DELAY (10 * US_PER_MS)
+#endif /* ifndef HEDGE_MIN_DELAY */
+#ifndef HEDGE_BURST
+#define HEDGE_BURST 100
+#endif /* ifndef HEDGE_BURST */
+
 /*%
  * Maximum EDNS0 input packet size.
  */
@@ -242,6 +273,7 @@ STATIC_ASSERT(NS_PROCESSING_LIMIT > NS_RR_LIMIT,
 	(((fctx)->res->lame_ttl > 30) ? (fctx)->res->lame_ttl : 30)
 
 typedef struct fetchctx fetchctx_t;
+typedef ISC_LIST(dns_fetchresponse_t) fetchresponselist_t;
 
 typedef struct query {
 	/* Locked by loop event serialization. */
@@ -288,9 +320,13 @@ struct tried {
 #define VALID_QUERY(query) ISC_MAGIC_VALID(query, QUERY_MAGIC)
 
 #define RESQUERY_ATTR_CANCELED 0x02
+#define RESQUERY_ATTR_HEDGED   0x04
+#define RESQUERY_ATTR_RACING   0x08
 
 #define RESQUERY_CONNECTING(q) ((q)->connects > 0)
 #define RESQUERY_CANCELED(q)   (((q)->attributes & RESQUERY_ATTR_CANCELED) != 0)
+#define RESQUERY_HEDGED(q)     (((q)->attributes & RESQUERY_ATTR_HEDGED) != 0)
+#define RESQUERY_RACING(q)     (((q)->attributes & RESQUERY_ATTR_RACING) != 0)
 #define RESQUERY_SENDING(q)    ((q)->sends > 0)
 
 typedef enum {
@@ -362,7 +398,7 @@ struct fetchctx {
 	bool cloned;
 	bool spilled;
 	ISC_LINK(struct fetchctx) link;
-	ISC_LIST(dns_fetchresponse_t) resps;
+	fetchresponselist_t resps;
 
 	/*% Locked by loop event serialization. */
 	dns_fixedname_t dfname;
@@ -370,6 +406,7 @@ struct fetchctx {
 	dns_rdataset_t nameservers;
 	atomic_uint_fast32_t attributes;
 	isc_timer_t *timer;
+	isc_timer_t *hedgetimer;
 	isc_time_t expires;
 	isc_time_t expires_try_stale;
 	isc_time_t next_timeout;
@@ -473,6 +510,7 @@ struct fetchctx {
 	unsigned int adberr;
 	unsigned int findfail;
 	unsigned int valfail;
+	unsigned int qminskip;
 	bool timeout;
 	dns_adbaddrinfo_t *addrinfo;
 	unsigned int depth;
@@ -539,6 +577,20 @@ typedef struct alternate {
 	ISC_LINK(struct alternate) link;
 } alternate_t;
 
+/*%
+ * A name that a QNAME minimization query found not to be a zone cut:
+ * either an empty non-terminal or a name with other data (NODATA for
+ * NS), or a name that does not exist at all (NXDOMAIN).
+ */
+typedef struct noncut noncut_t;
+struct noncut {
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	isc_stdtime_t expire;
+	bool nxdomain;
+	ISC_LINK(noncut_t) link;
+};
+
 struct dns_resolver {
 	/* Unlocked. */
 	unsigned int magic;
@@ -561,6 +613,16 @@ struct dns_resolver {
 	isc_hashmap_t *counters;
 	isc_rwlock_t counters_lock;
 
+	isc_hashmap_t *refreshes;
+	isc_mutex_t refreshes_lock;
+
+	isc_hashmap_t *noncuts;
+	ISC_LIST(noncut_t) noncutlist;
+	isc_mutex_t noncuts_lock;
+
+	uint32_t nloops;
+	dns_messagepool_t **msgpools;
+
 	uint32_t lame_ttl;
 	ISC_LIST(alternate_t) alternates;
 	dns_nametree_t *algorithms;
@@ -581,6 +643,9 @@ struct dns_resolver {
 	unsigned int retryinterval; /* in milliseconds */
 	unsigned int nonbackofftries;
 
+	unsigned int hedgepercent;
+	atomic_uint_fast32_t hedgecredit; /* in hundredths of queries */
+
 	/* Atomic */
 	isc_refcount_t references;
 	atomic_uint_fast32_t zspill; /* fetches-per-zone */
@@ -987,6 +1052,22 @@ valcreate(fetchctx_t *fctx, dns_message_t *message, dns_adbaddrinfo_t *addrinfo,
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Create a message, reusing one from the pool of the current loop if
+ * we are running on one.
+ */
+static void
+create_message(dns_resolver_t *res, isc_mem_t *mctx, unsigned int intent,
+	       dns_message_t **msgp) {
+	uint32_t tid = isc_tid();
+
+	if (tid < res->nloops) {
+		dns_message_createpooled(res->msgpools[tid], intent, msgp);
+	} else {
+		dns_message_create(mctx, intent, msgp);
+	}
+}
+
 static void
 resquery_destroy(resquery_t *query) {
 	fetchctx_t *fctx = query->fctx;
@@ -1124,6 +1205,8 @@ fctx_cancelquery(resquery_t **queryp, isc_time_t *finish, bool no_response,
 			rttms = rtt / US_PER_MS;
 			factor = DNS_ADB_RTTADJDEFAULT;
 
+			dns_adb_rttsample(fctx->adb, query->addrinfo, rtt);
+
 			if (rttms < DNS_RESOLVER_QRYRTTCLASS0) {
 				inc_stats(fctx->res,
 					  dns_resstatscounter_queryrtt0);
@@ -1335,6 +1418,10 @@ fctx_cancelqueries(fetchctx_t *fctx, bool no_response, bool age_untried) {
 
 	ISC_LIST_INIT(queries);
 
+	if (fctx->hedgetimer != NULL) {
+		isc_timer_stop(fctx->hedgetimer);
+	}
+
 	/*
 	 * Move the queries to a local list so we can cancel
 	 * them without holding the lock.
@@ -1353,7 +1440,15 @@ fctx_cancelqueries(fetchctx_t *fctx, bool no_response, bool age_untried) {
 		 * then it will try to unlink it from fctx->queries.
 		 */
 		ISC_LIST_UNLINK(queries, query, link);
-		fctx_cancelquery(&query, NULL, no_response, age_untried);
+
+		/*
+		 * A query sent alongside a hedged one (or the hedged
+		 * query itself) has only been outrun by the other one,
+		 * so its server is not penalized for the missing response.
+		 */
+		fctx_cancelquery(&query, NULL,
+				 no_response && !RESQUERY_RACING(query),
+				 age_untried);
 	}
 }
 
@@ -1525,9 +1620,50 @@ fcount_decr(fetchctx_t *fctx) {
 static void
 spillattimer_countdown(void *arg);
 
+/*
+ * Call the callbacks of a chain of responses built by post_responses();
+ * they are all for the current loop.
+ */
+static void
+send_responses(void *arg) {
+	dns_fetchresponse_t *resp = arg, *next = NULL;
+
+	for (; resp != NULL; resp = next) {
+		next = ISC_LIST_NEXT(resp, link);
+		ISC_LINK_INIT(resp, link);
+		resp->cb(resp);
+	}
+}
+
+/*
+ * Send the responses on 'list' to their loops.  Rather than posting each
+ * response separately, the responses for each loop are chained together
+ * and posted with a single job, so a fetch with many waiters costs one
+ * isc_async_run() per loop instead of one per waiter.
+ */
+static void
+post_responses(fetchresponselist_t *list) {
+	while (!ISC_LIST_EMPTY(*list)) {
+		dns_fetchresponse_t *head = ISC_LIST_HEAD(*list);
+		dns_fetchresponse_t *resp = NULL, *next = NULL;
+		fetchresponselist_t batch = ISC_LIST_INITIALIZER;
+
+		for (resp = head; resp != NULL; resp = next) {
+			next = ISC_LIST_NEXT(resp, link);
+			if (resp->loop == head->loop) {
+				ISC_LIST_UNLINK(*list, resp, link);
+				ISC_LIST_APPEND(batch, resp, link);
+			}
+		}
+
+		isc_async_run(head->loop, send_responses, head);
+	}
+}
+
 static void
 fctx_sendevents(fetchctx_t *fctx, isc_result_t result) {
 	dns_fetchresponse_t *resp = NULL, *next = NULL;
+	fetchresponselist_t sendlist = ISC_LIST_INITIALIZER;
 	unsigned int count = 0;
 	bool logit = false;
 	isc_time_t now;
@@ -1595,11 +1731,13 @@ fctx_sendevents(fetchctx_t *fctx, isc_result_t result) {
 			       resp->result == DNS_R_NCACHENXRRSET);
 		}
 
-		FCTXTRACE("post response event");
-		isc_async_run(resp->loop, resp->cb, resp);
+		ISC_LIST_APPEND(sendlist, resp, link);
 	}
 	UNLOCK(&fctx->lock);
 
+	FCTXTRACE("post response events");
+	post_responses(&sendlist);
+
 	if (HAVE_ANSWER(fctx) && fctx->spilled &&
 	    (count < fctx->res->spillatmax || fctx->res->spillatmax == 0))
 	{
@@ -1727,6 +1865,9 @@ fctx__done(fetchctx_t *fctx, isc_result_t result, const char *func,
 	fctx_cleanup(fctx);
 
 	isc_timer_destroy(&fctx->timer);
+	if (fctx->hedgetimer != NULL) {
+		isc_timer_destroy(&fctx->hedgetimer);
+	}
 
 	return (true);
 }
@@ -1881,6 +2022,7 @@ static isc_result_t
 resquery_timeout(resquery_t *query) {
 	fetchctx_t *fctx = query->fctx;
 	dns_fetchresponse_t *resp = NULL, *next = NULL;
+	fetchresponselist_t sendlist = ISC_LIST_INITIALIZER;
 	uint64_t timeleft;
 	isc_time_t now;
 
@@ -1917,10 +2059,12 @@ resquery_timeout(resquery_t *query) {
 		ISC_LIST_UNLINK(fctx->resps, resp, link);
 		resp->vresult = ISC_R_TIMEDOUT;
 		resp->result = ISC_R_TIMEDOUT;
-		isc_async_run(resp->loop, resp->cb, resp);
+		ISC_LIST_APPEND(sendlist, resp, link);
 	}
 	UNLOCK(&fctx->lock);
 
+	post_responses(&sendlist);
+
 	/*
 	 * If the next timeout is more than 1ms in the future,
 	 * resume waiting.
@@ -2008,8 +2152,8 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	 * remain valid until this query is canceled.
 	 */
 
-	dns_message_create(fctx->mctx, DNS_MESSAGE_INTENTPARSE,
-			   &query->rmessage);
+	create_message(fctx->res, fctx->mctx, DNS_MESSAGE_INTENTPARSE,
+		       &query->rmessage);
 	query->start = isc_time_now();
 
 	/*
@@ -3138,7 +3282,8 @@ add_bad(fetchctx_t *fctx, dns_message_t *rmessage, dns_adbaddrinfo_t *addrinfo,
 }
 
 /*
- * Sort addrinfo list by RTT.
+ * Sort addrinfo list by score: the 90th percentile RTT of the server,
+ * penalized by its failure rate.
  */
 static void
 sort_adbfind(dns_adbfind_t *find, unsigned int bias) {
@@ -3148,21 +3293,21 @@ sort_adbfind(dns_adbfind_t *find, unsigned int bias) {
 	/* Lame N^2 bubble sort. */
 	ISC_LIST_INIT(sorted);
 	while (!ISC_LIST_EMPTY(find->list)) {
-		unsigned int best_srtt;
+		unsigned int best_score;
 		best = ISC_LIST_HEAD(find->list);
-		best_srtt = best->srtt;
+		best_score = best->score;
 		if (isc_sockaddr_pf(&best->sockaddr) != AF_INET6) {
-			best_srtt += bias;
+			best_score += bias;
 		}
 		curr = ISC_LIST_NEXT(best, publink);
 		while (curr != NULL) {
-			unsigned int curr_srtt = curr->srtt;
+			unsigned int curr_score = curr->score;
 			if (isc_sockaddr_pf(&curr->sockaddr) != AF_INET6) {
-				curr_srtt += bias;
+				curr_score += bias;
 			}
-			if (curr_srtt < best_srtt) {
+			if (curr_score < best_score) {
 				best = curr;
-				best_srtt = curr_srtt;
+				best_score = curr_score;
 			}
 			curr = ISC_LIST_NEXT(curr, publink);
 		}
@@ -3173,7 +3318,7 @@ sort_adbfind(dns_adbfind_t *find, unsigned int bias) {
 }
 
 /*
- * Sort a list of finds by server RTT.
+ * Sort a list of finds by server score.
  */
 static void
 sort_finds(dns_adbfindlist_t *findlist, unsigned int bias) {
@@ -3181,7 +3326,7 @@ sort_finds(dns_adbfindlist_t *findlist, unsigned int bias) {
 	dns_adbfindlist_t sorted;
 	dns_adbaddrinfo_t *addrinfo, *bestaddrinfo;
 
-	/* Sort each find's addrinfo list by SRTT. */
+	/* Sort each find's addrinfo list by score. */
 	for (curr = ISC_LIST_HEAD(*findlist); curr != NULL;
 	     curr = ISC_LIST_NEXT(curr, publink))
 	{
@@ -3191,26 +3336,26 @@ sort_finds(dns_adbfindlist_t *findlist, unsigned int bias) {
 	/* Lame N^2 bubble sort. */
 	ISC_LIST_INIT(sorted);
 	while (!ISC_LIST_EMPTY(*findlist)) {
-		unsigned int best_srtt;
+		unsigned int best_score;
 		best = ISC_LIST_HEAD(*findlist);
 		bestaddrinfo = ISC_LIST_HEAD(best->list);
 		INSIST(bestaddrinfo != NULL);
-		best_srtt = bestaddrinfo->srtt;
+		best_score = bestaddrinfo->score;
 		if (isc_sockaddr_pf(&bestaddrinfo->sockaddr) != AF_INET6) {
-			best_srtt += bias;
+			best_score += bias;
 		}
 		curr = ISC_LIST_NEXT(best, publink);
 		while (curr != NULL) {
-			unsigned int curr_srtt;
+			unsigned int curr_score;
 			addrinfo = ISC_LIST_HEAD(curr->list);
 			INSIST(addrinfo != NULL);
-			curr_srtt = addrinfo->srtt;
+			curr_score = addrinfo->score;
 			if (isc_sockaddr_pf(&addrinfo->sockaddr) != AF_INET6) {
-				curr_srtt += bias;
+				curr_score += bias;
 			}
-			if (curr_srtt < best_srtt) {
+			if (curr_score < best_score) {
 				best = curr;
-				best_srtt = curr_srtt;
+				best_score = curr_score;
 			}
 			curr = ISC_LIST_NEXT(curr, publink);
 		}
@@ -3549,7 +3694,7 @@ fctx_getaddresses(fetchctx_t *fctx, bool badcache) {
 				}
 			}
 			cur = ISC_LIST_HEAD(fctx->forwaddrs);
-			while (cur != NULL && cur->srtt < ai->srtt) {
+			while (cur != NULL && cur->score < ai->score) {
 				cur = ISC_LIST_NEXT(cur, publink);
 			}
 			if (cur != NULL) {
@@ -3673,7 +3818,7 @@ normal_nses:
 				ai->flags |= FCTX_ADDRINFO_FORWARDER;
 				ai->flags |= FCTX_ADDRINFO_DUALSTACK;
 				cur = ISC_LIST_HEAD(fctx->altaddrs);
-				while (cur != NULL && cur->srtt < ai->srtt) {
+				while (cur != NULL && cur->score < ai->score) {
 					cur = ISC_LIST_NEXT(cur, publink);
 				}
 				if (cur != NULL) {
@@ -3965,7 +4110,7 @@ fctx_nextaddress(fetchctx_t *fctx) {
 		}
 		possibly_mark(fctx, addrinfo);
 		if (UNMARKED(addrinfo) &&
-		    (faddrinfo == NULL || addrinfo->srtt < faddrinfo->srtt))
+		    (faddrinfo == NULL || addrinfo->score < faddrinfo->score))
 		{
 			if (faddrinfo != NULL) {
 				faddrinfo->flags &= ~FCTX_ADDRINFO_MARK;
@@ -3983,6 +4128,114 @@ fctx_nextaddress(fetchctx_t *fctx) {
 	return (addrinfo);
 }
 
+/*
+ * Take one hedged query from the resolver's allowance, if there is one.
+ */
+static bool
+hedge_take(dns_resolver_t *res) {
+	uint_fast32_t credit = atomic_load_relaxed(&res->hedgecredit);
+
+	do {
+		if (credit < 100) {
+			return (false);
+		}
+	} while (!atomic_compare_exchange_weak_relaxed(&res->hedgecredit,
+							&credit, credit - 100));
+
+	return (true);
+}
+
+/*
+ * A query has been sent to 'addrinfo', the best server left: if it is
+ * still the only query in flight once the server's SRTT has passed,
+ * fctx_hedge() sends the query to the next server as well, and the
+ * first answer is used.
+ */
+static void
+fctx_starthedge(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo) {
+	dns_resolver_t *res = fctx->res;
+	isc_interval_t interval;
+	uint64_t us;
+
+	if (fctx->hedgetimer == NULL) {
+		return;
+	}
+
+	isc_timer_stop(fctx->hedgetimer);
+
+	if (atomic_load_relaxed(&res->hedgecredit) < HEDGE_BURST * 100) {
+		atomic_fetch_add_relaxed(&res->hedgecredit, res->hedgepercent);
+	}
+
+	/*
+	 * No point in hedging when the query will be retried first.
+	 */
+	us = ISC_MAX(addrinfo->srtt, HEDGE_MIN_DELAY);
+	if (us >= isc_interval_ms(&fctx->interval) * US_PER_MS) {
+		return;
+	}
+
+	isc_interval_set(&interval, us / US_PER_SEC,
+			 (us % US_PER_SEC) * NS_PER_US);
+	isc_timer_start(fctx->hedgetimer, isc_timertype_once, &interval);
+}
+
+static void
+fctx_hedge(void *arg) {
+	fetchctx_t *fctx = (fetchctx_t *)arg;
+	dns_resolver_t *res = NULL;
+	dns_adbaddrinfo_t *addrinfo = NULL;
+	resquery_t *query = NULL;
+	isc_result_t result;
+	bool hedge;
+
+	REQUIRE(VALID_FCTX(fctx));
+	REQUIRE(fctx->tid == isc_tid());
+
+	res = fctx->res;
+
+	LOCK(&fctx->lock);
+	query = ISC_LIST_HEAD(fctx->queries);
+	hedge = !SHUTTINGDOWN(fctx) && !ISC_LIST_EMPTY(fctx->resps) &&
+		query != NULL && ISC_LIST_NEXT(query, link) == NULL &&
+		(query->options & DNS_FETCHOPT_TCP) == 0;
+	UNLOCK(&fctx->lock);
+
+	if (!hedge || ADDRWAIT(fctx) || fctx->nsfetch != NULL ||
+	    !hedge_take(res))
+	{
+		return;
+	}
+
+	addrinfo = fctx_nextaddress(fctx);
+	while (addrinfo != NULL && dns_adb_overquota(fctx->adb, addrinfo)) {
+		addrinfo = fctx_nextaddress(fctx);
+	}
+
+	if (addrinfo == NULL ||
+	    isc_counter_increment(fctx->qc) != ISC_R_SUCCESS)
+	{
+		atomic_fetch_add_relaxed(&res->hedgecredit, 100);
+		return;
+	}
+
+	FCTXTRACE("hedge");
+
+	result = fctx_query(fctx, addrinfo, fctx->options);
+	if (result != ISC_R_SUCCESS) {
+		atomic_fetch_add_relaxed(&res->hedgecredit, 100);
+		return;
+	}
+
+	LOCK(&fctx->lock);
+	ISC_LIST_HEAD(fctx->queries)->attributes |= RESQUERY_ATTR_RACING;
+	query = ISC_LIST_TAIL(fctx->queries);
+	query->attributes |= RESQUERY_ATTR_HEDGED | RESQUERY_ATTR_RACING;
+	UNLOCK(&fctx->lock);
+
+	inc_stats(res, dns_resstatscounter_hedge);
+}
+
 static void
 fctx_try(fetchctx_t *fctx, bool retrying, bool badcache) {
 	isc_result_t result;
@@ -4131,6 +4384,7 @@ fctx_try(fetchctx_t *fctx, bool retrying, bool badcache) {
 	if (retrying) {
 		inc_stats(res, dns_resstatscounter_retry);
 	}
+	fctx_starthedge(fctx, addrinfo);
 
 done:
 	if (result != ISC_R_SUCCESS) {
@@ -4138,6 +4392,113 @@ done:
 	}
 }
 
+/*
+ * Names found not to be zone cuts by QNAME minimization queries are
+ * remembered for the TTL of the negative answer, so that later fetches
+ * for names below them skip the labels without asking again.  This is
+ * kept apart from the cache, where the negative answers may be evicted
+ * or expire sooner than the knowledge they carry is useful.
+ */
+static void
+noncut_free(dns_resolver_t *res, noncut_t *noncut) {
+	isc_result_t result;
+
+	result = isc_hashmap_delete(res->noncuts, NULL, noncut->name->ndata,
+				    noncut->name->length);
+	INSIST(result == ISC_R_SUCCESS);
+	ISC_LIST_UNLINK(res->noncutlist, noncut, link);
+	isc_mem_put(res->mctx, noncut, sizeof(*noncut));
+}
+
+static void
+noncut_add(dns_resolver_t *res, const dns_name_t *name, dns_ttl_t ttl,
+	   bool nxdomain) {
+	noncut_t *noncut = NULL;
+	uint32_t hashval;
+	isc_result_t result;
+
+	if (ttl == 0) {
+		return;
+	}
+
+	hashval = isc_hashmap_hash(res->noncuts, name->ndata, name->length);
+
+	LOCK(&res->noncuts_lock);
+	result = isc_hashmap_find(res->noncuts, &hashval, name->ndata,
+				  name->length, (void **)&noncut);
+	if (result == ISC_R_SUCCESS) {
+		ISC_LIST_UNLINK(res->noncutlist, noncut, link);
+	} else {
+		if (isc_hashmap_count(res->noncuts) >= RES_NONCUTS_MAX) {
+			noncut_free(res, ISC_LIST_HEAD(res->noncutlist));
+		}
+		noncut = isc_mem_get(res->mctx, sizeof(*noncut));
+		*noncut = (noncut_t){ .link = ISC_LINK_INITIALIZER };
+		noncut->name = dns_fixedname_initname(&noncut->fname);
+		dns_name_copy(name, noncut->name);
+		result = isc_hashmap_add(res->noncuts, &hashval,
+					 noncut->name->ndata,
+					 noncut->name->length, noncut);
+		INSIST(result == ISC_R_SUCCESS);
+	}
+	noncut->expire = isc_stdtime_now() + ttl;
+	noncut->nxdomain = nxdomain;
+	ISC_LIST_APPEND(res->noncutlist, noncut, link);
+	UNLOCK(&res->noncuts_lock);
+}
+
+/*
+ * Returns ISC_R_SUCCESS if 'name' is known not to be a zone cut,
+ * DNS_R_NXDOMAIN if it is known not to exist, and ISC_R_NOTFOUND
+ * otherwise.
+ */
+static isc_result_t
+noncut_find(dns_resolver_t *res, const dns_name_t *name) {
+	noncut_t *noncut = NULL;
+	uint32_t hashval;
+	isc_result_t result;
+
+	hashval = isc_hashmap_hash(res->noncuts, name->ndata, name->length);
+
+	LOCK(&res->noncuts_lock);
+	result = isc_hashmap_find(res->noncuts, &hashval, name->ndata,
+				  name->length, (void **)&noncut);
+	if (result == ISC_R_SUCCESS) {
+		if (noncut->expire <= isc_stdtime_now()) {
+			noncut_free(res, noncut);
+			result = ISC_R_NOTFOUND;
+		} else if (noncut->nxdomain) {
+			result = DNS_R_NXDOMAIN;
+		}
+	}
+	UNLOCK(&res->noncuts_lock);
+
+	return (result);
+}
+
+/*
+ * Forget the names at 'name' (or also below it, if 'tree' is true), or
+ * all of them if 'name' is NULL.
+ */
+static void
+noncuts_flush(dns_resolver_t *res, const dns_name_t *name, bool tree) {
+	noncut_t *noncut = NULL, *next = NULL;
+
+	LOCK(&res->noncuts_lock);
+	for (noncut = ISC_LIST_HEAD(res->noncutlist); noncut != NULL;
+	     noncut = next)
+	{
+		next = ISC_LIST_NEXT(noncut, link);
+		if (name == NULL ||
+		    (tree ? dns_name_issubdomain(noncut->name, name)
+			  : dns_name_equal(noncut->name, name)))
+		{
+			noncut_free(res, noncut);
+		}
+	}
+	UNLOCK(&res->noncuts_lock);
+}
+
 static void
 resume_qmin(void *arg) {
 	dns_fetchresponse_t *resp = (dns_fetchresponse_t *)arg;
@@ -4167,11 +4528,28 @@ resume_qmin(void *arg) {
 		dns_db_detach(&resp->db);
 	}
 
+	result = resp->result;
+	switch (result) {
+	case DNS_R_NXDOMAIN:
+	case DNS_R_NCACHENXDOMAIN:
+	case DNS_R_NXRRSET:
+	case DNS_R_NCACHENXRRSET:
+		if (fctx->qmintype == dns_rdatatype_ns &&
+		    dns_rdataset_isassociated(resp->rdataset))
+		{
+			noncut_add(res, fctx->qminname, resp->rdataset->ttl,
+				   result == DNS_R_NXDOMAIN ||
+					   result == DNS_R_NCACHENXDOMAIN);
+		}
+		break;
+	default:
+		break;
+	}
+
 	if (dns_rdataset_isassociated(resp->rdataset)) {
 		dns_rdataset_disassociate(resp->rdataset);
 	}
 
-	result = resp->result;
 	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
 
 	LOCK(&fctx->lock);
@@ -4428,10 +4806,16 @@ fctx_add_event(fetchctx_t *fctx, isc_loop_t *loop, const isc_sockaddr_t *client,
 	       dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
 	       dns_fetch_t *fetch, int type) {
 	dns_fetchresponse_t *resp = NULL;
+	isc_mem_t *mctx = isc_loop_getmctx(loop);
 
 	FCTXTRACE("addevent");
 
-	resp = isc_mem_get(fctx->mctx, sizeof(*resp));
+	/*
+	 * The response is allocated from the memory context of the loop
+	 * it will be delivered to, and freed there by the callback, so
+	 * the waiters of a busy fetch don't all contend on fctx->mctx.
+	 */
+	resp = isc_mem_get(mctx, sizeof(*resp));
 	*resp = (dns_fetchresponse_t){
 		.result = DNS_R_SERVFAIL,
 		.qtype = fctx->type,
@@ -4446,7 +4830,7 @@ fctx_add_event(fetchctx_t *fctx, isc_loop_t *loop, const isc_sockaddr_t *client,
 		.arg = arg,
 		.link = ISC_LINK_INITIALIZER,
 	};
-	isc_mem_attach(fctx->mctx, &resp->mctx);
+	isc_mem_attach(mctx, &resp->mctx);
 
 	resp->foundname = dns_fixedname_initname(&resp->fname);
 
@@ -4694,8 +5078,8 @@ fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 		goto cleanup_fcount;
 	}
 
-	dns_message_create(fctx->mctx, DNS_MESSAGE_INTENTRENDER,
-			   &fctx->qmessage);
+	create_message(res, fctx->mctx, DNS_MESSAGE_INTENTRENDER,
+		       &fctx->qmessage);
 
 	/*
 	 * Compute an expiration time for the entire fetch.
@@ -4765,6 +5149,11 @@ fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 	inc_stats(res, dns_resstatscounter_nfetch);
 
 	isc_timer_create(fctx->loop, fctx_expired, fctx, &fctx->timer);
+	isc_timer_setcoarse(fctx->timer, true);
+	if (res->hedgepercent > 0) {
+		isc_timer_create(fctx->loop, fctx_hedge, fctx,
+				 &fctx->hedgetimer);
+	}
 
 	*fctxp = fctx;
 
@@ -7337,6 +7726,18 @@ resquery_response(isc_result_t eresult, isc_region_t *region, void *arg) {
 	fctx->timeout = false;
 	fctx->timeouts = 0;
 
+	if (RESQUERY_HEDGED(query)) {
+		resquery_t *first = NULL;
+
+		/* The query it was sent alongside is still in flight */
+		LOCK(&fctx->lock);
+		first = ISC_LIST_HEAD(fctx->queries);
+		UNLOCK(&fctx->lock);
+		if (first != query) {
+			inc_stats(fctx->res, dns_resstatscounter_hedgewin);
+		}
+	}
+
 	/*
 	 * Check whether the dispatcher has failed; if so we're done
 	 */
@@ -9875,6 +10276,21 @@ dns_resolver__destroy(dns_resolver_t *res) {
 	isc_hashmap_destroy(&res->counters);
 	isc_rwlock_destroy(&res->counters_lock);
 
+	INSIST(isc_hashmap_count(res->refreshes) == 0);
+	isc_hashmap_destroy(&res->refreshes);
+	isc_mutex_destroy(&res->refreshes_lock);
+
+	noncuts_flush(res, NULL, false);
+	INSIST(isc_hashmap_count(res->noncuts) == 0);
+	isc_hashmap_destroy(&res->noncuts);
+	isc_mutex_destroy(&res->noncuts_lock);
+
+	for (uint32_t i = 0; i < res->nloops; i++) {
+		dns_messagepool_destroy(&res->msgpools[i]);
+	}
+	isc_mem_cput(res->mctx, res->msgpools, res->nloops,
+		     sizeof(res->msgpools[0]));
+
 	if (res->dispatches4 != NULL) {
 		dns_dispatchset_destroy(&res->dispatches4);
 	}
@@ -9983,6 +10399,24 @@ dns_resolver_create(dns_view_t *view, isc_loopmgr_t *loopmgr,
 			   ISC_HASHMAP_CASE_INSENSITIVE, &res->counters);
 	isc_rwlock_init(&res->counters_lock);
 
+	/* The keys are built like the fetch context keys */
+	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS,
+			   ISC_HASHMAP_CASE_SENSITIVE, &res->refreshes);
+	isc_mutex_init(&res->refreshes_lock);
+
+	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS,
+			   ISC_HASHMAP_CASE_INSENSITIVE, &res->noncuts);
+	ISC_LIST_INIT(res->noncutlist);
+	isc_mutex_init(&res->noncuts_lock);
+
+	res->nloops = isc_loopmgr_nloops(loopmgr);
+	res->msgpools = isc_mem_cget(res->mctx, res->nloops,
+				     sizeof(res->msgpools[0]));
+	for (uint32_t i = 0; i < res->nloops; i++) {
+		dns_messagepool_create(res->mctx, i, RES_MESSAGEPOOL_SIZE,
+				       &res->msgpools[i]);
+	}
+
 	if (dispatchv4 != NULL) {
 		dns_dispatchset_create(res->mctx, dispatchv4, &res->dispatches4,
 				       ndisp);
@@ -10241,6 +10675,30 @@ fctx_minimize_qname(fetchctx_t *fctx) {
 			 */
 			dns_name_split(fctx->name, fctx->qmin_labels, NULL,
 				       &name);
+
+			/*
+			 * Skip the names that earlier fetches found not to
+			 * be zone cuts.  Below a name that does not exist,
+			 * relaxed mode gives up minimizing anyway, so the
+			 * full name is asked for straight away.
+			 */
+			result = noncut_find(fctx->res, &name);
+			if (result == DNS_R_NXDOMAIN &&
+			    (fctx->options & DNS_FETCHOPT_QMIN_STRICT) == 0)
+			{
+				fctx->qminskip++;
+				fctx->qmin_labels = nlabels;
+				inc_stats(fctx->res,
+					  dns_resstatscounter_qminskip);
+				break;
+			} else if (result == ISC_R_SUCCESS) {
+				fctx->qminskip++;
+				fctx->qmin_labels++;
+				inc_stats(fctx->res,
+					  dns_resstatscounter_qminskip);
+				continue;
+			}
+
 			/*
 			 * Look to see if we have anything cached about NS
 			 * RRsets at this name and if so skip this name and
@@ -10644,6 +11102,211 @@ dns_resolver_destroyfetch(dns_fetch_t **fetchp) {
 	dns_resolver_detach(&res);
 }
 
+/*
+ * A background refresh of a stale RRset, see dns_resolver_refresh().
+ */
+typedef struct refresh {
+	isc_mem_t *mctx;
+	dns_resolver_t *res;
+	dns_db_t *cache;
+	dns_fetch_t *fetch;
+	isc_quota_t *quota;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	dns_rdatatype_t type;
+	uint32_t hashval;
+	fctxkey_t key;
+} refresh_t;
+
+/*
+ * If the refresh failed, start the stale-refresh-time window for the
+ * RRset, so that the stale data are used without trying to refresh
+ * them again for a while.
+ */
+static void
+refresh_failed(refresh_t *refresh, isc_result_t result) {
+	dns_fixedname_t ffound;
+	dns_name_t *found = dns_fixedname_initname(&ffound);
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset;
+	char namebuf[DNS_NAME_FORMATSIZE];
+	char typebuf[DNS_RDATATYPE_FORMATSIZE];
+
+	switch (result) {
+	case ISC_R_SUCCESS:
+	case DNS_R_GLUE:
+	case DNS_R_ZONECUT:
+	case ISC_R_NOTFOUND:
+	case DNS_R_DELEGATION:
+	case DNS_R_EMPTYNAME:
+	case DNS_R_NXRRSET:
+	case DNS_R_EMPTYWILD:
+	case DNS_R_NXDOMAIN:
+	case DNS_R_COVERINGNSEC:
+	case DNS_R_NCACHENXDOMAIN:
+	case DNS_R_NCACHENXRRSET:
+	case DNS_R_CNAME:
+	case DNS_R_DNAME:
+		return;
+	default:
+		break;
+	}
+
+	dns_name_format(refresh->name, namebuf, sizeof(namebuf));
+	dns_rdatatype_format(refresh->type, typebuf, sizeof(typebuf));
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_RESOLVER,
+		      DNS_LOGMODULE_RESOLVER, ISC_LOG_NOTICE,
+		      "%s/%s stale refresh failed: timed out", namebuf,
+		      typebuf);
+
+	dns_rdataset_init(&rdataset);
+	(void)dns_db_find(refresh->cache, refresh->name, NULL, refresh->type,
+			  DNS_DBFIND_STALEOK | DNS_DBFIND_STALESTART,
+			  isc_stdtime_now(), &node, found, &rdataset, NULL);
+	if (dns_rdataset_isassociated(&rdataset)) {
+		dns_rdataset_disassociate(&rdataset);
+	}
+	if (node != NULL) {
+		dns_db_detachnode(refresh->cache, &node);
+	}
+}
+
+static void
+refresh_done(void *arg) {
+	dns_fetchresponse_t *resp = (dns_fetchresponse_t *)arg;
+	refresh_t *refresh = resp->arg;
+	dns_resolver_t *res = refresh->res;
+	isc_result_t result;
+
+	REQUIRE(resp->type == FETCHDONE);
+	REQUIRE(VALID_RESOLVER(res));
+
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	if (dns_rdataset_isassociated(resp->rdataset)) {
+		dns_rdataset_disassociate(resp->rdataset);
+	}
+	INSIST(resp->sigrdataset == NULL);
+
+	refresh_failed(refresh, resp->result);
+
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+	dns_resolver_destroyfetch(&refresh->fetch);
+
+	LOCK(&res->refreshes_lock);
+	result = isc_hashmap_delete(res->refreshes, &refresh->hashval,
+				    refresh->key.key, refresh->key.size);
+	INSIST(result == ISC_R_SUCCESS);
+	UNLOCK(&res->refreshes_lock);
+
+	if (refresh->quota != NULL) {
+		isc_quota_release(refresh->quota);
+	}
+	dns_db_detach(&refresh->cache);
+	isc_mem_putanddetach(&refresh->mctx, refresh, sizeof(*refresh));
+	dns_resolver_detach(&res);
+}
+
+isc_result_t
+dns_resolver_refresh(dns_resolver_t *res, const dns_name_t *name,
+		     dns_rdatatype_t type, unsigned int options,
+		     isc_quota_t *quota, isc_loop_t *loop) {
+	refresh_t *refresh = NULL;
+	isc_mem_t *mctx = isc_loop_getmctx(loop);
+	isc_result_t result;
+
+	REQUIRE(VALID_RESOLVER(res));
+	REQUIRE(res->frozen);
+
+	if (atomic_load_acquire(&res->exiting) || res->view->cachedb == NULL) {
+		return (ISC_R_SHUTTINGDOWN);
+	}
+
+	refresh = isc_mem_get(mctx, sizeof(*refresh));
+	*refresh = (refresh_t){
+		.type = type,
+		.key = { .size = sizeof(unsigned int) +
+				 sizeof(dns_rdatatype_t) + name->length },
+	};
+	refresh->key.options = options;
+	refresh->key.type = type;
+	isc_ascii_lowercopy(refresh->key.name, name->ndata, name->length);
+	refresh->hashval = isc_hashmap_hash(res->refreshes, refresh->key.key,
+					    refresh->key.size);
+
+	/*
+	 * Only one refresh of an RRset runs at a time; any further stale
+	 * answers given meanwhile don't need another one.
+	 */
+	LOCK(&res->refreshes_lock);
+	result = isc_hashmap_add(res->refreshes, &refresh->hashval,
+				 refresh->key.key, refresh->key.size, refresh);
+	UNLOCK(&res->refreshes_lock);
+	if (result != ISC_R_SUCCESS) {
+		isc_mem_put(mctx, refresh, sizeof(*refresh));
+		inc_stats(res, dns_resstatscounter_stalerefreshdup);
+		return (result);
+	}
+
+	/*
+	 * A refresh is charged to 'quota' like the recursion of a client,
+	 * but it is not worth more than the clients waiting for an answer:
+	 * it is skipped as soon as the soft limit is reached, and the stale
+	 * data keep being served.
+	 */
+	if (quota != NULL) {
+		result = isc_quota_acquire(quota);
+		if (result == ISC_R_SOFTQUOTA) {
+			isc_quota_release(quota);
+			result = ISC_R_QUOTA;
+		}
+		if (result != ISC_R_SUCCESS) {
+			inc_stats(res, dns_resstatscounter_stalerefreshquota);
+			goto cleanup;
+		}
+		refresh->quota = quota;
+	}
+
+	isc_mem_attach(mctx, &refresh->mctx);
+	dns_resolver_attach(res, &refresh->res);
+	dns_db_attach(res->view->cachedb, &refresh->cache);
+	refresh->name = dns_fixedname_initname(&refresh->fname);
+	dns_name_copy(name, refresh->name);
+	dns_rdataset_init(&refresh->rdataset);
+
+	result = dns_resolver_createfetch(
+		res, name, type, NULL, NULL, NULL, NULL, 0, options, 0, NULL,
+		loop, refresh_done, refresh, &refresh->rdataset, NULL,
+		&refresh->fetch);
+	if (result != ISC_R_SUCCESS) {
+		if (refresh->quota != NULL) {
+			isc_quota_release(refresh->quota);
+		}
+		dns_db_detach(&refresh->cache);
+		dns_resolver_detach(&refresh->res);
+		isc_mem_detach(&refresh->mctx);
+		goto cleanup;
+	}
+
+	inc_stats(res, dns_resstatscounter_stalerefresh);
+
+	return (ISC_R_SUCCESS);
+
+cleanup:
+	LOCK(&res->refreshes_lock);
+	(void)isc_hashmap_delete(res->refreshes, &refresh->hashval,
+				 refresh->key.key, refresh->key.size);
+	UNLOCK(&res->refreshes_lock);
+
+	isc_mem_put(mctx, refresh, sizeof(*refresh));
+	return (result);
+}
+
 void
 dns_resolver_logfetch(dns_fetch_t *fetch, isc_log_t *lctx,
 		      isc_logcategory_t *category, isc_logmodule_t *module,
@@ -10665,7 +11328,8 @@ dns_resolver_logfetch(dns_fetch_t *fetch, isc_log_t *lctx,
 			      "%06" PRIu64 ": %s/%s "
 			      "[domain:%s,referral:%u,restart:%u,qrysent:%u,"
 			      "timeout:%u,lame:%u,quota:%u,neterr:%u,"
-			      "badresp:%u,adberr:%u,findfail:%u,valfail:%u]",
+			      "badresp:%u,adberr:%u,findfail:%u,valfail:%u,"
+			      "qminskip:%u]",
 			      fctx->info, fctx->duration / US_PER_SEC,
 			      fctx->duration % US_PER_SEC,
 			      isc_result_totext(fctx->result),
@@ -10673,7 +11337,7 @@ dns_resolver_logfetch(dns_fetch_t *fetch, isc_log_t *lctx,
 			      fctx->referrals, fctx->restarts, fctx->querysent,
 			      fctx->timeouts, fctx->lamecount, fctx->quotacount,
 			      fctx->neterr, fctx->badresp, fctx->adberr,
-			      fctx->findfail, fctx->valfail);
+			      fctx->findfail, fctx->valfail, fctx->qminskip);
 		fctx->logged = true;
 	}
 
@@ -10734,11 +11398,13 @@ dns_resolver_flushbadcache(dns_resolver_t *resolver, const dns_name_t *name) {
 	} else {
 		dns_badcache_flush(resolver->badcache);
 	}
+	noncuts_flush(resolver, name, false);
 }
 
 void
 dns_resolver_flushbadnames(dns_resolver_t *resolver, const dns_name_t *name) {
 	dns_badcache_flushtree(resolver->badcache, name);
+	noncuts_flush(resolver, name, true);
 }
 
 void
@@ -11079,6 +11745,21 @@ dns_resolver_setnonbackofftries(dns_resolver_t *resolver, unsigned int tries) {
 	resolver->nonbackofftries = tries;
 }
 
+unsigned int
+dns_resolver_gethedgepercent(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (resolver->hedgepercent);
+}
+
+void
+dns_resolver_sethedgepercent(dns_resolver_t *resolver, unsigned int percent) {
+	REQUIRE(VALID_RESOLVER(resolver));
+	REQUIRE(percent <= 100);
+
+	resolver->hedgepercent = percent;
+}
+
 void
 dns_resolver_setstats(dns_resolver_t *res, isc_stats_t *stats) {
 	REQUIRE(VALID_RESOLVER(res));
@@ -76,6 +76,7 @@
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
 #include <dns/remote.h>
+#include <dns/rendercache.h>
 #include <dns/request.h>
 #include <dns/resolver.h>
 #include <dns/rriterator.h>
@@ -383,6 +384,11 @@ struct dns_zone {
 	isc_stats_t *requeststats;
 	dns_stats_t *rcvquerystats;
 	dns_stats_t *dnssecsignstats;
+	/*%
+	 * Optional cache of rendered answers, created on first use and
+	 * kept until the zone is freed.
+	 */
+	atomic_ptr(dns_rendercache_t) rendercache;
 	uint32_t notifydelay;
 	dns_isselffunc_t isself;
 	void *isselfarg;
@@ -1187,6 +1193,7 @@ zone_free(dns_zone_t *zone) {
 	dns_signing_t *signing = NULL;
 	dns_nsec3chain_t *nsec3chain = NULL;
 	dns_include_t *include = NULL;
+	dns_rendercache_t *rendercache = NULL;
 
 	REQUIRE(DNS_ZONE_VALID(zone));
 	REQUIRE(!LOCKED_ZONE(zone));
@@ -1282,6 +1289,10 @@ zone_free(dns_zone_t *zone) {
 	if (zone->db != NULL) {
 		zone_detachdb(zone);
 	}
+	rendercache = atomic_exchange_relaxed(&zone->rendercache, NULL);
+	if (rendercache != NULL) {
+		dns_rendercache_detach(&rendercache);
+	}
 	if (zone->rpzs != NULL) {
 		REQUIRE(zone->rpz_num < zone->rpzs->p.num_zones);
 		dns_rpz_detach_rpzs(&zone->rpzs);
@@ -11834,6 +11845,36 @@ dns_zone_setmaxretrytime(dns_zone_t *zone, uint32_t val) {
 	zone->maxretry = val;
 }
 
+void
+dns_zone_setrendercachesize(dns_zone_t *zone, uint32_t size) {
+	dns_rendercache_t *rc = NULL;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	rc = atomic_load_acquire(&zone->rendercache);
+	if (rc != NULL) {
+		/*
+		 * This is called when the zone is (re)configured: the
+		 * answers rendered under the old configuration of the
+		 * views may no longer be valid.
+		 */
+		dns_rendercache_setsize(rc, size);
+		dns_rendercache_flush(rc);
+	} else if (size > 0) {
+		dns_rendercache_create(zone->mctx, size, &rc);
+		atomic_store_release(&zone->rendercache, rc);
+	}
+	UNLOCK_ZONE(zone);
+}
+
+dns_rendercache_t *
+dns_zone_getrendercache(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	return (atomic_load_acquire(&zone->rendercache));
+}
+
 uint32_t
 dns_zone_getmaxrecords(dns_zone_t *zone) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -17115,6 +17156,9 @@ zone_detachdb(dns_zone_t *zone) {
 
 	dns_zone_rpz_disable_db(zone, zone->db);
 	dns_zone_catz_disable_db(zone, zone->db);
+	if (atomic_load_acquire(&zone->rendercache) != NULL) {
+		dns_rendercache_flush(atomic_load_acquire(&zone->rendercache));
+	}
 	dns_db_detach(&zone->db);
 }
 
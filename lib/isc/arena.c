@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <stdalign.h>
+#include <stddef.h>
+
+#include <isc/arena.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/overflow.h>
+#include <isc/util.h>
+
+#define ARENA_MAGIC    ISC_MAGIC('A', 'r', 'n', 'a')
+#define VALID_ARENA(a) ISC_MAGIC_VALID(a, ARENA_MAGIC)
+
+#define ARENA_ALIGN    alignof(max_align_t)
+#define ARENA_ROUND(s) (((s) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/*
+ * All the chunks are at least 'chunksize' bytes long, so an allocation
+ * which fits in a chunk can always use the next chunk of the list, and
+ * only the allocations larger than 'chunksize' make the list grow
+ * after the first use of the arena.
+ */
+
+typedef struct chunk chunk_t;
+struct chunk {
+	chunk_t *next;
+	size_t size;
+	size_t used;
+	alignas(max_align_t) unsigned char data[];
+};
+
+struct isc_arena {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	size_t chunksize;
+	size_t total;
+	chunk_t *first;
+	chunk_t *current;
+};
+
+static chunk_t *
+chunk_new(isc_arena_t *arena, size_t size) {
+	chunk_t *chunk = isc_mem_get(arena->mctx,
+				     ISC_CHECKED_ADD(sizeof(*chunk), size));
+	*chunk = (chunk_t){ .size = size };
+	arena->total += size;
+	return (chunk);
+}
+
+void
+isc_arena_create(isc_mem_t *mctx, size_t chunksize, isc_arena_t **arenap) {
+	isc_arena_t *arena = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(chunksize > 0);
+	REQUIRE(arenap != NULL && *arenap == NULL);
+
+	arena = isc_mem_get(mctx, sizeof(*arena));
+	*arena = (isc_arena_t){
+		.chunksize = ARENA_ROUND(chunksize),
+	};
+	isc_mem_attach(mctx, &arena->mctx);
+
+	arena->first = chunk_new(arena, arena->chunksize);
+	arena->current = arena->first;
+	arena->magic = ARENA_MAGIC;
+
+	*arenap = arena;
+}
+
+void
+isc_arena_destroy(isc_arena_t **arenap) {
+	isc_arena_t *arena = NULL;
+	chunk_t *chunk = NULL, *next = NULL;
+
+	REQUIRE(arenap != NULL && VALID_ARENA(*arenap));
+
+	arena = *arenap;
+	*arenap = NULL;
+
+	arena->magic = 0;
+	for (chunk = arena->first; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		isc_mem_put(arena->mctx, chunk, sizeof(*chunk) + chunk->size);
+	}
+	isc_mem_putanddetach(&arena->mctx, arena, sizeof(*arena));
+}
+
+void *
+isc_arena_get(isc_arena_t *arena, size_t size) {
+	chunk_t *chunk = NULL;
+	void *ptr = NULL;
+
+	REQUIRE(VALID_ARENA(arena));
+	REQUIRE(size > 0);
+
+	size = ARENA_ROUND(size);
+	chunk = arena->current;
+
+	if (chunk->size - chunk->used < size) {
+		/*
+		 * Move on to the next chunk, reusing it if it is large
+		 * enough or inserting a new one before it otherwise.
+		 */
+		chunk_t *next = chunk->next;
+
+		if (next == NULL || next->size < size) {
+			next = chunk_new(arena, ISC_MAX(arena->chunksize, size));
+			next->next = chunk->next;
+			chunk->next = next;
+		}
+		next->used = 0;
+		chunk = arena->current = next;
+	}
+
+	ptr = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return (ptr);
+}
+
+void
+isc_arena_mark(isc_arena_t *arena, isc_arenamark_t *mark) {
+	REQUIRE(VALID_ARENA(arena));
+	REQUIRE(mark != NULL);
+
+	*mark = (isc_arenamark_t){
+		.chunk = arena->current,
+		.used = arena->current->used,
+	};
+}
+
+void
+isc_arena_release(isc_arena_t *arena, const isc_arenamark_t *mark) {
+	chunk_t *chunk = NULL;
+
+	REQUIRE(VALID_ARENA(arena));
+	REQUIRE(mark != NULL && mark->chunk != NULL);
+
+	chunk = mark->chunk;
+	chunk->used = mark->used;
+	arena->current = chunk;
+}
+
+void
+isc_arena_reset(isc_arena_t *arena) {
+	REQUIRE(VALID_ARENA(arena));
+
+	arena->first->used = 0;
+	arena->current = arena->first;
+}
+
+size_t
+isc_arena_size(isc_arena_t *arena) {
+	REQUIRE(VALID_ARENA(arena));
+
+	return (arena->total);
+}
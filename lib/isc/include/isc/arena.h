@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file isc/arena.h
+ *
+ * \brief The isc_arena_t object is a bump pointer allocator for
+ * short-lived objects which all die together.
+ *
+ * Memory is carved out of large chunks taken from a memory context.
+ * Objects allocated from the arena are never freed individually;
+ * instead, the arena is rewound, either completely with
+ * isc_arena_reset(), or to a position saved earlier with
+ * isc_arena_mark(), which makes it possible to nest scopes of
+ * temporary allocations.
+ *
+ * The chunks are kept when the arena is rewound, so that an arena that
+ * is reset after each unit of work (e.g. a client request) reaches a
+ * steady state where it no longer allocates memory.  The memory of a
+ * rewound arena stays valid, with its old contents, until the arena is
+ * used again.
+ *
+ * MP:
+ *\li	The arena is not locked; it must only be used by a single thread
+ *	at a time.
+ */
+
+/***
+ *** Imports.
+ ***/
+
+#include <stddef.h>
+
+#include <isc/lang.h>
+#include <isc/types.h>
+
+/*****
+***** Types.
+*****/
+
+typedef struct isc_arenamark {
+	void  *chunk;
+	size_t used;
+} isc_arenamark_t;
+
+ISC_LANG_BEGINDECLS
+
+void
+isc_arena_create(isc_mem_t *mctx, size_t chunksize, isc_arena_t **arenap);
+/*%<
+ * Create an arena which allocates memory from 'mctx' in chunks of
+ * 'chunksize' bytes.  The first chunk is allocated immediately.
+ *
+ * Requires:
+ *\li	'mctx' is a valid memory context.
+ *\li	'chunksize' is not zero.
+ *\li	'arenap' is not NULL and '*arenap' is NULL.
+ */
+
+void
+isc_arena_destroy(isc_arena_t **arenap);
+/*%<
+ * Free all the memory held by the arena in '*arenap', and the arena
+ * itself.
+ *
+ * Requires:
+ *\li	'*arenap' is a valid arena.
+ *
+ * Ensures:
+ *\li	'*arenap' is NULL.
+ */
+
+void *
+isc_arena_get(isc_arena_t *arena, size_t size);
+/*%<
+ * Allocate 'size' bytes, suitably aligned for any type, from 'arena'.
+ * Allocations larger than the chunk size of the arena get a chunk of
+ * their own.
+ *
+ * Requires:
+ *\li	'arena' is a valid arena.
+ *\li	'size' is not zero.
+ */
+
+void
+isc_arena_mark(isc_arena_t *arena, isc_arenamark_t *mark);
+/*%<
+ * Save the current position of 'arena' in 'mark'.
+ *
+ * Requires:
+ *\li	'arena' is a valid arena.
+ *\li	'mark' is not NULL.
+ */
+
+void
+isc_arena_release(isc_arena_t *arena, const isc_arenamark_t *mark);
+/*%<
+ * Rewind 'arena' to the position saved in 'mark', releasing all the
+ * memory allocated since.  Marks taken after 'mark' become invalid.
+ *
+ * Requires:
+ *\li	'arena' is a valid arena.
+ *\li	'mark' was set by isc_arena_mark() on 'arena', and the arena has
+ *	not been rewound past it since.
+ */
+
+void
+isc_arena_reset(isc_arena_t *arena);
+/*%<
+ * Rewind 'arena' to its beginning, releasing all the memory allocated
+ * from it.  All the marks become invalid.
+ *
+ * Requires:
+ *\li	'arena' is a valid arena.
+ */
+
+size_t
+isc_arena_size(isc_arena_t *arena);
+/*%<
+ * Return the total size of the chunks held by 'arena'.
+ *
+ * Requires:
+ *\li	'arena' is a valid arena.
+ */
+
+ISC_LANG_ENDDECLS
@@ -612,6 +612,25 @@ isc_nm_http_set_endpoints(isc_nmsocket_t	  *listener,
  * \li	'eps' is a valid pointer to an HTTP endpoints set.
  */
 
+void
+isc_nm_http_set_response_cache_size(isc_nmsocket_t *listener,
+				    const uint32_t  max_entries);
+/*%<
+ * Set the maximum number of responses to DNS-over-HTTPS GET requests
+ * kept in the per-worker response caches of the listener. Identical GET
+ * requests (ignoring the DNS message ID) are then answered directly
+ * from the cache for as long as the "max-age" of the cached response
+ * allows, and revalidation requests carrying a matching "If-None-Match"
+ * header are answered with "304 Not Modified".
+ *
+ * Only responses for which a non-zero "max-age" was set (see
+ * isc_nm_set_maxage()) are cached. Setting 'max_entries' to '0' (the
+ * default) disables the cache.
+ *
+ * Requires:
+ * \li	'listener' is a pointer to a valid network manager HTTP listener socket.
+ */
+
 #endif /* HAVE_LIBNGHTTP2 */
 
 void
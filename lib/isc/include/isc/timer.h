@@ -110,6 +110,24 @@ isc_timer_stop(isc_timer_t *timer);
  *\li	'timer' is a valid timer
  */
 
+void
+isc_timer_setcoarse(isc_timer_t *timer, bool coarse);
+/*%<
+ * Set whether the timer is 'coarse'.  Coarse timers are kept in a timing
+ * wheel on the timer's loop, which makes starting, restarting and stopping
+ * them cheap, at the price of firing up to 10 milliseconds late.
+ * This is meant for timeouts that are mostly restarted or stopped before
+ * they fire, like query and read timeouts.
+ *
+ * Requires:
+ *
+ *\li	'timer' is a valid timer
+ *
+ *\li	The timer is not running
+ *
+ *\li	The caller is running on the timer's loop
+ */
+
 void
 isc_timer_start(isc_timer_t *timer, isc_timertype_t type,
 		const isc_interval_t *interval);
@@ -586,6 +586,163 @@ isc_tlsctx_set_random_session_id_context(isc_tlsctx_t *ctx);
  *\li   'ctx' - a valid non-NULL pointer;
  */
 
+#define ISC_TLSCTX_TICKETKEYS_MAX 3
+
+typedef struct isc_tlsctx_ticketkeys isc_tlsctx_ticketkeys_t;
+/*%<
+ * A reference counted ring of TLS session ticket keys (see RFC5077).
+ *
+ * By default, OpenSSL generates ticket keys for every TLS context
+ * separately, which means that the tickets issued by a context cannot
+ * be used with any other context, including the contexts created on
+ * reconfiguration. A key ring can be shared by multiple server-side
+ * contexts and can outlive them. The most recent key in the ring is used
+ * to issue new tickets, while the older keys are kept to accept the
+ * tickets issued before the most recent rotation.
+ *
+ * The ring also keeps the number of the full and resumed server-side
+ * TLS handshakes done by the contexts using it.
+ */
+
+void
+isc_tlsctx_ticketkeys_create(isc_mem_t *mctx, isc_tlsctx_ticketkeys_t **keysp);
+/*%<
+ * Create a new session ticket key ring containing a single randomly
+ * generated key.
+ *
+ * Requires:
+ *\li	'mctx' - a valid memory context;
+ *\li	'keysp' - a valid pointer to a pointer which must be equal to NULL.
+ */
+
+void
+isc_tlsctx_ticketkeys_attach(isc_tlsctx_ticketkeys_t  *source,
+			     isc_tlsctx_ticketkeys_t **targetp);
+/*%<
+ * Create a reference to the session ticket key ring.
+ *
+ * Requires:
+ *\li	'source' - a valid key ring object;
+ *\li	'targetp' - a valid pointer to a pointer which must equal NULL.
+ */
+
+void
+isc_tlsctx_ticketkeys_detach(isc_tlsctx_ticketkeys_t **keysp);
+/*%<
+ * Remove a reference to the session ticket key ring. If the reference
+ * counter reaches zero, the keys are wiped and the object is destroyed.
+ *
+ * Requires:
+ *\li	'keysp' - a valid pointer to a pointer to a valid key ring object.
+ */
+
+void
+isc_tlsctx_ticketkeys_rotate(isc_tlsctx_ticketkeys_t *keys);
+/*%<
+ * Generate a new key to be used for issuing session tickets. The
+ * previous keys are kept for decryption only, up to
+ * #ISC_TLSCTX_TICKETKEYS_MAX keys in total; the oldest key is
+ * discarded once the ring is full. The tickets encrypted with a key
+ * other than the most recent one get renewed on resumption.
+ *
+ * Requires:
+ *\li	'keys' - a valid key ring object.
+ */
+
+isc_result_t
+isc_tlsctx_ticketkeys_load(isc_tlsctx_ticketkeys_t *keys, const char *filename);
+/*%<
+ * Replace the contents of the key ring with the keys stored in the
+ * file 'filename' by isc_tlsctx_ticketkeys_save().
+ *
+ * Requires:
+ *\li	'keys' - a valid key ring object;
+ *\li	'filename' - a valid non-NULL string.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS - the keys have been loaded;
+ *\li	#ISC_R_UNEXPECTEDEND - the file is malformed;
+ *\li	other errors returned by isc_stdio_open() and isc_stdio_read().
+ */
+
+isc_result_t
+isc_tlsctx_ticketkeys_save(isc_tlsctx_ticketkeys_t *keys, const char *filename);
+/*%<
+ * Atomically replace the file 'filename' with a file, readable by the
+ * owner only, containing the keys from the key ring.
+ *
+ * Requires:
+ *\li	'keys' - a valid key ring object;
+ *\li	'filename' - a valid non-NULL string.
+ */
+
+void
+isc_tlsctx_ticketkeys_getstats(isc_tlsctx_ticketkeys_t *keys, uint64_t *fullp,
+			       uint64_t *resumedp);
+/*%<
+ * Get the number of the full and resumed server-side handshakes
+ * accounted by isc_tls_account_handshake() for the contexts using the
+ * key ring.
+ *
+ * Requires:
+ *\li	'keys' - a valid key ring object;
+ *\li	'fullp' and 'resumedp' - valid non-NULL pointers.
+ */
+
+void
+isc_tlsctx_set_ticketkeys(isc_tlsctx_t *ctx, isc_tlsctx_ticketkeys_t *keys,
+			  const char *name);
+/*%<
+ * Make the server TLS context 'ctx' use the session ticket key ring
+ * 'keys' for session tickets encryption and decryption. The context
+ * keeps a reference to the key ring until it is freed.
+ *
+ * The session ID context of 'ctx' is derived from the key ring and
+ * 'name' (which is expected to be the name of the 'tls' statement the
+ * context was created from) so that the sessions stay resumable across
+ * all the contexts created from the same configuration. This function
+ * is meant to be used instead of
+ * isc_tlsctx_set_random_session_id_context().
+ *
+ * Requires:
+ *\li	'ctx' - a valid non-NULL pointer without a key ring set;
+ *\li	'keys' - a valid key ring object;
+ *\li	'name' - a valid non-NULL string.
+ */
+
+void
+isc_tls_account_handshake(isc_tls_t *tls);
+/*%<
+ * Account the just finished server-side handshake on 'tls' as either
+ * full or resumed in the key ring used by its TLS context. Does nothing
+ * if the context uses no key ring.
+ *
+ * Requires:
+ *\li	'tls' - a valid non-NULL pointer.
+ */
+
+void
+isc_tlsctx_cache_set_ticketkeys(isc_tlsctx_cache_t	*cache,
+				isc_tlsctx_ticketkeys_t *keys);
+/*%<
+ * Attach the session ticket key ring 'keys' to the TLS context cache so
+ * that it can be used for the server-side contexts stored in the cache.
+ *
+ * Requires:
+ *\li	'cache' - a valid TLS context cache object without a key ring;
+ *\li	'keys' - a valid key ring object.
+ */
+
+isc_tlsctx_ticketkeys_t *
+isc_tlsctx_cache_get_ticketkeys(isc_tlsctx_cache_t *cache);
+/*%<
+ * Return the session ticket key ring attached to the TLS context cache
+ * or NULL if there is none. No reference is created.
+ *
+ * Requires:
+ *\li	'cache' - a valid TLS context cache object.
+ */
+
 void
 isc__tls_initialize(void);
 
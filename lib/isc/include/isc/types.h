@@ -32,6 +32,7 @@
 
 /* Core Types.  Alphabetized by defined type. */
 
+typedef struct isc_arena  isc_arena_t;			  /*%< Arena */
 typedef struct isc_buffer isc_buffer_t;			  /*%< Buffer */
 typedef ISC_LIST(isc_buffer_t) isc_bufferlist_t;	  /*%< Buffer List */
 typedef struct isc_constregion	   isc_constregion_t;	  /*%< Const region */
@@ -151,6 +151,7 @@ destroy_cb(uv_async_t *handle) {
 	uv_close(&loop->destroy_trigger, NULL);
 	uv_close(&loop->pause_trigger, NULL);
 	uv_close(&loop->quiescent, NULL);
+	uv_close(&loop->wheel_timer, NULL);
 
 	uv_walk(&loop->loop, loop_walk_cb, (char *)"destroy_cb");
 }
@@ -220,6 +221,10 @@ loop_init(isc_loop_t *loop, isc_loopmgr_t *loopmgr, uint32_t tid) {
 	UV_RUNTIME_CHECK(uv_prepare_init, r);
 	uv_handle_set_data(&loop->quiescent, loop);
 
+	r = uv_timer_init(&loop->loop, &loop->wheel_timer);
+	UV_RUNTIME_CHECK(uv_timer_init, r);
+	uv_handle_set_data(&loop->wheel_timer, loop);
+
 	char name[16];
 	snprintf(name, sizeof(name), "loop-%08" PRIx32, tid);
 	isc_mem_create(&loop->mctx);
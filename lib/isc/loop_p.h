@@ -18,6 +18,7 @@
 #include <isc/barrier.h>
 #include <isc/job.h>
 #include <isc/lang.h>
+#include <isc/list.h>
 #include <isc/loop.h>
 #include <isc/magic.h>
 #include <isc/mem.h>
@@ -33,6 +34,23 @@
 #include "async_p.h"
 #include "job_p.h"
 
+/*
+ * Timing wheel for coarse timeouts, see timer.c.
+ */
+#define TIMERWHEEL_SLOTS 1024
+#define TIMERWHEEL_TICK	 10 /* milliseconds */
+
+typedef struct isc__wheelentry isc__wheelentry_t;
+typedef ISC_LIST(isc__wheelentry_t) isc__wheelslot_t;
+
+struct isc__wheelentry {
+	uint64_t expires; /* in ticks */
+	isc__wheelslot_t *slot;
+	isc_job_cb cb;
+	void *cbarg;
+	ISC_LINK(isc__wheelentry_t) link;
+};
+
 /*
  * Per-thread loop
  */
@@ -76,6 +94,12 @@ struct isc_loop {
 
 	/* safe memory reclamation */
 	uv_prepare_t quiescent;
+
+	/* Timing wheel */
+	uv_timer_t wheel_timer;
+	uint64_t wheel_now;
+	size_t wheel_count;
+	isc__wheelslot_t wheel[TIMERWHEEL_SLOTS];
 };
 
 /*
@@ -148,3 +172,23 @@ struct isc_work {
 #define CURRENT_LOOP(loopmgr) (&(loopmgr)->loops[isc_tid()])
 #define LOOP(loopmgr, tid)    (&(loopmgr)->loops[tid])
 #define ON_LOOP(loop)	      ((loop) == CURRENT_LOOP((loop)->loopmgr))
+
+void
+isc__wheel_start(isc_loop_t *loop, isc__wheelentry_t *entry, uint64_t timeout,
+		 isc_job_cb cb, void *cbarg);
+/*%<
+ * (Re)start 'entry' on the timing wheel of 'loop', to call 'cb' with
+ * 'cbarg' on the first tick of the wheel at least 'timeout' milliseconds
+ * from now.  Starting, restarting and stopping an entry are O(1), and
+ * all the entries of a loop are driven by a single libuv timer that only
+ * runs while the wheel is not empty.  The entry must be zeroed or
+ * stopped when it is first started.  Must be called from 'loop'.
+ */
+
+void
+isc__wheel_stop(isc_loop_t *loop, isc__wheelentry_t *entry);
+/*%<
+ * Stop 'entry', if it is running.  Must be called from 'loop'.
+ */
+
+#define ISC__WHEEL_ACTIVE(entry) ((entry)->slot != NULL)
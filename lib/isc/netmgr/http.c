@@ -20,9 +20,13 @@
 
 #include <isc/async.h>
 #include <isc/base64.h>
+#include <isc/hash.h>
+#include <isc/ht.h>
+#include <isc/job.h>
 #include <isc/log.h>
 #include <isc/netmgr.h>
 #include <isc/sockaddr.h>
+#include <isc/stdtime.h>
 #include <isc/tls.h>
 #include <isc/url.h>
 #include <isc/util.h>
@@ -66,14 +70,14 @@
 #define MIN_SUCCESSFUL_HTTP_STATUS (200)
 #define MAX_SUCCESSFUL_HTTP_STATUS (299)
 
-/* This definition sets the upper limit of pending write buffer to an
- * adequate enough value. That is done mostly to fight a limitation
- * for a max TLS record size in flamethrower (2K).  In a perfect world
- * this constant should not be required, if we ever move closer to
- * that state, the constant, and corresponding code, should be
- * removed. For now the limit seems adequate enough to fight
- * "tinygrams" problem. */
-#define FLUSH_HTTP_WRITE_BUFFER_AFTER (1536)
+/* This definition sets the upper limit of pending write buffer. The
+ * frames generated by nghttp2 are accumulated in the buffer and it is
+ * flushed at the end of the current event loop iteration, or as soon
+ * as it holds enough data to fill a TLS record of the maximum size
+ * (16K), whichever comes first. That way the responses to the streams
+ * processed within one loop iteration are sent in as few writes (and
+ * TLS records) as possible, fighting the "tinygrams" problem. */
+#define FLUSH_HTTP_WRITE_BUFFER_AFTER (16384)
 
 /* This switch is here mostly to test the code interoperability with
  * buggy implementations */
@@ -85,6 +89,18 @@
 
 #define INITIAL_DNS_MESSAGE_BUFFER_SIZE (512)
 
+/*
+ * The size of the DNS message header and of the message ID in it. The
+ * GET response cache zeroes the ID in both the key and the stored
+ * response and patches the requester's ID back in on a cache hit.
+ */
+#define DNS_MESSAGE_HEADER_SIZE (12)
+#define DNS_MESSAGE_ID_SIZE	(2)
+
+#define RESPCACHE_HT_BITS (10)
+
+#define MAX_IF_NONE_MATCH_LEN (512)
+
 typedef struct isc_nm_http_response_status {
 	size_t code;
 	size_t content_length;
@@ -155,6 +171,10 @@ struct isc_nm_http_session {
 
 	isc__nm_http_pending_callbacks_t pending_write_callbacks;
 	isc_buffer_t *pending_write_data;
+
+	isc_job_t flush_job;
+	bool flush_scheduled;
+	bool flushing;
 };
 
 typedef enum isc_http_error_responses {
@@ -179,6 +199,27 @@ typedef struct isc_http_send_req {
 	isc__nm_http_pending_callbacks_t pending_write_callbacks;
 } isc_http_send_req_t;
 
+typedef struct http_respcache_entry {
+	uint8_t *key;
+	size_t keylen;
+	uint8_t *data;
+	size_t datalen;
+	isc_stdtime_t expire;
+	uint64_t etag;
+	ISC_LINK(struct http_respcache_entry) link;
+} http_respcache_entry_t;
+
+/*
+ * There is one response cache per worker per listener, so it is only
+ * ever accessed from a single thread and needs no locking.
+ */
+typedef struct http_respcache {
+	isc_mem_t *mctx;
+	isc_ht_t *ht;
+	ISC_LIST(http_respcache_entry_t) lru;
+	size_t count;
+} http_respcache_t;
+
 #define HTTP_ENDPOINTS_MAGIC	ISC_MAGIC('H', 'T', 'E', 'P')
 #define VALID_HTTP_ENDPOINTS(t) ISC_MAGIC_VALID(t, HTTP_ENDPOINTS_MAGIC)
 
@@ -238,6 +279,18 @@ http_cleanup_listener_endpoints(isc_nmsocket_t *listener);
 static isc_nm_http_endpoints_t *
 http_get_listener_endpoints(isc_nmsocket_t *listener, const int tid);
 
+static void
+http_init_listener_respcaches(isc_nmsocket_t *listener);
+
+static void
+http_cleanup_listener_respcaches(isc_nmsocket_t *listener);
+
+static http_respcache_t *
+http_get_listener_respcache(isc_nmsocket_t *listener, const int tid);
+
+static void
+http_flush_listener_respcache(isc_nmsocket_t *listener, const int tid);
+
 static bool
 http_session_active(isc_nm_http_session_t *session) {
 	REQUIRE(VALID_HTTP2_SESSION(session));
@@ -1065,6 +1118,56 @@ move_pending_send_callbacks(isc_nm_http_session_t *session,
 	ISC_LIST_INIT(session->pending_write_callbacks);
 }
 
+static void
+http_flush_cb(void *arg) {
+	isc_nm_http_session_t *session = (isc_nm_http_session_t *)arg;
+
+	REQUIRE(VALID_HTTP2_SESSION(session));
+
+	session->flush_scheduled = false;
+
+	if (!session->closed) {
+		session->flushing = true;
+		http_do_bio(session, NULL, NULL, NULL);
+		session->flushing = false;
+	}
+
+	isc__nm_httpsession_detach(&session);
+}
+
+/*
+ * Flush the pending writes buffer at the end of the current loop
+ * iteration.
+ */
+static void
+http_schedule_flush(isc_nm_http_session_t *session) {
+	isc_nm_http_session_t *tmpsess = NULL;
+
+	if (session->flush_scheduled) {
+		return;
+	}
+
+	session->flush_scheduled = true;
+	isc__nm_httpsession_attach(session, &tmpsess);
+	isc_job_run(session->handle->sock->worker->loop, &session->flush_job,
+		    http_flush_cb, tmpsess);
+}
+
+static void
+add_pending_send_callback(isc_nm_http_session_t *session,
+			  isc_nmhandle_t *httphandle, isc_nm_cb_t cb,
+			  void *cbarg) {
+	isc__nm_uvreq_t *newcb = NULL;
+
+	INSIST(VALID_NMHANDLE(httphandle));
+
+	newcb = isc__nm_uvreq_get(httphandle->sock);
+	newcb->cb.send = cb;
+	newcb->cbarg = cbarg;
+	isc_nmhandle_attach(httphandle, &newcb->handle);
+	ISC_LIST_APPEND(session->pending_write_callbacks, newcb, link);
+}
+
 static bool
 http_send_outgoing(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
 		   isc_nm_cb_t cb, void *cbarg) {
@@ -1125,9 +1228,9 @@ http_send_outgoing(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
 	}
 
 	/*
-	 * Here we are trying to flush the pending writes buffer earlier
-	 * to avoid hitting unnecessary limitations on a TLS record size
-	 * within some tools (e.g. flamethrower).
+	 * Here we are trying to flush the pending writes buffer once it
+	 * is large enough, without waiting for the end of the loop
+	 * iteration.
 	 */
 	if (max_total_write_size >= FLUSH_HTTP_WRITE_BUFFER_AFTER) {
 		/*
@@ -1135,27 +1238,25 @@ http_send_outgoing(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
 		 * bytes to send. Let's flush it.
 		 */
 		total = max_total_write_size;
-	} else if (session->sending > 0 && total > 0) {
+	} else if (total > 0 && (session->sending > 0 || !session->flushing)) {
 		/*
-		 * Case 2: There is one or more write requests in flight and
-		 * we have some new data form nghttp2 to send. Let's put the
-		 * write callback (if any) into the pending write callbacks
-		 * list. Then let's return from the function: as soon as the
-		 * "in-flight" write callback get's called or we have reached
-		 * FLUSH_HTTP_WRITE_BUFFER_AFTER bytes in the write buffer, we
-		 * will flush the buffer.
+		 * Case 2: We have some new data from nghttp2 to send, and
+		 * either there is one or more write requests in flight, or
+		 * we are not at the end of the loop iteration yet. Let's
+		 * put the write callback (if any) into the pending write
+		 * callbacks list. Then let's return from the function: as
+		 * soon as the "in-flight" write callback gets called, the
+		 * loop iteration ends, or we have reached
+		 * FLUSH_HTTP_WRITE_BUFFER_AFTER bytes in the write buffer,
+		 * we will flush the buffer. That way the frames for all the
+		 * streams served within a loop iteration get coalesced.
 		 */
 		if (cb != NULL) {
-			isc__nm_uvreq_t *newcb = NULL;
-
-			INSIST(VALID_NMHANDLE(httphandle));
-
-			newcb = isc__nm_uvreq_get(httphandle->sock);
-			newcb->cb.send = cb;
-			newcb->cbarg = cbarg;
-			isc_nmhandle_attach(httphandle, &newcb->handle);
-			ISC_LIST_APPEND(session->pending_write_callbacks, newcb,
-					link);
+			add_pending_send_callback(session, httphandle, cb,
+						  cbarg);
+		}
+		if (session->sending == 0) {
+			http_schedule_flush(session);
 		}
 		goto nothing_to_send;
 	} else if (session->sending == 0 && total == 0 &&
@@ -1164,7 +1265,8 @@ http_send_outgoing(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
 		/*
 		 * Case 3: There is no write in flight and we haven't got
 		 * anything new from nghttp2, but there is some data pending
-		 * in the write buffer. Let's flush the buffer.
+		 * in the write buffer (e.g. because the previous write has
+		 * just completed). Let's flush the buffer.
 		 */
 		isc_region_t region = { 0 };
 		total = isc_buffer_usedlength(session->pending_write_data);
@@ -1183,8 +1285,9 @@ http_send_outgoing(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
 		 * Case 6: There is nothing new to send nor are there any
 		 * write requests in flight.
 		 *
-		 * Case 7: There is some new data to send and there are no
-		 * write requests in flight: Let's send the data.
+		 * Case 7: There is some new data to send, there are no
+		 * write requests in flight and we are at the end of the
+		 * loop iteration: Let's send the data.
 		 */
 		INSIST((total == 0 && session->pending_write_data == NULL) ||
 		       (total == 0 && session->sending > 0) ||
@@ -1817,6 +1920,28 @@ server_handle_content_type_header(isc_nmsocket_t *socket, const uint8_t *value,
 	return (resp);
 }
 
+static isc_http_error_responses_t
+server_handle_if_none_match_header(isc_nmsocket_t *socket,
+				   const uint8_t *value,
+				   const size_t valuelen) {
+	/*
+	 * The header is only used to revalidate cached GET responses, so
+	 * oversized values are silently ignored instead of failing the
+	 * whole request.
+	 */
+	if (valuelen == 0 || valuelen > MAX_IF_NONE_MATCH_LEN) {
+		return (ISC_HTTP_ERROR_SUCCESS);
+	}
+
+	if (socket->h2.if_none_match != NULL) {
+		isc_mem_free(socket->worker->mctx, socket->h2.if_none_match);
+	}
+	socket->h2.if_none_match = isc_mem_strndup(
+		socket->worker->mctx, (const char *)value, valuelen + 1);
+
+	return (ISC_HTTP_ERROR_SUCCESS);
+}
+
 static isc_http_error_responses_t
 server_handle_header(isc_nmsocket_t *socket, const uint8_t *name,
 		     size_t namelen, const uint8_t *value,
@@ -1828,6 +1953,7 @@ server_handle_header(isc_nmsocket_t *socket, const uint8_t *name,
 	const char scheme[] = ":scheme";
 	const char content_length[] = "Content-Length";
 	const char content_type[] = "Content-Type";
+	const char if_none_match[] = "If-None-Match";
 
 	was_error = socket->h2.headers_error_code != ISC_HTTP_ERROR_SUCCESS;
 	/*
@@ -1846,6 +1972,9 @@ server_handle_header(isc_nmsocket_t *socket, const uint8_t *name,
 	} else if (!was_error && HEADER_MATCH(content_type, name, namelen)) {
 		code = server_handle_content_type_header(socket, value,
 							 valuelen);
+	} else if (!was_error && HEADER_MATCH(if_none_match, name, namelen)) {
+		code = server_handle_if_none_match_header(socket, value,
+							  valuelen);
 	}
 
 	return (code);
@@ -1957,6 +2086,278 @@ server_send_response(nghttp2_session *ngsession, int32_t stream_id,
 	return (ISC_R_SUCCESS);
 }
 
+static http_respcache_t *
+respcache_new(isc_mem_t *mctx) {
+	http_respcache_t *cache = isc_mem_get(mctx, sizeof(*cache));
+
+	*cache = (http_respcache_t){ .lru = ISC_LIST_INITIALIZER };
+	isc_mem_attach(mctx, &cache->mctx);
+	isc_ht_init(&cache->ht, mctx, RESPCACHE_HT_BITS, ISC_HT_CASE_SENSITIVE);
+
+	return (cache);
+}
+
+static void
+respcache_entry_free(http_respcache_t *cache, http_respcache_entry_t *entry) {
+	isc_result_t result;
+
+	result = isc_ht_delete(cache->ht, entry->key, entry->keylen);
+	INSIST(result == ISC_R_SUCCESS);
+	ISC_LIST_UNLINK(cache->lru, entry, link);
+	INSIST(cache->count > 0);
+	cache->count--;
+
+	isc_mem_put(cache->mctx, entry->key, entry->keylen);
+	isc_mem_put(cache->mctx, entry->data, entry->datalen);
+	isc_mem_put(cache->mctx, entry, sizeof(*entry));
+}
+
+static void
+respcache_destroy(http_respcache_t **cachep) {
+	http_respcache_t *cache = NULL;
+	http_respcache_entry_t *entry = NULL;
+
+	REQUIRE(cachep != NULL && *cachep != NULL);
+
+	cache = *cachep;
+	*cachep = NULL;
+
+	while ((entry = ISC_LIST_HEAD(cache->lru)) != NULL) {
+		respcache_entry_free(cache, entry);
+	}
+	INSIST(cache->count == 0);
+
+	isc_ht_destroy(&cache->ht);
+	isc_mem_putanddetach(&cache->mctx, cache, sizeof(*cache));
+}
+
+static http_respcache_entry_t *
+respcache_find(http_respcache_t *cache, const uint8_t *key, size_t keylen,
+	       isc_stdtime_t now) {
+	http_respcache_entry_t *entry = NULL;
+	isc_result_t result;
+
+	result = isc_ht_find(cache->ht, key, keylen, (void **)&entry);
+	if (result != ISC_R_SUCCESS) {
+		return (NULL);
+	}
+
+	if (entry->expire <= now) {
+		respcache_entry_free(cache, entry);
+		return (NULL);
+	}
+
+	/* Keep the most recently used entries at the head of the list */
+	ISC_LIST_UNLINK(cache->lru, entry, link);
+	ISC_LIST_PREPEND(cache->lru, entry, link);
+
+	return (entry);
+}
+
+static void
+respcache_add(http_respcache_t *cache, size_t max_entries, const uint8_t *key,
+	      size_t keylen, const uint8_t *data, size_t datalen,
+	      isc_stdtime_t expire, uint64_t etag) {
+	http_respcache_entry_t *entry = NULL;
+	isc_result_t result;
+
+	result = isc_ht_find(cache->ht, key, keylen, (void **)&entry);
+	if (result == ISC_R_SUCCESS) {
+		respcache_entry_free(cache, entry);
+		entry = NULL;
+	}
+
+	while (cache->count >= max_entries) {
+		respcache_entry_free(cache, ISC_LIST_TAIL(cache->lru));
+	}
+
+	entry = isc_mem_get(cache->mctx, sizeof(*entry));
+	*entry = (http_respcache_entry_t){
+		.key = isc_mem_get(cache->mctx, keylen),
+		.keylen = keylen,
+		.data = isc_mem_get(cache->mctx, datalen),
+		.datalen = datalen,
+		.expire = expire,
+		.etag = etag,
+		.link = ISC_LINK_INITIALIZER,
+	};
+	memmove(entry->key, key, keylen);
+	memmove(entry->data, data, datalen);
+	/* The requester's message ID is patched in on every cache hit */
+	memset(entry->data, 0, DNS_MESSAGE_ID_SIZE);
+
+	result = isc_ht_add(cache->ht, entry->key, entry->keylen, entry);
+	INSIST(result == ISC_R_SUCCESS);
+	ISC_LIST_PREPEND(cache->lru, entry, link);
+	cache->count++;
+}
+
+static uint64_t
+respcache_etag(const uint8_t *data, size_t datalen) {
+	isc_hash64_t state;
+	const uint8_t zero_id[DNS_MESSAGE_ID_SIZE] = { 0 };
+
+	INSIST(datalen >= DNS_MESSAGE_HEADER_SIZE);
+
+	/* The ETag must not depend on the message ID */
+	isc_hash64_init(&state);
+	isc_hash64_hash(&state, zero_id, sizeof(zero_id), true);
+	isc_hash64_hash(&state, data + DNS_MESSAGE_ID_SIZE,
+			datalen - DNS_MESSAGE_ID_SIZE, true);
+	return (isc_hash64_finalize(&state));
+}
+
+static size_t
+server_format_etag(isc_nmsocket_t *socket, uint64_t etag) {
+	return (snprintf(socket->h2.etag_buf, sizeof(socket->h2.etag_buf),
+			 "\"%016" PRIx64 "\"", etag));
+}
+
+static bool
+server_etag_matches(isc_nmsocket_t *socket) {
+	const char *inm = socket->h2.if_none_match;
+
+	if (inm == NULL) {
+		return (false);
+	}
+
+	/*
+	 * A simplified weak comparison (RFC 9110, Section 13.1.2): "*"
+	 * or any of the listed entity tags, with or without the "W/"
+	 * prefix, matches.
+	 */
+	while (*inm == ' ' || *inm == '\t') {
+		inm++;
+	}
+	if (strcmp(inm, "*") == 0) {
+		return (true);
+	}
+
+	return (strstr(inm, socket->h2.etag_buf) != NULL);
+}
+
+/*
+ * Try to answer a DoH GET request from the response cache.  Returns
+ * ISC_R_NOTFOUND when the request has to be passed to the DNS layer; in
+ * that case the cache key is remembered in the stream, so that the
+ * response can be stored when it is being sent.
+ */
+static isc_result_t
+server_respcache_reply(nghttp2_session *ngsession, isc_nmsocket_t *socket,
+		       const isc_region_t *query) {
+	http_respcache_t *cache = NULL;
+	http_respcache_entry_t *entry = NULL;
+	isc_mem_t *mctx = socket->worker->mctx;
+	isc_stdtime_t now;
+	size_t cache_control_len, etag_len;
+
+	if (query->length < DNS_MESSAGE_HEADER_SIZE) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	cache = http_get_listener_respcache(socket->h2.session->serversocket,
+					    socket->tid);
+	if (cache == NULL) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	INSIST(socket->h2.respcache_key == NULL);
+	socket->h2.respcache_key_len = query->length;
+	socket->h2.respcache_key = isc_mem_get(mctx, query->length);
+	memmove(socket->h2.respcache_key, query->base, query->length);
+	memset(socket->h2.respcache_key, 0, DNS_MESSAGE_ID_SIZE);
+
+	now = isc_stdtime_now();
+	entry = respcache_find(cache, socket->h2.respcache_key,
+			       socket->h2.respcache_key_len, now);
+	if (entry == NULL) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	/* Nothing is to be stored when the response is sent. */
+	isc_mem_put(mctx, socket->h2.respcache_key,
+		    socket->h2.respcache_key_len);
+	socket->h2.respcache_key = NULL;
+	socket->h2.respcache_key_len = 0;
+
+	etag_len = server_format_etag(socket, entry->etag);
+	cache_control_len = snprintf(socket->h2.cache_control_buf,
+				     sizeof(socket->h2.cache_control_buf),
+				     "max-age=%" PRIu32,
+				     (uint32_t)(entry->expire - now));
+
+	if (server_etag_matches(socket)) {
+		const nghttp2_nv hdrs[] = {
+			MAKE_NV2(":status", "304"),
+			MAKE_NV("ETag", socket->h2.etag_buf, etag_len),
+			MAKE_NV("Cache-Control", socket->h2.cache_control_buf,
+				cache_control_len)
+		};
+
+		INSIST(isc_buffer_base(&socket->h2.wbuf) == NULL);
+		return (server_send_response(ngsession, socket->h2.stream_id,
+					     hdrs, ARRAY_SIZE(hdrs), socket));
+	}
+
+	socket->h2.cached_response_len = entry->datalen;
+	socket->h2.cached_response = isc_mem_get(mctx, entry->datalen);
+	memmove(socket->h2.cached_response, entry->data, entry->datalen);
+	memmove(socket->h2.cached_response, query->base, DNS_MESSAGE_ID_SIZE);
+
+	isc_buffer_init(&socket->h2.wbuf, socket->h2.cached_response,
+			socket->h2.cached_response_len);
+	isc_buffer_add(&socket->h2.wbuf, socket->h2.cached_response_len);
+
+	size_t content_len_buf_len = snprintf(
+		socket->h2.clenbuf, sizeof(socket->h2.clenbuf), "%lu",
+		(unsigned long)socket->h2.cached_response_len);
+	const nghttp2_nv hdrs[] = {
+		MAKE_NV2(":status", "200"),
+		MAKE_NV2("Content-Type", DNS_MEDIA_TYPE),
+		MAKE_NV("Content-Length", socket->h2.clenbuf,
+			content_len_buf_len),
+		MAKE_NV("Cache-Control", socket->h2.cache_control_buf,
+			cache_control_len),
+		MAKE_NV("ETag", socket->h2.etag_buf, etag_len)
+	};
+
+	return (server_send_response(ngsession, socket->h2.stream_id, hdrs,
+				     ARRAY_SIZE(hdrs), socket));
+}
+
+/*
+ * Store a response to a cacheable DoH GET request and return the length
+ * of its ETag (formatted into the stream's 'etag_buf'), or zero if the
+ * response has not been cached.
+ */
+static size_t
+server_respcache_store(isc_nmsocket_t *socket, const isc_region_t *response) {
+	isc_nmsocket_t *listener = socket->h2.session->serversocket;
+	http_respcache_t *cache = NULL;
+	uint64_t etag;
+	size_t max_entries;
+
+	if (socket->h2.respcache_key == NULL || socket->h2.min_ttl == 0 ||
+	    response->length < DNS_MESSAGE_HEADER_SIZE)
+	{
+		return (0);
+	}
+
+	max_entries = atomic_load_relaxed(&listener->h2.response_cache_size);
+	cache = http_get_listener_respcache(listener, socket->tid);
+	if (cache == NULL || max_entries == 0) {
+		return (0);
+	}
+
+	etag = respcache_etag(response->base, response->length);
+	respcache_add(cache, max_entries, socket->h2.respcache_key,
+		      socket->h2.respcache_key_len, response->base,
+		      response->length, isc_stdtime_now() + socket->h2.min_ttl,
+		      etag);
+
+	return (server_format_etag(socket, etag));
+}
+
 #define MAKE_ERROR_REPLY(tag, code, desc)             \
 	{                                             \
 		tag, MAKE_NV2(":status", #code), desc \
@@ -2134,6 +2535,13 @@ server_on_request_recv(nghttp2_session *ngsession,
 			goto error;
 		}
 		isc_buffer_usedregion(&decoded_buf, &data);
+
+		result = server_respcache_reply(ngsession, socket, &data);
+		if (result == ISC_R_SUCCESS) {
+			return (0);
+		} else if (result != ISC_R_NOTFOUND) {
+			return (NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE);
+		}
 	} else if (socket->h2.request_type == ISC_HTTP_REQ_POST) {
 		INSIST(socket->h2.content_length > 0);
 		isc_buffer_usedregion(&socket->h2.rbuf, &data);
@@ -2215,10 +2623,12 @@ client_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 static void
 server_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 		isc__nm_uvreq_t *req) {
-	size_t content_len_buf_len, cache_control_buf_len;
+	size_t content_len_buf_len, cache_control_buf_len, etag_len;
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_nm_cb_t cb = req->cb.send;
 	void *cbarg = req->cbarg;
+	nghttp2_nv hdrs[5];
+	size_t nhdrs = 0;
 	if (isc__nmsocket_closing(sock) ||
 	    !http_session_active(handle->httpsession))
 	{
@@ -2230,12 +2640,29 @@ server_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 	INSIST(VALID_NMHANDLE(handle->httpsession->handle));
 	INSIST(VALID_NMSOCK(handle->httpsession->handle->sock));
 
-	isc_buffer_init(&sock->h2.wbuf, req->uvbuf.base, req->uvbuf.len);
-	isc_buffer_add(&sock->h2.wbuf, req->uvbuf.len);
+	etag_len = server_respcache_store(
+		sock, &(isc_region_t){ (uint8_t *)req->uvbuf.base,
+				       req->uvbuf.len });
+
+	if (etag_len > 0 && server_etag_matches(sock)) {
+		/* The client already has this very response. */
+		isc_buffer_initnull(&sock->h2.wbuf);
+		hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV2(":status", "304");
+	} else {
+		isc_buffer_init(&sock->h2.wbuf, req->uvbuf.base,
+				req->uvbuf.len);
+		isc_buffer_add(&sock->h2.wbuf, req->uvbuf.len);
+
+		content_len_buf_len = snprintf(sock->h2.clenbuf,
+					       sizeof(sock->h2.clenbuf), "%lu",
+					       (unsigned long)req->uvbuf.len);
+		hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV2(":status", "200");
+		hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV2("Content-Type",
+						     DNS_MEDIA_TYPE);
+		hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV(
+			"Content-Length", sock->h2.clenbuf, content_len_buf_len);
+	}
 
-	content_len_buf_len = snprintf(sock->h2.clenbuf,
-				       sizeof(sock->h2.clenbuf), "%lu",
-				       (unsigned long)req->uvbuf.len);
 	if (sock->h2.min_ttl == 0) {
 		cache_control_buf_len =
 			snprintf(sock->h2.cache_control_buf,
@@ -2247,17 +2674,19 @@ server_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 				 sizeof(sock->h2.cache_control_buf),
 				 "max-age=%" PRIu32, sock->h2.min_ttl);
 	}
-	const nghttp2_nv hdrs[] = { MAKE_NV2(":status", "200"),
-				    MAKE_NV2("Content-Type", DNS_MEDIA_TYPE),
-				    MAKE_NV("Content-Length", sock->h2.clenbuf,
-					    content_len_buf_len),
-				    MAKE_NV("Cache-Control",
-					    sock->h2.cache_control_buf,
-					    cache_control_buf_len) };
+	hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV(
+		"Cache-Control", sock->h2.cache_control_buf,
+		cache_control_buf_len);
+
+	if (etag_len > 0) {
+		hdrs[nhdrs++] = (nghttp2_nv)MAKE_NV(
+			"ETag", sock->h2.etag_buf, etag_len);
+	}
+
+	INSIST(nhdrs <= ARRAY_SIZE(hdrs));
 
 	result = server_send_response(handle->httpsession->ngsession,
-				      sock->h2.stream_id, hdrs,
-				      sizeof(hdrs) / sizeof(nghttp2_nv), sock);
+				      sock->h2.stream_id, hdrs, nhdrs, sock);
 
 	if (result == ISC_R_SUCCESS) {
 		http_do_bio(handle->httpsession, handle, cb, cbarg);
@@ -2477,6 +2906,7 @@ isc_nm_listenhttp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 
 	atomic_store(&eps->in_use, true);
 	http_init_listener_endpoints(sock, eps);
+	http_init_listener_respcaches(sock);
 
 	if (ctx != NULL) {
 		result = isc_nm_listentls(mgr, workers, iface,
@@ -2936,6 +3366,9 @@ http_set_endpoints_cb(void *arg) {
 	isc_nm_http_endpoints_attach(endpoints,
 				     &listener->h2.listener_endpoints[tid]);
 
+	/* Do not serve responses cached before the reconfiguration */
+	http_flush_listener_respcache(listener, tid);
+
 	isc_nm_http_endpoints_detach(&endpoints);
 	isc__nmsocket_detach(&listener);
 }
@@ -3021,6 +3454,87 @@ http_get_listener_endpoints(isc_nmsocket_t *listener, const int tid) {
 	return (eps);
 }
 
+void
+isc_nm_http_set_response_cache_size(isc_nmsocket_t *listener,
+				    const uint32_t max_entries) {
+	REQUIRE(VALID_NMSOCK(listener));
+	REQUIRE(listener->type == isc_nm_httplistener);
+
+	atomic_store_relaxed(&listener->h2.response_cache_size, max_entries);
+}
+
+static void
+http_init_listener_respcaches(isc_nmsocket_t *listener) {
+	size_t nworkers;
+	isc_loopmgr_t *loopmgr = NULL;
+
+	REQUIRE(VALID_NMSOCK(listener));
+	REQUIRE(listener->worker != NULL && VALID_NM(listener->worker->netmgr));
+
+	loopmgr = listener->worker->netmgr->loopmgr;
+	nworkers = (size_t)isc_loopmgr_nloops(loopmgr);
+	INSIST(nworkers > 0);
+
+	/* The caches themselves are created on demand by the workers */
+	listener->h2.response_caches = isc_mem_cget(
+		listener->worker->mctx, nworkers, sizeof(http_respcache_t *));
+	listener->h2.n_response_caches = nworkers;
+}
+
+static void
+http_cleanup_listener_respcaches(isc_nmsocket_t *listener) {
+	REQUIRE(listener->worker != NULL && VALID_NM(listener->worker->netmgr));
+
+	if (listener->h2.response_caches == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < listener->h2.n_response_caches; i++) {
+		if (listener->h2.response_caches[i] != NULL) {
+			respcache_destroy(&listener->h2.response_caches[i]);
+		}
+	}
+	isc_mem_cput(listener->worker->mctx, listener->h2.response_caches,
+		     listener->h2.n_response_caches, sizeof(http_respcache_t *));
+	listener->h2.n_response_caches = 0;
+}
+
+static http_respcache_t *
+http_get_listener_respcache(isc_nmsocket_t *listener, const int tid) {
+	isc__networker_t *worker = NULL;
+
+	REQUIRE(VALID_NMSOCK(listener));
+	REQUIRE(listener->type == isc_nm_httplistener);
+	REQUIRE(tid >= 0);
+	REQUIRE((size_t)tid < listener->h2.n_response_caches);
+	REQUIRE(tid == isc_tid());
+
+	if (atomic_load_relaxed(&listener->h2.response_cache_size) == 0) {
+		/* The cache might have been disabled by reconfiguration */
+		http_flush_listener_respcache(listener, tid);
+		return (NULL);
+	}
+
+	if (listener->h2.response_caches[tid] == NULL) {
+		worker = &listener->worker->netmgr->workers[tid];
+		listener->h2.response_caches[tid] = respcache_new(worker->mctx);
+	}
+
+	return (listener->h2.response_caches[tid]);
+}
+
+static void
+http_flush_listener_respcache(isc_nmsocket_t *listener, const int tid) {
+	REQUIRE(VALID_NMSOCK(listener));
+	REQUIRE(tid >= 0);
+
+	if ((size_t)tid < listener->h2.n_response_caches &&
+	    listener->h2.response_caches[tid] != NULL)
+	{
+		respcache_destroy(&listener->h2.response_caches[tid]);
+	}
+}
+
 static const bool base64url_validation_table[256] = {
 	false, false, false, false, false, false, false, false, false, false,
 	false, false, false, false, false, false, false, false, false, false,
@@ -3175,6 +3689,10 @@ isc__nm_http_cleanup_data(isc_nmsocket_t *sock) {
 			http_cleanup_listener_endpoints(sock);
 		}
 
+		if (sock->type == isc_nm_httplistener) {
+			http_cleanup_listener_respcaches(sock);
+		}
+
 		if (sock->h2.request_path != NULL) {
 			isc_mem_free(sock->worker->mctx, sock->h2.request_path);
 			sock->h2.request_path = NULL;
@@ -3185,6 +3703,27 @@ isc__nm_http_cleanup_data(isc_nmsocket_t *sock) {
 			sock->h2.query_data = NULL;
 		}
 
+		if (sock->h2.respcache_key != NULL) {
+			isc_mem_put(sock->worker->mctx, sock->h2.respcache_key,
+				    sock->h2.respcache_key_len);
+			sock->h2.respcache_key = NULL;
+			sock->h2.respcache_key_len = 0;
+		}
+
+		if (sock->h2.if_none_match != NULL) {
+			isc_mem_free(sock->worker->mctx,
+				     sock->h2.if_none_match);
+			sock->h2.if_none_match = NULL;
+		}
+
+		if (sock->h2.cached_response != NULL) {
+			isc_mem_put(sock->worker->mctx,
+				    sock->h2.cached_response,
+				    sock->h2.cached_response_len);
+			sock->h2.cached_response = NULL;
+			sock->h2.cached_response_len = 0;
+		}
+
 		INSIST(sock->h2.connect.cstream == NULL);
 
 		if (isc_buffer_base(&sock->h2.rbuf) != NULL) {
@@ -463,6 +463,20 @@ typedef struct isc_nmsocket_h2 {
 	isc_nm_http_endpoints_t **listener_endpoints;
 	size_t n_listener_endpoints;
 
+	/*
+	 * GET response cache: the per-worker caches and their size
+	 * live in the listener, the rest is per-stream state.
+	 */
+	atomic_uint_fast32_t response_cache_size;
+	struct http_respcache **response_caches;
+	size_t n_response_caches;
+	uint8_t *respcache_key;
+	size_t respcache_key_len;
+	char *if_none_match;
+	uint8_t *cached_response;
+	size_t cached_response_len;
+	char etag_buf[32];
+
 	bool response_submitted;
 	struct {
 		char *uri;
@@ -552,6 +566,13 @@ struct isc_nmsocket {
 	 * TCP read/connect timeout timers.
 	 */
 	uv_timer_t read_timer;
+
+	/*%
+	 * UDP read timeouts are kept in the loop's timing wheel, as they
+	 * are restarted for every query sent and usually stopped well
+	 * before they fire.
+	 */
+	isc__wheelentry_t read_wheel;
 	uint64_t read_timeout;
 	uint64_t connect_timeout;
 
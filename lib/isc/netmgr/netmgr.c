@@ -1126,6 +1126,7 @@ isc__nmsocket_readtimeout_cb(uv_timer_t *timer) {
 
 	if (sock->client) {
 		uv_timer_stop(timer);
+		isc__wheel_stop(sock->worker->loop, &sock->read_wheel);
 
 		if (sock->recv_cb != NULL) {
 			isc__nm_uvreq_t *req = isc__nm_get_read_req(sock, NULL);
@@ -1141,6 +1142,13 @@ isc__nmsocket_readtimeout_cb(uv_timer_t *timer) {
 	}
 }
 
+static void
+readtimeout_wheel_cb(void *arg) {
+	isc_nmsocket_t *sock = arg;
+
+	isc__nmsocket_readtimeout_cb(&sock->read_timer);
+}
+
 void
 isc__nmsocket_timer_restart(isc_nmsocket_t *sock) {
 	REQUIRE(VALID_NMSOCK(sock));
@@ -1179,6 +1187,13 @@ isc__nmsocket_timer_restart(isc_nmsocket_t *sock) {
 			return;
 		}
 
+		if (sock->type == isc_nm_udpsocket) {
+			isc__wheel_start(sock->worker->loop, &sock->read_wheel,
+					 sock->read_timeout,
+					 readtimeout_wheel_cb, sock);
+			return;
+		}
+
 		r = uv_timer_start(&sock->read_timer,
 				   isc__nmsocket_readtimeout_cb,
 				   sock->read_timeout, 0);
@@ -1199,7 +1214,8 @@ isc__nmsocket_timer_running(isc_nmsocket_t *sock) {
 		break;
 	}
 
-	return (uv_is_active((uv_handle_t *)&sock->read_timer));
+	return (uv_is_active((uv_handle_t *)&sock->read_timer) ||
+		ISC__WHEEL_ACTIVE(&sock->read_wheel));
 }
 
 void
@@ -1234,6 +1250,8 @@ isc__nmsocket_timer_stop(isc_nmsocket_t *sock) {
 
 	r = uv_timer_stop(&sock->read_timer);
 	UV_RUNTIME_CHECK(uv_timer_stop, r);
+
+	isc__wheel_stop(sock->worker->loop, &sock->read_wheel);
 }
 
 isc__nm_uvreq_t *
@@ -1402,7 +1420,7 @@ isc_nmhandle_cleartimeout(isc_nmhandle_t *handle) {
 	default:
 		handle->sock->read_timeout = 0;
 
-		if (uv_is_active((uv_handle_t *)&handle->sock->read_timer)) {
+		if (isc__nmsocket_timer_running(handle->sock)) {
 			isc__nmsocket_timer_stop(handle->sock);
 		}
 	}
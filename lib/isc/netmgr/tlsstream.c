@@ -12,6 +12,7 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <libgen.h>
 #include <unistd.h>
 
@@ -45,6 +46,13 @@
 
 #define TLS_MAX_SEND_BUF_SIZE (UINT16_MAX + UINT16_MAX / 2)
 
+/*
+ * The maximum amount of plaintext in a TLS record (RFC 8446, Section
+ * 5.1). DNS messages up to this size (including the length prefix) are
+ * written as a single record.
+ */
+#define TLS_MAX_RECORD_PLAINTEXT (16384)
+
 #ifdef ISC_NETMGR_TRACE
 ISC_ATTR_UNUSED static const char *
 tls_status2str(int tls_status) {
@@ -459,6 +467,9 @@ tls_try_handshake(isc_nmsocket_t *sock, isc_result_t *presult) {
 		INSIST(SSL_is_init_finished(sock->tlsstream.tls) == 1);
 
 		isc__nmsocket_log_tls_session_reuse(sock, sock->tlsstream.tls);
+		if (sock->tlsstream.server) {
+			isc_tls_account_handshake(sock->tlsstream.tls);
+		}
 		tlshandle = isc__nmhandle_get(sock, &sock->peer, &sock->iface);
 		tls_read_stop(sock);
 
@@ -512,6 +523,47 @@ tls_try_to_close_unused_socket(isc_nmsocket_t *sock) {
 	return (false);
 }
 
+/*
+ * Write a DNS message together with its length prefix. When the whole
+ * message fits into a single TLS record, the two are coalesced, as
+ * writing them separately would produce an extra TLS record carrying
+ * just two bytes of payload for every DNS message, doubling the number
+ * of encryption operations and the framing overhead on the wire.
+ */
+static int
+tls_write_dnsmsg(isc_tls_t *tls, isc__nm_uvreq_t *send_data) {
+	int rv;
+	size_t len = 0;
+	const size_t msglen = sizeof(send_data->tcplen) + send_data->uvbuf.len;
+
+	if (msglen <= TLS_MAX_RECORD_PLAINTEXT) {
+		uint8_t buf[TLS_MAX_RECORD_PLAINTEXT];
+
+		memmove(buf, send_data->tcplen, sizeof(send_data->tcplen));
+		memmove(buf + sizeof(send_data->tcplen), send_data->uvbuf.base,
+			send_data->uvbuf.len);
+		rv = SSL_write_ex(tls, buf, msglen, &len);
+		if (rv != 1 || len != msglen) {
+			return (0);
+		}
+		return (1);
+	}
+
+	rv = SSL_write_ex(tls, send_data->tcplen, sizeof(send_data->tcplen),
+			  &len);
+	if (rv != 1 || len != sizeof(send_data->tcplen)) {
+		return (0);
+	}
+
+	rv = SSL_write_ex(tls, send_data->uvbuf.base, send_data->uvbuf.len,
+			  &len);
+	if (rv != 1 || len != send_data->uvbuf.len) {
+		return (0);
+	}
+
+	return (1);
+}
+
 static void
 tls_do_bio(isc_nmsocket_t *sock, isc_region_t *received_data,
 	   isc__nm_uvreq_t *send_data, bool finish) {
@@ -559,7 +611,16 @@ tls_do_bio(isc_nmsocket_t *sock, isc_region_t *received_data,
 	} else if (sock->tlsstream.state == TLS_CLOSED) {
 		return;
 	} else { /* initialised and doing I/O */
-		if (received_data != NULL) {
+		if (received_data != NULL &&
+		    SSL_get_rbio(sock->tlsstream.tls) != sock->tlsstream.bio_in)
+		{
+			/*
+			 * The data is read directly from the network
+			 * buffer, see tls_do_bio_received().
+			 */
+			INSIST(send_data == NULL);
+			INSIST(sock->tlsstream.state == TLS_IO);
+		} else if (received_data != NULL) {
 			INSIST(send_data == NULL);
 			rv = BIO_write_ex(sock->tlsstream.bio_in,
 					  received_data->base,
@@ -609,23 +670,10 @@ tls_do_bio(isc_nmsocket_t *sock, isc_region_t *received_data,
 				 * There is a DNS message length to write - do
 				 * it.
 				 */
-				rv = SSL_write_ex(
-					sock->tlsstream.tls, send_data->tcplen,
-					sizeof(send_data->tcplen), &len);
-				if (rv != 1 || len != sizeof(send_data->tcplen))
-				{
+				rv = tls_write_dnsmsg(sock->tlsstream.tls,
+						      send_data);
+				if (rv != 1) {
 					write_failed = true;
-				} else {
-					/* Write data */
-					rv = SSL_write_ex(sock->tlsstream.tls,
-							  send_data->uvbuf.base,
-							  send_data->uvbuf.len,
-							  &len);
-					if (rv != 1 ||
-					    len != send_data->uvbuf.len)
-					{
-						write_failed = true;
-					}
 				}
 			} else {
 				/* Write data only */
@@ -807,6 +855,76 @@ error:
 	tls_failed_read_cb(sock, result);
 }
 
+/*
+ * Pass the data received from the network to OpenSSL. Unless there is
+ * some previously received data still waiting to be processed, the data
+ * is not copied into the input memory BIO: a read-only memory BIO
+ * pointing directly into the network buffer is temporarily installed
+ * instead. Only the data that has not been consumed by OpenSSL (e.g.
+ * because reading has been paused) is then copied into the input BIO.
+ *
+ * This is only done once the handshake has finished: until then the
+ * data has to go through the regular path in tls_do_bio(), which is
+ * what drives the handshake forward.
+ */
+static void
+tls_do_bio_received(isc_nmsocket_t *sock, isc_region_t *region) {
+	BIO *bio_in = sock->tlsstream.bio_in;
+	BIO *rbio = NULL;
+	int pending;
+
+	if (sock->tlsstream.tls == NULL ||
+	    sock->tlsstream.state != TLS_IO || BIO_pending(bio_in) > 0 ||
+	    region->length > INT_MAX)
+	{
+		tls_do_bio(sock, region, NULL, false);
+		return;
+	}
+
+	rbio = BIO_new_mem_buf(region->base, (int)region->length);
+	if (rbio == NULL) {
+		tls_do_bio(sock, region, NULL, false);
+		return;
+	}
+	/* Signal "retry" rather than EOF once the data has been read */
+	if (BIO_set_mem_eof_return(rbio, EOF) != 1) {
+		BIO_free(rbio);
+		tls_do_bio(sock, region, NULL, false);
+		return;
+	}
+
+	/* Keep the input BIO around while it is detached from 'tls' */
+	RUNTIME_CHECK(BIO_up_ref(bio_in) == 1);
+	SSL_set0_rbio(sock->tlsstream.tls, rbio);
+
+	tls_do_bio(sock, region, NULL, false);
+
+	/*
+	 * The TLS socket cannot be destroyed while its underlying TCP
+	 * socket exists, so 'sock' is still valid here.
+	 */
+	if (sock->tlsstream.tls == NULL) {
+		BIO_free(bio_in);
+		return;
+	}
+
+	INSIST(SSL_get_rbio(sock->tlsstream.tls) == rbio);
+	pending = BIO_pending(rbio);
+	if (pending > 0) {
+		size_t len = 0;
+		int rv;
+
+		INSIST((size_t)pending <= region->length);
+		rv = BIO_write_ex(bio_in,
+				  region->base + region->length - pending,
+				  pending, &len);
+		RUNTIME_CHECK(rv == 1 && len == (size_t)pending);
+	}
+
+	/* This frees the temporary BIO */
+	SSL_set0_rbio(sock->tlsstream.tls, bio_in);
+}
+
 static void
 tls_readcb(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	   void *cbarg) {
@@ -825,7 +943,7 @@ tls_readcb(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	}
 
 	REQUIRE(handle == tlssock->outerhandle);
-	tls_do_bio(tlssock, region, NULL, false);
+	tls_do_bio_received(tlssock, region);
 }
 
 static isc_result_t
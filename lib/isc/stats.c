@@ -108,6 +108,15 @@ isc_stats_decrement(isc_stats_t *stats, isc_statscounter_t counter) {
 #endif
 }
 
+void
+isc_stats_add(isc_stats_t *stats, isc_statscounter_t counter,
+	      isc_statscounter_t value) {
+	REQUIRE(ISC_STATS_VALID(stats));
+	REQUIRE(counter < stats->ncounters);
+
+	atomic_fetch_add_relaxed(&stats->counters[counter], value);
+}
+
 void
 isc_stats_dump(isc_stats_t *stats, isc_stats_dumper_t dump_fn, void *arg,
 	       unsigned int options) {
@@ -39,6 +39,8 @@ struct isc_timer {
 	unsigned int magic;
 	isc_loop_t *loop;
 	uv_timer_t timer;
+	isc__wheelentry_t entry;
+	bool coarse;
 	isc_job_cb cb;
 	void *cbarg;
 	uint64_t timeout;
@@ -46,6 +48,105 @@ struct isc_timer {
 	atomic_bool running;
 };
 
+/*
+ * Coarse timers are kept in a hashed timing wheel per loop instead of
+ * libuv's timer heap.  Each slot of the wheel holds the entries that
+ * expire on the ticks that are equal modulo TIMERWHEEL_SLOTS, so an
+ * entry can be added and removed in constant time.  On every tick, the
+ * wheel visits the slots of the ticks that have passed since the last
+ * one, and fires the entries that have expired, leaving the ones that
+ * expire on a later turn of the wheel in place.
+ */
+static void
+wheel_link(isc_loop_t *loop, isc__wheelentry_t *entry) {
+	entry->slot = &loop->wheel[entry->expires % TIMERWHEEL_SLOTS];
+	ISC_LIST_INITANDAPPEND(*entry->slot, entry, link);
+}
+
+static void
+wheel_unlink(isc__wheelentry_t *entry) {
+	ISC_LIST_UNLINK(*entry->slot, entry, link);
+	entry->slot = NULL;
+}
+
+static void
+wheel_cb(uv_timer_t *handle) {
+	isc_loop_t *loop = uv_handle_get_data(handle);
+	uint64_t now = uv_now(&loop->loop) / TIMERWHEEL_TICK;
+	uint64_t ticks = ISC_MIN(now - loop->wheel_now, TIMERWHEEL_SLOTS);
+	isc__wheelslot_t expired = ISC_LIST_INITIALIZER;
+	isc__wheelentry_t *entry = NULL, *next = NULL;
+
+	for (uint64_t tick = loop->wheel_now + 1; ticks > 0; tick++, ticks--) {
+		isc__wheelslot_t *slot = &loop->wheel[tick % TIMERWHEEL_SLOTS];
+
+		for (entry = ISC_LIST_HEAD(*slot); entry != NULL; entry = next)
+		{
+			next = ISC_LIST_NEXT(entry, link);
+			if (entry->expires <= now) {
+				ISC_LIST_UNLINK(*slot, entry, link);
+				ISC_LIST_APPEND(expired, entry, link);
+				entry->slot = &expired;
+			}
+		}
+	}
+	loop->wheel_now = now;
+
+	/*
+	 * The callbacks may stop or restart any entry, including the
+	 * ones that are still on the 'expired' list.
+	 */
+	while ((entry = ISC_LIST_HEAD(expired)) != NULL) {
+		wheel_unlink(entry);
+		loop->wheel_count--;
+		entry->cb(entry->cbarg);
+	}
+
+	if (loop->wheel_count == 0) {
+		uv_timer_stop(handle);
+	}
+}
+
+void
+isc__wheel_start(isc_loop_t *loop, isc__wheelentry_t *entry, uint64_t timeout,
+		 isc_job_cb cb, void *cbarg) {
+	uint64_t now = uv_now(&loop->loop);
+
+	REQUIRE(ON_LOOP(loop));
+	REQUIRE(cb != NULL);
+
+	if (ISC__WHEEL_ACTIVE(entry)) {
+		wheel_unlink(entry);
+	} else if (loop->wheel_count++ == 0) {
+		int r = uv_timer_start(&loop->wheel_timer, wheel_cb,
+				       TIMERWHEEL_TICK, TIMERWHEEL_TICK);
+		UV_RUNTIME_CHECK(uv_timer_start, r);
+		loop->wheel_now = now / TIMERWHEEL_TICK;
+	}
+
+	entry->expires = (now + timeout + TIMERWHEEL_TICK - 1) /
+			 TIMERWHEEL_TICK;
+	entry->expires = ISC_MAX(entry->expires, loop->wheel_now + 1);
+	entry->cb = cb;
+	entry->cbarg = cbarg;
+	wheel_link(loop, entry);
+}
+
+void
+isc__wheel_stop(isc_loop_t *loop, isc__wheelentry_t *entry) {
+	REQUIRE(ON_LOOP(loop));
+
+	if (!ISC__WHEEL_ACTIVE(entry)) {
+		return;
+	}
+
+	wheel_unlink(entry);
+	INSIST(loop->wheel_count > 0);
+	if (--loop->wheel_count == 0) {
+		uv_timer_stop(&loop->wheel_timer);
+	}
+}
+
 void
 isc_timer_create(isc_loop_t *loop, isc_job_cb cb, void *cbarg,
 		 isc_timer_t **timerp) {
@@ -93,8 +194,26 @@ isc_timer_stop(isc_timer_t *timer) {
 
 	/* Stop the timer, if the loops are matching */
 	if (timer->loop == isc_loop_current(timer->loop->loopmgr)) {
+		if (timer->coarse) {
+			isc__wheel_stop(timer->loop, &timer->entry);
+		} else {
+			uv_timer_stop(&timer->timer);
+		}
+	}
+}
+
+void
+isc_timer_setcoarse(isc_timer_t *timer, bool coarse) {
+	REQUIRE(VALID_TIMER(timer));
+	REQUIRE(timer->loop == isc_loop_current(timer->loop->loopmgr));
+	REQUIRE(!atomic_load_acquire(&timer->running));
+
+	if (timer->coarse) {
+		isc__wheel_stop(timer->loop, &timer->entry);
+	} else {
 		uv_timer_stop(&timer->timer);
 	}
+	timer->coarse = coarse;
 }
 
 static void
@@ -111,6 +230,24 @@ timer_cb(uv_timer_t *handle) {
 	timer->cb(timer->cbarg);
 }
 
+static void
+timer_wheel_cb(void *arg) {
+	isc_timer_t *timer = arg;
+
+	REQUIRE(VALID_TIMER(timer));
+
+	if (!atomic_load_acquire(&timer->running)) {
+		return;
+	}
+
+	if (timer->repeat > 0) {
+		isc__wheel_start(timer->loop, &timer->entry, timer->repeat,
+				 timer_wheel_cb, timer);
+	}
+
+	timer->cb(timer->cbarg);
+}
+
 void
 isc_timer_start(isc_timer_t *timer, isc_timertype_t type,
 		const isc_interval_t *interval) {
@@ -143,6 +280,11 @@ isc_timer_start(isc_timer_t *timer, isc_timertype_t type,
 	}
 
 	atomic_store_release(&timer->running, true);
+	if (timer->coarse) {
+		isc__wheel_start(loop, &timer->entry, timer->timeout,
+				 timer_wheel_cb, timer);
+		return;
+	}
 	r = uv_timer_start(&timer->timer, timer_cb, timer->timeout,
 			   timer->repeat);
 	UV_RUNTIME_CHECK(uv_timer_start, r);
@@ -167,6 +309,7 @@ timer_destroy(void *arg) {
 	isc_timer_t *timer = arg;
 
 	atomic_store_release(&timer->running, false);
+	isc__wheel_stop(timer->loop, &timer->entry);
 	uv_timer_stop(&timer->timer);
 	uv_close(&timer->timer, timer_close);
 }
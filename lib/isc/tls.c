@@ -12,6 +12,7 @@
  */
 
 #include <inttypes.h>
+#include <limits.h>
 #include <netinet/in.h>
 #include <stdlib.h>
 #include <string.h>
@@ -32,8 +33,13 @@
 #include <openssl/rsa.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
+#if HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif /* HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB */
 
 #include <isc/atomic.h>
+#include <isc/file.h>
 #include <isc/ht.h>
 #include <isc/log.h>
 #include <isc/magic.h>
@@ -44,7 +50,9 @@
 #include <isc/random.h>
 #include <isc/refcount.h>
 #include <isc/rwlock.h>
+#include <isc/safe.h>
 #include <isc/sockaddr.h>
+#include <isc/stdio.h>
 #include <isc/thread.h>
 #include <isc/tls.h>
 #include <isc/util.h>
@@ -56,6 +64,16 @@
 
 static isc_mem_t *isc__tls_mctx = NULL;
 
+/*
+ * The index of the SSL_CTX "extra data" slot used to store a pointer to
+ * the session ticket key ring.
+ */
+static int tlsctx_ticketkeys_exidx = -1;
+
+static void
+tlsctx_ticketkeys_exfree(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx,
+			 long argl, void *argp);
+
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
 static isc_mutex_t *locks = NULL;
 static int nlocks;
@@ -216,6 +234,10 @@ isc__tls_initialize(void) {
 				       CONF_MFLAGS_IGNORE_MISSING_FILE);
 #endif
 
+	tlsctx_ticketkeys_exidx = SSL_CTX_get_ex_new_index(
+		0, NULL, NULL, NULL, tlsctx_ticketkeys_exfree);
+	RUNTIME_CHECK(tlsctx_ticketkeys_exidx >= 0);
+
 	/* Protect ourselves against unseeded PRNG */
 	if (RAND_status() != 1) {
 		FATAL_ERROR("OpenSSL pseudorandom number generator "
@@ -1186,6 +1208,8 @@ struct isc_tlsctx_cache {
 
 	isc_rwlock_t rwlock;
 	isc_ht_t *data;
+
+	isc_tlsctx_ticketkeys_t *ticketkeys;
 };
 
 void
@@ -1259,6 +1283,9 @@ tlsctx_cache_destroy(isc_tlsctx_cache_t *cache) {
 	isc_ht_iter_destroy(&it);
 	isc_ht_destroy(&cache->data);
 	isc_rwlock_destroy(&cache->rwlock);
+	if (cache->ticketkeys != NULL) {
+		isc_tlsctx_ticketkeys_detach(&cache->ticketkeys);
+	}
 	isc_mem_putanddetach(&cache->mctx, cache, sizeof(*cache));
 }
 
@@ -1278,6 +1305,22 @@ isc_tlsctx_cache_detach(isc_tlsctx_cache_t **cachep) {
 	}
 }
 
+void
+isc_tlsctx_cache_set_ticketkeys(isc_tlsctx_cache_t *cache,
+				isc_tlsctx_ticketkeys_t *keys) {
+	REQUIRE(VALID_TLSCTX_CACHE(cache));
+	REQUIRE(cache->ticketkeys == NULL);
+
+	isc_tlsctx_ticketkeys_attach(keys, &cache->ticketkeys);
+}
+
+isc_tlsctx_ticketkeys_t *
+isc_tlsctx_cache_get_ticketkeys(isc_tlsctx_cache_t *cache) {
+	REQUIRE(VALID_TLSCTX_CACHE(cache));
+
+	return (cache->ticketkeys);
+}
+
 isc_result_t
 isc_tlsctx_cache_add(
 	isc_tlsctx_cache_t *cache, const char *name,
@@ -1760,6 +1803,405 @@ isc_tlsctx_set_random_session_id_context(isc_tlsctx_t *ctx) {
 		SSL_CTX_set_session_id_context(ctx, session_id_ctx, len) == 1);
 }
 
+#define TLSCTX_TICKETKEYS_MAGIC	   ISC_MAGIC('T', 'l', 'T', 'k')
+#define VALID_TLSCTX_TICKETKEYS(t) ISC_MAGIC_VALID(t, TLSCTX_TICKETKEYS_MAGIC)
+
+#define TICKETKEY_NAME_LEN   16
+#define TICKETKEY_SECRET_LEN 32
+
+typedef struct tlsctx_ticketkey {
+	uint8_t name[TICKETKEY_NAME_LEN];
+	uint8_t hmac_key[TICKETKEY_SECRET_LEN];
+	uint8_t aes_key[TICKETKEY_SECRET_LEN];
+} tlsctx_ticketkey_t;
+
+struct isc_tlsctx_ticketkeys {
+	uint32_t magic;
+	isc_refcount_t references;
+	isc_mem_t *mctx;
+
+	isc_rwlock_t rwlock;
+	/*
+	 * The secret used to derive session ID contexts, see
+	 * isc_tlsctx_set_ticketkeys().
+	 */
+	uint8_t secret[TICKETKEY_SECRET_LEN];
+	/* keys[0] is the key used to issue new tickets. */
+	tlsctx_ticketkey_t keys[ISC_TLSCTX_TICKETKEYS_MAX];
+	size_t nkeys;
+
+	atomic_uint_fast64_t full_handshakes;
+	atomic_uint_fast64_t resumed_handshakes;
+};
+
+/*
+ * The on-disk format of the key ring is the secret followed by 1 to
+ * ISC_TLSCTX_TICKETKEYS_MAX keys, the most recent key first.
+ */
+#define TICKETKEYS_FILE_MAXSIZE \
+	(TICKETKEY_SECRET_LEN +  \
+	 ISC_TLSCTX_TICKETKEYS_MAX * sizeof(tlsctx_ticketkey_t))
+
+static void
+tlsctx_ticketkey_generate(tlsctx_ticketkey_t *key) {
+	RUNTIME_CHECK(RAND_bytes((unsigned char *)key, sizeof(*key)) == 1);
+}
+
+void
+isc_tlsctx_ticketkeys_create(isc_mem_t *mctx, isc_tlsctx_ticketkeys_t **keysp) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+
+	REQUIRE(keysp != NULL && *keysp == NULL);
+
+	keys = isc_mem_get(mctx, sizeof(*keys));
+	*keys = (isc_tlsctx_ticketkeys_t){ .magic = TLSCTX_TICKETKEYS_MAGIC,
+					   .nkeys = 1 };
+	isc_refcount_init(&keys->references, 1);
+	isc_mem_attach(mctx, &keys->mctx);
+	isc_rwlock_init(&keys->rwlock);
+	atomic_init(&keys->full_handshakes, 0);
+	atomic_init(&keys->resumed_handshakes, 0);
+
+	RUNTIME_CHECK(RAND_bytes(keys->secret, sizeof(keys->secret)) == 1);
+	tlsctx_ticketkey_generate(&keys->keys[0]);
+
+	*keysp = keys;
+}
+
+void
+isc_tlsctx_ticketkeys_attach(isc_tlsctx_ticketkeys_t *source,
+			     isc_tlsctx_ticketkeys_t **targetp) {
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(source));
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+	isc_refcount_increment(&source->references);
+
+	*targetp = source;
+}
+
+void
+isc_tlsctx_ticketkeys_detach(isc_tlsctx_ticketkeys_t **keysp) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+
+	REQUIRE(keysp != NULL);
+
+	keys = *keysp;
+	*keysp = NULL;
+
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+
+	if (isc_refcount_decrement(&keys->references) != 1) {
+		return;
+	}
+
+	keys->magic = 0;
+	isc_refcount_destroy(&keys->references);
+	isc_rwlock_destroy(&keys->rwlock);
+	isc_safe_memwipe(keys->secret, sizeof(keys->secret));
+	isc_safe_memwipe(keys->keys, sizeof(keys->keys));
+	isc_mem_putanddetach(&keys->mctx, keys, sizeof(*keys));
+}
+
+void
+isc_tlsctx_ticketkeys_rotate(isc_tlsctx_ticketkeys_t *keys) {
+	tlsctx_ticketkey_t newkey;
+
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+
+	tlsctx_ticketkey_generate(&newkey);
+
+	RWLOCK(&keys->rwlock, isc_rwlocktype_write);
+	memmove(&keys->keys[1], &keys->keys[0],
+		(ISC_TLSCTX_TICKETKEYS_MAX - 1) * sizeof(keys->keys[0]));
+	keys->keys[0] = newkey;
+	if (keys->nkeys < ISC_TLSCTX_TICKETKEYS_MAX) {
+		keys->nkeys++;
+	}
+	RWUNLOCK(&keys->rwlock, isc_rwlocktype_write);
+
+	isc_safe_memwipe(&newkey, sizeof(newkey));
+}
+
+isc_result_t
+isc_tlsctx_ticketkeys_load(isc_tlsctx_ticketkeys_t *keys,
+			   const char *filename) {
+	isc_result_t result;
+	FILE *fp = NULL;
+	uint8_t buf[TICKETKEYS_FILE_MAXSIZE + 1];
+	size_t len = 0, nkeys;
+
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+	REQUIRE(filename != NULL);
+
+	result = isc_stdio_open(filename, "rb", &fp);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	result = isc_stdio_read(buf, 1, sizeof(buf), fp, &len);
+	(void)isc_stdio_close(fp);
+	if (result == ISC_R_EOF) {
+		result = ISC_R_SUCCESS;
+	}
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	if (len <= TICKETKEY_SECRET_LEN || len > TICKETKEYS_FILE_MAXSIZE ||
+	    (len - TICKETKEY_SECRET_LEN) % sizeof(tlsctx_ticketkey_t) != 0)
+	{
+		result = ISC_R_UNEXPECTEDEND;
+		goto cleanup;
+	}
+
+	nkeys = (len - TICKETKEY_SECRET_LEN) / sizeof(tlsctx_ticketkey_t);
+
+	RWLOCK(&keys->rwlock, isc_rwlocktype_write);
+	memmove(keys->secret, buf, TICKETKEY_SECRET_LEN);
+	isc_safe_memwipe(keys->keys, sizeof(keys->keys));
+	memmove(keys->keys, buf + TICKETKEY_SECRET_LEN,
+		nkeys * sizeof(keys->keys[0]));
+	keys->nkeys = nkeys;
+	RWUNLOCK(&keys->rwlock, isc_rwlocktype_write);
+
+cleanup:
+	isc_safe_memwipe(buf, sizeof(buf));
+	return (result);
+}
+
+isc_result_t
+isc_tlsctx_ticketkeys_save(isc_tlsctx_ticketkeys_t *keys,
+			   const char *filename) {
+	isc_result_t result;
+	FILE *fp = NULL;
+	char tmpname[PATH_MAX];
+	uint8_t buf[TICKETKEYS_FILE_MAXSIZE];
+	size_t len;
+
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+	REQUIRE(filename != NULL);
+
+	RWLOCK(&keys->rwlock, isc_rwlocktype_read);
+	memmove(buf, keys->secret, TICKETKEY_SECRET_LEN);
+	memmove(buf + TICKETKEY_SECRET_LEN, keys->keys,
+		keys->nkeys * sizeof(keys->keys[0]));
+	len = TICKETKEY_SECRET_LEN + keys->nkeys * sizeof(keys->keys[0]);
+	RWUNLOCK(&keys->rwlock, isc_rwlocktype_read);
+
+	result = isc_file_template(filename, "tickets-XXXXXXXXXX", tmpname,
+				   sizeof(tmpname));
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = isc_file_openuniqueprivate(tmpname, &fp);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = isc_stdio_write(buf, 1, len, fp, NULL);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_flush(fp);
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_sync(fp);
+	}
+	(void)isc_stdio_close(fp);
+
+	if (result == ISC_R_SUCCESS) {
+		result = isc_file_rename(tmpname, filename);
+	}
+	if (result != ISC_R_SUCCESS) {
+		(void)isc_file_remove(tmpname);
+	}
+
+cleanup:
+	isc_safe_memwipe(buf, sizeof(buf));
+	return (result);
+}
+
+void
+isc_tlsctx_ticketkeys_getstats(isc_tlsctx_ticketkeys_t *keys, uint64_t *fullp,
+			       uint64_t *resumedp) {
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+	REQUIRE(fullp != NULL && resumedp != NULL);
+
+	*fullp = atomic_load_relaxed(&keys->full_handshakes);
+	*resumedp = atomic_load_relaxed(&keys->resumed_handshakes);
+}
+
+static void
+tlsctx_ticketkeys_exfree(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx,
+			 long argl, void *argp) {
+	isc_tlsctx_ticketkeys_t *keys = (isc_tlsctx_ticketkeys_t *)ptr;
+
+	UNUSED(parent);
+	UNUSED(ad);
+	UNUSED(idx);
+	UNUSED(argl);
+	UNUSED(argp);
+
+	if (keys != NULL) {
+		isc_tlsctx_ticketkeys_detach(&keys);
+	}
+}
+
+/*
+ * The callback called by OpenSSL to encrypt ('enc' == 1) or decrypt
+ * ('enc' == 0) session tickets. See the OpenSSL documentation for
+ * 'SSL_CTX_set_tlsext_ticket_key_cb()' for the meaning of the return
+ * values.
+ */
+#if HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB
+static int
+tlsctx_ticketkey_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv,
+		    EVP_CIPHER_CTX *cctx, EVP_MAC_CTX *hctx, int enc)
+#else
+static int
+tlsctx_ticketkey_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv,
+		    EVP_CIPHER_CTX *cctx, HMAC_CTX *hctx, int enc)
+#endif /* HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB */
+{
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+	tlsctx_ticketkey_t key;
+	int ret = 0;
+
+	keys = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl),
+				   tlsctx_ticketkeys_exidx);
+	if (keys == NULL) {
+		return (-1);
+	}
+
+	RWLOCK(&keys->rwlock, isc_rwlocktype_read);
+	if (enc == 1) {
+		key = keys->keys[0];
+		ret = 1;
+	} else {
+		for (size_t i = 0; i < keys->nkeys; i++) {
+			if (memcmp(keys->keys[i].name, key_name,
+				   TICKETKEY_NAME_LEN) == 0)
+			{
+				key = keys->keys[i];
+				/* Ask for a renewal of the old tickets */
+				ret = (i == 0) ? 1 : 2;
+				break;
+			}
+		}
+	}
+	RWUNLOCK(&keys->rwlock, isc_rwlocktype_read);
+
+	if (ret == 0) {
+		/* Unknown key - fall back to a full handshake */
+		return (0);
+	}
+
+	if (enc == 1) {
+		memmove(key_name, key.name, TICKETKEY_NAME_LEN);
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) !=
+		    1)
+		{
+			ret = -1;
+			goto cleanup;
+		}
+	}
+
+	if (EVP_CipherInit_ex(cctx, EVP_aes_256_cbc(), NULL, key.aes_key, iv,
+			      enc) != 1)
+	{
+		ret = -1;
+		goto cleanup;
+	}
+
+#if HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY,
+						  key.hmac_key,
+						  sizeof(key.hmac_key)),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+						 (char *)"SHA256", 0),
+		OSSL_PARAM_construct_end()
+	};
+	if (EVP_MAC_CTX_set_params(hctx, params) != 1) {
+		ret = -1;
+	}
+#else
+	if (HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key),
+			 EVP_sha256(), NULL) != 1)
+	{
+		ret = -1;
+	}
+#endif /* HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB */
+
+cleanup:
+	isc_safe_memwipe(&key, sizeof(key));
+	return (ret);
+}
+
+void
+isc_tlsctx_set_ticketkeys(isc_tlsctx_t *ctx, isc_tlsctx_ticketkeys_t *keys,
+			  const char *name) {
+	isc_tlsctx_ticketkeys_t *ctxkeys = NULL;
+	uint8_t digest[EVP_MAX_MD_SIZE];
+	unsigned int digestlen = 0;
+	const size_t len = ISC_MIN(20, SSL_MAX_SID_CTX_LENGTH);
+	EVP_MD_CTX *mdctx = NULL;
+
+	REQUIRE(ctx != NULL);
+	REQUIRE(VALID_TLSCTX_TICKETKEYS(keys));
+	REQUIRE(name != NULL);
+	REQUIRE(SSL_CTX_get_ex_data(ctx, tlsctx_ticketkeys_exidx) == NULL);
+
+	/*
+	 * Derive the session ID context from the key ring secret and the
+	 * name of the configuration, so that the tickets issued by any of
+	 * the contexts created from the same configuration are accepted by
+	 * all of them.
+	 */
+	mdctx = EVP_MD_CTX_new();
+	RUNTIME_CHECK(mdctx != NULL);
+	RUNTIME_CHECK(EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) == 1);
+	RWLOCK(&keys->rwlock, isc_rwlocktype_read);
+	RUNTIME_CHECK(EVP_DigestUpdate(mdctx, keys->secret,
+				       sizeof(keys->secret)) == 1);
+	RWUNLOCK(&keys->rwlock, isc_rwlocktype_read);
+	RUNTIME_CHECK(EVP_DigestUpdate(mdctx, name, strlen(name)) == 1);
+	RUNTIME_CHECK(EVP_DigestFinal_ex(mdctx, digest, &digestlen) == 1);
+	EVP_MD_CTX_free(mdctx);
+	INSIST(digestlen >= len);
+
+	RUNTIME_CHECK(SSL_CTX_set_session_id_context(ctx, digest, len) == 1);
+
+	isc_tlsctx_ticketkeys_attach(keys, &ctxkeys);
+	RUNTIME_CHECK(SSL_CTX_set_ex_data(ctx, tlsctx_ticketkeys_exidx,
+					  ctxkeys) == 1);
+#if HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB
+	RUNTIME_CHECK(SSL_CTX_set_tlsext_ticket_key_evp_cb(
+			      ctx, tlsctx_ticketkey_cb) == 1);
+#else
+	RUNTIME_CHECK(SSL_CTX_set_tlsext_ticket_key_cb(
+			      ctx, tlsctx_ticketkey_cb) == 1);
+#endif /* HAVE_SSL_CTX_SET_TLSEXT_TICKET_KEY_EVP_CB */
+}
+
+void
+isc_tls_account_handshake(isc_tls_t *tls) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+
+	REQUIRE(tls != NULL);
+
+	keys = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(tls),
+				   tlsctx_ticketkeys_exidx);
+	if (keys == NULL) {
+		return;
+	}
+
+	if (SSL_session_reused(tls)) {
+		atomic_fetch_add_relaxed(&keys->resumed_handshakes, 1);
+	} else {
+		atomic_fetch_add_relaxed(&keys->full_handshakes, 1);
+	}
+}
+
 void
 isc__tls_setfatalmode(void) {
 	atomic_store(&handle_fatal, true);
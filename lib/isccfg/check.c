@@ -1764,6 +1764,16 @@ check_options(const cfg_obj_t *options, const cfg_obj_t *config,
 		}
 	}
 
+	obj = NULL;
+	(void)cfg_map_get(options, "resolver-hedge-queries", &obj);
+	if (obj != NULL && cfg_obj_aspercentage(obj) > 100) {
+		cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
+			    "'resolver-hedge-queries' must not exceed 100%%");
+		if (result == ISC_R_SUCCESS) {
+			result = ISC_R_RANGE;
+		}
+	}
+
 	obj = NULL;
 	(void)cfg_map_get(options, "max-ixfr-ratio", &obj);
 	if (obj != NULL && cfg_obj_ispercentage(obj)) {
@@ -2099,6 +2109,171 @@ done:
 	isc_symtab_destroy(&symtab);
 	return (result);
 }
+
+/*
+ * Is 'acl' just the built-in ACL 'name' ("any" or "none")?
+ */
+static bool
+acl_isbuiltin(const cfg_obj_t *acl, const char *name) {
+	const cfg_listelt_t *elt = cfg_list_first(acl);
+	const cfg_obj_t *ce = NULL;
+
+	if (elt == NULL || cfg_list_next(elt) != NULL) {
+		return (false);
+	}
+	ce = cfg_listelt_value(elt);
+	return (cfg_obj_isstring(ce) &&
+		strcasecmp(cfg_obj_asstring(ce), name) == 0);
+}
+
+static const cfg_obj_t *
+view_or_options(const cfg_obj_t *voptions, const cfg_obj_t *options,
+		const char *name) {
+	const cfg_obj_t *obj = NULL;
+
+	if (voptions != NULL &&
+	    cfg_map_get(voptions, name, &obj) == ISC_R_SUCCESS)
+	{
+		return (obj);
+	}
+	if (options != NULL &&
+	    cfg_map_get(options, name, &obj) == ISC_R_SUCCESS)
+	{
+		return (obj);
+	}
+	return (NULL);
+}
+
+/*
+ * The DoH response cache answers repeated GET requests in the HTTP
+ * layer, before the view selection, the ACLs and the rate limiting of
+ * the DNS layer, and whatever client sent them.  It can only be enabled
+ * where every client is given the same answers.
+ */
+static isc_result_t
+check_httpresponsecache(const cfg_obj_t *config, isc_log_t *logctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	const cfg_obj_t *obj = NULL, *cacheobj = NULL;
+	const cfg_obj_t *options = NULL, *views = NULL, *voptions = NULL;
+	const cfg_listelt_t *elt = NULL;
+	bool recursion = true;
+
+	static const char *acls[] = {
+		"allow-query",	      "allow-query-on",
+		"allow-query-cache",  "allow-query-cache-on",
+		"allow-recursion",    "allow-recursion-on",
+		"match-clients",      "match-destinations",
+		NULL
+	};
+	static const char *perclient[] = { "rate-limit", "sortlist", NULL };
+
+	(void)cfg_map_get(config, "http", &obj);
+	for (elt = cfg_list_first(obj); elt != NULL; elt = cfg_list_next(elt))
+	{
+		const cfg_obj_t *size = NULL;
+
+		(void)cfg_map_get(cfg_listelt_value(elt),
+				  "response-cache-size", &size);
+		if (size != NULL && cfg_obj_asuint32(size) != 0) {
+			cacheobj = size;
+			break;
+		}
+	}
+	if (cacheobj == NULL) {
+		return (ISC_R_SUCCESS);
+	}
+
+	(void)cfg_map_get(config, "options", &options);
+	(void)cfg_map_get(config, "view", &views);
+	if (views != NULL) {
+		elt = cfg_list_first(views);
+		if (elt != NULL && cfg_list_next(elt) != NULL) {
+			cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+				    "'response-cache-size' cannot be used "
+				    "with multiple views");
+			return (ISC_R_FAILURE);
+		}
+		if (elt != NULL) {
+			voptions = cfg_tuple_get(cfg_listelt_value(elt),
+						 "options");
+		}
+	}
+
+	for (size_t i = 0; acls[i] != NULL; i++) {
+		obj = view_or_options(voptions, options, acls[i]);
+		if (obj != NULL && !acl_isbuiltin(obj, "any")) {
+			cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+				    "'response-cache-size' cannot be used "
+				    "unless '%s' is 'any'",
+				    acls[i]);
+			result = ISC_R_FAILURE;
+		}
+	}
+
+	/*
+	 * Zones may restrict the queries further.
+	 */
+	obj = NULL;
+	(void)cfg_map_get(voptions != NULL ? voptions : config, "zone", &obj);
+	for (elt = cfg_list_first(obj); elt != NULL; elt = cfg_list_next(elt))
+	{
+		const cfg_obj_t *zone = cfg_listelt_value(elt);
+		const cfg_obj_t *zoptions = cfg_tuple_get(zone, "options");
+		const cfg_obj_t *zname = cfg_tuple_get(zone, "name");
+
+		for (size_t i = 0; acls[i] != NULL; i++) {
+			const cfg_obj_t *acl = NULL;
+
+			if (cfg_map_get(zoptions, acls[i], &acl) ==
+				    ISC_R_SUCCESS &&
+			    !acl_isbuiltin(acl, "any"))
+			{
+				cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+					    "'response-cache-size' cannot be "
+					    "used unless '%s' is 'any' in "
+					    "zone '%s'",
+					    acls[i], cfg_obj_asstring(zname));
+				result = ISC_R_FAILURE;
+			}
+		}
+	}
+
+	obj = view_or_options(NULL, options, "blackhole");
+	if (obj != NULL && !acl_isbuiltin(obj, "none")) {
+		cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+			    "'response-cache-size' cannot be used "
+			    "with 'blackhole'");
+		result = ISC_R_FAILURE;
+	}
+
+	for (size_t i = 0; perclient[i] != NULL; i++) {
+		if (view_or_options(voptions, options, perclient[i]) != NULL) {
+			cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+				    "'response-cache-size' cannot be used "
+				    "with '%s'",
+				    perclient[i]);
+			result = ISC_R_FAILURE;
+		}
+	}
+
+	/*
+	 * The default allow-recursion ACL depends on the client too.
+	 */
+	obj = view_or_options(voptions, options, "recursion");
+	if (obj != NULL) {
+		recursion = cfg_obj_asboolean(obj);
+	}
+	if (recursion &&
+	    view_or_options(voptions, options, "allow-recursion") == NULL)
+	{
+		cfg_obj_log(cacheobj, logctx, ISC_LOG_ERROR,
+			    "'response-cache-size' cannot be used with "
+			    "recursion unless 'allow-recursion' is 'any'");
+		result = ISC_R_FAILURE;
+	}
+
+	return (result);
+}
 #endif /* HAVE_LIBNGHTTP2 */
 
 static isc_result_t
@@ -5726,6 +5901,96 @@ check_controls(const cfg_obj_t *config, isc_log_t *logctx, isc_mem_t *mctx) {
 	return (result);
 }
 
+/*
+ * Each cache is saved to its own snapshot file: a file set in 'options'
+ * would be inherited by all the views, so it is only allowed there when
+ * there are no views, and two views may only name the same file if they
+ * share a cache.
+ */
+static isc_result_t
+check_cachesnapshots(const cfg_obj_t *options, const cfg_obj_t *views,
+		     isc_log_t *logctx, isc_mem_t *mctx) {
+	const cfg_obj_t *obj = NULL;
+	const cfg_listelt_t *element = NULL;
+	isc_symtab_t *symtab = NULL;
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_result_t tresult;
+
+	if (views == NULL) {
+		return (ISC_R_SUCCESS);
+	}
+
+	if (options != NULL &&
+	    cfg_map_get(options, "cache-snapshot-file", &obj) == ISC_R_SUCCESS)
+	{
+		cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
+			    "'cache-snapshot-file' cannot be set in 'options' "
+			    "when 'view' statements are used; set it in each "
+			    "view instead");
+		result = ISC_R_FAILURE;
+	}
+
+	/*
+	 * Use case insensitive comparison as not all file systems are
+	 * case sensitive.
+	 */
+	tresult = isc_symtab_create(mctx, 100, NULL, NULL, false, &symtab);
+	if (tresult != ISC_R_SUCCESS) {
+		return (tresult);
+	}
+
+	for (element = cfg_list_first(views); element != NULL;
+	     element = cfg_list_next(element))
+	{
+		const cfg_obj_t *view = cfg_listelt_value(element);
+		const cfg_obj_t *voptions = cfg_tuple_get(view, "options");
+		const cfg_obj_t *vname = cfg_tuple_get(view, "name");
+		const char *cachename = cfg_obj_asstring(vname);
+		const cfg_obj_t *fileobj = NULL;
+		const char *file = NULL;
+		isc_symvalue_t symvalue;
+
+		if (voptions == NULL ||
+		    cfg_map_get(voptions, "cache-snapshot-file", &fileobj) !=
+			    ISC_R_SUCCESS)
+		{
+			continue;
+		}
+		file = cfg_obj_asstring(fileobj);
+
+		obj = NULL;
+		if ((cfg_map_get(voptions, "attach-cache", &obj) ==
+		     ISC_R_SUCCESS) ||
+		    (options != NULL &&
+		     cfg_map_get(options, "attach-cache", &obj) ==
+			     ISC_R_SUCCESS))
+		{
+			cachename = cfg_obj_asstring(obj);
+		}
+
+		symvalue.as_cpointer = cachename;
+		tresult = isc_symtab_define(symtab, file, 1, symvalue,
+					    isc_symexists_reject);
+		if (tresult == ISC_R_EXISTS) {
+			RUNTIME_CHECK(isc_symtab_lookup(symtab, file, 1,
+							&symvalue) ==
+				      ISC_R_SUCCESS);
+			if (strcmp(symvalue.as_cpointer, cachename) != 0) {
+				cfg_obj_log(fileobj, logctx, ISC_LOG_ERROR,
+					    "view '%s': 'cache-snapshot-file' "
+					    "'%s' is already used by the cache "
+					    "'%s'",
+					    cfg_obj_asstring(vname), file,
+					    (const char *)symvalue.as_cpointer);
+				result = ISC_R_FAILURE;
+			}
+		}
+	}
+
+	isc_symtab_destroy(&symtab);
+	return (result);
+}
+
 isc_result_t
 isccfg_check_namedconf(const cfg_obj_t *config, unsigned int flags,
 		       isc_log_t *logctx, isc_mem_t *mctx) {
@@ -5773,6 +6038,10 @@ isccfg_check_namedconf(const cfg_obj_t *config, unsigned int flags,
 	if (check_httpservers(config, logctx, mctx) != ISC_R_SUCCESS) {
 		result = ISC_R_FAILURE;
 	}
+
+	if (check_httpresponsecache(config, logctx) != ISC_R_SUCCESS) {
+		result = ISC_R_FAILURE;
+	}
 #endif /* HAVE_LIBNGHTTP2 */
 
 	if (check_tls_definitions(config, logctx, mctx) != ISC_R_SUCCESS) {
@@ -5781,6 +6050,12 @@ isccfg_check_namedconf(const cfg_obj_t *config, unsigned int flags,
 
 	(void)cfg_map_get(config, "view", &views);
 
+	if (check_cachesnapshots(options, views, logctx, mctx) !=
+	    ISC_R_SUCCESS)
+	{
+		result = ISC_R_FAILURE;
+	}
+
 	if (views != NULL && options != NULL) {
 		if (check_dual_stack(options, logctx) != ISC_R_SUCCESS) {
 			result = ISC_R_FAILURE;
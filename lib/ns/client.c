@@ -51,6 +51,7 @@
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
+#include <dns/rendercache.h>
 #include <dns/resolver.h>
 #include <dns/result.h>
 #include <dns/stats.h>
@@ -59,6 +60,7 @@
 #include <dns/zone.h>
 
 #include <ns/client.h>
+#include <ns/hotzone.h>
 #include <ns/interfacemgr.h>
 #include <ns/log.h>
 #include <ns/notify.h>
@@ -456,6 +458,41 @@ done:
 	ns_client_drop(client, result);
 }
 
+/*%
+ * Add the sections of the response being rendered in 'buffer', starting
+ * at 'start', to the cache of rendered answers of the zone, unless the
+ * response was made from more than the zone data or has anything in its
+ * OPT record that the cache key does not cover.
+ */
+static void
+client_addrendered(ns_client_t *client, isc_buffer_t *buffer,
+		   unsigned int start) {
+	ns_dbversion_t *dbversion = NULL;
+	isc_region_t r;
+
+	if (client->query.restarts != 0 || client->query.authdb == NULL ||
+	    (client->message->rcode != dns_rcode_noerror &&
+	     client->message->rcode != dns_rcode_nxdomain) ||
+	    (client->message->flags & DNS_MESSAGEFLAG_TC) != 0 ||
+	    (client->query.attributes & NS_QUERYATTR_REDIRECT) != 0 ||
+	    (client->attributes & NS_CLIENTATTR_HAVEEXPIRE) != 0 ||
+	    client->ede != NULL)
+	{
+		return;
+	}
+
+	dbversion = ns_client_findversion(client, client->query.authdb);
+	if (dbversion == NULL) {
+		return;
+	}
+
+	isc_buffer_usedregion(buffer, &r);
+	isc_region_consume(&r, start);
+	dns_rendercache_add(client->query.rendercache, client->query.authdb,
+			    dbversion->version, &client->query.renderkey,
+			    client->message, &r);
+}
+
 void
 ns_client_send(ns_client_t *client) {
 	isc_result_t result;
@@ -469,6 +506,7 @@ ns_client_send(ns_client_t *client) {
 	unsigned int preferred_glue;
 	bool opt_included = false;
 	size_t respsize;
+	unsigned int sections = 0;
 	dns_aclenv_t *env = NULL;
 #ifdef HAVE_DNSTAP
 	unsigned char zone[DNS_NAME_MAXWIRE];
@@ -583,6 +621,17 @@ ns_client_send(ns_client_t *client) {
 	if ((client->message->flags & DNS_MESSAGEFLAG_TC) != 0) {
 		goto renderend;
 	}
+	if (client->query.rendered != NULL) {
+		result = dns_message_renderanswer(client->message,
+						  client->query.rendered);
+		if (result == ISC_R_NOSPACE) {
+			client->message->flags |= DNS_MESSAGEFLAG_TC;
+		} else if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+		goto renderend;
+	}
+	sections = isc_buffer_usedlength(&buffer);
 	result = dns_message_rendersection(client->message, DNS_SECTION_ANSWER,
 					   DNS_MESSAGERENDER_PARTIAL |
 						   render_opts);
@@ -609,6 +658,9 @@ ns_client_send(ns_client_t *client) {
 	if (result != ISC_R_SUCCESS && result != ISC_R_NOSPACE) {
 		goto cleanup;
 	}
+	if (result == ISC_R_SUCCESS && client->query.rendercache != NULL) {
+		client_addrendered(client, &buffer, sections);
+	}
 renderend:
 	result = dns_message_renderend(client->message);
 	if (result != ISC_R_SUCCESS) {
@@ -1620,6 +1672,13 @@ ns__client_reset_cb(void *client0) {
 	}
 
 	ns_client_endrequest(client);
+
+	/*
+	 * The name buffers were allocated from the arena; query_reset()
+	 * only forgets them for requests that went through ns_query_start().
+	 */
+	ISC_LIST_INIT(client->query.namebufs);
+	isc_arena_reset(client->arena);
 	if (client->tcpbuf != NULL) {
 		isc_mem_put(client->manager->send_mctx, client->tcpbuf,
 			    client->tcpbuf_size);
@@ -1655,6 +1714,7 @@ ns__client_put_cb(void *client0) {
 	 */
 	ns_query_free(client);
 	client_extendederror_reset(client);
+	isc_arena_destroy(&client->arena);
 
 	client->magic = 0;
 
@@ -2311,6 +2371,8 @@ ns__client_setup(ns_client_t *client, ns_clientmgr_t *mgr, bool new) {
 
 		client->sendbuf = isc_mem_get(client->manager->send_mctx,
 					      NS_CLIENT_SEND_BUFFER_SIZE);
+		isc_arena_create(client->manager->mctx, NS_CLIENT_ARENA_SIZE,
+				 &client->arena);
 		/*
 		 * Set magic earlier than usual because ns_query_init()
 		 * and the functions it calls will require it.
@@ -2332,6 +2394,7 @@ ns__client_setup(ns_client_t *client, ns_clientmgr_t *mgr, bool new) {
 			.magic = 0,
 			.manager = client->manager,
 			.sendbuf = client->sendbuf,
+			.arena = client->arena,
 			.message = client->message,
 			.query = client->query,
 		};
@@ -2356,6 +2419,10 @@ ns__client_setup(ns_client_t *client, ns_clientmgr_t *mgr, bool new) {
 	return (ISC_R_SUCCESS);
 
 cleanup:
+	if (client->arena != NULL) {
+		isc_arena_destroy(&client->arena);
+	}
+
 	if (client->sendbuf != NULL) {
 		isc_mem_put(client->manager->send_mctx, client->sendbuf,
 			    NS_CLIENT_SEND_BUFFER_SIZE);
@@ -2391,6 +2458,8 @@ clientmgr_destroy_cb(void *arg) {
 
 	isc_mutex_destroy(&manager->reclock);
 
+	ns_hotzones_destroy(&manager->hotzones);
+
 	ns_server_detach(&manager->sctx);
 
 	isc_mem_detach(&manager->send_mctx);
@@ -2426,6 +2495,7 @@ ns_clientmgr_create(ns_server_t *sctx, isc_loopmgr_t *loopmgr,
 	dns_aclenv_attach(aclenv, &manager->aclenv);
 	isc_refcount_init(&manager->references, 1);
 	ns_server_attach(sctx, &manager->sctx);
+	ns_hotzones_create(mctx, &manager->hotzones);
 
 	/*
 	 * We create specialised per-worker memory context specifically
@@ -2845,7 +2915,11 @@ ns_client_newnamebuf(ns_client_t *client) {
 
 	CTRACE("ns_client_newnamebuf");
 
-	isc_buffer_allocate(client->manager->mctx, &dbuf, 1024);
+	/*
+	 * Name buffers live until the end of the request.
+	 */
+	dbuf = isc_arena_get(client->arena, sizeof(*dbuf) + 1024);
+	isc_buffer_init(dbuf, dbuf + 1, 1024);
 	ISC_LIST_APPEND(client->query.namebufs, dbuf, link);
 
 	CTRACE("ns_client_newnamebuf: done");
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <isc/buffer.h>
+#include <isc/log.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/log.h>
+#include <dns/name.h>
+
+#include <ns/hotzone.h>
+#include <ns/log.h>
+
+#define HOTZONES_MAGIC	  ISC_MAGIC('H', 'o', 't', 'Z')
+#define VALID_HOTZONES(h) ISC_MAGIC_VALID(h, HOTZONES_MAGIC)
+
+typedef struct hotzone {
+	dns_fixedname_t fixed;
+	dns_name_t     *name; /*%< NULL if the counter is unused */
+	uint32_t	hashval;
+	uint32_t	count;	  /*%< Recursions this second */
+	uint32_t	error;	  /*%< Overestimation of 'count' */
+	uint32_t	admitted; /*%< Recursions allowed while hot */
+	uint32_t	rate;	  /*%< Recursions in the previous second */
+	uint32_t	refused;  /*%< Refused since it became hot */
+	bool		hot;
+} hotzone_t;
+
+struct ns_hotzones {
+	unsigned int  magic;
+	isc_mem_t    *mctx;
+	isc_stdtime_t now;
+	hotzone_t     zones[NS_HOTZONES_SIZE];
+};
+
+void
+ns_hotzones_create(isc_mem_t *mctx, ns_hotzones_t **hzp) {
+	ns_hotzones_t *hz = NULL;
+
+	REQUIRE(hzp != NULL && *hzp == NULL);
+
+	hz = isc_mem_get(mctx, sizeof(*hz));
+	*hz = (ns_hotzones_t){ .magic = HOTZONES_MAGIC };
+	isc_mem_attach(mctx, &hz->mctx);
+
+	*hzp = hz;
+}
+
+void
+ns_hotzones_destroy(ns_hotzones_t **hzp) {
+	ns_hotzones_t *hz = NULL;
+
+	REQUIRE(hzp != NULL && VALID_HOTZONES(*hzp));
+
+	hz = *hzp;
+	*hzp = NULL;
+
+	hz->magic = 0;
+	isc_mem_putanddetach(&hz->mctx, hz, sizeof(*hz));
+}
+
+/*
+ * Start a new second: the zones whose guaranteed count (the count less
+ * its possible overestimation) in the second that just ended exceeds the
+ * limit are hot for the next one.  If a second or more went by without
+ * any recursion, the counts are too old to tell and nothing is hot.
+ */
+static void
+hotzones_tick(ns_hotzones_t *hz, uint32_t limit, isc_stdtime_t now) {
+	bool recent = (now == hz->now + 1);
+
+	for (size_t i = 0; i < NS_HOTZONES_SIZE; i++) {
+		hotzone_t *zone = &hz->zones[i];
+		uint32_t guaranteed = zone->count - zone->error;
+		bool hot = recent && guaranteed > limit;
+
+		if (hot && !zone->hot) {
+			char namebuf[DNS_NAME_FORMATSIZE];
+
+			dns_name_format(zone->name, namebuf, sizeof(namebuf));
+			isc_log_write(ns_lctx, DNS_LOGCATEGORY_SPILL,
+				      NS_LOGMODULE_QUERY, ISC_LOG_INFO,
+				      "recursions-per-zone: '%s' is hot "
+				      "(%" PRIu32 " recursions/s), limiting",
+				      namebuf, guaranteed);
+		}
+		if (!hot) {
+			zone->refused = 0;
+		}
+
+		zone->hot = hot;
+		zone->rate = recent ? guaranteed : 0;
+		zone->count = 0;
+		zone->error = 0;
+		zone->admitted = 0;
+	}
+
+	hz->now = now;
+}
+
+isc_result_t
+ns_hotzones_admit(ns_hotzones_t *hz, const dns_name_t *zone, uint32_t limit,
+		  isc_stdtime_t now) {
+	hotzone_t *found = NULL, *victim = NULL;
+	uint32_t hashval;
+
+	REQUIRE(VALID_HOTZONES(hz));
+	REQUIRE(DNS_NAME_VALID(zone));
+
+	if (now != hz->now) {
+		hotzones_tick(hz, limit, now);
+	}
+
+	hashval = dns_name_hash(zone);
+	for (size_t i = 0; i < NS_HOTZONES_SIZE; i++) {
+		hotzone_t *z = &hz->zones[i];
+
+		if (z->name != NULL && z->hashval == hashval &&
+		    dns_name_equal(z->name, zone))
+		{
+			found = z;
+			break;
+		}
+
+		/* Prefer to replace a zone that is not hot */
+		if (victim == NULL || z->count < victim->count ||
+		    (z->count == victim->count && victim->hot && !z->hot))
+		{
+			victim = z;
+		}
+	}
+
+	if (found == NULL) {
+		/*
+		 * Space-Saving: the new zone takes over the smallest
+		 * counter, whose count is an upper bound of the number
+		 * of times the new zone could have been missed.
+		 */
+		found = victim;
+		found->name = dns_fixedname_initname(&found->fixed);
+		dns_name_copy(zone, found->name);
+		found->hashval = hashval;
+		found->error = found->count;
+		found->admitted = 0;
+		found->rate = 0;
+		found->refused = 0;
+		found->hot = false;
+	}
+
+	found->count++;
+
+	if (!found->hot) {
+		return (ISC_R_SUCCESS);
+	}
+	if (found->admitted < limit) {
+		found->admitted++;
+		return (ISC_R_SUCCESS);
+	}
+
+	found->refused++;
+	return (ISC_R_QUOTA);
+}
+
+/*
+ * Second level labels under which country code top level domains commonly
+ * register names, as in "example.co.uk" or "example.com.au".
+ */
+static const char *registries[] = { "ac",  "co",  "com", "edu", "go",
+				    "gob", "gov", "ne",	 "net", "or",
+				    "org", NULL };
+
+/*
+ * Whether 'name' is the root, a top level domain, or a second level
+ * domain such as "co.uk" under which a country code top level domain
+ * registers names: all the names looked up below it that miss the cache
+ * are distinct, so it would be hot on any busy resolver.
+ */
+static bool
+public_suffix(const dns_name_t *name) {
+	unsigned int labels = dns_name_countlabels(name);
+	dns_label_t sld, tld;
+
+	if (labels <= 2) {
+		return (true);
+	}
+	if (labels > 3) {
+		return (false);
+	}
+
+	/* The length octet is included in the label length */
+	dns_name_getlabel(name, 1, &tld);
+	if (tld.length != 3) {
+		return (false);
+	}
+
+	dns_name_getlabel(name, 0, &sld);
+	for (size_t i = 0; registries[i] != NULL; i++) {
+		if (sld.length - 1 == strlen(registries[i]) &&
+		    strncasecmp((const char *)sld.base + 1, registries[i],
+				sld.length - 1) == 0)
+		{
+			return (true);
+		}
+	}
+
+	return (false);
+}
+
+isc_result_t
+ns_hotzones_admitname(ns_hotzones_t *hz, const dns_name_t *name,
+		      const dns_name_t *zone, uint32_t limit,
+		      isc_stdtime_t now) {
+	unsigned int labels, zlabels;
+
+	REQUIRE(VALID_HOTZONES(hz));
+	REQUIRE(DNS_NAME_VALID(name));
+	REQUIRE(zone == NULL || DNS_NAME_VALID(zone));
+
+	if (zone == NULL || !dns_name_issubdomain(name, zone)) {
+		zone = dns_rootname;
+	}
+
+	/*
+	 * Count the recursion in the zone cut, unless it is a public
+	 * suffix: then in the name below it on the way to 'name', which
+	 * is the zone that the resolver will find under the public
+	 * suffix.
+	 */
+	labels = dns_name_countlabels(name);
+	zlabels = dns_name_countlabels(zone);
+	for (unsigned int n = zlabels; n <= labels; n++) {
+		dns_name_t suffix = DNS_NAME_INITEMPTY;
+
+		dns_name_getlabelsequence(name, labels - n, n, &suffix);
+		if (!public_suffix(&suffix)) {
+			return (ns_hotzones_admit(hz, &suffix, limit, now));
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+isc_result_t
+ns_hotzones_dump(ns_hotzones_t *hz, isc_stdtime_t now, isc_buffer_t **buf) {
+	isc_result_t result;
+
+	REQUIRE(VALID_HOTZONES(hz));
+	REQUIRE(buf != NULL && *buf != NULL);
+
+	/* The hot zones were computed at the start of the second hz->now */
+	if (now != hz->now && now != hz->now + 1) {
+		return (ISC_R_SUCCESS);
+	}
+
+	for (size_t i = 0; i < NS_HOTZONES_SIZE; i++) {
+		hotzone_t *zone = &hz->zones[i];
+		char nb[DNS_NAME_FORMATSIZE];
+		char text[DNS_NAME_FORMATSIZE + BUFSIZ];
+
+		if (!zone->hot) {
+			continue;
+		}
+
+		dns_name_format(zone->name, nb, sizeof(nb));
+		snprintf(text, sizeof(text),
+			 "\n- %s: %" PRIu32 " recursions/s (refused %" PRIu32
+			 ")",
+			 nb, zone->rate, zone->refused);
+
+		result = isc_buffer_reserve(*buf, strlen(text));
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		isc_buffer_putstr(*buf, text);
+	}
+
+	return (ISC_R_SUCCESS);
+}
@@ -58,6 +58,7 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/arena.h>
 #include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/magic.h>
@@ -82,6 +83,7 @@
 
 #define NS_CLIENT_TCP_BUFFER_SIZE  65535
 #define NS_CLIENT_SEND_BUFFER_SIZE 4096
+#define NS_CLIENT_ARENA_SIZE	   8192
 
 /*!
  * Client object states.  Ordering is significant: higher-numbered
@@ -155,6 +157,9 @@ struct ns_clientmgr {
 	/* Lock covers the recursing list */
 	isc_mutex_t   reclock;
 	client_list_t recursing; /*%< Recursing clients */
+
+	/* Only used on the loop of the manager */
+	ns_hotzones_t *hotzones; /*%< Zones recursed into the most */
 };
 
 /*% nameserver client structure */
@@ -175,6 +180,7 @@ struct ns_client {
 	size_t		tcpbuf_size;
 	dns_message_t  *message;
 	unsigned char  *sendbuf;
+	isc_arena_t    *arena; /*%< Memory freed when the request ends */
 	dns_rdataset_t *opt;
 	dns_ednsopt_t  *ede;
 	uint16_t	udpsize;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*! \file
+ * \brief
+ * Detection of the zones that receive the most recursive queries.
+ *
+ * A random-subdomain ("water torture") attack sends queries for unique
+ * names under a victim zone, so that every query misses the cache and
+ * is resolved by the victim's servers.  The hot zone table counts the
+ * recursions for each zone (the deepest zone cut known from the cache,
+ * or the zone below it when that is a public suffix) with the
+ * Space-Saving algorithm, which finds the heavy hitters of a stream in
+ * a fixed number of counters.  A zone that was recursed into
+ * more than the limit during the previous second is hot, and only the
+ * limit of recursions is allowed for it during the current second.
+ *
+ * A table belongs to one loop (the client manager of the loop) and is
+ * not locked; the loops must be paused to read another loop's table.
+ */
+
+#include <isc/buffer.h>
+#include <isc/stdtime.h>
+#include <isc/types.h>
+
+#include <dns/types.h>
+
+#include <ns/types.h>
+
+#define NS_HOTZONES_SIZE 32
+
+void
+ns_hotzones_create(isc_mem_t *mctx, ns_hotzones_t **hzp);
+/*%<
+ * Create a hot zone table with NS_HOTZONES_SIZE counters.
+ *
+ * Requires:
+ *\li	'hzp' is not NULL and '*hzp' is NULL.
+ */
+
+void
+ns_hotzones_destroy(ns_hotzones_t **hzp);
+/*%<
+ * Destroy a hot zone table.
+ */
+
+isc_result_t
+ns_hotzones_admit(ns_hotzones_t *hz, const dns_name_t *zone, uint32_t limit,
+		  isc_stdtime_t now);
+/*%<
+ * Count a recursion for a name in 'zone' at time 'now', and check
+ * whether it may proceed: the zone is hot if more than 'limit'
+ * recursions into it were counted during the previous second, and then
+ * at most 'limit' are admitted during the current second.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS	the recursion may proceed
+ *\li	ISC_R_QUOTA	the zone is hot and its limit is exhausted
+ */
+
+isc_result_t
+ns_hotzones_admitname(ns_hotzones_t *hz, const dns_name_t *name,
+		      const dns_name_t *zone, uint32_t limit,
+		      isc_stdtime_t now);
+/*%<
+ * Like ns_hotzones_admit(), for a recursion for 'name' starting from
+ * the zone cut 'zone' (the root if NULL).  The recursion is counted in
+ * 'zone', unless it is the root, a top level domain, or a public suffix
+ * such as "co.uk": then in the closest enclosing name of 'name' below
+ * it that is not.  Recursions for public suffixes themselves are not
+ * counted, and always admitted.
+ */
+
+isc_result_t
+ns_hotzones_dump(ns_hotzones_t *hz, isc_stdtime_t now, isc_buffer_t **buf);
+/*%<
+ * Append a line for each zone of the table that is hot at time 'now'
+ * to '*buf', with the number of recursions counted for it in the
+ * previous second and of the recursions refused since it became hot.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	ISC_R_NOSPACE	the buffer could not be extended
+ */
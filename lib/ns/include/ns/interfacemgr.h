@@ -43,6 +43,7 @@
 
 #include <stdbool.h>
 
+#include <isc/buffer.h>
 #include <isc/loop.h>
 #include <isc/magic.h>
 #include <isc/mem.h>
@@ -169,6 +170,14 @@ ns_interface_shutdown(ns_interface_t *ifp);
 void
 ns_interfacemgr_dumprecursing(FILE *f, ns_interfacemgr_t *mgr);
 
+isc_result_t
+ns_interfacemgr_dumphotzones(ns_interfacemgr_t *mgr, isc_buffer_t **buf);
+/*%<
+ * Append the zones that are hot on any of the worker threads, as
+ * limited by 'recursions-per-zone', to '*buf'.  The loops must be
+ * paused, see isc_loopmgr_pause().
+ */
+
 bool
 ns_interfacemgr_listeningon(ns_interfacemgr_t *mgr, const isc_sockaddr_t *addr);
 
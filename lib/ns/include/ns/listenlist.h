@@ -51,6 +51,7 @@ struct ns_listenelt {
 	size_t		    http_endpoints_number;
 	uint32_t	    http_max_clients;
 	uint32_t	    max_concurrent_streams;
+	uint32_t	    http_response_cache_size;
 	ISC_LINK(ns_listenelt_t) link;
 };
 
@@ -98,9 +99,14 @@ ns_listenelt_create_http(isc_mem_t *mctx, in_port_t http_port, dns_acl_t *acl,
 			 const ns_listen_tls_params_t *tls_params,
 			 isc_tlsctx_cache_t *tlsctx_cache, char **endpoints,
 			 size_t nendpoints, const uint32_t max_clients,
-			 const uint32_t max_streams, ns_listenelt_t **target);
+			 const uint32_t max_streams,
+			 const uint32_t response_cache_size,
+			 ns_listenelt_t **target);
 /*%<
  * Create a listen-on list element for HTTP(S).
+ *
+ * 'response_cache_size' is the maximum number of DoH GET responses
+ * cached per worker; '0' disables the response cache.
  */
 
 void
@@ -45,7 +45,6 @@ typedef enum {
 	RECTYPE_NORMAL,
 	RECTYPE_PREFETCH,
 	RECTYPE_RPZ,
-	RECTYPE_STALE_REFRESH,
 	RECTYPE_HOOK,
 	RECTYPE_COUNT,
 } ns_query_rectype_t;
@@ -60,8 +59,6 @@ typedef enum {
 	((client)->query.recursions[RECTYPE_PREFETCH].handle)
 #define HANDLE_RECTYPE_RPZ(client) \
 	((client)->query.recursions[RECTYPE_RPZ].handle)
-#define HANDLE_RECTYPE_STALE_REFRESH(client) \
-	((client)->query.recursions[RECTYPE_STALE_REFRESH].handle)
 #define HANDLE_RECTYPE_HOOK(client) \
 	((client)->query.recursions[RECTYPE_HOOK].handle)
 
@@ -75,8 +72,6 @@ typedef enum {
 	((client)->query.recursions[RECTYPE_PREFETCH].fetch)
 #define FETCH_RECTYPE_RPZ(client) \
 	((client)->query.recursions[RECTYPE_RPZ].fetch)
-#define FETCH_RECTYPE_STALE_REFRESH(client) \
-	((client)->query.recursions[RECTYPE_STALE_REFRESH].fetch)
 #define FETCH_RECTYPE_HOOK(client) \
 	((client)->query.recursions[RECTYPE_HOOK].fetch)
 
@@ -120,6 +115,10 @@ struct ns_query {
 	unsigned int	dns64_options;
 	unsigned int	dns64_ttl;
 
+	dns_rendercache_t    *rendercache;
+	dns_renderedanswer_t *rendered;
+	isc_region_t	      renderkey;
+
 	struct {
 		dns_db_t       *db;
 		dns_zone_t     *zone;
@@ -95,6 +95,7 @@ struct ns_server {
 	uint32_t options;
 
 	dns_acl_t     *blackholeacl;
+	uint32_t       recursionsperzone;
 	uint16_t       udpsize;
 	uint16_t       transfer_tcp_message_size;
 	bool	       interface_auto;
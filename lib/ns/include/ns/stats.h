@@ -112,7 +112,19 @@ enum {
 
 	ns_statscounter_updatequota = 67,
 
-	ns_statscounter_max = 68,
+	ns_statscounter_rendercachehit = 68,
+	ns_statscounter_rendercachemiss = 69,
+
+	ns_statscounter_recurstime0 = 70,
+	ns_statscounter_recurstime1 = 71,
+	ns_statscounter_recurstime2 = 72,
+	ns_statscounter_recurstime3 = 73,
+	ns_statscounter_recurstime4 = 74,
+	ns_statscounter_recurstime5 = 75,
+
+	ns_statscounter_reczonelimited = 76,
+
+	ns_statscounter_max = 77,
 };
 
 void
@@ -20,6 +20,7 @@
 #include <isc/netmgr.h>
 #include <isc/os.h>
 #include <isc/random.h>
+#include <isc/stdtime.h>
 #include <isc/string.h>
 #include <isc/tid.h>
 #include <isc/util.h>
@@ -28,6 +29,7 @@
 #include <dns/dispatch.h>
 
 #include <ns/client.h>
+#include <ns/hotzone.h>
 #include <ns/interfacemgr.h>
 #include <ns/log.h>
 #include <ns/server.h>
@@ -572,7 +574,8 @@ load_http_endpoints(isc_nm_http_endpoints_t *epset, ns_interface_t *ifp,
 static isc_result_t
 ns_interface_listenhttp(ns_interface_t *ifp, isc_tlsctx_t *sslctx, char **eps,
 			size_t neps, uint32_t max_clients,
-			uint32_t max_concurrent_streams) {
+			uint32_t max_concurrent_streams,
+			uint32_t response_cache_size) {
 #if HAVE_LIBNGHTTP2
 	isc_result_t result = ISC_R_FAILURE;
 	isc_nmsocket_t *sock = NULL;
@@ -594,6 +597,10 @@ ns_interface_listenhttp(ns_interface_t *ifp, isc_tlsctx_t *sslctx, char **eps,
 
 	isc_nm_http_endpoints_detach(&epset);
 
+	if (result == ISC_R_SUCCESS) {
+		isc_nm_http_set_response_cache_size(sock, response_cache_size);
+	}
+
 	if (quota != NULL) {
 		if (result != ISC_R_SUCCESS) {
 			isc_quota_destroy(quota);
@@ -638,6 +645,7 @@ ns_interface_listenhttp(ns_interface_t *ifp, isc_tlsctx_t *sslctx, char **eps,
 	UNUSED(neps);
 	UNUSED(max_clients);
 	UNUSED(max_concurrent_streams);
+	UNUSED(response_cache_size);
 	return (ISC_R_NOTIMPLEMENTED);
 #endif
 }
@@ -666,7 +674,8 @@ interface_setup(ns_interfacemgr_t *mgr, isc_sockaddr_t *addr, const char *name,
 		result = ns_interface_listenhttp(
 			ifp, elt->sslctx, elt->http_endpoints,
 			elt->http_endpoints_number, elt->http_max_clients,
-			elt->max_concurrent_streams);
+			elt->max_concurrent_streams,
+			elt->http_response_cache_size);
 		if (result != ISC_R_SUCCESS) {
 			goto cleanup_interface;
 		}
@@ -956,6 +965,8 @@ update_http_settings(ns_interface_t *ifp, ns_listenelt_t *le) {
 	}
 
 	isc_nmsocket_set_max_streams(listener, le->max_concurrent_streams);
+	isc_nm_http_set_response_cache_size(listener,
+					    le->http_response_cache_size);
 
 	epset = isc_nm_http_endpoints_new(ifp->mgr->mctx);
 
@@ -1370,6 +1381,23 @@ ns_interfacemgr_dumprecursing(FILE *f, ns_interfacemgr_t *mgr) {
 	UNLOCK(&mgr->lock);
 }
 
+isc_result_t
+ns_interfacemgr_dumphotzones(ns_interfacemgr_t *mgr, isc_buffer_t **buf) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_stdtime_t now = isc_stdtime_now();
+
+	REQUIRE(NS_INTERFACEMGR_VALID(mgr));
+
+	LOCK(&mgr->lock);
+	for (size_t i = 0; i < mgr->ncpus && result == ISC_R_SUCCESS; i++) {
+		result = ns_hotzones_dump(mgr->clientmgrs[i]->hotzones, now,
+					  buf);
+	}
+	UNLOCK(&mgr->lock);
+
+	return (result);
+}
+
 bool
 ns_interfacemgr_listeningon(ns_interfacemgr_t *mgr,
 			    const isc_sockaddr_t *addr) {
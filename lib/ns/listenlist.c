@@ -36,6 +36,7 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_tlsctx_t *sslctx = NULL;
 	isc_tls_cert_store_t *store = NULL, *found_store = NULL;
+	isc_tlsctx_ticketkeys_t *ticketkeys = NULL;
 
 	REQUIRE(target != NULL && *target == NULL);
 	REQUIRE(!tls || (tls_params != NULL && tlsctx_cache != NULL));
@@ -73,8 +74,23 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 			 * handshake failures. See OpenSSL documentation for
 			 * 'SSL_CTX_set_session_id_context()', the "Warnings"
 			 * section.
+			 *
+			 * When a shared session ticket key ring is available,
+			 * the session ID context is derived from it, so that
+			 * the sessions survive reconfiguration.
 			 */
-			isc_tlsctx_set_random_session_id_context(sslctx);
+			ticketkeys = isc_tlsctx_cache_get_ticketkeys(
+				tlsctx_cache);
+			if (ticketkeys != NULL &&
+			    (!tls_params->session_tickets_set ||
+			     tls_params->session_tickets))
+			{
+				isc_tlsctx_set_ticketkeys(sslctx, ticketkeys,
+							  tls_params->name);
+			} else {
+				isc_tlsctx_set_random_session_id_context(
+					sslctx);
+			}
 
 			/*
 			 * If CA-bundle file is specified - enable client
@@ -192,6 +208,7 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 	elt->http_endpoints_number = 0;
 	elt->http_max_clients = 0;
 	elt->max_concurrent_streams = 0;
+	elt->http_response_cache_size = 0;
 
 	*target = elt;
 	return (ISC_R_SUCCESS);
@@ -221,7 +238,9 @@ ns_listenelt_create_http(isc_mem_t *mctx, in_port_t http_port, dns_acl_t *acl,
 			 const ns_listen_tls_params_t *tls_params,
 			 isc_tlsctx_cache_t *tlsctx_cache, char **endpoints,
 			 size_t nendpoints, const uint32_t max_clients,
-			 const uint32_t max_streams, ns_listenelt_t **target) {
+			 const uint32_t max_streams,
+			 const uint32_t response_cache_size,
+			 ns_listenelt_t **target) {
 	isc_result_t result;
 
 	REQUIRE(target != NULL && *target == NULL);
@@ -243,6 +262,7 @@ ns_listenelt_create_http(isc_mem_t *mctx, in_port_t http_port, dns_acl_t *acl,
 		(*target)->http_max_clients = max_clients == 0 ? UINT32_MAX
 							       : max_clients;
 		(*target)->max_concurrent_streams = max_streams;
+		(*target)->http_response_cache_size = response_cache_size;
 	} else {
 		size_t i;
 		for (i = 0; i < nendpoints; i++) {
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <isc/arena.h>
 #include <isc/async.h>
 #include <isc/hex.h>
 #include <isc/mem.h>
@@ -55,6 +56,7 @@
 #include <dns/rdatasetiter.h>
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
+#include <dns/rendercache.h>
 #include <dns/resolver.h>
 #include <dns/result.h>
 #include <dns/stats.h>
@@ -66,6 +68,7 @@
 
 #include <ns/client.h>
 #include <ns/hooks.h>
+#include <ns/hotzone.h>
 #include <ns/interfacemgr.h>
 #include <ns/log.h>
 #include <ns/server.h>
@@ -575,7 +578,11 @@ query_send(ns_client_t *client) {
 
 	if (client->message->rcode == dns_rcode_noerror) {
 		dns_section_t answer = DNS_SECTION_ANSWER;
-		if (ISC_LIST_EMPTY(client->message->sections[answer])) {
+		bool noanswer = ISC_LIST_EMPTY(client->message->sections[answer]);
+		if (client->query.rendered != NULL) {
+			noanswer = (client->query.rendered->counts[answer] == 0);
+		}
+		if (noanswer) {
 			if (client->query.isreferral) {
 				counter = ns_statscounter_referral;
 			} else {
@@ -689,7 +696,6 @@ ns_query_cancel(ns_client_t *client) {
 
 static void
 query_reset(ns_client_t *client, bool everything) {
-	isc_buffer_t *dbuf, *dbuf_next;
 	ns_dbversion_t *dbversion, *dbversion_next;
 
 	CTRACE(ISC_LOG_DEBUG(3), "query_reset");
@@ -730,12 +736,20 @@ query_reset(ns_client_t *client, bool everything) {
 	if (client->query.dns64_sigaaaa != NULL) {
 		ns_client_putrdataset(client, &client->query.dns64_sigaaaa);
 	}
-	if (client->query.dns64_aaaaok != NULL) {
-		isc_mem_cput(client->manager->mctx, client->query.dns64_aaaaok,
-			     client->query.dns64_aaaaoklen, sizeof(bool));
-		client->query.dns64_aaaaok = NULL;
-		client->query.dns64_aaaaoklen = 0;
+	/*
+	 * The dns64_aaaaok array and the name buffers are allocated from
+	 * the client arena, which is reset after the request.
+	 */
+	client->query.dns64_aaaaok = NULL;
+	client->query.dns64_aaaaoklen = 0;
+
+	if (client->query.rendercache != NULL) {
+		dns_rendercache_detach(&client->query.rendercache);
+	}
+	if (client->query.rendered != NULL) {
+		dns_renderedanswer_detach(&client->query.rendered);
 	}
+	client->query.renderkey = (isc_region_t){ 0 };
 
 	ns_client_putrdataset(client, &client->query.redirect.rdataset);
 	ns_client_putrdataset(client, &client->query.redirect.sigrdataset);
@@ -752,15 +766,7 @@ query_reset(ns_client_t *client, bool everything) {
 
 	query_freefreeversions(client, everything);
 
-	for (dbuf = ISC_LIST_HEAD(client->query.namebufs); dbuf != NULL;
-	     dbuf = dbuf_next)
-	{
-		dbuf_next = ISC_LIST_NEXT(dbuf, link);
-		if (dbuf_next != NULL || everything) {
-			ISC_LIST_UNLINK(client->query.namebufs, dbuf, link);
-			isc_buffer_free(&dbuf);
-		}
-	}
+	ISC_LIST_INIT(client->query.namebufs);
 
 	if (client->query.restarts > 0) {
 		/*
@@ -828,7 +834,6 @@ ns_query_init(ns_client_t *client) {
 		dns_fixedname_initname(&client->query.redirect.fixed);
 	query_reset(client, false);
 	ns_client_newdbversion(client, 3);
-	ns_client_newnamebuf(client);
 
 	return (result);
 }
@@ -2530,95 +2535,12 @@ recursionquotatype_detach(ns_client_t *client) {
 			   ns_statscounter_recursclients);
 }
 
-static void
-stale_refresh_aftermath(ns_client_t *client, isc_result_t result) {
-	dns_db_t *db = NULL;
-	unsigned int dboptions;
-	isc_buffer_t buffer;
-	query_ctx_t qctx;
-	dns_clientinfomethods_t cm;
-	dns_clientinfo_t ci;
-	char namebuf[DNS_NAME_FORMATSIZE];
-	char typebuf[DNS_RDATATYPE_FORMATSIZE];
-
-	/*
-	 * If refreshing a stale RRset failed, we need to set the
-	 * stale-refresh-time window, so that on future requests for this
-	 * RRset the stale entry may be used immediately.
-	 */
-	switch (result) {
-	case ISC_R_SUCCESS:
-	case DNS_R_GLUE:
-	case DNS_R_ZONECUT:
-	case ISC_R_NOTFOUND:
-	case DNS_R_DELEGATION:
-	case DNS_R_EMPTYNAME:
-	case DNS_R_NXRRSET:
-	case DNS_R_EMPTYWILD:
-	case DNS_R_NXDOMAIN:
-	case DNS_R_COVERINGNSEC:
-	case DNS_R_NCACHENXDOMAIN:
-	case DNS_R_NCACHENXRRSET:
-	case DNS_R_CNAME:
-	case DNS_R_DNAME:
-		break;
-	default:
-		dns_name_format(client->query.qname, namebuf, sizeof(namebuf));
-		dns_rdatatype_format(client->query.qtype, typebuf,
-				     sizeof(typebuf));
-		ns_client_log(client, NS_LOGCATEGORY_SERVE_STALE,
-			      NS_LOGMODULE_QUERY, ISC_LOG_NOTICE,
-			      "%s/%s stale refresh failed: timed out", namebuf,
-			      typebuf);
-
-		/*
-		 * Set up a short lived query context, solely to set the
-		 * last refresh failure time on the RRset in the cache
-		 * database, starting the stale-refresh-time window for it.
-		 * This is a condensed form of query_lookup().
-		 */
-		client->now = isc_stdtime_now();
-		client->query.attributes &= ~NS_QUERYATTR_RECURSIONOK;
-		qctx_init(client, NULL, 0, &qctx);
-
-		dns_clientinfomethods_init(&cm, ns_client_sourceip);
-		dns_clientinfo_init(&ci, qctx.client, NULL);
-		if (HAVEECS(qctx.client)) {
-			dns_clientinfo_setecs(&ci, &qctx.client->ecs);
-		}
-
-		result = qctx_prepare_buffers(&qctx, &buffer);
-		if (result != ISC_R_SUCCESS) {
-			goto cleanup;
-		}
-
-		dboptions = qctx.client->query.dboptions;
-		dboptions |= DNS_DBFIND_STALEOK;
-		dboptions |= DNS_DBFIND_STALESTART;
-
-		dns_db_attach(qctx.client->view->cachedb, &db);
-		(void)dns_db_findext(db, qctx.client->query.qname, NULL,
-				     qctx.client->query.qtype, dboptions,
-				     qctx.client->now, &qctx.node, qctx.fname,
-				     &cm, &ci, qctx.rdataset, qctx.sigrdataset);
-		if (qctx.node != NULL) {
-			dns_db_detachnode(db, &qctx.node);
-		}
-		dns_db_detach(&db);
-
-	cleanup:
-		qctx_freedata(&qctx);
-		qctx_destroy(&qctx);
-	}
-}
-
 static void
 cleanup_after_fetch(dns_fetchresponse_t *resp, const char *ctracestr,
 		    ns_query_rectype_t recursion_type) {
 	ns_client_t *client = resp->arg;
 	isc_nmhandle_t **handlep = NULL;
 	dns_fetch_t **fetchp = NULL;
-	isc_result_t result;
 
 	REQUIRE(resp->type == FETCHDONE);
 	REQUIRE(NS_CLIENT_VALID(client));
@@ -2627,7 +2549,6 @@ cleanup_after_fetch(dns_fetchresponse_t *resp, const char *ctracestr,
 
 	handlep = &client->query.recursions[recursion_type].handle;
 	fetchp = &client->query.recursions[recursion_type].fetch;
-	result = resp->result;
 
 	LOCK(&client->query.fetchlock);
 	if (*fetchp != NULL) {
@@ -2636,11 +2557,6 @@ cleanup_after_fetch(dns_fetchresponse_t *resp, const char *ctracestr,
 	}
 	UNLOCK(&client->query.fetchlock);
 
-	/* Some type of recursions require a bit of aftermath. */
-	if (recursion_type == RECTYPE_STALE_REFRESH) {
-		stale_refresh_aftermath(client, result);
-	}
-
 	recursionquotatype_detach(client);
 	free_fresp(client, &resp);
 	isc_nmhandle_detach(handlep);
@@ -2656,11 +2572,6 @@ rpzfetch_done(void *arg) {
 	cleanup_after_fetch(arg, "rpzfetch_done", RECTYPE_RPZ);
 }
 
-static void
-stale_refresh_done(void *arg) {
-	cleanup_after_fetch(arg, "stale_refresh_done", RECTYPE_STALE_REFRESH);
-}
-
 /*
  * Try initiating a fetch for the given 'qname' and 'qtype' (using the slot in
  * the 'recursions' array indicated by 'recursion_type') that will be
@@ -2702,10 +2613,6 @@ fetch_and_forget(ns_client_t *client, dns_name_t *qname, dns_rdatatype_t qtype,
 		options = client->query.fetchoptions;
 		cb = rpzfetch_done;
 		break;
-	case RECTYPE_STALE_REFRESH:
-		options = client->query.fetchoptions;
-		cb = stale_refresh_done;
-		break;
 	default:
 		UNREACHABLE();
 	}
@@ -2725,6 +2632,27 @@ fetch_and_forget(ns_client_t *client, dns_name_t *qname, dns_rdatatype_t qtype,
 	}
 }
 
+/*
+ * The prefetch trigger grows with the number of times the RRset has been
+ * found in the cache: one more multiple of the configured trigger for
+ * every PREFETCH_HOTHITS hits, up to PREFETCH_MAXSCALE times the trigger,
+ * so that popular RRsets are refreshed earlier than the rest.  It does
+ * not exceed half of the minimum TTL for an RRset to be eligible, to
+ * keep popular RRsets with short TTLs from being refreshed all the time.
+ */
+#define PREFETCH_HOTHITS  16
+#define PREFETCH_MAXSCALE 4
+
+static dns_ttl_t
+prefetch_trigger(dns_view_t *view, dns_rdataset_t *rdataset) {
+	dns_ttl_t scale = 1 + ISC_MIN(rdataset->hits / PREFETCH_HOTHITS,
+				      PREFETCH_MAXSCALE - 1);
+	dns_ttl_t trigger = ISC_MIN(view->prefetch_trigger * scale,
+				    view->prefetch_eligible / 2);
+
+	return (ISC_MAX(trigger, view->prefetch_trigger));
+}
+
 static void
 query_prefetch(ns_client_t *client, dns_name_t *qname,
 	       dns_rdataset_t *rdataset) {
@@ -2732,7 +2660,7 @@ query_prefetch(ns_client_t *client, dns_name_t *qname,
 
 	if (FETCH_RECTYPE_PREFETCH(client) != NULL ||
 	    client->view->prefetch_trigger == 0U ||
-	    rdataset->ttl > client->view->prefetch_trigger ||
+	    rdataset->ttl > prefetch_trigger(client->view, rdataset) ||
 	    (rdataset->attributes & DNS_RDATASETATTR_PREFETCH) == 0)
 	{
 		return;
@@ -2745,16 +2673,19 @@ query_prefetch(ns_client_t *client, dns_name_t *qname,
 			   ns_statscounter_prefetch);
 }
 
+/*
+ * Refresh the stale RRset that was just sent to the client.  The refresh
+ * is done by the resolver in the background: it does not hold on to the
+ * client, and only one is run for an RRset however many clients get the
+ * stale answer in the meantime.  It takes a unit of the recursive client
+ * quota while it runs, and is skipped when the soft limit is reached.
+ */
 static void
 query_stale_refresh(ns_client_t *client) {
 	dns_name_t *qname;
 
 	CTRACE(ISC_LOG_DEBUG(3), "query_stale_refresh");
 
-	if (FETCH_RECTYPE_STALE_REFRESH(client) != NULL) {
-		return;
-	}
-
 	client->query.dboptions &= ~(DNS_DBFIND_STALETIMEOUT |
 				     DNS_DBFIND_STALEOK |
 				     DNS_DBFIND_STALEENABLED);
@@ -2765,8 +2696,11 @@ query_stale_refresh(ns_client_t *client) {
 		qname = client->query.qname;
 	}
 
-	fetch_and_forget(client, qname, client->query.qtype,
-			 RECTYPE_STALE_REFRESH);
+	(void)dns_resolver_refresh(client->view->resolver, qname,
+				   client->query.qtype,
+				   client->query.fetchoptions,
+				   &client->manager->sctx->recursionquota,
+				   client->manager->loop);
 }
 
 static void
@@ -4941,6 +4875,7 @@ dns64_aaaaok(ns_client_t *client, dns_rdataset_t *rdataset,
 	unsigned int flags = 0;
 	unsigned int i, count;
 	bool *aaaaok;
+	isc_arenamark_t mark;
 
 	INSIST(client->query.dns64_aaaaok == NULL);
 	INSIST(client->query.dns64_aaaaoklen == 0);
@@ -4961,30 +4896,29 @@ dns64_aaaaok(ns_client_t *client, dns_rdataset_t *rdataset,
 		flags |= DNS_DNS64_DNSSEC;
 	}
 
+	/*
+	 * The array is only kept if some of the AAAA records are
+	 * excluded; otherwise, the arena is rewound.
+	 */
 	count = dns_rdataset_count(rdataset);
-	aaaaok = isc_mem_cget(client->manager->mctx, count, sizeof(bool));
+	isc_arena_mark(client->arena, &mark);
+	aaaaok = isc_arena_get(client->arena, count * sizeof(bool));
 
 	isc_netaddr_fromsockaddr(&netaddr, &client->peeraddr);
 	if (dns_dns64_aaaaok(dns64, &netaddr, client->signer, env, flags,
 			     rdataset, aaaaok, count))
 	{
 		for (i = 0; i < count; i++) {
-			if (aaaaok != NULL && !aaaaok[i]) {
-				SAVE(client->query.dns64_aaaaok, aaaaok);
+			if (!aaaaok[i]) {
+				client->query.dns64_aaaaok = aaaaok;
 				client->query.dns64_aaaaoklen = count;
-				break;
+				return (true);
 			}
 		}
-		if (aaaaok != NULL) {
-			isc_mem_cput(client->manager->mctx, aaaaok, count,
-				     sizeof(bool));
-		}
+		isc_arena_release(client->arena, &mark);
 		return (true);
 	}
-	if (aaaaok != NULL) {
-		isc_mem_cput(client->manager->mctx, aaaaok, count,
-			     sizeof(bool));
-	}
+	isc_arena_release(client->arena, &mark);
 	return (false);
 }
 
@@ -5597,6 +5531,103 @@ root_key_sentinel_detect(query_ctx_t *qctx) {
 	}
 }
 
+/*%
+ * If the zone has a cache of rendered answers and the response to this
+ * query depends on nothing else than the question, the zone version and
+ * the parameters of the client gathered into the cache key, look the
+ * answer up in the cache.  If it is found, the response is sent from
+ * the cache by ns_client_send(); otherwise, the key is saved so that
+ * ns_client_send() can add the response to the cache.
+ *
+ * Returns true if the answer was found.
+ */
+static bool
+query_rendercache(query_ctx_t *qctx) {
+	ns_client_t *client = qctx->client;
+	dns_view_t *view = qctx->view;
+	dns_rendercache_t *rc = NULL;
+	dns_renderedanswer_t *answer = NULL;
+	isc_region_t qr, key;
+	isc_buffer_t b;
+	isc_result_t result;
+	size_t viewlen;
+
+	if (!qctx->is_zone || qctx->zone == NULL || !qctx->authoritative ||
+	    qctx->fresp != NULL || client->query.restarts != 0)
+	{
+		return (false);
+	}
+
+	rc = dns_zone_getrendercache(qctx->zone);
+	if (rc == NULL) {
+		return (false);
+	}
+
+	/*
+	 * Anything that makes the response depend on the client, on other
+	 * databases than the zone, or on the query processing hooks rules
+	 * out the cache.  When the view has a cache, the additional data
+	 * and the best NS set may come from it, even if the client did not
+	 * ask for recursion, and the cached answers would not follow the
+	 * expiry or the flush of the cached data.
+	 */
+	if (RECURSIONOK(client) || USECACHE(client) || view->recursion ||
+	    dns_rdatatype_ismeta(qctx->qtype) ||
+	    client->message->tsig != NULL || client->message->sig0 != NULL ||
+	    (client->attributes & NS_CLIENTATTR_HAVEECS) != 0 ||
+	    view->rrl != NULL || view->sortlist != NULL ||
+	    view->nocasecompress != NULL || view->dns64cnt != 0 ||
+	    (view->rpzs != NULL && view->rpzs->p.num_zones != 0) ||
+	    view->hooktable != NULL)
+	{
+		return (false);
+	}
+
+	/*
+	 * The key: the view name, the parameters of the client which change
+	 * the response or the size of the OPT record, and the question, with
+	 * the case of the name preserved as the answers may be compressed
+	 * against it.  The zone outlives its views across reconfigurations,
+	 * so the view is identified by its name rather than its address.
+	 */
+	dns_name_toregion(client->query.qname, &qr);
+	viewlen = strlen(view->name);
+	key.length = 2 + viewlen + 4 + 4 + 2 + 2 + 1 + 2 + 2 + qr.length;
+	key.base = isc_arena_get(client->arena, key.length);
+	isc_buffer_init(&b, key.base, key.length);
+	isc_buffer_putuint16(&b, (uint16_t)viewlen);
+	isc_buffer_putmem(&b, (unsigned char *)view->name, viewlen);
+	isc_buffer_putuint32(&b, client->query.attributes);
+	isc_buffer_putuint32(&b, client->attributes);
+	isc_buffer_putuint16(&b, client->udpsize);
+	isc_buffer_putuint16(&b, client->message->flags);
+	isc_buffer_putuint8(&b, isc_sockaddr_pf(&client->peeraddr) == AF_INET);
+	isc_buffer_putuint16(&b, qctx->qtype);
+	isc_buffer_putuint16(&b, client->message->rdclass);
+	isc_buffer_putmem(&b, qr.base, qr.length);
+
+	result = dns_rendercache_find(rc, qctx->db, qctx->version, &key,
+				      &answer);
+	switch (result) {
+	case ISC_R_SUCCESS:
+		inc_stats(client, ns_statscounter_rendercachehit);
+		client->message->flags = answer->flags;
+		client->message->rcode = answer->rcode;
+		client->query.isreferral =
+			((answer->flags & DNS_MESSAGEFLAG_AA) == 0 &&
+			 answer->counts[DNS_SECTION_ANSWER] == 0);
+		client->query.rendered = answer;
+		return (true);
+	case ISC_R_NOTFOUND:
+		inc_stats(client, ns_statscounter_rendercachemiss);
+		dns_rendercache_attach(rc, &client->query.rendercache);
+		client->query.renderkey = key;
+		return (false);
+	default:
+		return (false);
+	}
+}
+
 /*%
  * Starting point for a client query or a chaining query.
  *
@@ -5806,6 +5837,10 @@ ns__query_start(query_ctx_t *qctx) {
 		}
 	}
 
+	if (query_rendercache(qctx)) {
+		return (ns_query_done(qctx));
+	}
+
 	if (!qctx->is_zone && (qctx->view->staleanswerclienttimeout == 0) &&
 	    dns_view_staleanswerenabled(qctx->view))
 	{
@@ -5835,6 +5870,11 @@ async_restart(void *arg) {
 	query_ctx_t *qctx = arg;
 	ns_client_t *client = qctx->client;
 
+	/*
+	 * 'qctx' is not allocated from the client arena: the query may be
+	 * completed by ns__query_start(), and then the arena is reset
+	 * before 'qctx' is destroyed.
+	 */
 	ns__query_start(qctx);
 
 	qctx_clean(qctx);
@@ -6259,6 +6299,33 @@ query_lookup_stale(ns_client_t *client) {
 	qctx_destroy(&qctx);
 }
 
+/*
+ * Count the time from the arrival of the query to the completion of a
+ * recursion for it, as the resolver does for the RTT of its queries.
+ */
+static void
+recursion_time(ns_client_t *client) {
+	isc_time_t now = isc_time_now();
+	uint64_t ms = isc_time_microdiff(&now, &client->requesttime) / 1000;
+	isc_statscounter_t counter;
+
+	if (ms < DNS_RESOLVER_QRYRTTCLASS0) {
+		counter = ns_statscounter_recurstime0;
+	} else if (ms < DNS_RESOLVER_QRYRTTCLASS1) {
+		counter = ns_statscounter_recurstime1;
+	} else if (ms < DNS_RESOLVER_QRYRTTCLASS2) {
+		counter = ns_statscounter_recurstime2;
+	} else if (ms < DNS_RESOLVER_QRYRTTCLASS3) {
+		counter = ns_statscounter_recurstime3;
+	} else if (ms < DNS_RESOLVER_QRYRTTCLASS4) {
+		counter = ns_statscounter_recurstime4;
+	} else {
+		counter = ns_statscounter_recurstime5;
+	}
+
+	ns_stats_increment(client->manager->sctx->nsstats, counter);
+}
+
 /*
  * Event handler to resume processing a query after recursion, or when a
  * client timeout is triggered. If the query has timed out or been cancelled
@@ -6323,6 +6390,7 @@ fetch_callback(void *arg) {
 		 * Update client->now.
 		 */
 		client->now = isc_stdtime_now();
+		recursion_time(client);
 	} else {
 		/*
 		 * This is a fetch completion event for a canceled fetch.
@@ -6501,6 +6569,30 @@ check_recursionquota(ns_client_t *client) {
 	return (ISC_R_SUCCESS);
 }
 
+/*%
+ * Count a new recursion in the hot zone table of the client manager, and
+ * refuse it if its zone is hot and over the 'recursions-per-zone' limit.
+ * The zone is the deepest zone cut found in the cache ('qdomain'), or
+ * the zone below it on the way to 'qname' if that is a public suffix.
+ */
+static isc_result_t
+check_hotzone(ns_client_t *client, dns_name_t *qname, dns_name_t *qdomain) {
+	uint32_t limit = client->manager->sctx->recursionsperzone;
+	isc_result_t result;
+
+	if (limit == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	result = ns_hotzones_admitname(client->manager->hotzones, qname,
+				       qdomain, limit, client->now);
+	if (result != ISC_R_SUCCESS) {
+		inc_stats(client, ns_statscounter_reczonelimited);
+	}
+
+	return (result);
+}
+
 isc_result_t
 ns_query_recurse(ns_client_t *client, dns_rdatatype_t qtype, dns_name_t *qname,
 		 dns_name_t *qdomain, dns_rdataset_t *nameservers,
@@ -6525,6 +6617,11 @@ ns_query_recurse(ns_client_t *client, dns_rdatatype_t qtype, dns_name_t *qname,
 
 	if (!resuming) {
 		inc_stats(client, ns_statscounter_recursion);
+
+		result = check_hotzone(client, qname, qdomain);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
 	}
 
 	result = check_recursionquota(client);
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the cache eviction policies that have been used by the RBT
+ * cache database, on a Zipf-distributed workload:
+ *
+ * - "lru": move the entry to the head of its bucket's list on every hit,
+ *   which needs the bucket write lock;
+ * - "lru-limited": the same, but only when the entry was not moved
+ *   during the last 600 (simulated) seconds, as with the former
+ *   DNS_RBTDB_LIMITLRUUPDATE;
+ * - "sieve": set a visited bit on hits under the bucket read lock, and
+ *   let the eviction hand skip visited entries once.
+ *
+ * The hit ratio is measured by running the requests through a cache of
+ * a fixed number of entries, split into buckets like the node locks of
+ * the cache database.  The hit path throughput is then measured with a
+ * number of threads doing lookups in the warmed up cache.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/atomic.h>
+#include <isc/list.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/random.h>
+#include <isc/rwlock.h>
+#include <isc/thread.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#define BUCKETS	     17
+#define REQUESTS     (8 * 1024 * 1024)
+#define LOOKUPS	     (4 * 1024 * 1024)
+#define RATE	     10000 /* simulated queries per second */
+#define LRUUPDATE    600
+#define MAXTHREADS   128
+
+typedef struct entry entry_t;
+struct entry {
+	ISC_LINK(entry_t) link;
+	atomic_bool visited;
+	bool cached;
+	uint32_t last_used;
+};
+
+typedef struct bucket {
+	isc_rwlock_t lock;
+	ISC_LIST(entry_t) list;
+	entry_t *hand;
+	size_t count;
+	size_t capacity;
+} bucket_t;
+
+typedef enum { LRU, LRU_LIMITED, SIEVE } policy_t;
+
+static const char *policies[] = { "lru", "lru-limited", "sieve" };
+
+static isc_mem_t *mctx = NULL;
+static entry_t *entries = NULL;
+static bucket_t buckets[BUCKETS];
+static uint32_t *requests = NULL;
+static size_t nkeys = 1000000;
+static size_t capacity = 100000;
+static double alpha = 0.9;
+static policy_t policy;
+
+static void
+make_requests(void) {
+	double *cdf = isc_mem_cget(mctx, nkeys, sizeof(cdf[0]));
+	double sum = 0.0;
+
+	for (size_t i = 0; i < nkeys; i++) {
+		sum += 1.0 / pow((double)(i + 1), alpha);
+		cdf[i] = sum;
+	}
+
+	requests = isc_mem_cget(mctx, REQUESTS, sizeof(requests[0]));
+	for (size_t i = 0; i < REQUESTS; i++) {
+		double u = (double)isc_random32() / UINT32_MAX * sum;
+		size_t lo = 0, hi = nkeys - 1;
+
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (cdf[mid] < u) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		/* spread the popular keys over the buckets */
+		requests[i] = (uint32_t)((lo * 2654435761U) % nkeys);
+	}
+
+	isc_mem_cput(mctx, cdf, nkeys, sizeof(cdf[0]));
+}
+
+static void
+reset(void) {
+	for (size_t i = 0; i < nkeys; i++) {
+		entries[i] = (entry_t){ .link = ISC_LINK_INITIALIZER };
+	}
+	for (size_t i = 0; i < BUCKETS; i++) {
+		ISC_LIST_INIT(buckets[i].list);
+		buckets[i].hand = NULL;
+		buckets[i].count = 0;
+		buckets[i].capacity = capacity / BUCKETS;
+	}
+}
+
+static void
+evict(bucket_t *bucket) {
+	entry_t *e = NULL;
+
+	switch (policy) {
+	case LRU:
+	case LRU_LIMITED:
+		e = ISC_LIST_TAIL(bucket->list);
+		break;
+	case SIEVE:
+		for (;;) {
+			e = bucket->hand;
+			if (e == NULL) {
+				e = ISC_LIST_TAIL(bucket->list);
+			}
+			bucket->hand = ISC_LIST_PREV(e, link);
+			if (!atomic_load_relaxed(&e->visited)) {
+				break;
+			}
+			atomic_store_relaxed(&e->visited, false);
+		}
+		break;
+	}
+
+	ISC_LIST_UNLINK(bucket->list, e, link);
+	e->cached = false;
+	bucket->count--;
+}
+
+/*
+ * Returns true if the entry must be moved to the head of the list,
+ * which needs the bucket write lock.
+ */
+static bool
+hit(entry_t *e, uint32_t now) {
+	switch (policy) {
+	case LRU:
+		return (true);
+	case LRU_LIMITED:
+		return (e->last_used + LRUUPDATE <= now);
+	case SIEVE:
+		if (!atomic_load_relaxed(&e->visited)) {
+			atomic_store_relaxed(&e->visited, true);
+		}
+		return (false);
+	}
+	UNREACHABLE();
+}
+
+static void
+move(bucket_t *bucket, entry_t *e, uint32_t now) {
+	ISC_LIST_UNLINK(bucket->list, e, link);
+	ISC_LIST_PREPEND(bucket->list, e, link);
+	e->last_used = now;
+}
+
+static double
+hitratio(void) {
+	size_t hits = 0;
+
+	reset();
+
+	for (size_t i = 0; i < REQUESTS; i++) {
+		uint32_t now = i / RATE;
+		entry_t *e = &entries[requests[i]];
+		bucket_t *bucket = &buckets[requests[i] % BUCKETS];
+
+		if (e->cached) {
+			hits++;
+			if (hit(e, now)) {
+				move(bucket, e, now);
+			}
+			continue;
+		}
+
+		if (bucket->count == bucket->capacity) {
+			evict(bucket);
+		}
+		ISC_LIST_PREPEND(bucket->list, e, link);
+		e->cached = true;
+		e->last_used = now;
+		bucket->count++;
+	}
+
+	return ((double)hits / REQUESTS);
+}
+
+static void *
+lookups(void *arg) {
+	size_t start = (uintptr_t)arg;
+	uint32_t now = REQUESTS / RATE;
+
+	for (size_t i = 0; i < LOOKUPS; i++) {
+		uint32_t key = requests[(start + i) % REQUESTS];
+		entry_t *e = &entries[key];
+		bucket_t *bucket = &buckets[key % BUCKETS];
+		bool update = false;
+
+		RWLOCK(&bucket->lock, isc_rwlocktype_read);
+		if (e->cached) {
+			update = hit(e, now);
+		}
+		RWUNLOCK(&bucket->lock, isc_rwlocktype_read);
+
+		if (update) {
+			RWLOCK(&bucket->lock, isc_rwlocktype_write);
+			if (e->cached && hit(e, now)) {
+				move(bucket, e, now);
+			}
+			RWUNLOCK(&bucket->lock, isc_rwlocktype_write);
+		}
+	}
+
+	return (NULL);
+}
+
+static double
+throughput(size_t nthreads) {
+	isc_thread_t threads[MAXTHREADS];
+	isc_time_t start, finish;
+	uint64_t us;
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < nthreads; i++) {
+		isc_thread_create(lookups,
+				  (void *)(uintptr_t)(i * (REQUESTS / nthreads)),
+				  &threads[i]);
+	}
+	for (size_t i = 0; i < nthreads; i++) {
+		isc_thread_join(threads[i], NULL);
+	}
+	finish = isc_time_now_hires();
+	us = isc_time_microdiff(&finish, &start);
+
+	return ((double)LOOKUPS * nthreads / us);
+}
+
+int
+main(int argc, char *argv[]) {
+	size_t maxthreads = ISC_MIN(isc_os_ncpus(), MAXTHREADS);
+
+	if (argc > 1) {
+		nkeys = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		capacity = strtoul(argv[2], NULL, 10);
+	}
+	if (argc > 3) {
+		alpha = strtod(argv[3], NULL);
+	}
+	if (argc > 4 || nkeys == 0 || capacity < BUCKETS || alpha <= 0.0) {
+		fprintf(stderr, "usage: cache-eviction [keys [capacity "
+				"[alpha]]]\n");
+		exit(1);
+	}
+
+	isc_mem_create(&mctx);
+	entries = isc_mem_cget(mctx, nkeys, sizeof(entries[0]));
+	for (size_t i = 0; i < BUCKETS; i++) {
+		isc_rwlock_init(&buckets[i].lock);
+	}
+	make_requests();
+
+	printf("%zu keys, %zu cached, zipf alpha %.2f, %u requests\n\n",
+	       nkeys, capacity, alpha, REQUESTS);
+	printf("%12s | %9s |", "policy", "hit ratio");
+	for (size_t n = 1; n <= maxthreads; n *= 2) {
+		printf(" %3zu thr Mq/s |", n);
+	}
+	printf("\n");
+
+	for (policy = LRU; policy <= SIEVE; policy++) {
+		printf("%12s | %8.2f%% |", policies[policy], hitratio() * 100);
+		for (size_t n = 1; n <= maxthreads; n *= 2) {
+			printf(" %12.2f |", throughput(n));
+		}
+		printf("\n");
+	}
+
+	for (size_t i = 0; i < BUCKETS; i++) {
+		isc_rwlock_destroy(&buckets[i].lock);
+	}
+	isc_mem_cput(mctx, requests, REQUESTS, sizeof(requests[0]));
+	isc_mem_cput(mctx, entries, nkeys, sizeof(entries[0]));
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
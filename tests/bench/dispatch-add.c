@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure how the allocation and release of query IDs scales with the
+ * number of loops: each loop has its own UDP dispatch, like the resolver
+ * dispatch sets, and keeps a window of queries outstanding, adding a new
+ * one and releasing the oldest one.  Nothing is sent; the only state
+ * shared between the loops is the dispatch manager.
+ */
+
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/async.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/random.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/dispatch.h>
+
+#define WINDOW	 256
+#define QUERIES	 (1024 * 1024)
+#define SERVERS	 64
+#define MAXLOOPS 1024
+
+typedef struct worker {
+	dns_dispatch_t *dispatch;
+	dns_dispentry_t *resps[WINDOW];
+} worker_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static dns_dispatchmgr_t *dispatchmgr = NULL;
+static isc_sockaddr_t servers[SERVERS];
+static worker_t *workers = NULL;
+static uint32_t nloops = 32;
+static uint32_t active, running;
+static isc_time_t start;
+
+static void
+callback(isc_result_t eresult, isc_region_t *region, void *arg) {
+	UNUSED(eresult);
+	UNUSED(region);
+	UNUSED(arg);
+}
+
+static void
+phase_done(void *arg);
+
+static void
+work(void *arg) {
+	worker_t *worker = arg;
+	isc_loop_t *loop = isc_loop_current(loopmgr);
+
+	for (size_t i = 0; i < QUERIES; i++) {
+		dns_dispentry_t **respp = &worker->resps[i % WINDOW];
+		dns_messageid_t id;
+		isc_result_t result;
+
+		if (*respp != NULL) {
+			dns_dispatch_done(respp);
+		}
+		result = dns_dispatch_add(
+			worker->dispatch, loop, 0, 1000,
+			&servers[isc_random_uniform(SERVERS)], NULL, NULL,
+			callback, callback, callback, NULL, &id, respp);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+
+	for (size_t i = 0; i < WINDOW; i++) {
+		if (worker->resps[i] != NULL) {
+			dns_dispatch_done(&worker->resps[i]);
+		}
+	}
+
+	isc_async_run(isc_loop_main(loopmgr), phase_done, NULL);
+}
+
+static void
+phase_start(void) {
+	running = active;
+	start = isc_time_now_hires();
+	for (uint32_t i = 0; i < active; i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), work, &workers[i]);
+	}
+}
+
+static void
+phase_done(void *arg ISC_ATTR_UNUSED) {
+	isc_time_t finish;
+	uint64_t us;
+
+	if (--running > 0) {
+		return;
+	}
+
+	finish = isc_time_now_hires();
+	us = isc_time_microdiff(&finish, &start);
+	printf("%5u | %10.2f | %12.1f\n", active,
+	       (double)QUERIES * active / us,
+	       (double)us * 1000.0 / QUERIES);
+
+	if (active < nloops) {
+		active = ISC_MIN(active * 2, nloops);
+		phase_start();
+		return;
+	}
+
+	for (uint32_t i = 0; i < nloops; i++) {
+		dns_dispatch_detach(&workers[i].dispatch);
+	}
+	dns_dispatchmgr_detach(&dispatchmgr);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+setup(void *arg ISC_ATTR_UNUSED) {
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	result = dns_dispatchmgr_create(mctx, netmgr, &dispatchmgr);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	isc_sockaddr_fromin6(&local, &in6addr_loopback, 0);
+	for (uint32_t i = 0; i < nloops; i++) {
+		result = dns_dispatch_createudp(dispatchmgr, &local,
+						&workers[i].dispatch);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+
+	for (size_t i = 0; i < SERVERS; i++) {
+		struct in6_addr addr = in6addr_loopback;
+
+		addr.s6_addr[14] = i;
+		isc_sockaddr_fromin6(&servers[i], &addr, 53);
+	}
+
+	printf("%u loops, %u queries per loop, %u outstanding\n\n", nloops,
+	       QUERIES, WINDOW);
+	printf("%5s | %10s | %12s\n", "loops", "Mq/s", "ns/q per loop");
+
+	active = 1;
+	phase_start();
+}
+
+int
+main(int argc, char *argv[]) {
+	if (argc > 1) {
+		nloops = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2 || nloops == 0 || nloops > MAXLOOPS) {
+		fprintf(stderr, "usage: dispatch-add [loops]\n");
+		exit(1);
+	}
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+	workers = isc_mem_cget(mctx, nloops, sizeof(workers[0]));
+
+	isc_loop_setup(isc_loop_main(loopmgr), setup, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_mem_cput(mctx, workers, nloops, sizeof(workers[0]));
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
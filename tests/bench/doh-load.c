@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * A DNS-over-HTTPS load generator: it keeps a fixed number of HTTP/2
+ * streams in flight on each of a number of connections to a DoH server
+ * and reports the number of queries per second answered on every
+ * connection.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/commandline.h>
+#include <isc/loop.h>
+#include <isc/managers.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/os.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdataclass.h>
+#include <dns/rdatatype.h>
+
+#include "netmgr/netmgr-int.h"
+
+typedef struct conn {
+	unsigned int id;
+	isc_nmhandle_t *handle;
+	isc_result_t result;
+	uint64_t answered;
+	uint64_t failed;
+} conn_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_tlsctx_t *tlsctx = NULL;
+static isc_timer_t *timer = NULL;
+
+static conn_t *conns = NULL;
+static unsigned int nconns = 1;
+static unsigned int nstreams = 100;
+static unsigned int duration = 10;
+static bool post = true;
+static bool https = true;
+
+static isc_sockaddr_t peer;
+static char uri[256];
+
+static uint8_t querybuf[512];
+static isc_region_t query;
+
+static atomic_bool stopping = false;
+static isc_time_t start, end;
+
+static void
+usage(void) {
+	fprintf(stderr,
+		"usage: doh-load [-GH] [-c connections] [-s streams] "
+		"[-d seconds]\n"
+		"		[-p port] [-w workers] [-q name] <address>\n"
+		"	-c	number of connections (default 1)\n"
+		"	-s	concurrent streams per connection (default 100)\n"
+		"	-d	duration of the test in seconds (default 10)\n"
+		"	-p	server port (default 443, 80 with -H)\n"
+		"	-w	number of worker threads (default ncpus)\n"
+		"	-q	query name (default example.com)\n"
+		"	-G	use GET requests instead of POST\n"
+		"	-H	use plain HTTP/2 instead of HTTPS\n");
+}
+
+static void
+make_query(const char *qname) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	isc_buffer_t b;
+	isc_region_t r;
+
+	result = dns_name_fromstring(name, qname, dns_rootname, 0, NULL);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "invalid query name '%s': %s\n", qname,
+			isc_result_totext(result));
+		exit(1);
+	}
+
+	/*
+	 * The message ID is zero, as recommended by RFC 8484, Section 4.1.
+	 */
+	isc_buffer_init(&b, querybuf, sizeof(querybuf));
+	isc_buffer_putuint16(&b, 0);	  /* ID */
+	isc_buffer_putuint16(&b, 0x0100); /* RD */
+	isc_buffer_putuint16(&b, 1);	  /* QDCOUNT */
+	isc_buffer_putuint16(&b, 0);	  /* ANCOUNT */
+	isc_buffer_putuint16(&b, 0);	  /* NSCOUNT */
+	isc_buffer_putuint16(&b, 0);	  /* ARCOUNT */
+	dns_name_toregion(name, &r);
+	isc_buffer_putmem(&b, r.base, r.length);
+	isc_buffer_putuint16(&b, dns_rdatatype_a);
+	isc_buffer_putuint16(&b, dns_rdataclass_in);
+
+	isc_buffer_usedregion(&b, &query);
+}
+
+static void
+send_request(conn_t *conn);
+
+static void
+reply_cb(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
+	 void *cbarg) {
+	conn_t *conn = cbarg;
+
+	UNUSED(handle);
+	UNUSED(region);
+
+	if (atomic_load_relaxed(&stopping)) {
+		return;
+	}
+
+	if (eresult != ISC_R_SUCCESS) {
+		conn->failed++;
+		if (conn->result == ISC_R_SUCCESS) {
+			conn->result = eresult;
+		}
+		return;
+	}
+
+	conn->answered++;
+	send_request(conn);
+}
+
+static void
+send_request(conn_t *conn) {
+	if (conn->handle == NULL) {
+		return;
+	}
+
+	/*
+	 * On failure, reply_cb() has already been called.
+	 */
+	(void)isc__nm_http_request(conn->handle, &query, reply_cb, conn);
+}
+
+static void
+connect_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	conn_t *conn = cbarg;
+
+	if (eresult != ISC_R_SUCCESS) {
+		conn->result = eresult;
+		return;
+	}
+
+	isc_nmhandle_attach(handle, &conn->handle);
+	for (unsigned int i = 0; i < nstreams; i++) {
+		send_request(conn);
+	}
+}
+
+static void
+conn_start(void *arg) {
+	conn_t *conn = arg;
+
+	isc_nm_httpconnect(netmgr, NULL, &peer, uri, post, connect_cb, conn,
+			   tlsctx, NULL, 30000);
+}
+
+static void
+conn_stop(void *arg) {
+	conn_t *conn = arg;
+
+	if (conn->handle != NULL) {
+		isc_nmhandle_detach(&conn->handle);
+	}
+}
+
+static void
+stop_cb(void *arg) {
+	UNUSED(arg);
+
+	atomic_store_relaxed(&stopping, true);
+	end = isc_time_now_hires();
+
+	isc_timer_destroy(&timer);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+startup(void *arg) {
+	isc_interval_t interval;
+
+	UNUSED(arg);
+
+	isc_timer_create(isc_loop_main(loopmgr), stop_cb, NULL, &timer);
+	isc_interval_set(&interval, duration, 0);
+	isc_timer_start(timer, isc_timertype_once, &interval);
+
+	start = isc_time_now_hires();
+}
+
+static unsigned int
+parse_uint(const char *input, unsigned int max) {
+	char *endptr = NULL;
+	unsigned long val = strtoul(input, &endptr, 10);
+
+	if (*endptr != '\0' || val == 0 || val > max) {
+		usage();
+		exit(1);
+	}
+
+	return (val);
+}
+
+int
+main(int argc, char *argv[]) {
+	const char *qname = "example.com";
+	unsigned int port = 0;
+	uint32_t workers = isc_os_ncpus();
+	struct in_addr in;
+	struct in6_addr in6;
+	uint64_t answered = 0, failed = 0;
+	double seconds;
+	int opt;
+
+	while ((opt = isc_commandline_parse(argc, argv, "c:d:Gp:q:s:w:H")) !=
+	       -1)
+	{
+		switch (opt) {
+		case 'c':
+			nconns = parse_uint(isc_commandline_argument, 100000);
+			continue;
+		case 'd':
+			duration = parse_uint(isc_commandline_argument, 3600);
+			continue;
+		case 'G':
+			post = false;
+			continue;
+		case 'H':
+			https = false;
+			continue;
+		case 'p':
+			port = parse_uint(isc_commandline_argument, 65535);
+			continue;
+		case 'q':
+			qname = isc_commandline_argument;
+			continue;
+		case 's':
+			nstreams = parse_uint(isc_commandline_argument, 65535);
+			continue;
+		case 'w':
+			workers = parse_uint(isc_commandline_argument, 128);
+			continue;
+		default:
+			usage();
+			exit(1);
+			continue;
+		}
+	}
+	argc -= isc_commandline_index;
+	argv += isc_commandline_index;
+
+	if (argc != 1) {
+		/* must exit 0 to appease test runner */
+		usage();
+		exit(0);
+	}
+
+	if (port == 0) {
+		port = https ? 443 : 80;
+	}
+
+	if (inet_pton(AF_INET6, argv[0], &in6) == 1) {
+		isc_sockaddr_fromin6(&peer, &in6, port);
+	} else if (inet_pton(AF_INET, argv[0], &in) == 1) {
+		isc_sockaddr_fromin(&peer, &in, port);
+	} else {
+		fprintf(stderr, "invalid address '%s'\n", argv[0]);
+		exit(1);
+	}
+
+	make_query(qname);
+	isc_nm_http_makeuri(https, &peer, NULL, 0, ISC_NM_HTTP_DEFAULT_PATH,
+			    uri, sizeof(uri));
+
+	isc_managers_create(&mctx, workers, &loopmgr, &netmgr);
+
+	if (https) {
+		RUNTIME_CHECK(isc_tlsctx_createclient(&tlsctx) ==
+			      ISC_R_SUCCESS);
+		isc_tlsctx_enable_http2client_alpn(tlsctx);
+	}
+
+	/*
+	 * Spread the connections over the loops.
+	 */
+	conns = isc_mem_cget(mctx, nconns, sizeof(conns[0]));
+	for (unsigned int i = 0; i < nconns; i++) {
+		isc_loop_t *loop = isc_loop_get(loopmgr, i % workers);
+
+		conns[i] = (conn_t){ .id = i, .result = ISC_R_SUCCESS };
+		isc_loop_setup(loop, conn_start, &conns[i]);
+		isc_loop_teardown(loop, conn_stop, &conns[i]);
+	}
+	isc_loop_setup(isc_loop_main(loopmgr), startup, NULL);
+
+	printf("%u connection(s) to %s, %u stream(s) each, %u second(s)\n",
+	       nconns, uri, nstreams, duration);
+
+	isc_loopmgr_run(loopmgr);
+
+	seconds = (double)isc_time_microdiff(&end, &start) / 1000000.0;
+	for (unsigned int i = 0; i < nconns; i++) {
+		printf("connection %u: %" PRIu64 " answered, %" PRIu64
+		       " failed, %.0f qps%s%s\n",
+		       conns[i].id, conns[i].answered, conns[i].failed,
+		       (double)conns[i].answered / seconds,
+		       conns[i].result != ISC_R_SUCCESS ? ", " : "",
+		       conns[i].result != ISC_R_SUCCESS
+			       ? isc_result_totext(conns[i].result)
+			       : "");
+		answered += conns[i].answered;
+		failed += conns[i].failed;
+	}
+	printf("total: %" PRIu64 " answered, %" PRIu64 " failed, %.0f qps, "
+	       "%.0f qps per connection\n",
+	       answered, failed, (double)answered / seconds,
+	       (double)answered / seconds / nconns);
+
+	isc_mem_cput(mctx, conns, nconns, sizeof(conns[0]));
+	if (tlsctx != NULL) {
+		isc_tlsctx_free(&tlsctx);
+	}
+	isc_managers_destroy(&mctx, &loopmgr, &netmgr);
+
+	return (0);
+}
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * A loopback throughput benchmark for DNS over stream transports: an
+ * in-process server answers every DNS message with a response of a
+ * fixed size, and a number of client connections keep a fixed number
+ * of queries in flight each. The test is run over plain TCP and then
+ * over TLS, so that the cost of the TLS layer can be compared.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/commandline.h>
+#include <isc/loop.h>
+#include <isc/managers.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/os.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+typedef struct conn {
+	unsigned int id;
+	isc_loop_t *loop;
+	isc_nmhandle_t *handle;
+	isc_result_t result;
+	uint64_t answered;
+	uint64_t bytes;
+} conn_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_tlsctx_t *server_tlsctx = NULL;
+static isc_tlsctx_t *client_tlsctx = NULL;
+static isc_nmsocket_t *listener = NULL;
+static isc_timer_t *timer = NULL;
+
+static conn_t *conns = NULL;
+static unsigned int nconns = 4;
+static unsigned int inflight = 16;
+static unsigned int duration = 5;
+static unsigned int port = 5353;
+static uint32_t workers = 0;
+
+static isc_sockaddr_t server_addr;
+
+/*
+ * A query for "example.com/A" with the message ID 0, and a response
+ * padded to 'response_size' octets; only the length matters here.
+ */
+static uint8_t querybuf[] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00,
+			      0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 'e',
+			      'x',  'a',  'm',	'p',  'l',  'e',  0x03,
+			      'c',  'o',  'm',	0x00, 0x00, 0x01, 0x00,
+			      0x01 };
+static isc_region_t query = { querybuf, sizeof(querybuf) };
+static uint8_t responsebuf[UINT16_MAX];
+static isc_region_t response;
+static unsigned int response_size = 1232;
+
+static atomic_bool stopping = false;
+static isc_time_t start, end;
+
+static void
+usage(void) {
+	fprintf(stderr,
+		"usage: dot-throughput [-c connections] [-n in-flight] "
+		"[-d seconds]\n"
+		"		[-s response-size] [-p port] [-w workers]\n"
+		"	-c	number of connections (default 4)\n"
+		"	-n	queries in flight per connection (default 16)\n"
+		"	-d	duration of each test in seconds (default 5)\n"
+		"	-s	response size in octets (default 1232)\n"
+		"	-p	loopback port to listen on (default 5353)\n"
+		"	-w	number of worker threads (default ncpus)\n");
+}
+
+static void
+server_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	UNUSED(handle);
+	UNUSED(eresult);
+	UNUSED(cbarg);
+}
+
+static void
+server_recv_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+	       isc_region_t *region, void *cbarg) {
+	UNUSED(region);
+	UNUSED(cbarg);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	isc_nm_send(handle, &response, server_send_cb, NULL);
+}
+
+static isc_result_t
+server_accept_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	UNUSED(handle);
+	UNUSED(cbarg);
+
+	return (eresult);
+}
+
+static void
+client_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	conn_t *conn = cbarg;
+
+	UNUSED(handle);
+
+	if (eresult != ISC_R_SUCCESS && conn->result == ISC_R_SUCCESS &&
+	    !atomic_load_relaxed(&stopping))
+	{
+		conn->result = eresult;
+	}
+}
+
+static void
+client_read_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+	       isc_region_t *region, void *cbarg) {
+	conn_t *conn = cbarg;
+
+	if (atomic_load_relaxed(&stopping)) {
+		return;
+	}
+
+	if (eresult != ISC_R_SUCCESS) {
+		if (conn->result == ISC_R_SUCCESS) {
+			conn->result = eresult;
+		}
+		return;
+	}
+
+	conn->answered++;
+	conn->bytes += region->length;
+
+	/*
+	 * A client connection stops reading after each message.
+	 */
+	isc_nm_read(handle, client_read_cb, conn);
+	isc_nm_send(handle, &query, client_send_cb, conn);
+}
+
+static void
+client_connect_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		  void *cbarg) {
+	conn_t *conn = cbarg;
+
+	if (eresult != ISC_R_SUCCESS) {
+		conn->result = eresult;
+		return;
+	}
+
+	isc_nmhandle_attach(handle, &conn->handle);
+	isc_nm_read(handle, client_read_cb, conn);
+	for (unsigned int i = 0; i < inflight; i++) {
+		isc_nm_send(handle, &query, client_send_cb, conn);
+	}
+}
+
+static void
+conn_start(void *arg) {
+	conn_t *conn = arg;
+
+	isc_nm_streamdnsconnect(netmgr, NULL, &server_addr, client_connect_cb,
+				conn, 30000, client_tlsctx, NULL);
+}
+
+static void
+conn_stop(void *arg) {
+	conn_t *conn = arg;
+
+	if (conn->handle != NULL) {
+		isc_nmhandle_detach(&conn->handle);
+	}
+}
+
+static void
+stop_cb(void *arg) {
+	UNUSED(arg);
+
+	atomic_store_relaxed(&stopping, true);
+	end = isc_time_now_hires();
+
+	isc_timer_destroy(&timer);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+stop_listening(void *arg) {
+	UNUSED(arg);
+
+	if (listener != NULL) {
+		isc_nm_stoplistening(listener);
+		isc_nmsocket_close(&listener);
+	}
+}
+
+static void
+startup(void *arg) {
+	isc_interval_t interval;
+	isc_result_t result;
+
+	UNUSED(arg);
+
+	result = isc_nm_listenstreamdns(netmgr, ISC_NM_LISTEN_ALL,
+					&server_addr, server_recv_cb, NULL,
+					server_accept_cb, NULL, 128, NULL,
+					server_tlsctx, &listener);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "unable to listen on port %u: %s\n", port,
+			isc_result_totext(result));
+		exit(1);
+	}
+
+	/*
+	 * Spread the connections over the loops.
+	 */
+	for (unsigned int i = 0; i < nconns; i++) {
+		isc_async_run(conns[i].loop, conn_start, &conns[i]);
+	}
+
+	isc_timer_create(isc_loop_main(loopmgr), stop_cb, NULL, &timer);
+	isc_interval_set(&interval, duration, 0);
+	isc_timer_start(timer, isc_timertype_once, &interval);
+
+	start = isc_time_now_hires();
+}
+
+static void
+run(bool tls) {
+	uint64_t answered = 0, bytes = 0;
+	isc_result_t result = ISC_R_SUCCESS;
+	double seconds;
+
+	atomic_store_relaxed(&stopping, false);
+
+	isc_managers_create(&mctx, workers, &loopmgr, &netmgr);
+	isc_nm_settimeouts(netmgr, 30000, 30000, 30000, 30000);
+
+	if (tls) {
+		RUNTIME_CHECK(isc_tlsctx_createserver(NULL, NULL,
+						      &server_tlsctx) ==
+			      ISC_R_SUCCESS);
+		RUNTIME_CHECK(isc_tlsctx_createclient(&client_tlsctx) ==
+			      ISC_R_SUCCESS);
+	}
+
+	conns = isc_mem_cget(mctx, nconns, sizeof(conns[0]));
+	for (unsigned int i = 0; i < nconns; i++) {
+		isc_loop_t *loop = isc_loop_get(loopmgr, i % workers);
+
+		conns[i] = (conn_t){
+			.id = i,
+			.loop = loop,
+			.result = ISC_R_SUCCESS,
+		};
+		isc_loop_teardown(loop, conn_stop, &conns[i]);
+	}
+	isc_loop_setup(isc_loop_main(loopmgr), startup, NULL);
+	isc_loop_teardown(isc_loop_main(loopmgr), stop_listening, NULL);
+
+	isc_loopmgr_run(loopmgr);
+
+	seconds = (double)isc_time_microdiff(&end, &start) / 1000000.0;
+	for (unsigned int i = 0; i < nconns; i++) {
+		answered += conns[i].answered;
+		bytes += conns[i].bytes;
+		if (result == ISC_R_SUCCESS) {
+			result = conns[i].result;
+		}
+	}
+	printf("%-4s %10.0f msg/s %10.2f MB/s %10.0f msg/s per connection"
+	       "%s%s\n",
+	       tls ? "tls" : "tcp", (double)answered / seconds,
+	       (double)bytes / seconds / 1000000.0,
+	       (double)answered / seconds / nconns,
+	       result != ISC_R_SUCCESS ? ", " : "",
+	       result != ISC_R_SUCCESS ? isc_result_totext(result) : "");
+
+	isc_mem_cput(mctx, conns, nconns, sizeof(conns[0]));
+	if (server_tlsctx != NULL) {
+		isc_tlsctx_free(&server_tlsctx);
+	}
+	if (client_tlsctx != NULL) {
+		isc_tlsctx_free(&client_tlsctx);
+	}
+	isc_managers_destroy(&mctx, &loopmgr, &netmgr);
+}
+
+static unsigned int
+parse_uint(const char *input, unsigned int min, unsigned int max) {
+	char *endptr = NULL;
+	unsigned long val = strtoul(input, &endptr, 10);
+
+	if (*endptr != '\0' || val < min || val > max) {
+		usage();
+		exit(1);
+	}
+
+	return (val);
+}
+
+int
+main(int argc, char *argv[]) {
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+	int opt;
+
+	workers = isc_os_ncpus();
+
+	while ((opt = isc_commandline_parse(argc, argv, "c:d:n:p:s:w:")) != -1)
+	{
+		switch (opt) {
+		case 'c':
+			nconns = parse_uint(isc_commandline_argument, 1,
+					    10000);
+			continue;
+		case 'd':
+			duration = parse_uint(isc_commandline_argument, 1,
+					      3600);
+			continue;
+		case 'n':
+			inflight = parse_uint(isc_commandline_argument, 1,
+					      65535);
+			continue;
+		case 'p':
+			port = parse_uint(isc_commandline_argument, 1, 65535);
+			continue;
+		case 's':
+			response_size = parse_uint(isc_commandline_argument,
+						   12, UINT16_MAX);
+			continue;
+		case 'w':
+			workers = parse_uint(isc_commandline_argument, 1, 128);
+			continue;
+		default:
+			usage();
+			exit(1);
+			continue;
+		}
+	}
+
+	isc_sockaddr_fromin(&server_addr, &in, port);
+
+	/*
+	 * Turn the query into a response: QR bit set, the question
+	 * copied, and the rest padded with zeroes.
+	 */
+	memmove(responsebuf, querybuf, sizeof(querybuf));
+	responsebuf[2] |= 0x80;
+	response = (isc_region_t){ responsebuf, response_size };
+
+	printf("%u connection(s) to %s port %u, %u quer%s in flight each, "
+	       "%u octet responses, %u second(s) per test\n",
+	       nconns, "127.0.0.1", port, inflight,
+	       inflight == 1 ? "y" : "ies", response_size, duration);
+
+	run(false);
+	run(true);
+
+	return (0);
+}
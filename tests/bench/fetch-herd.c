@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure how long it takes to complete a fetch that many clients are
+ * waiting for: the fetches are spread over all the loops and all join
+ * the same fetch context, which is stuck waiting for a forwarder that
+ * never answers.  The resolver is then shut down, which completes the
+ * fetch context and sends a response to every waiter; the time from
+ * the shutdown to each callback is the completion latency.
+ */
+
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/list.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/dispatch.h>
+#include <dns/fixedname.h>
+#include <dns/forward.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/resolver.h>
+#include <dns/view.h>
+
+#define MAXLOOPS 1024
+
+typedef struct waiter {
+	dns_fetch_t *fetch;
+	dns_rdataset_t rdataset;
+	uint64_t latency;
+} waiter_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static dns_dispatchmgr_t *dispatchmgr = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static dns_view_t *view = NULL;
+static isc_sockaddr_t blackhole;
+static int blackhole_fd = -1;
+static dns_fixedname_t fixed;
+static dns_name_t *name = NULL;
+
+static waiter_t *waiters = NULL;
+static uint32_t nwaiters = 10000;
+static uint32_t nloops = 8;
+static atomic_uint_fast32_t joined, completed;
+static isc_time_t start;
+
+static void
+finish(void *arg);
+
+static void
+fetch_done(void *arg) {
+	dns_fetchresponse_t *resp = arg;
+	waiter_t *waiter = resp->arg;
+	isc_time_t now = isc_time_now_hires();
+
+	waiter->latency = isc_time_microdiff(&now, &start);
+
+	if (dns_rdataset_isassociated(&waiter->rdataset)) {
+		dns_rdataset_disassociate(&waiter->rdataset);
+	}
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	dns_resolver_destroyfetch(&waiter->fetch);
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+
+	if (atomic_fetch_add_relaxed(&completed, 1) + 1 == nwaiters) {
+		isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+	}
+}
+
+static void
+all_joined(void *arg ISC_ATTR_UNUSED) {
+	dns_resolver_t *resolver = NULL;
+
+	RUNTIME_CHECK(dns_view_getresolver(view, &resolver) == ISC_R_SUCCESS);
+
+	start = isc_time_now_hires();
+	dns_resolver_shutdown(resolver);
+	dns_resolver_detach(&resolver);
+}
+
+static void
+join(void *arg) {
+	uintptr_t tid = (uintptr_t)arg;
+	isc_loop_t *loop = isc_loop_current(loopmgr);
+	dns_resolver_t *resolver = NULL;
+
+	RUNTIME_CHECK(dns_view_getresolver(view, &resolver) == ISC_R_SUCCESS);
+
+	for (uint32_t i = tid; i < nwaiters; i += nloops) {
+		waiter_t *waiter = &waiters[i];
+		isc_result_t result;
+
+		dns_rdataset_init(&waiter->rdataset);
+		result = dns_resolver_createfetch(
+			resolver, name, dns_rdatatype_a, NULL, NULL, NULL, NULL,
+			0, 0, 0, NULL, loop, fetch_done, waiter,
+			&waiter->rdataset, NULL, &waiter->fetch);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+		if (atomic_fetch_add_relaxed(&joined, 1) + 1 == nwaiters) {
+			isc_async_run(isc_loop_main(loopmgr), all_joined, NULL);
+		}
+	}
+
+	dns_resolver_detach(&resolver);
+}
+
+static int
+compare(const void *a, const void *b) {
+	const waiter_t *wa = a, *wb = b;
+
+	return ((wa->latency > wb->latency) - (wa->latency < wb->latency));
+}
+
+static void
+finish(void *arg ISC_ATTR_UNUSED) {
+	qsort(waiters, nwaiters, sizeof(waiters[0]), compare);
+
+	printf("%u waiters on %u loops\n\n", nwaiters, nloops);
+	printf("%8s | %10s\n", "quantile", "latency/us");
+	printf("%8s | %10" PRIu64 "\n", "min", waiters[0].latency);
+	printf("%8s | %10" PRIu64 "\n", "p50",
+	       waiters[nwaiters / 2].latency);
+	printf("%8s | %10" PRIu64 "\n", "p90",
+	       waiters[(uint64_t)nwaiters * 9 / 10].latency);
+	printf("%8s | %10" PRIu64 "\n", "p99",
+	       waiters[(uint64_t)nwaiters * 99 / 100].latency);
+	printf("%8s | %10" PRIu64 "\n", "max",
+	       waiters[nwaiters - 1].latency);
+
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	dns_dispatchmgr_detach(&dispatchmgr);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+setup(void *arg ISC_ATTR_UNUSED) {
+	isc_sockaddr_t local;
+	isc_sockaddrlist_t addrs = ISC_LIST_INITIALIZER;
+	isc_result_t result;
+
+	result = dns_dispatchmgr_create(mctx, netmgr, &dispatchmgr);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	isc_sockaddr_fromin6(&local, &in6addr_loopback, 0);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_view_create(mctx, dispatchmgr, dns_rdataclass_in, "herd",
+				 &view);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, loopmgr, 1, netmgr, 0,
+					 tlsctx_cache, NULL, dispatch);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &view->cachedb);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	ISC_LINK_INIT(&blackhole, link);
+	ISC_LIST_APPEND(addrs, &blackhole, link);
+	result = dns_fwdtable_add(view->fwdtable, dns_rootname, &addrs,
+				  dns_fwdpolicy_only);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	dns_view_freeze(view);
+
+	for (uint32_t i = 0; i < nloops; i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), join,
+			      (void *)(uintptr_t)i);
+	}
+}
+
+/*
+ * Bind a UDP socket on the loopback interface that is never read from,
+ * to be the forwarder.
+ */
+static void
+blackhole_open(void) {
+	socklen_t len = sizeof(blackhole.type.sin6);
+
+	isc_sockaddr_fromin6(&blackhole, &in6addr_loopback, 0);
+	blackhole_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+	RUNTIME_CHECK(blackhole_fd >= 0);
+	RUNTIME_CHECK(bind(blackhole_fd, &blackhole.type.sa, len) == 0);
+	RUNTIME_CHECK(getsockname(blackhole_fd, &blackhole.type.sa, &len) ==
+		      0);
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_result_t result;
+
+	if (argc > 1) {
+		nwaiters = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		nloops = strtoul(argv[2], NULL, 10);
+	}
+	if (argc > 3 || nwaiters == 0 || nloops == 0 || nloops > MAXLOOPS) {
+		fprintf(stderr, "usage: fetch-herd [waiters [loops]]\n");
+		exit(1);
+	}
+
+	blackhole_open();
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+	waiters = isc_mem_cget(mctx, nwaiters, sizeof(waiters[0]));
+
+	name = dns_fixedname_initname(&fixed);
+	result = dns_name_fromstring(name, "herd.example.", dns_rootname, 0,
+				     NULL);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	isc_loop_setup(isc_loop_main(loopmgr), setup, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_mem_cput(mctx, waiters, nwaiters, sizeof(waiters[0]));
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+	close(blackhole_fd);
+
+	return (0);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the cost of parsing a query into a reused message, as done
+ * by ns_client for each UDP request.  A response of similar size, which
+ * goes through the general parser, is measured for reference.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/message.h>
+
+/* www.example.com/AAAA */
+static const uint8_t query[] = {
+	0xab, 0xcd, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x03, 'w',  'w',	'w',  0x07, 'e',  'x',	'a',  'm',  'p',
+	'l',  'e',  0x03, 'c',	'o',  'm',  0x00, 0x00, 0x1c, 0x00, 0x01
+};
+
+/* the same, with an OPT record */
+static const uint8_t query_edns[] = {
+	0xab, 0xcd, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x03, 'w',  'w',	'w',  0x07, 'e',  'x',	'a',  'm',  'p',
+	'l',  'e',  0x03, 'c',	'o',  'm',  0x00, 0x00, 0x1c, 0x00, 0x01,
+	0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00
+};
+
+/* the same, with a client cookie */
+static const uint8_t query_cookie[] = {
+	0xab, 0xcd, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x03, 'w',  'w',	'w',  0x07, 'e',  'x',	'a',  'm',  'p',
+	'l',  'e',  0x03, 'c',	'o',  'm',  0x00, 0x00, 0x1c, 0x00, 0x01,
+	0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x80, 0x00, 0x00, 0x0c,
+	0x00, 0x0a, 0x00, 0x08, 1,    2,    3,	  4,	5,    6,    7,
+	8
+};
+
+/* www.example.com/AAAA response with one answer */
+static const uint8_t response[] = {
+	0xab, 0xcd, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x03, 'w',  'w',	'w',  0x07, 'e',  'x',	'a',  'm',  'p',
+	'l',  'e',  0x03, 'c',	'o',  'm',  0x00, 0x00, 0x1c, 0x00, 0x01,
+	0xc0, 0x0c, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00,
+	0x10, 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+
+static unsigned int repeat = 1000000;
+
+static void
+run(const char *label, dns_message_t *msg, const uint8_t *wire,
+    size_t len) {
+	isc_time_t start, finish;
+	uint64_t ns;
+
+	start = isc_time_now_hires();
+
+	for (unsigned int i = 0; i < repeat; i++) {
+		isc_buffer_t buf;
+		isc_result_t result;
+
+		isc_buffer_constinit(&buf, wire, len);
+		isc_buffer_add(&buf, len);
+		result = dns_message_parse(msg, &buf, 0);
+		if (result != ISC_R_SUCCESS) {
+			fprintf(stderr, "dns_message_parse: %s\n",
+				isc_result_totext(result));
+			exit(1);
+		}
+		dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	}
+
+	finish = isc_time_now_hires();
+	ns = isc_time_microdiff(&finish, &start) * 1000;
+
+	printf("%-10s %4zu bytes %8.1f ns/message\n", label, len,
+	       (double)ns / repeat);
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_mem_t *mctx = NULL;
+	dns_message_t *msg = NULL;
+
+	if (argc > 1) {
+		repeat = strtoul(argv[1], NULL, 10);
+		if (repeat == 0) {
+			fprintf(stderr, "usage: message-parse [iterations]\n");
+			exit(1);
+		}
+	}
+
+	isc_mem_create(&mctx);
+	dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	run("query", msg, query, sizeof(query));
+	run("edns", msg, query_edns, sizeof(query_edns));
+	run("cookie", msg, query_cookie, sizeof(query_cookie));
+	run("response", msg, response, sizeof(response));
+
+	dns_message_detach(&msg);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
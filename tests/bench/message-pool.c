@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the cost of the message life cycle of a resolver query: create
+ * a message, parse a response into it and detach it, with and without a
+ * message pool.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/message.h>
+
+#if defined(__GLIBC__) && !defined(HAVE_JEMALLOC)
+/*
+ * Count the calls into the system allocator.  With jemalloc, the memory
+ * contexts do not call malloc() and only the time is reported.
+ */
+#define COUNT_MALLOC 1
+
+extern void *
+__libc_malloc(size_t size);
+extern void *
+__libc_calloc(size_t nmemb, size_t size);
+extern void *
+__libc_realloc(void *ptr, size_t size);
+
+static atomic_size_t mallocs = 0;
+
+void *
+malloc(size_t size) {
+	atomic_fetch_add_relaxed(&mallocs, 1);
+	return (__libc_malloc(size));
+}
+
+void *
+calloc(size_t nmemb, size_t size) {
+	atomic_fetch_add_relaxed(&mallocs, 1);
+	return (__libc_calloc(nmemb, size));
+}
+
+void *
+realloc(void *ptr, size_t size) {
+	atomic_fetch_add_relaxed(&mallocs, 1);
+	return (__libc_realloc(ptr, size));
+}
+#endif /* if defined(__GLIBC__) && !defined(HAVE_JEMALLOC) */
+
+/*
+ * example.com/A response with two answers, one NS record in the
+ * authority section and its glue.
+ */
+static const uint8_t response[] = {
+	0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x00, 0x01,
+	/* question */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00, 0x00,
+	0x01, 0x00, 0x01,
+	/* answer */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04,
+	0xc0, 0x00, 0x02, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+	0x0e, 0x10, 0x00, 0x04, 0xc0, 0x00, 0x02, 0x02,
+	/* authority */
+	0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x06,
+	0x03, 'n', 's', '1', 0xc0, 0x0c,
+	/* additional */
+	0xc0, 0x49, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04,
+	0xc0, 0x00, 0x02, 0x35
+};
+
+static unsigned int repeat = 1000000;
+
+static void
+cycle(isc_mem_t *mctx, dns_messagepool_t *pool) {
+	dns_message_t *msg = NULL;
+	isc_buffer_t buf;
+	isc_result_t result;
+
+	if (pool != NULL) {
+		dns_message_createpooled(pool, DNS_MESSAGE_INTENTPARSE, &msg);
+	} else {
+		dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+	}
+
+	isc_buffer_constinit(&buf, response, sizeof(response));
+	isc_buffer_add(&buf, sizeof(response));
+	result = dns_message_parse(msg, &buf, 0);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "dns_message_parse: %s\n",
+			isc_result_totext(result));
+		exit(1);
+	}
+
+	dns_message_detach(&msg);
+}
+
+static void
+run(const char *label, isc_mem_t *mctx, dns_messagepool_t *pool) {
+	isc_time_t start, finish;
+	uint64_t ns;
+#if COUNT_MALLOC
+	size_t before;
+#endif /* if COUNT_MALLOC */
+
+	/* warm up */
+	for (unsigned int i = 0; i < 1000; i++) {
+		cycle(mctx, pool);
+	}
+
+#if COUNT_MALLOC
+	before = atomic_load_relaxed(&mallocs);
+#endif /* if COUNT_MALLOC */
+	start = isc_time_now_hires();
+
+	for (unsigned int i = 0; i < repeat; i++) {
+		cycle(mctx, pool);
+	}
+
+	finish = isc_time_now_hires();
+	ns = isc_time_microdiff(&finish, &start) * 1000;
+
+	printf("%-10s %8.1f ns/query", label, (double)ns / repeat);
+#if COUNT_MALLOC
+	printf(" %8.2f mallocs/query",
+	       (double)(atomic_load_relaxed(&mallocs) - before) / repeat);
+#endif /* if COUNT_MALLOC */
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_mem_t *mctx = NULL;
+	dns_messagepool_t *pool = NULL;
+
+	if (argc > 1) {
+		repeat = strtoul(argv[1], NULL, 10);
+		if (repeat == 0) {
+			fprintf(stderr, "usage: message-pool [iterations]\n");
+			exit(1);
+		}
+	}
+
+	isc_mem_create(&mctx);
+
+	run("create", mctx, NULL);
+
+	dns_messagepool_create(mctx, isc_tid(), 1, &pool);
+	run("pooled", mctx, pool);
+	dns_messagepool_destroy(&pool);
+
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the memory used per RBT node, and the cost of finding a name,
+ * for a set of names shaped like the contents of a resolver cache: the
+ * names from a top sites list (in the "rank,domain" format also used by
+ * load-names), each with a few common host names below them.  Without a
+ * file, names are generated under a small set of top level domains.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rbt.h>
+
+static const char *hosts[] = { NULL, "www", "mail", "ns1", "cdn", "api" };
+
+static const char *tlds[] = { "com", "net", "org", "de",   "uk",
+			      "ru",  "jp",  "br",  "info", "io" };
+
+static dns_name_t **names = NULL;
+static size_t count = 0, alloc = 0;
+
+static void
+addname(isc_mem_t *mctx, const char *host, const char *domain) {
+	char text[DNS_NAME_FORMATSIZE];
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	isc_buffer_t buffer;
+	isc_result_t result;
+	int len;
+
+	if (count == alloc) {
+		size_t newalloc = alloc == 0 ? 65536 : alloc * 2;
+		names = isc_mem_creget(mctx, names, alloc, newalloc,
+				       sizeof(names[0]));
+		alloc = newalloc;
+	}
+
+	if (host != NULL) {
+		len = snprintf(text, sizeof(text), "%s.%s", host, domain);
+	} else {
+		len = snprintf(text, sizeof(text), "%s", domain);
+	}
+	if (len < 0 || (size_t)len >= sizeof(text)) {
+		return;
+	}
+
+	isc_buffer_init(&buffer, text, len);
+	isc_buffer_add(&buffer, len);
+	result = dns_name_fromtext(name, &buffer, dns_rootname, 0, NULL);
+	if (result == ISC_R_SUCCESS) {
+		names[count] = isc_mem_get(mctx, sizeof(*names[count]));
+		dns_name_init(names[count], NULL);
+		dns_name_dup(name, mctx, names[count]);
+		count++;
+	}
+}
+
+static void
+adddomain(isc_mem_t *mctx, const char *domain) {
+	for (size_t i = 0; i < ARRAY_SIZE(hosts); i++) {
+		addname(mctx, hosts[i], domain);
+	}
+}
+
+static void
+readfile(isc_mem_t *mctx, const char *filename) {
+	char line[1024];
+	FILE *fp = fopen(filename, "r");
+
+	if (fp == NULL) {
+		fprintf(stderr, "fopen(%s): %s\n", filename, strerror(errno));
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *domain = line + strspn(line, "0123456789");
+
+		if (*domain == ',') {
+			domain++;
+		}
+		domain[strcspn(domain, "\r\n")] = '\0';
+		if (*domain != '\0') {
+			adddomain(mctx, domain);
+		}
+	}
+	fclose(fp);
+}
+
+static void
+generate(isc_mem_t *mctx, size_t ndomains) {
+	static const char alnum[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+	for (size_t i = 0; i < ndomains; i++) {
+		char domain[64];
+		size_t len = 3 + isc_random_uniform(10);
+
+		for (size_t j = 0; j < len; j++) {
+			domain[j] =
+				alnum[isc_random_uniform(sizeof(alnum) - 1)];
+		}
+		snprintf(domain + len, sizeof(domain) - len, ".%s",
+			 tlds[isc_random_uniform(ARRAY_SIZE(tlds))]);
+		adddomain(mctx, domain);
+	}
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_mem_t *mctx = NULL, *mem = NULL;
+	dns_rbt_t *rbt = NULL;
+	isc_time_t start, finish;
+	uint64_t addus, findus;
+	size_t before, after, nodes;
+
+	isc_mem_create(&mctx);
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: rbt-nodes [filename.csv]\n");
+		exit(1);
+	} else if (argc == 2) {
+		readfile(mctx, argv[1]);
+	} else {
+		generate(mctx, 200000);
+	}
+
+	isc_mem_create(&mem);
+	before = isc_mem_inuse(mem);
+	RUNTIME_CHECK(dns_rbt_create(mem, NULL, NULL, &rbt) == ISC_R_SUCCESS);
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < count; i++) {
+		dns_rbtnode_t *node = NULL;
+		isc_result_t result = dns_rbt_addnode(rbt, names[i], &node);
+		if (result == ISC_R_SUCCESS) {
+			node->data = names[i];
+		}
+	}
+	finish = isc_time_now_hires();
+	addus = isc_time_microdiff(&finish, &start);
+
+	after = isc_mem_inuse(mem);
+	nodes = dns_rbt_nodecount(rbt);
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < count; i++) {
+		dns_rbtnode_t *node = NULL;
+		isc_result_t result = dns_rbt_findnode(
+			rbt, names[i], NULL, &node, NULL, 0, NULL, NULL);
+		INSIST(result == ISC_R_SUCCESS);
+	}
+	finish = isc_time_now_hires();
+	findus = isc_time_microdiff(&finish, &start);
+
+	printf("names %zu nodes %zu sizeof(dns_rbtnode_t) %zu\n", count,
+	       nodes, sizeof(dns_rbtnode_t));
+	printf("memory %.1f MB, %.1f bytes/node, %.1f bytes/name\n",
+	       (double)(after - before) / (1024.0 * 1024.0),
+	       (double)(after - before) / nodes,
+	       (double)(after - before) / count);
+	printf("add %.1f ns/name, find %.1f ns/name\n",
+	       (double)addus * 1000.0 / count,
+	       (double)findus * 1000.0 / count);
+
+	dns_rbt_destroy(&rbt);
+	isc_mem_destroy(&mem);
+	for (size_t i = 0; i < count; i++) {
+		dns_name_free(names[i], mctx);
+		isc_mem_put(mctx, names[i], sizeof(*names[i]));
+	}
+	isc_mem_cput(mctx, names, alloc, sizeof(names[0]));
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
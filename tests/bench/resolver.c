@@ -0,0 +1,860 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the whole recursive path of the resolver against a fake
+ * hierarchy of authoritative servers on the loopback interface: the root
+ * server on 127.0.0.1 delegates NTLDS top-level domains "tK." to the
+ * server on 127.0.0.2, which delegates NSLDS second-level domains
+ * "sM.tK." to the server on 127.0.0.3, which has NHOSTS addresses
+ * "hN.sM.tK." in each.  The servers can delay their answers and drop
+ * some of the queries.
+ *
+ * Clients spread over all the loops look up names drawn from a Zipf
+ * distribution, first in the cache and then with a fetch, like named
+ * does.  The throughput, the latency quantiles and the upstream queries
+ * are reported, and with the glibc allocator, the calls into malloc()
+ * per fetch made outside of the servers, which have their own memory
+ * context.
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/random.h>
+#include <isc/sockaddr.h>
+#include <isc/stats.h>
+#include <isc/stdtime.h>
+#include <isc/thread.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/callbacks.h>
+#include <dns/db.h>
+#include <dns/dispatch.h>
+#include <dns/fixedname.h>
+#include <dns/master.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/resolver.h>
+#include <dns/stats.h>
+#include <dns/view.h>
+
+/* Set while the fake servers run, so that their work is not counted */
+static thread_local bool serving = false;
+
+#if defined(__GLIBC__) && !defined(HAVE_JEMALLOC)
+/*
+ * Count the calls into the system allocator.  With jemalloc, the memory
+ * contexts do not call malloc() and only the time is reported.
+ */
+#define COUNT_MALLOC 1
+
+extern void *
+__libc_malloc(size_t size);
+extern void *
+__libc_calloc(size_t nmemb, size_t size);
+extern void *
+__libc_realloc(void *ptr, size_t size);
+
+static atomic_size_t mallocs = 0;
+
+void *
+malloc(size_t size) {
+	if (!serving) {
+		atomic_fetch_add_relaxed(&mallocs, 1);
+	}
+	return (__libc_malloc(size));
+}
+
+void *
+calloc(size_t nmemb, size_t size) {
+	if (!serving) {
+		atomic_fetch_add_relaxed(&mallocs, 1);
+	}
+	return (__libc_calloc(nmemb, size));
+}
+
+void *
+realloc(void *ptr, size_t size) {
+	if (!serving) {
+		atomic_fetch_add_relaxed(&mallocs, 1);
+	}
+	return (__libc_realloc(ptr, size));
+}
+#endif /* if defined(__GLIBC__) && !defined(HAVE_JEMALLOC) */
+
+#define MAXLOOPS 1024
+
+#define NTLDS	  10
+#define NSLDS	  100
+#define NHOSTS	  100
+#define NNAMES	  (NTLDS * NSLDS * NHOSTS)
+#define NLEVELS	  3
+#define MAXLABELS 128
+
+/* A prime that does not divide NNAMES, to scatter the popular names */
+#define SCATTER 2654435761U
+
+typedef struct reply {
+	isc_nmhandle_t *handle;
+	isc_timer_t *timer;
+	isc_region_t region;
+	uint8_t buf[512];
+} reply_t;
+
+typedef struct client {
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	dns_fetch_t *fetch;
+	dns_rdataset_t rdataset;
+	isc_time_t start;
+} client_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_mem_t *server_mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static dns_dispatchmgr_t *dispatchmgr = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static dns_view_t *view = NULL;
+static dns_resolver_t *resolver = NULL;
+static isc_stats_t *resstats = NULL;
+static isc_nmsocket_t *servers[NLEVELS];
+static in_port_t port;
+
+/* parameters */
+static uint32_t nqueries = 100000;
+static uint32_t nclients = 100;
+static uint32_t nloops = 4;
+static uint32_t delay = 0;
+static uint32_t loss = 0;
+static uint32_t ttl = 300;
+static double exponent = 1.0;
+static bool qminimize = false;
+
+static double *zipf = NULL;
+static client_t *clients = NULL;
+static uint64_t *latencies = NULL;
+static atomic_uint_fast32_t issued, completed, hits, failures, running;
+static isc_time_t start;
+#if COUNT_MALLOC
+static size_t mallocs_before;
+#endif /* if COUNT_MALLOC */
+
+/*
+ * The fake authoritative servers.  The server at level 0 is the root
+ * server, level 1 the server of the top-level domains and level 2 the
+ * server of the second-level domains.  The responses are put together
+ * by hand, with the owner names compressed against the question.
+ */
+
+static const char prefixes[NLEVELS] = { 't', 's', 'h' };
+static const uint32_t limits[NLEVELS] = { NTLDS, NSLDS, NHOSTS };
+
+/*
+ * Return the number in a label like "t12", or UINT32_MAX if the label
+ * is not one for 'depth'.
+ */
+static uint32_t
+label_index(const uint8_t *label, unsigned int depth) {
+	uint32_t index = 0;
+
+	if (label[0] < 2 || label[0] > 6 ||
+	    tolower(label[1]) != prefixes[depth])
+	{
+		return (UINT32_MAX);
+	}
+	for (unsigned int i = 2; i <= label[0]; i++) {
+		if (!isdigit(label[i])) {
+			return (UINT32_MAX);
+		}
+		index = index * 10 + label[i] - '0';
+	}
+
+	return ((index < limits[depth]) ? index : UINT32_MAX);
+}
+
+static bool
+label_is_ns(const uint8_t *label) {
+	return (label[0] == 2 && tolower(label[1]) == 'n' &&
+		tolower(label[2]) == 's');
+}
+
+static uint8_t *
+put16(uint8_t *p, uint16_t value) {
+	*p++ = value >> 8;
+	*p++ = value & 0xff;
+	return (p);
+}
+
+static uint8_t *
+put32(uint8_t *p, uint32_t value) {
+	p = put16(p, value >> 16);
+	return (put16(p, value & 0xffff));
+}
+
+/*
+ * Put the name made of the last 'suffix' labels of the question name:
+ * the root name, or a pointer into the question.
+ */
+static uint8_t *
+put_suffix(uint8_t *p, const uint16_t *offsets, unsigned int nlabels,
+	   unsigned int suffix) {
+	if (suffix == 0) {
+		*p++ = 0;
+		return (p);
+	}
+	return (put16(p, 0xc000 | (12 + offsets[nlabels - suffix])));
+}
+
+static unsigned int
+suffix_length(unsigned int suffix) {
+	return ((suffix == 0) ? 1 : 2);
+}
+
+static uint8_t *
+put_ns_name(uint8_t *p, const uint16_t *offsets, unsigned int nlabels,
+	    unsigned int suffix) {
+	*p++ = 2;
+	*p++ = 'n';
+	*p++ = 's';
+	return (put_suffix(p, offsets, nlabels, suffix));
+}
+
+static uint8_t *
+put_rr(uint8_t *p, uint16_t type, uint16_t rdlength) {
+	p = put16(p, type);
+	p = put16(p, dns_rdataclass_in);
+	p = put32(p, ttl);
+	return (put16(p, rdlength));
+}
+
+/* The NS record of the zone made of the last 'suffix' labels */
+static uint8_t *
+put_ns(uint8_t *p, const uint16_t *offsets, unsigned int nlabels,
+       unsigned int suffix) {
+	p = put_suffix(p, offsets, nlabels, suffix);
+	p = put_rr(p, dns_rdatatype_ns, 3 + suffix_length(suffix));
+	return (put_ns_name(p, offsets, nlabels, suffix));
+}
+
+/* The address of the name server of that zone */
+static uint8_t *
+put_glue(uint8_t *p, const uint16_t *offsets, unsigned int nlabels,
+	 unsigned int suffix) {
+	p = put_ns_name(p, offsets, nlabels, suffix);
+	p = put_rr(p, dns_rdatatype_a, 4);
+	return (put32(p, INADDR_LOOPBACK + suffix));
+}
+
+static uint8_t *
+put_soa(uint8_t *p, const uint16_t *offsets, unsigned int nlabels,
+	unsigned int suffix) {
+	p = put_suffix(p, offsets, nlabels, suffix);
+	p = put_rr(p, dns_rdatatype_soa,
+		   3 + 11 + 2 * suffix_length(suffix) + 20);
+	p = put_ns_name(p, offsets, nlabels, suffix);
+	*p++ = 10;
+	memmove(p, "hostmaster", 10);
+	p = put_suffix(p + 10, offsets, nlabels, suffix);
+	p = put32(p, 1);
+	p = put32(p, 3600);
+	p = put32(p, 600);
+	p = put32(p, 86400);
+	return (put32(p, ttl));
+}
+
+/*
+ * Put together the answer of the server at 'level' to 'query' in 'buf',
+ * and return its length, or 0 if the query is to be ignored.
+ */
+static unsigned int
+respond(const isc_region_t *query, unsigned int level, uint8_t *buf) {
+	uint16_t offsets[MAXLABELS];
+	const uint8_t *labels[MAXLABELS];
+	unsigned int nlabels = 0, qlength, qtype;
+	unsigned int ancount = 0, nscount = 0, arcount = 0;
+	unsigned int pos = 12;
+	uint8_t *p = NULL;
+	bool authoritative = true;
+	uint8_t rcode = dns_rcode_noerror;
+
+	if (query->length < 12 + 5 || (query->base[2] & 0x80) != 0) {
+		return (0);
+	}
+
+	while (pos < query->length && query->base[pos] != 0) {
+		if (query->base[pos] > 63 || nlabels == MAXLABELS) {
+			return (0);
+		}
+		offsets[nlabels] = pos - 12;
+		labels[nlabels++] = &query->base[pos];
+		pos += query->base[pos] + 1;
+	}
+	qlength = pos + 1 + 4;
+	if (qlength > query->length || qlength > 256) {
+		return (0);
+	}
+	qtype = (query->base[pos + 1] << 8) | query->base[pos + 2];
+
+	/* the header and the question */
+	memmove(buf, query->base, qlength);
+	buf[2] = 0x80 | (query->base[2] & 0x79);
+	put16(buf + 4, 1);
+	p = buf + qlength;
+
+	/* the labels of the zone are numbered from the top */
+#define LABEL(depth) labels[nlabels - 1 - (depth)]
+
+	for (unsigned int depth = 0; depth < level; depth++) {
+		if (depth >= nlabels ||
+		    label_index(LABEL(depth), depth) == UINT32_MAX)
+		{
+			rcode = dns_rcode_refused;
+			authoritative = false;
+			goto done;
+		}
+	}
+
+	if (nlabels == level) {
+		/* the zone apex */
+		if (qtype == dns_rdatatype_ns) {
+			p = put_ns(p, offsets, nlabels, level);
+			p = put_glue(p, offsets, nlabels, level);
+			ancount = arcount = 1;
+		} else if (qtype == dns_rdatatype_soa) {
+			p = put_soa(p, offsets, nlabels, level);
+			ancount = 1;
+		} else {
+			p = put_soa(p, offsets, nlabels, level);
+			nscount = 1;
+		}
+	} else if (nlabels == level + 1 && label_is_ns(LABEL(level))) {
+		/* the name server of the zone */
+		if (qtype == dns_rdatatype_a) {
+			p = put_glue(p, offsets, nlabels, level);
+			ancount = 1;
+		} else {
+			p = put_soa(p, offsets, nlabels, level);
+			nscount = 1;
+		}
+	} else if (label_index(LABEL(level), level) == UINT32_MAX ||
+		   (level == NLEVELS - 1 && nlabels > NLEVELS))
+	{
+		rcode = dns_rcode_nxdomain;
+		p = put_soa(p, offsets, nlabels, level);
+		nscount = 1;
+	} else if (level < NLEVELS - 1) {
+		/* a referral to the child zone */
+		authoritative = false;
+		p = put_ns(p, offsets, nlabels, level + 1);
+		p = put_glue(p, offsets, nlabels, level + 1);
+		nscount = arcount = 1;
+	} else if (qtype == dns_rdatatype_a) {
+		/* a host */
+		p = put16(p, 0xc000 | 12);
+		p = put_rr(p, dns_rdatatype_a, 4);
+		*p++ = 10;
+		*p++ = label_index(LABEL(0), 0);
+		*p++ = label_index(LABEL(1), 1);
+		*p++ = label_index(LABEL(2), 2);
+		ancount = 1;
+	} else {
+		p = put_soa(p, offsets, nlabels, level);
+		nscount = 1;
+	}
+
+#undef LABEL
+
+done:
+	if (authoritative) {
+		buf[2] |= 0x04;
+	}
+	buf[3] = rcode;
+	put16(buf + 6, ancount);
+	put16(buf + 8, nscount);
+	put16(buf + 10, arcount);
+
+	return (p - buf);
+}
+
+static void
+server_senddone(isc_nmhandle_t *handle ISC_ATTR_UNUSED,
+		isc_result_t eresult ISC_ATTR_UNUSED, void *arg) {
+	reply_t *reply = arg;
+
+	if (reply->timer != NULL) {
+		isc_timer_destroy(&reply->timer);
+	}
+	isc_nmhandle_detach(&reply->handle);
+	isc_mem_put(server_mctx, reply, sizeof(*reply));
+}
+
+static void
+server_send(void *arg) {
+	reply_t *reply = arg;
+
+	serving = true;
+	isc_nm_send(reply->handle, &reply->region, server_senddone, reply);
+	serving = false;
+}
+
+static void
+serve(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
+      void *arg) {
+	isc_sockaddr_t local = isc_nmhandle_localaddr(handle);
+	unsigned int level = (ntohl(local.type.sin.sin_addr.s_addr) & 0xff) - 1;
+	reply_t *reply = NULL;
+	isc_interval_t interval;
+
+	UNUSED(arg);
+
+	if (eresult != ISC_R_SUCCESS ||
+	    (loss > 0 && isc_random_uniform(100) < loss))
+	{
+		return;
+	}
+
+	reply = isc_mem_get(server_mctx, sizeof(*reply));
+	*reply = (reply_t){ .region.base = reply->buf };
+	reply->region.length = respond(region, level, reply->buf);
+	if (reply->region.length == 0) {
+		isc_mem_put(server_mctx, reply, sizeof(*reply));
+		return;
+	}
+
+	isc_nmhandle_attach(handle, &reply->handle);
+	if (delay == 0) {
+		server_send(reply);
+		return;
+	}
+
+	isc_timer_create(isc_loop_current(loopmgr), server_send, reply,
+			 &reply->timer);
+	isc_interval_set(&interval, delay / 1000, (delay % 1000) * 1000000);
+	isc_timer_start(reply->timer, isc_timertype_once, &interval);
+}
+
+static void
+server_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
+	    void *arg) {
+	serving = true;
+	serve(handle, eresult, region, arg);
+	serving = false;
+}
+
+/*
+ * The clients.
+ */
+
+static void
+finish(void *arg);
+
+static void
+next_query(void *arg);
+
+static void
+done(client_t *client) {
+	isc_time_t now = isc_time_now_hires();
+	uint32_t n = atomic_fetch_add_relaxed(&completed, 1);
+
+	latencies[n] = isc_time_microdiff(&now, &client->start);
+}
+
+static void
+fetch_done(void *arg) {
+	dns_fetchresponse_t *resp = arg;
+	client_t *client = resp->arg;
+
+	if (resp->result != ISC_R_SUCCESS) {
+		atomic_fetch_add_relaxed(&failures, 1);
+	}
+	done(client);
+
+	if (dns_rdataset_isassociated(&client->rdataset)) {
+		dns_rdataset_disassociate(&client->rdataset);
+	}
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	dns_resolver_destroyfetch(&client->fetch);
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+
+	next_query(client);
+}
+
+/*
+ * Draw a name from the Zipf distribution, and spread the ranks over
+ * the zones.
+ */
+static void
+pick_name(client_t *client) {
+	double u = (double)isc_random32() / UINT32_MAX;
+	uint32_t lo = 0, hi = NNAMES - 1, n;
+	char text[64];
+	isc_result_t result;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (zipf[mid] < u) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	n = ((uint64_t)lo * SCATTER) % NNAMES;
+	snprintf(text, sizeof(text), "h%u.s%u.t%u.", n % NHOSTS,
+		 (n / NHOSTS) % NSLDS, n / (NHOSTS * NSLDS));
+	result = dns_name_fromstring(client->name, text, dns_rootname, 0,
+				     NULL);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+}
+
+static void
+next_query(void *arg) {
+	client_t *client = arg;
+	dns_fixedname_t fixed;
+	dns_name_t *found = dns_fixedname_initname(&fixed);
+	unsigned int options = qminimize ? DNS_FETCHOPT_QMINIMIZE : 0;
+	isc_result_t result;
+
+	if (atomic_fetch_add_relaxed(&issued, 1) >= nqueries) {
+		if (atomic_fetch_sub_release(&running, 1) == 1) {
+			isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+		}
+		return;
+	}
+
+	pick_name(client);
+	client->start = isc_time_now_hires();
+
+	result = dns_db_find(view->cachedb, client->name, NULL,
+			     dns_rdatatype_a, 0, isc_stdtime_now(), NULL, found,
+			     &client->rdataset, NULL);
+	if (dns_rdataset_isassociated(&client->rdataset)) {
+		dns_rdataset_disassociate(&client->rdataset);
+	}
+	if (result == ISC_R_SUCCESS) {
+		atomic_fetch_add_relaxed(&hits, 1);
+		done(client);
+		isc_async_current(loopmgr, next_query, client);
+		return;
+	}
+
+	result = dns_resolver_createfetch(
+		resolver, client->name, dns_rdatatype_a, NULL, NULL, NULL, NULL,
+		0, options, 0, NULL, isc_loop_current(loopmgr), fetch_done,
+		client, &client->rdataset, NULL, &client->fetch);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+}
+
+static void
+start_clients(void *arg) {
+	uintptr_t tid = (uintptr_t)arg;
+
+	for (uint32_t i = 0; i < nclients; i++) {
+		client_t *client = &clients[tid * nclients + i];
+
+		client->name = dns_fixedname_initname(&client->fixed);
+		dns_rdataset_init(&client->rdataset);
+		next_query(client);
+	}
+}
+
+static int
+compare(const void *a, const void *b) {
+	const uint64_t *la = a, *lb = b;
+
+	return ((*la > *lb) - (*la < *lb));
+}
+
+static void
+finish(void *arg ISC_ATTR_UNUSED) {
+	isc_time_t now = isc_time_now_hires();
+	uint64_t us = isc_time_microdiff(&now, &start);
+	uint32_t n = atomic_load_relaxed(&completed);
+	uint32_t fetches = n - atomic_load_relaxed(&hits);
+	uint32_t nfailures = atomic_load_relaxed(&failures);
+	uint64_t upstream = isc_stats_get_counter(
+		resstats, dns_resstatscounter_queryv4);
+
+	qsort(latencies, n, sizeof(latencies[0]), compare);
+
+	printf("%u queries from %u clients on %u loops, "
+	       "Zipf exponent %.2f over %u names\n",
+	       n, nclients * nloops, nloops, exponent, NNAMES);
+	printf("delay %u ms, loss %u%%, TTL %u s, QNAME minimization %s\n\n",
+	       delay, loss, ttl, qminimize ? "on" : "off");
+
+	printf("%-16s %12.0f\n", "queries/s", (double)n * 1000000.0 / us);
+	printf("%-16s %11.1f%%\n", "cache hits",
+	       100.0 * (n - fetches) / ISC_MAX(n, 1));
+	printf("%-16s %12u\n", "fetches", fetches);
+	printf("%-16s %12u\n", "failures", nfailures);
+	printf("%-16s %12.2f\n", "upstream/fetch",
+	       (double)upstream / ISC_MAX(fetches, 1));
+#if COUNT_MALLOC
+	printf("%-16s %12.2f\n", "mallocs/fetch",
+	       (double)(atomic_load_relaxed(&mallocs) - mallocs_before) /
+		       ISC_MAX(fetches, 1));
+#endif /* if COUNT_MALLOC */
+
+	printf("\n%8s | %10s\n", "quantile", "latency/us");
+	printf("%8s | %10" PRIu64 "\n", "p50", latencies[n / 2]);
+	printf("%8s | %10" PRIu64 "\n", "p90",
+	       latencies[(uint64_t)n * 9 / 10]);
+	printf("%8s | %10" PRIu64 "\n", "p99",
+	       latencies[(uint64_t)n * 99 / 100]);
+	printf("%8s | %10" PRIu64 "\n", "max", latencies[n - 1]);
+
+	for (size_t i = 0; i < NLEVELS; i++) {
+		isc_nm_stoplistening(servers[i]);
+		isc_nmsocket_close(&servers[i]);
+	}
+	dns_resolver_detach(&resolver);
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	dns_dispatchmgr_detach(&dispatchmgr);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Root hints pointing at the fake root server.
+ */
+static void
+load_hints(void) {
+	static char hints[] = ". 3600000 NS ns.\n"
+			      "ns. 3600000 A 127.0.0.1\n";
+	dns_rdatacallbacks_t callbacks;
+	isc_buffer_t source;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &db);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	isc_buffer_init(&source, hints, strlen(hints));
+	isc_buffer_add(&source, strlen(hints));
+
+	dns_rdatacallbacks_init(&callbacks);
+	result = dns_db_beginload(db, &callbacks);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	result = dns_master_loadbuffer(&source, &db->origin, &db->origin,
+				       db->rdclass, DNS_MASTER_HINT,
+				       &callbacks, db->mctx);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	result = dns_db_endload(db, &callbacks);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	dns_view_sethints(view, db);
+	dns_db_detach(&db);
+}
+
+static void
+setup(void *arg ISC_ATTR_UNUSED) {
+	isc_sockaddr_t addr;
+	struct in_addr in;
+	isc_result_t result;
+
+	for (size_t i = 0; i < NLEVELS; i++) {
+		in.s_addr = htonl(INADDR_LOOPBACK + i);
+		isc_sockaddr_fromin(&addr, &in, port);
+		result = isc_nm_listenudp(netmgr, ISC_NM_LISTEN_ALL, &addr,
+					  server_recv, NULL, &servers[i]);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+
+	result = dns_dispatchmgr_create(mctx, netmgr, &dispatchmgr);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	in.s_addr = htonl(INADDR_LOOPBACK);
+	isc_sockaddr_fromin(&addr, &in, 0);
+	result = dns_dispatch_createudp(dispatchmgr, &addr, &dispatch);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_view_create(mctx, dispatchmgr, dns_rdataclass_in,
+				 "resolver", &view);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	dns_view_setdstport(view, port);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, loopmgr, 1, netmgr, 0,
+					 tlsctx_cache, dispatch, NULL);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &view->cachedb);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	load_hints();
+	dns_view_freeze(view);
+
+	RUNTIME_CHECK(dns_view_getresolver(view, &resolver) == ISC_R_SUCCESS);
+	isc_stats_create(mctx, &resstats, dns_resstatscounter_max);
+	dns_resolver_setstats(resolver, resstats);
+
+	atomic_init(&running, nclients * nloops);
+#if COUNT_MALLOC
+	mallocs_before = atomic_load_relaxed(&mallocs);
+#endif /* if COUNT_MALLOC */
+	start = isc_time_now_hires();
+	for (uint32_t i = 0; i < nloops; i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), start_clients,
+			      (void *)(uintptr_t)i);
+	}
+}
+
+/*
+ * Find a free UDP port on the loopback interface for the servers.
+ */
+static void
+server_port(void) {
+	struct sockaddr_in sin = { .sin_family = AF_INET };
+	socklen_t len = sizeof(sin);
+	int fd;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	RUNTIME_CHECK(fd >= 0);
+	RUNTIME_CHECK(bind(fd, (struct sockaddr *)&sin, len) == 0);
+	RUNTIME_CHECK(getsockname(fd, (struct sockaddr *)&sin, &len) == 0);
+	close(fd);
+
+	port = ntohs(sin.sin_port);
+}
+
+/*
+ * The cumulative distribution of the Zipf ranks.
+ */
+static void
+zipf_init(void) {
+	double sum = 0.0;
+
+	zipf = isc_mem_cget(mctx, NNAMES, sizeof(zipf[0]));
+	for (uint32_t i = 0; i < NNAMES; i++) {
+		sum += 1.0 / pow(i + 1, exponent);
+		zipf[i] = sum;
+	}
+	for (uint32_t i = 0; i < NNAMES; i++) {
+		zipf[i] /= sum;
+	}
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: resolver [-c clients] [-d delay] [-l loss] "
+			"[-n queries] [-p loops] [-q]\n"
+			"                [-s exponent] [-t ttl]\n"
+			"\t-c\tclients per loop (%u)\n"
+			"\t-d\tdelay of the answers in milliseconds (%u)\n"
+			"\t-l\tpercentage of queries dropped (%u)\n"
+			"\t-n\tnumber of queries (%u)\n"
+			"\t-p\tnumber of loops (%u)\n"
+			"\t-q\tuse QNAME minimization\n"
+			"\t-s\texponent of the Zipf distribution (%.2f)\n"
+			"\t-t\tTTL of the records in seconds (%u)\n",
+		nclients, delay, loss, nqueries, nloops, exponent, ttl);
+	exit(1);
+}
+
+int
+main(int argc, char *argv[]) {
+	int ch;
+
+	while ((ch = getopt(argc, argv, "c:d:l:n:p:qs:t:")) != -1) {
+		switch (ch) {
+		case 'c':
+			nclients = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			delay = strtoul(optarg, NULL, 10);
+			break;
+		case 'l':
+			loss = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			nqueries = strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			nloops = strtoul(optarg, NULL, 10);
+			break;
+		case 'q':
+			qminimize = true;
+			break;
+		case 's':
+			exponent = strtod(optarg, NULL);
+			break;
+		case 't':
+			ttl = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || nclients == 0 || nqueries == 0 || nloops == 0 ||
+	    nloops > MAXLOOPS || loss >= 100 || exponent < 0.0)
+	{
+		usage();
+	}
+
+	server_port();
+
+	isc_mem_create(&mctx);
+	isc_mem_create(&server_mctx);
+	isc_mem_setname(server_mctx, "servers");
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+
+	zipf_init();
+	clients = isc_mem_cget(mctx, nloops * nclients, sizeof(clients[0]));
+	latencies = isc_mem_cget(mctx, nqueries, sizeof(latencies[0]));
+
+	isc_loop_setup(isc_loop_main(loopmgr), setup, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_stats_detach(&resstats);
+	isc_mem_cput(mctx, latencies, nqueries, sizeof(latencies[0]));
+	isc_mem_cput(mctx, clients, nloops * nclients, sizeof(clients[0]));
+	isc_mem_cput(mctx, zipf, NNAMES, sizeof(zipf[0]));
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&server_mctx);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the cost of restarting and stopping timers the way the
+ * resolver uses them: a large number of pending timeouts, most of which
+ * are pushed back or stopped long before they fire.  The libuv timers
+ * (kept in a heap, so restarting one is O(log n)) are compared with the
+ * coarse timers kept in the loop's timing wheel.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/random.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/util.h>
+
+#define RESTARTS (4 * 1024 * 1024)
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static size_t ntimers = 100000;
+
+static void
+fired(void *arg ISC_ATTR_UNUSED) {
+	/* the timeouts are long enough never to fire */
+	UNREACHABLE();
+}
+
+static void
+run(bool coarse) {
+	isc_loop_t *loop = isc_loop_main(loopmgr);
+	isc_timer_t **timers = isc_mem_cget(mctx, ntimers, sizeof(timers[0]));
+	isc_interval_t interval;
+	isc_time_t start, finish;
+	uint64_t startus, restartus, stopus;
+
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_create(loop, fired, NULL, &timers[i]);
+		isc_timer_setcoarse(timers[i], coarse);
+	}
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_interval_set(&interval, 10 + isc_random_uniform(20), 0);
+		isc_timer_start(timers[i], isc_timertype_once, &interval);
+	}
+	finish = isc_time_now_hires();
+	startus = isc_time_microdiff(&finish, &start);
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < RESTARTS; i++) {
+		isc_timer_t *timer = timers[isc_random_uniform(ntimers)];
+
+		isc_interval_set(&interval, 10 + (i % 20), 0);
+		isc_timer_start(timer, isc_timertype_once, &interval);
+	}
+	finish = isc_time_now_hires();
+	restartus = isc_time_microdiff(&finish, &start);
+
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_stop(timers[i]);
+	}
+	finish = isc_time_now_hires();
+	stopus = isc_time_microdiff(&finish, &start);
+
+	printf("%8s | %9.1f | %10.1f | %8.1f\n", coarse ? "wheel" : "libuv",
+	       (double)startus * 1000.0 / ntimers,
+	       (double)restartus * 1000.0 / RESTARTS,
+	       (double)stopus * 1000.0 / ntimers);
+
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_destroy(&timers[i]);
+	}
+	isc_mem_cput(mctx, timers, ntimers, sizeof(timers[0]));
+}
+
+static void
+bench(void *arg ISC_ATTR_UNUSED) {
+	printf("%zu timers, %u restarts\n\n", ntimers, RESTARTS);
+	printf("%8s | %9s | %10s | %8s\n", "timers", "start ns", "restart ns",
+	       "stop ns");
+
+	run(false);
+	run(true);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+int
+main(int argc, char *argv[]) {
+	if (argc > 1) {
+		ntimers = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2 || ntimers == 0) {
+		fprintf(stderr, "usage: timer-restart [timers]\n");
+		exit(1);
+	}
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, 1, &loopmgr);
+
+	isc_loop_setup(isc_loop_main(loopmgr), bench, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
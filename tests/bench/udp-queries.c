@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the throughput of outgoing UDP queries sent through a dispatch,
+ * to a server on the loopback interface that echoes the query header
+ * back, with a new socket for every query and with the sockets kept for
+ * reuse (see dns_dispatchmgr_setudpreuse()).
+ */
+
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <isc/async.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/sockaddr.h>
+#include <isc/stats.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/dispatch.h>
+#include <dns/stats.h>
+
+#define CONCURRENCY 64
+#define TIMEOUT	    2000
+
+typedef struct query {
+	dns_dispentry_t *resp;
+	unsigned char buf[12];
+	isc_region_t region;
+} query_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_nmsocket_t *server = NULL;
+static isc_sockaddr_t server_addr;
+static dns_dispatchmgr_t *dispatchmgr = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_stats_t *stats = NULL;
+
+static query_t queries[CONCURRENCY];
+static size_t nqueries = 100000;
+static size_t sent, answered, failed, running;
+static unsigned int reuses[] = { 0, 10, 100 };
+static size_t phase = 0;
+static isc_time_t start;
+
+static void
+send_query(void *arg);
+
+static void
+server_senddone(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
+	UNUSED(handle);
+	UNUSED(eresult);
+
+	isc_mem_put(mctx, arg, 12);
+}
+
+static void
+server_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
+	    void *arg) {
+	unsigned char *buf = NULL;
+	isc_region_t response;
+
+	UNUSED(arg);
+
+	if (eresult != ISC_R_SUCCESS || region->length < 12) {
+		return;
+	}
+
+	/* there can be several responses in flight */
+	buf = isc_mem_get(mctx, 12);
+	memmove(buf, region->base, 12);
+	buf[2] |= 0x80; /* qr=1 */
+	response = (isc_region_t){ buf, 12 };
+	isc_nm_send(handle, &response, server_senddone, buf);
+}
+
+static void
+connected(isc_result_t eresult, isc_region_t *region, void *arg) {
+	query_t *query = arg;
+
+	UNUSED(region);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+	dns_dispatch_send(query->resp, &query->region);
+}
+
+static void
+senddone(isc_result_t eresult, isc_region_t *region, void *arg) {
+	UNUSED(eresult);
+	UNUSED(region);
+	UNUSED(arg);
+}
+
+static void
+finish_phase(void);
+
+static void
+response(isc_result_t eresult, isc_region_t *region, void *arg) {
+	query_t *query = arg;
+
+	UNUSED(region);
+
+	if (eresult == ISC_R_SUCCESS) {
+		answered++;
+	} else {
+		failed++;
+	}
+	dns_dispatch_done(&query->resp);
+
+	/* Let the dispatch release the socket before sending the next one */
+	if (sent < nqueries) {
+		isc_async_run(isc_loop_main(loopmgr), send_query, query);
+	} else if (--running == 0) {
+		finish_phase();
+	}
+}
+
+static void
+send_query(void *arg) {
+	query_t *query = arg;
+	dns_messageid_t id;
+	isc_result_t result;
+
+	sent++;
+	result = dns_dispatch_add(dispatch, isc_loop_main(loopmgr), 0, TIMEOUT,
+				  &server_addr, NULL, NULL, connected,
+				  senddone, response, query, &id,
+				  &query->resp);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	memset(query->buf, 0, sizeof(query->buf));
+	query->buf[0] = (id >> 8) & 0xff;
+	query->buf[1] = id & 0xff;
+	query->region = (isc_region_t){ query->buf, sizeof(query->buf) };
+
+	dns_dispatch_connect(query->resp);
+}
+
+static void
+start_phase(void *arg ISC_ATTR_UNUSED) {
+	dns_dispatchmgr_setudpreuse(dispatchmgr, reuses[phase]);
+	isc_stats_set(stats, 0, dns_resstatscounter_dispsockreuse);
+
+	sent = answered = failed = 0;
+	running = CONCURRENCY;
+	start = isc_time_now_hires();
+	for (size_t i = 0; i < CONCURRENCY; i++) {
+		send_query(&queries[i]);
+	}
+}
+
+static void
+finish_phase(void) {
+	isc_time_t finish = isc_time_now_hires();
+	uint64_t us = isc_time_microdiff(&finish, &start);
+
+	printf("%8u | %10.0f | %8zu | %8zu | %8" PRIu64 "\n", reuses[phase],
+	       (double)answered * 1000000.0 / us, answered, failed,
+	       isc_stats_get_counter(stats,
+				     dns_resstatscounter_dispsockreuse));
+
+	if (++phase < ARRAY_SIZE(reuses)) {
+		isc_async_run(isc_loop_main(loopmgr), start_phase, NULL);
+		return;
+	}
+
+	dns_dispatch_detach(&dispatch);
+	dns_dispatchmgr_detach(&dispatchmgr);
+	isc_nm_stoplistening(server);
+	isc_nmsocket_close(&server);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+setup(void *arg ISC_ATTR_UNUSED) {
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	result = isc_nm_listenudp(netmgr, ISC_NM_LISTEN_ONE, &server_addr,
+				  server_recv, NULL, &server);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_dispatchmgr_create(mctx, netmgr, &dispatchmgr);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	isc_stats_create(mctx, &stats, dns_resstatscounter_max);
+	dns_dispatchmgr_setstats(dispatchmgr, stats);
+
+	isc_sockaddr_fromin6(&local, &in6addr_loopback, 0);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	printf("%zu queries, %u in flight\n\n", nqueries, CONCURRENCY);
+	printf("%8s | %10s | %8s | %8s | %8s\n", "reuse", "queries/s",
+	       "answered", "failed", "reused");
+
+	start_phase(NULL);
+}
+
+/*
+ * Find a free UDP port on the loopback interface for the server.
+ */
+static void
+server_port(void) {
+	socklen_t len = sizeof(server_addr.type.sin6);
+	int fd;
+
+	isc_sockaddr_fromin6(&server_addr, &in6addr_loopback, 0);
+	fd = socket(AF_INET6, SOCK_DGRAM, 0);
+	RUNTIME_CHECK(fd >= 0);
+	RUNTIME_CHECK(bind(fd, &server_addr.type.sa, len) == 0);
+	RUNTIME_CHECK(getsockname(fd, &server_addr.type.sa, &len) == 0);
+	close(fd);
+}
+
+int
+main(int argc, char *argv[]) {
+	if (argc > 1) {
+		nqueries = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2 || nqueries < CONCURRENCY) {
+		fprintf(stderr, "usage: udp-queries [queries]\n");
+		exit(1);
+	}
+
+	server_port();
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, 1, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+
+	isc_loop_setup(isc_loop_main(loopmgr), setup, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_stats_detach(&stats);
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
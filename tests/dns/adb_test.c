@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/net.h>
+#include <isc/sockaddr.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/dispatch.h>
+#include <dns/view.h>
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "adb.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+static dns_view_t *view = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static dns_adb_t *adb = NULL;
+
+static void
+mkadb(void) {
+	isc_result_t result;
+	isc_sockaddr_t local;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+
+	result = dns_test_makeview("view", true, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dispatchmgr = dns_view_getdispatchmgr(view);
+	assert_non_null(dispatchmgr);
+	isc_sockaddr_any(&local);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, loopmgr, 1, netmgr, 0,
+					 tlsctx_cache, dispatch, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_view_getadb(view, &adb);
+	assert_non_null(adb);
+}
+
+static void
+destroy_adb(void) {
+	dns_adb_detach(&adb);
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static dns_adbaddrinfo_t *
+getaddr(const char *text) {
+	isc_sockaddr_t sa;
+	struct in_addr in;
+	dns_adbaddrinfo_t *addr = NULL;
+
+	RUNTIME_CHECK(inet_pton(AF_INET, text, &in) == 1);
+	isc_sockaddr_fromin(&sa, &in, 53);
+	assert_int_equal(dns_adb_findaddrinfo(adb, &sa, &addr, 0),
+			 ISC_R_SUCCESS);
+
+	return (addr);
+}
+
+static void
+samples(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int n) {
+	for (unsigned int i = 0; i < n; i++) {
+		dns_adb_rttsample(adb, addr, rtt);
+	}
+}
+
+/* the 90th percentile is recalculated every ADB_RTT_UPDATE samples */
+ISC_LOOP_TEST_IMPL(p90) {
+	dns_adbaddrinfo_t *addr = NULL;
+
+	mkadb();
+	addr = getaddr("192.0.2.1");
+
+	samples(addr, 10000, ADB_RTT_UPDATE - 1);
+	assert_int_equal(addr->entry->rttp90, 0);
+	assert_int_equal(addr->score, addr->entry->srtt);
+
+	samples(addr, 10000, 1);
+	assert_in_range(addr->entry->rttp90, 8000, 12500);
+	assert_int_equal(addr->score,
+			 ISC_MAX(addr->entry->rttp90, addr->entry->srtt));
+
+	/* half of the samples are slower now */
+	samples(addr, 100000, ADB_RTT_UPDATE);
+	assert_in_range(addr->entry->rttp90, 80000, 125000);
+
+	dns_adb_freeaddrinfo(adb, &addr);
+	destroy_adb();
+}
+
+/* the histogram ages together with the 90th percentile */
+ISC_LOOP_TEST_IMPL(p90_age) {
+	dns_adbaddrinfo_t *addr = NULL;
+	unsigned int aged;
+
+	mkadb();
+	addr = getaddr("192.0.2.1");
+
+	samples(addr, 100000, ADB_RTT_UPDATE);
+	assert_in_range(addr->entry->rttp90, 80000, 125000);
+
+	/*
+	 * Age the entry for long enough that the histogram has to be
+	 * rebuilt, then answer as fast as the aged percentile: it does
+	 * not snap back to the old samples.
+	 */
+	for (isc_stdtime_t now = 1; now <= 400; now++) {
+		dns_adb_agesrtt(adb, addr, now);
+	}
+	aged = addr->entry->rttp90;
+	assert_true(aged < 60000);
+	assert_true(addr->entry->rttscale > ADB_SCALE_ONE / 2);
+
+	samples(addr, aged, ADB_RTT_UPDATE);
+	assert_in_range(addr->entry->rttp90, aged * 3 / 4, aged * 5 / 4);
+
+	/* the histogram still decays when it is full */
+	samples(addr, aged, ADB_RTT_WINDOW - 2 * ADB_RTT_UPDATE);
+	assert_true(addr->entry->rttsamples < ADB_RTT_WINDOW);
+	assert_in_range(addr->entry->rttp90, aged * 3 / 4, aged * 5 / 4);
+
+	dns_adb_freeaddrinfo(adb, &addr);
+	destroy_adb();
+}
+
+/* a timeout sorts a server with a good 90th percentile behind another */
+ISC_LOOP_TEST_IMPL(timeout_score) {
+	dns_adbaddrinfo_t *fast = NULL, *slow = NULL;
+
+	mkadb();
+	fast = getaddr("192.0.2.1");
+	slow = getaddr("192.0.2.2");
+
+	samples(fast, 10000, ADB_RTT_UPDATE);
+	dns_adb_adjustsrtt(adb, fast, 10000, DNS_ADB_RTTADJREPLACE);
+	dns_adb_adjustsrtt(adb, slow, 200000, DNS_ADB_RTTADJREPLACE);
+	assert_true(fast->score < slow->score);
+
+	/*
+	 * What the resolver does when a query times out: the failure
+	 * rate alone would not be enough, the SRTT penalty is.
+	 */
+	dns_adb_ednsto(adb, fast);
+	assert_true(fast->score < slow->score);
+	dns_adb_adjustsrtt(adb, fast, fast->srtt + 0x3ffff,
+			   DNS_ADB_RTTADJREPLACE);
+	assert_true(fast->score > slow->score);
+
+	dns_adb_freeaddrinfo(adb, &fast);
+	dns_adb_freeaddrinfo(adb, &slow);
+	destroy_adb();
+}
+
+/* the failure rate is a moving average of the timeouts */
+ISC_LOOP_TEST_IMPL(failrate) {
+	dns_adbaddrinfo_t *addr = NULL;
+	unsigned int score;
+	int n;
+
+	mkadb();
+	addr = getaddr("192.0.2.1");
+
+	samples(addr, 10000, ADB_RTT_UPDATE);
+	assert_int_equal(addr->entry->failrate, 0);
+	score = addr->score;
+
+	/* it takes 11 timeouts in a row for the failure rate to pass 50% */
+	for (n = 0; n < 10; n++) {
+		dns_adb_timeout(adb, addr);
+		assert_true(addr->score > score);
+		score = addr->score;
+	}
+	assert_false(addr->entry->unhealthy);
+	dns_adb_timeout(adb, addr);
+	assert_true(addr->entry->unhealthy);
+	assert_true(addr->entry->failrate >= ADB_UNHEALTHY);
+
+	/* and answers bring it back down */
+	for (n = 0; addr->entry->unhealthy; n++) {
+		samples(addr, 10000, 1);
+		assert_true(addr->score < score);
+		score = addr->score;
+	}
+	assert_in_range(n, 1, 2);
+	assert_true(addr->entry->failrate < ADB_UNHEALTHY);
+
+	dns_adb_freeaddrinfo(adb, &addr);
+	destroy_adb();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(p90, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(p90_age, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(timeout_score, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(failrate, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/cache.h>
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+
+#include <tests/dns.h>
+
+#define SNAPSHOT "cache_test.snapshot"
+
+static void
+addrdataset(dns_cache_t *cache, const dns_name_t *name, dns_ttl_t ttl,
+	    dns_trust_t trust, isc_stdtime_t now) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	unsigned char data[4] = { 192, 0, 2, 1 };
+	isc_region_t r = { .base = data, .length = sizeof(data) };
+
+	dns_rdata_fromregion(&rdata, dns_rdataclass_in, dns_rdatatype_a, &r);
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.ttl = ttl;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	rdataset.trust = trust;
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_findnode(db, name, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detach(&db);
+}
+
+static isc_result_t
+findrdataset(dns_cache_t *cache, const dns_name_t *name, isc_stdtime_t now,
+	     dns_rdataset_t *rdataset) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_findnode(db, name, false, &node);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a,
+					     0, now, rdataset, NULL);
+		dns_db_detachnode(db, &node);
+	}
+	dns_db_detach(&db);
+
+	return (result);
+}
+
+/* the contents of a cache survive a dump and load */
+ISC_LOOP_TEST_IMPL(snapshot) {
+	isc_result_t result;
+	dns_cache_t *cache = NULL;
+	dns_fixedname_t f1, f2;
+	dns_name_t *name1 = dns_fixedname_initname(&f1);
+	dns_name_t *name2 = dns_fixedname_initname(&f2);
+	dns_rdataset_t rdataset;
+	isc_stdtime_t now = isc_stdtime_now();
+
+	dns_name_fromstring(name1, "www.example.", NULL, 0, NULL);
+	dns_name_fromstring(name2, "mail.example.", NULL, 0, NULL);
+
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "test", &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	addrdataset(cache, name1, 3600, dns_trust_answer, now);
+	addrdataset(cache, name2, 600, dns_trust_additional, now);
+
+	(void)isc_file_remove(SNAPSHOT);
+	result = dns_cache_dumpsnapshot(cache, SNAPSHOT);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_cache_detach(&cache);
+
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "test", &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 3600);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdataset_init(&rdataset);
+	result = findrdataset(cache, name1, now, &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(rdataset.trust, dns_trust_answer);
+	assert_true(rdataset.ttl <= 3600 && rdataset.ttl > 3500);
+	assert_int_equal(dns_rdataset_count(&rdataset), 1);
+	dns_rdataset_disassociate(&rdataset);
+
+	result = findrdataset(cache, name2, now, &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(rdataset.trust, dns_trust_additional);
+	assert_true(rdataset.ttl <= 600 && rdataset.ttl > 500);
+	dns_rdataset_disassociate(&rdataset);
+
+	/* the RRsets that have expired since the dump are not loaded */
+	dns_cache_detach(&cache);
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "test", &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	addrdataset(cache, name1, 1, dns_trust_answer, now);
+	result = dns_cache_dumpsnapshot(cache, SNAPSHOT);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_cache_detach(&cache);
+
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "test", &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	while (isc_stdtime_now() < now + 1) {
+		/* wait for the RRset to expire */
+		usleep(10000);
+	}
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 3600);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = findrdataset(cache, name1, isc_stdtime_now(), &rdataset);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* nor are the snapshots older than the maximum age */
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 0);
+	assert_int_equal(result, DNS_R_EXPIRED);
+
+	dns_cache_detach(&cache);
+	(void)isc_file_remove(SNAPSHOT);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/* files that are not snapshots are rejected */
+ISC_LOOP_TEST_IMPL(badsnapshot) {
+	isc_result_t result;
+	dns_cache_t *cache = NULL;
+	FILE *fp = NULL;
+
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "test", &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	(void)isc_file_remove(SNAPSHOT);
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 3600);
+	assert_int_equal(result, ISC_R_FILENOTFOUND);
+
+	fp = fopen(SNAPSHOT, "w");
+	assert_non_null(fp);
+	fputs("www.example. 3600 IN A 192.0.2.1\n", fp);
+	fclose(fp);
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 3600);
+	assert_int_equal(result, DNS_R_FORMERR);
+
+	/* a snapshot cut short in the middle of a record */
+	result = dns_cache_dumpsnapshot(cache, SNAPSHOT);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	fp = fopen(SNAPSHOT, "a");
+	assert_non_null(fp);
+	fputs("\003www", fp);
+	fclose(fp);
+	result = dns_cache_loadsnapshot(cache, SNAPSHOT, 3600);
+	assert_int_equal(result, DNS_R_FORMERR);
+
+	dns_cache_detach(&cache);
+	(void)isc_file_remove(SNAPSHOT);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(snapshot, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(badsnapshot, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
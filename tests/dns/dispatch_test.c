@@ -24,6 +24,7 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/async.h>
 #include <isc/buffer.h>
 #include <isc/managers.h>
 #include <isc/refcount.h>
@@ -657,6 +658,174 @@ ISC_LOOP_TEST_IMPL(dispatch_getnext) {
 	dns_dispatch_connect(dispentry);
 }
 
+static void
+echo_nameserver(isc_nmhandle_t *handle, isc_result_t eresult,
+		isc_region_t *region, void *cbarg ISC_ATTR_UNUSED) {
+	static unsigned char buf[12];
+	isc_region_t response = { buf, sizeof(buf) };
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	memmove(buf, region->base, sizeof(buf));
+	buf[2] |= 0x80; /* qr=1 */
+	isc_nm_send(handle, &response, server_senddone, NULL);
+}
+
+static unsigned int reuse_queries = 0;
+static in_port_t reuse_port = 0;
+
+static void
+reuse_query(void *arg);
+
+static void
+reuse_connected(isc_result_t eresult, isc_region_t *region, void *cbarg) {
+	isc_region_t *r = (isc_region_t *)cbarg;
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	UNUSED(region);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	result = dns_dispentry_getlocaladdress(dispentry, &local);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	if (reuse_queries == 0) {
+		reuse_port = isc_sockaddr_getport(&local);
+	} else {
+		assert_int_equal(isc_sockaddr_getport(&local), reuse_port);
+	}
+
+	dns_dispatch_send(dispentry, r);
+}
+
+static void
+reuse_response(isc_result_t eresult, isc_region_t *region, void *arg) {
+	UNUSED(region);
+	UNUSED(arg);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+	dns_dispatch_done(&dispentry);
+
+	if (++reuse_queries < 3) {
+		/* the socket is returned to the pool after this callback */
+		isc_async_run(isc_loop_main(loopmgr), reuse_query, NULL);
+	} else {
+		dns_dispatch_detach(&dispatch);
+		isc_loopmgr_shutdown(loopmgr);
+	}
+}
+
+static void
+reuse_query(void *arg ISC_ATTR_UNUSED) {
+	isc_result_t result;
+	uint16_t id;
+
+	result = dns_dispatch_add(
+		dispatch, isc_loop_main(loopmgr), 0, T_CLIENT_CONNECT,
+		&udp_server_addr, NULL, NULL, reuse_connected, client_senddone,
+		reuse_response, &testdata.region, &id, &dispentry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	testdata.message[0] = (id >> 8) & 0xff;
+	testdata.message[1] = id & 0xff;
+
+	dns_dispatch_connect(dispentry);
+}
+
+/* test that the UDP socket is reused for the following queries */
+ISC_LOOP_TEST_IMPL(dispatch_udp_reuse) {
+	isc_result_t result;
+
+	/* Server */
+	result = isc_nm_listenudp(netmgr, ISC_NM_LISTEN_ONE, &udp_server_addr,
+				  echo_nameserver, NULL, &sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_loop_teardown(isc_loop_main(loopmgr), stop_listening, sock);
+
+	/* Client */
+	testdata.region.base = testdata.message;
+	testdata.region.length = sizeof(testdata.message);
+
+	result = dns_dispatchmgr_create(mctx, connect_nm, &dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_setudpreuse(dispatchmgr, 10);
+
+	result = dns_dispatch_createudp(dispatchmgr, &udp_connect_addr,
+					&dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	reuse_query(NULL);
+}
+
+static isc_result_t
+qid_add(uint16_t id, dns_dispentry_t **respp) {
+	isc_result_t result;
+	uint16_t fixed = id;
+
+	result = dns_dispatch_add(dispatch, isc_loop_main(loopmgr),
+				  DNS_DISPATCHOPT_FIXEDID, T_CLIENT_CONNECT,
+				  &tcp_server_addr, NULL, NULL, connected,
+				  client_senddone, response, NULL, &id, respp);
+	if (result == ISC_R_SUCCESS) {
+		assert_int_equal(id, fixed);
+	}
+
+	return (result);
+}
+
+ISC_LOOP_TEST_IMPL(dispatch_qid) {
+	isc_result_t result;
+	dns_dispentry_t *resps[3000] = { NULL };
+	dns_dispentry_t *dup = NULL;
+
+	result = dns_dispatchmgr_create(mctx, connect_nm, &dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dispatch_createtcp(dispatchmgr, &tcp_connect_addr,
+					&tcp_server_addr, &dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	/* Enough entries to make the query ID table grow */
+	for (size_t i = 0; i < ARRAY_SIZE(resps); i++) {
+		result = qid_add(i, &resps[i]);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	/* Every ID in use is found */
+	for (size_t i = 0; i < ARRAY_SIZE(resps); i += 7) {
+		result = qid_add(i, &dup);
+		assert_int_equal(result, ISC_R_NOMORE);
+		assert_null(dup);
+	}
+
+	/* The released IDs can be used again, the others still can't */
+	for (size_t i = 0; i < ARRAY_SIZE(resps); i += 2) {
+		dns_dispatch_done(&resps[i]);
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(resps); i++) {
+		result = qid_add(i, &dup);
+		if (i % 2 == 0) {
+			assert_int_equal(result, ISC_R_SUCCESS);
+			resps[i] = dup;
+			dup = NULL;
+		} else {
+			assert_int_equal(result, ISC_R_NOMORE);
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(resps); i++) {
+		dns_dispatch_done(&resps[i]);
+	}
+	dns_dispatch_detach(&dispatch);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(dispatch_timeout_udp_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatchset_create, setup_test, teardown_test)
@@ -666,6 +835,8 @@ ISC_TEST_ENTRY_CUSTOM(dispatch_timeout_tcp_connect, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tcp_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tls_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_getnext, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_udp_reuse, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_qid, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
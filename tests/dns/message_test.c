@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+
+#include <tests/dns.h>
+
+/*
+ * www.example.com/AAAA with RD set.
+ */
+static const unsigned char query[] = {
+	0xab, 0xcd, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x03, 'w',	'w',  'w',  0x07, 'e',	'x',  'a',
+	'm',  'p',  'l',  'e',	0x03, 'c',  'o',  'm',	0x00, 0x00,
+	0x1c, 0x00, 0x01
+};
+
+/*
+ * OPT record: UDP size 1232, extended rcode 1, version 0, DO set, and
+ * an 8 byte client cookie.
+ */
+static const unsigned char opt[] = { 0x00, 0x00, 0x29, 0x04, 0xd0, 0x01,
+				     0x00, 0x80, 0x00, 0x00, 0x0c, 0x00,
+				     0x0a, 0x00, 0x08, 1,    2,	   3,
+				     4,	   5,	 6,    7,    8 };
+
+static isc_result_t
+parse(dns_message_t *msg, const unsigned char *wire, size_t len) {
+	isc_buffer_t b;
+
+	isc_buffer_constinit(&b, wire, len);
+	isc_buffer_add(&b, len);
+	return (dns_message_parse(msg, &b, 0));
+}
+
+static void
+check_question(dns_message_t *msg) {
+	dns_fixedname_t fixed;
+	dns_name_t *expected = dns_fixedname_initname(&fixed);
+	dns_name_t *qname = NULL;
+	dns_rdataset_t *rdataset = NULL;
+	dns_name_t suffix;
+
+	dns_name_fromstring(expected, "www.example.com.", NULL, 0, NULL);
+
+	assert_int_equal(dns_message_firstname(msg, DNS_SECTION_QUESTION),
+			 ISC_R_SUCCESS);
+	dns_message_currentname(msg, DNS_SECTION_QUESTION, &qname);
+	assert_true(dns_name_equal(qname, expected));
+	assert_true(dns_name_isabsolute(qname));
+	assert_int_equal(dns_name_countlabels(qname), 4);
+
+	/* the offsets are usable */
+	dns_name_init(&suffix, NULL);
+	dns_name_getlabelsequence(qname, 1, 3, &suffix);
+	dns_name_fromstring(expected, "example.com.", NULL, 0, NULL);
+	assert_true(dns_name_equal(&suffix, expected));
+
+	rdataset = ISC_LIST_HEAD(qname->list);
+	assert_non_null(rdataset);
+	assert_int_equal(rdataset->type, dns_rdatatype_aaaa);
+	assert_int_equal(rdataset->rdclass, dns_rdataclass_in);
+	assert_true((rdataset->attributes & DNS_RDATASETATTR_QUESTION) != 0);
+	assert_null(ISC_LIST_NEXT(rdataset, link));
+
+	assert_int_equal(dns_message_nextname(msg, DNS_SECTION_QUESTION),
+			 ISC_R_NOMORE);
+	assert_int_equal(msg->rdclass, dns_rdataclass_in);
+}
+
+/* a query with a single question */
+ISC_RUN_TEST_IMPL(parse_query) {
+	dns_message_t *msg = NULL;
+
+	dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	assert_int_equal(parse(msg, query, sizeof(query)), ISC_R_SUCCESS);
+	assert_int_equal(msg->id, 0xabcd);
+	assert_int_equal(msg->flags, DNS_MESSAGEFLAG_RD);
+	check_question(msg);
+	assert_null(dns_message_getopt(msg));
+
+	dns_message_detach(&msg);
+}
+
+/* a query with an OPT record */
+ISC_RUN_TEST_IMPL(parse_query_opt) {
+	dns_message_t *msg = NULL;
+	dns_rdataset_t *optset = NULL;
+	unsigned char wire[sizeof(query) + sizeof(opt)];
+
+	memmove(wire, query, sizeof(query));
+	memmove(wire + sizeof(query), opt, sizeof(opt));
+	wire[11] = 1; /* ARCOUNT */
+
+	dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	assert_int_equal(parse(msg, wire, sizeof(wire)), ISC_R_SUCCESS);
+	check_question(msg);
+
+	optset = dns_message_getopt(msg);
+	assert_non_null(optset);
+	assert_int_equal(optset->type, dns_rdatatype_opt);
+	assert_int_equal(optset->rdclass, 1232);
+	assert_int_equal(optset->ttl, 0x01008000);
+	assert_int_equal(dns_rdataset_count(optset), 1);
+	assert_int_equal(msg->rcode, 1 << 4);
+
+	/* the message can be reused */
+	dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	assert_int_equal(parse(msg, wire, sizeof(wire)), ISC_R_SUCCESS);
+	check_question(msg);
+
+	/* truncated OPT rdata */
+	dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	assert_int_equal(parse(msg, wire, sizeof(wire) - 1),
+			 ISC_R_UNEXPECTEDEND);
+
+	dns_message_detach(&msg);
+}
+
+/* the OPT owner name must be the root */
+ISC_RUN_TEST_IMPL(parse_query_badopt) {
+	dns_message_t *msg = NULL;
+	unsigned char wire[sizeof(query) + sizeof(opt) + 1];
+
+	memmove(wire, query, sizeof(query));
+	wire[11] = 1; /* ARCOUNT */
+	wire[sizeof(query)] = 0xc0;
+	wire[sizeof(query) + 1] = 0x0c;
+	memmove(wire + sizeof(query) + 2, opt + 1, sizeof(opt) - 1);
+
+	dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+	assert_int_equal(parse(msg, wire, sizeof(wire)), DNS_R_FORMERR);
+	dns_message_detach(&msg);
+}
+
+/* malformed questions are still rejected */
+ISC_RUN_TEST_IMPL(parse_query_bad) {
+	dns_message_t *msg = NULL;
+	unsigned char wire[sizeof(query)];
+
+	dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	/* truncated question */
+	assert_int_equal(parse(msg, query, sizeof(query) - 1),
+			 ISC_R_UNEXPECTEDEND);
+
+	/* truncated name */
+	dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	assert_int_equal(parse(msg, query, 20), ISC_R_UNEXPECTEDEND);
+
+	/* bad label type */
+	dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	memmove(wire, query, sizeof(query));
+	wire[16] = 0x47;
+	assert_int_equal(parse(msg, wire, sizeof(wire)), DNS_R_BADLABELTYPE);
+
+	dns_message_detach(&msg);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(parse_query)
+ISC_TEST_ENTRY(parse_query_opt)
+ISC_TEST_ENTRY(parse_query_badopt)
+ISC_TEST_ENTRY(parse_query_bad)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
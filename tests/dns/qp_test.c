@@ -359,11 +359,91 @@ ISC_RUN_TEST_IMPL(partialmatch) {
 	dns_qp_destroy(&qp);
 }
 
+struct check_predecessor {
+	const char *query;
+	isc_result_t result;
+	const char *found;
+};
+
+static void
+check_predecessor(dns_qp_t *qp, struct check_predecessor check[]) {
+	for (int i = 0; check[i].query != NULL; i++) {
+		isc_result_t result;
+		dns_fixedname_t fixed;
+		dns_name_t *name = dns_fixedname_name(&fixed);
+		void *pval = NULL;
+
+		dns_test_namefromstring(check[i].query, &fixed);
+		result = dns_qp_findname_predecessor(qp, name, &pval, NULL);
+		assert_int_equal(result, check[i].result);
+		if (check[i].found == NULL) {
+			assert_null(pval);
+		} else {
+			assert_string_equal(pval, check[i].found);
+		}
+	}
+}
+
+ISC_RUN_TEST_IMPL(predecessor) {
+	dns_qp_t *qp = NULL;
+
+	dns_qp_create(mctx, &string_methods, NULL, &qp);
+
+	/*
+	 * Fixed size strings [16] should ensure leaf-compatible alignment.
+	 */
+	const char insert[][16] = {
+		"a.b.",	     "b.",	     "fo.bar.", "foo.bar.",
+		"fooo.bar.", "web.foo.bar.", ".",
+	};
+
+	int i = 0;
+	while (insert[i][0] != '.') {
+		insert_str(qp, insert[i++]);
+	}
+
+	/* in DNS order: b. a.b. fo.bar. foo.bar. web.foo.bar. fooo.bar. */
+	static struct check_predecessor check1[] = {
+		{ ".", ISC_R_NOTFOUND, NULL },
+		{ "a.", ISC_R_NOTFOUND, NULL },
+		{ "b.", ISC_R_SUCCESS, "b." },
+		{ "0.b.", DNS_R_PARTIALMATCH, "b." },
+		{ "a.b.", ISC_R_SUCCESS, "a.b." },
+		{ "c.b.", DNS_R_PARTIALMATCH, "a.b." },
+		{ "bar.", DNS_R_PARTIALMATCH, "a.b." },
+		{ "f.bar.", DNS_R_PARTIALMATCH, "a.b." },
+		{ "foo.bar.", ISC_R_SUCCESS, "foo.bar." },
+		{ "a.foo.bar.", DNS_R_PARTIALMATCH, "foo.bar." },
+		{ "www.foo.bar.", DNS_R_PARTIALMATCH, "web.foo.bar." },
+		{ "my.web.foo.bar.", DNS_R_PARTIALMATCH, "web.foo.bar." },
+		{ "fooa.bar.", DNS_R_PARTIALMATCH, "web.foo.bar." },
+		{ "z.bar.", DNS_R_PARTIALMATCH, "fooo.bar." },
+		{ "example.", DNS_R_PARTIALMATCH, "fooo.bar." },
+		{ NULL, 0, NULL },
+	};
+	check_predecessor(qp, check1);
+
+	/* the root precedes every other name */
+	INSIST(insert[i][0] == '.');
+	insert_str(qp, insert[i++]);
+
+	static struct check_predecessor check2[] = {
+		{ ".", ISC_R_SUCCESS, "." },
+		{ "a.", DNS_R_PARTIALMATCH, "." },
+		{ "0.b.", DNS_R_PARTIALMATCH, "b." },
+		{ NULL, 0, NULL },
+	};
+	check_predecessor(qp, check2);
+
+	dns_qp_destroy(&qp);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(qpkey_name)
 ISC_TEST_ENTRY(qpkey_sort)
 ISC_TEST_ENTRY(qpiter)
 ISC_TEST_ENTRY(partialmatch)
+ISC_TEST_ENTRY(predecessor)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -379,11 +379,260 @@ ISC_RUN_TEST_IMPL(overmempurge_longname) {
 	isc_mem_destroy(&mctx2);
 }
 
+static unsigned int
+expirewheel_count(dns_rbtdb_t *rbtdb) {
+	unsigned int count = 0;
+
+	for (unsigned int i = 0; i < rbtdb->node_lock_count; i++) {
+		count += rbtdb->expire[i].count;
+	}
+
+	return (count);
+}
+
+static void
+expirewheel_sweep(dns_rbtdb_t *rbtdb, isc_stdtime_t now) {
+	for (unsigned int i = 0; i < rbtdb->node_lock_count; i++) {
+		isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
+		isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+
+		NODE_WRLOCK(&rbtdb->node_locks[i].lock, &nlocktype);
+		(void)dns__cachedb_expirettl(rbtdb, i, now, UINT_MAX,
+					     &tlocktype DNS__DB_FILELINE);
+		NODE_UNLOCK(&rbtdb->node_locks[i].lock, &nlocktype);
+	}
+}
+
+/* headers stay on the expiry wheels until their TTL has passed */
+ISC_RUN_TEST_IMPL(expirewheel) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_stats_t *stats = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	dns_rbtdb_t *rbtdb = NULL;
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_stats_create(mctx, &stats, dns_cachestatscounter_max);
+	dns_db_setcachestats(db, stats);
+	rbtdb = (dns_rbtdb_t *)db;
+
+	for (int i = 0; i < 100; i++) {
+		overmempurge_addrdataset(db, now, i, 50053, 16, false);
+	}
+	assert_int_equal(expirewheel_count(rbtdb), 100);
+
+	/* the records have a TTL of 3600 */
+	expirewheel_sweep(rbtdb, now + 3600);
+	assert_int_equal(expirewheel_count(rbtdb), 100);
+	expirewheel_sweep(rbtdb, now + 3600 + RBTDB_VIRTUAL);
+	assert_int_equal(expirewheel_count(rbtdb), 100);
+	assert_int_equal(
+		isc_stats_get_counter(stats, dns_cachestatscounter_deletettl),
+		0);
+
+	expirewheel_sweep(rbtdb, now + 3600 + RBTDB_VIRTUAL + 1);
+	assert_int_equal(expirewheel_count(rbtdb), 0);
+	assert_int_equal(
+		isc_stats_get_counter(stats, dns_cachestatscounter_deletettl),
+		100);
+	assert_true(isc_stats_get_counter(
+			    stats, dns_cachestatscounter_reclaimttl) >= 100 * 16);
+
+	dns_db_detach(&db);
+	isc_stats_detach(&stats);
+}
+
+static uint64_t
+getstat(isc_stats_t *stats, isc_statscounter_t counter) {
+	return (isc_stats_get_counter(stats, counter));
+}
+
+/*
+ * the memory reclaimed by TTL expiry is counted for the headers that are
+ * freed, and only for those, whatever their size and expiry time
+ */
+ISC_RUN_TEST_IMPL(expirewheel_reclaim) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_stats_t *stats = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	dns_rbtdb_t *rbtdb = NULL;
+	dns_fixedname_t fname;
+	dns_dbnode_t *held = NULL, *lru = NULL;
+	isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	dns_rbtnode_t *node = NULL;
+	uint64_t small, large;
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_stats_create(mctx, &stats, dns_cachestatscounter_max);
+	dns_db_setcachestats(db, stats);
+	rbtdb = (dns_rbtdb_t *)db;
+
+	/*
+	 * The records have a TTL of 3600: added half an hour ago, the
+	 * small ones expire half an hour before the large ones.
+	 */
+	for (int i = 0; i < 10; i++) {
+		overmempurge_addrdataset(db, now - 1800, i, 50053, 16, false);
+	}
+	for (int i = 10; i < 21; i++) {
+		overmempurge_addrdataset(db, now, i, 50053, 100, false);
+	}
+	assert_int_equal(expirewheel_count(rbtdb), 21);
+
+	/* a large record is held by a reference */
+	dns_test_namefromstring("10.example.com.", &fname);
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), false, &held);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/*
+	 * Another one is expired for memory while it is held too: it is
+	 * put back on the wheel with a TTL of 0, and then released.
+	 */
+	dns_test_namefromstring("20.example.com.", &fname);
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), false, &lru);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	node = (dns_rbtnode_t *)lru;
+	NODE_WRLOCK(&rbtdb->node_locks[node->locknum].lock, &nlocktype);
+	dns__cachedb_expireheader(node->data, &tlocktype,
+				  dns_expire_lru DNS__DB_FILELINE);
+	NODE_UNLOCK(&rbtdb->node_locks[node->locknum].lock, &nlocktype);
+	assert_int_equal(getstat(stats, dns_cachestatscounter_deletelru), 0);
+
+	/* the record expired for memory is not counted either */
+	expirewheel_sweep(rbtdb, now + 1800 + RBTDB_VIRTUAL + 1);
+	assert_int_equal(expirewheel_count(rbtdb), 10);
+	assert_int_equal(getstat(stats, dns_cachestatscounter_deletettl), 10);
+	small = getstat(stats, dns_cachestatscounter_reclaimttl);
+	assert_int_equal(small % 10, 0);
+	small /= 10;
+	assert_true(small > 16);
+
+	dns_db_detachnode(db, &lru);
+
+	/* the held record is expired, but not freed: it is not counted */
+	expirewheel_sweep(rbtdb, now + 3600 + RBTDB_VIRTUAL + 1);
+	assert_int_equal(expirewheel_count(rbtdb), 0);
+	assert_int_equal(getstat(stats, dns_cachestatscounter_deletettl), 19);
+	large = getstat(stats, dns_cachestatscounter_reclaimttl) - small * 10;
+	assert_int_equal(large % 9, 0);
+	large /= 9;
+	assert_int_equal(large - small, 100 - 16);
+
+	dns_db_detachnode(db, &held);
+	assert_int_equal(getstat(stats, dns_cachestatscounter_deletettl), 19);
+	assert_int_equal(getstat(stats, dns_cachestatscounter_reclaimttl),
+			 small * 10 + large * 9);
+
+	dns_db_detach(&db);
+	isc_stats_detach(&stats);
+}
+
+static void
+prefetch_addrdataset(dns_db_t *db, const dns_name_t *name, isc_stdtime_t now,
+		     unsigned char data, unsigned int options) {
+	isc_result_t result;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_dbnode_t *node = NULL;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	unsigned char rdatabuf[4] = { 192, 0, 2, data };
+	isc_region_t r = { .base = rdatabuf, .length = sizeof(rdatabuf) };
+
+	dns_rdata_fromregion(&rdata, dns_rdataclass_in, dns_rdatatype_a, &r);
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.ttl = 3600;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+
+	result = dns_db_findnode(db, name, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, options,
+				    NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+}
+
+static uint32_t
+prefetch_find(dns_db_t *db, const dns_name_t *name, isc_stdtime_t now) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_rdataset_t rdataset;
+	uint32_t hits;
+
+	dns_rdataset_init(&rdataset);
+	result = dns_db_find(db, name, NULL, dns_rdatatype_a, 0, now, NULL,
+			     dns_fixedname_initname(&fixed), &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	hits = rdataset.hits;
+	dns_rdataset_disassociate(&rdataset);
+
+	return (hits);
+}
+
+/* cache hits are counted, and survive a prefetch */
+ISC_RUN_TEST_IMPL(prefetchhits) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_stats_t *stats = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	dns_fixedname_t fname;
+	dns_name_t *name = NULL;
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_stats_create(mctx, &stats, dns_cachestatscounter_max);
+	dns_db_setcachestats(db, stats);
+
+	dns_test_namefromstring("www.example.com.", &fname);
+	name = dns_fixedname_name(&fname);
+
+	prefetch_addrdataset(db, name, now, 1, 0);
+	for (uint32_t i = 0; i < 10; i++) {
+		assert_int_equal(prefetch_find(db, name, now), i);
+	}
+
+	/* a prefetched RRset keeps half of the hits */
+	prefetch_addrdataset(db, name, now, 2, DNS_DBADD_PREFETCH);
+	assert_int_equal(
+		isc_stats_get_counter(stats, dns_cachestatscounter_prefetched),
+		1);
+	assert_int_equal(isc_stats_get_counter(
+				 stats, dns_cachestatscounter_prefetchused),
+			 0);
+	assert_int_equal(prefetch_find(db, name, now), 5);
+	assert_int_equal(prefetch_find(db, name, now), 6);
+	assert_int_equal(isc_stats_get_counter(
+				 stats, dns_cachestatscounter_prefetchused),
+			 1);
+
+	/* the count saturates */
+	for (uint32_t i = 0; i < 2 * DNS_SLABHEADER_MAXHITS; i++) {
+		(void)prefetch_find(db, name, now);
+	}
+	assert_int_equal(prefetch_find(db, name, now), DNS_SLABHEADER_MAXHITS);
+
+	dns_db_detach(&db);
+	isc_stats_detach(&stats);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(ownercase)
 ISC_TEST_ENTRY(setownercase)
 ISC_TEST_ENTRY(overmempurge_bigrdata)
 ISC_TEST_ENTRY(overmempurge_longname)
+ISC_TEST_ENTRY(expirewheel)
+ISC_TEST_ENTRY(expirewheel_reclaim)
+ISC_TEST_ENTRY(prefetchhits)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/result.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/message.h>
+#include <dns/rendercache.h>
+
+#include <tests/dns.h>
+
+static unsigned char section[] = { 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+				   0x00, 0x00, 0x0e, 0x10, 0x00, 0x04,
+				   192,	 0,    2,    1 };
+
+static void
+makemsg(dns_message_t **msgp) {
+	dns_message_t *msg = NULL;
+
+	dns_message_create(mctx, DNS_MESSAGE_INTENTRENDER, &msg);
+	msg->flags = DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA |
+		     DNS_MESSAGEFLAG_RA;
+	msg->rcode = dns_rcode_noerror;
+	msg->counts[DNS_SECTION_QUESTION] = 1;
+	msg->counts[DNS_SECTION_ANSWER] = 1;
+	*msgp = msg;
+}
+
+static void
+region(isc_region_t *r, const char *s) {
+	r->base = (unsigned char *)s;
+	r->length = strlen(s);
+}
+
+/* answers are found under their key for the version they were added for */
+ISC_RUN_TEST_IMPL(rendercache_find) {
+	isc_result_t result;
+	dns_rendercache_t *rc = NULL;
+	dns_renderedanswer_t *answer = NULL;
+	dns_message_t *msg = NULL;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *v1 = NULL, *v2 = NULL, *wv = NULL;
+	isc_region_t key, other, wire = { section, sizeof(section) };
+
+	result = dns_db_create(mctx, "rbt", dns_rootname,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_currentversion(db, &v1);
+
+	makemsg(&msg);
+	region(&key, "key1");
+	region(&other, "key2");
+
+	dns_rendercache_create(mctx, 5, &rc);
+	assert_int_equal(dns_rendercache_getsize(rc), 8);
+
+	result = dns_rendercache_find(rc, db, v1, &key, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_rendercache_add(rc, db, v1, &key, msg, &wire);
+	result = dns_rendercache_find(rc, db, v1, &key, &answer);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(answer->flags,
+			 DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA);
+	assert_int_equal(answer->rcode, dns_rcode_noerror);
+	assert_int_equal(answer->counts[DNS_SECTION_QUESTION], 0);
+	assert_int_equal(answer->counts[DNS_SECTION_ANSWER], 1);
+	assert_int_equal(answer->wire.length, sizeof(section));
+	assert_memory_equal(answer->wire.base, section, sizeof(section));
+	dns_renderedanswer_detach(&answer);
+
+	result = dns_rendercache_find(rc, db, v1, &other, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* a new version of the zone misses, and flushes when added to */
+	dns_db_newversion(db, &wv);
+	dns_db_closeversion(db, &wv, true);
+	dns_db_currentversion(db, &v2);
+	assert_ptr_not_equal(v1, v2);
+
+	result = dns_rendercache_find(rc, db, v2, &key, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	dns_rendercache_add(rc, db, v2, &other, msg, &wire);
+	result = dns_rendercache_find(rc, db, v1, &key, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	result = dns_rendercache_find(rc, db, v2, &other, &answer);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_renderedanswer_detach(&answer);
+
+	dns_rendercache_flush(rc);
+	result = dns_rendercache_find(rc, db, v2, &other, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_rendercache_detach(&rc);
+	dns_message_detach(&msg);
+	dns_db_closeversion(db, &v1, false);
+	dns_db_closeversion(db, &v2, false);
+	dns_db_detach(&db);
+}
+
+/* a cache of size zero is disabled */
+ISC_RUN_TEST_IMPL(rendercache_setsize) {
+	isc_result_t result;
+	dns_rendercache_t *rc = NULL;
+	dns_renderedanswer_t *answer = NULL;
+	dns_message_t *msg = NULL;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+	isc_region_t key, wire = { section, sizeof(section) };
+
+	result = dns_db_create(mctx, "rbt", dns_rootname,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_currentversion(db, &version);
+
+	makemsg(&msg);
+	region(&key, "key");
+
+	dns_rendercache_create(mctx, 16, &rc);
+	dns_rendercache_add(rc, db, version, &key, msg, &wire);
+
+	/* resizing flushes */
+	dns_rendercache_setsize(rc, 32);
+	assert_int_equal(dns_rendercache_getsize(rc), 32);
+	result = dns_rendercache_find(rc, db, version, &key, &answer);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_rendercache_setsize(rc, 0);
+	assert_int_equal(dns_rendercache_getsize(rc), 0);
+	dns_rendercache_add(rc, db, version, &key, msg, &wire);
+	result = dns_rendercache_find(rc, db, version, &key, &answer);
+	assert_int_equal(result, ISC_R_DISABLED);
+
+	dns_rendercache_setsize(rc, 1);
+	dns_rendercache_add(rc, db, version, &key, msg, &wire);
+	result = dns_rendercache_find(rc, db, version, &key, &answer);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_renderedanswer_detach(&answer);
+
+	dns_rendercache_detach(&rc);
+	dns_message_detach(&msg);
+	dns_db_closeversion(db, &version, false);
+	dns_db_detach(&db);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(rendercache_find)
+ISC_TEST_ENTRY(rendercache_setsize)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
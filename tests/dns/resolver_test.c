@@ -181,6 +181,20 @@ ISC_LOOP_TEST_IMPL(settimeout_overmax) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/* dns_resolver_sethedgepercent */
+ISC_LOOP_TEST_IMPL(sethedgepercent) {
+	dns_resolver_t *resolver = NULL;
+
+	mkres(&resolver);
+
+	assert_int_equal(dns_resolver_gethedgepercent(resolver), 0);
+	dns_resolver_sethedgepercent(resolver, 5);
+	assert_int_equal(dns_resolver_gethedgepercent(resolver), 5);
+
+	destroy_resolver(&resolver);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(gettimeout, setup_test, teardown_test)
@@ -188,6 +202,7 @@ ISC_TEST_ENTRY_CUSTOM(settimeout, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_default, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_belowmin, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_overmax, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(sethedgepercent, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdalign.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/arena.h>
+#include <isc/util.h>
+
+#include <tests/isc.h>
+
+/* allocations are aligned and do not overlap */
+ISC_RUN_TEST_IMPL(isc_arena_get) {
+	isc_arena_t *arena = NULL;
+	unsigned char *prev = NULL;
+
+	isc_arena_create(mctx, 1024, &arena);
+	assert_int_equal(isc_arena_size(arena), 1024);
+
+	for (size_t i = 1; i < 200; i++) {
+		unsigned char *p = isc_arena_get(arena, i);
+
+		assert_int_equal((uintptr_t)p % alignof(max_align_t), 0);
+		memset(p, i, i);
+		if (prev != NULL) {
+			/* the previous allocation was not overwritten */
+			assert_int_equal(prev[i - 2], (unsigned char)(i - 1));
+		}
+		prev = p;
+	}
+
+	/* larger than a chunk */
+	prev = isc_arena_get(arena, 4096);
+	memset(prev, 0, 4096);
+	assert_true(isc_arena_size(arena) >= 4096 + 1024);
+
+	isc_arena_destroy(&arena);
+	assert_null(arena);
+}
+
+/* nested marks and reset reuse the memory */
+ISC_RUN_TEST_IMPL(isc_arena_mark) {
+	isc_arena_t *arena = NULL;
+	isc_arenamark_t outer, inner;
+	void *p1, *p2, *p3;
+	size_t size;
+
+	isc_arena_create(mctx, 256, &arena);
+
+	p1 = isc_arena_get(arena, 16);
+	isc_arena_mark(arena, &outer);
+	p2 = isc_arena_get(arena, 16);
+	isc_arena_mark(arena, &inner);
+	p3 = isc_arena_get(arena, 16);
+
+	isc_arena_release(arena, &inner);
+	assert_ptr_equal(isc_arena_get(arena, 16), p3);
+
+	isc_arena_release(arena, &outer);
+	assert_ptr_equal(isc_arena_get(arena, 16), p2);
+
+	/* fill a few chunks, then go back to the mark */
+	for (size_t i = 0; i < 100; i++) {
+		(void)isc_arena_get(arena, 64);
+	}
+	size = isc_arena_size(arena);
+	isc_arena_release(arena, &outer);
+	assert_ptr_equal(isc_arena_get(arena, 16), p2);
+
+	/* the chunks are reused */
+	isc_arena_reset(arena);
+	assert_ptr_equal(isc_arena_get(arena, 16), p1);
+	for (size_t i = 0; i < 100; i++) {
+		(void)isc_arena_get(arena, 64);
+	}
+	assert_int_equal(isc_arena_size(arena), size);
+
+	isc_arena_destroy(&arena);
+}
+
+ISC_TEST_LIST_START
+
+ISC_TEST_ENTRY(isc_arena_get)
+ISC_TEST_ENTRY(isc_arena_mark)
+
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -1775,6 +1775,54 @@ ISC_RUN_TEST_IMPL(doh_connect_makeuri) {
 	assert_true(strcmp("https://[::1]:44343/dns-query", uri) == 0);
 }
 
+ISC_RUN_TEST_IMPL(doh_respcache) {
+	http_respcache_t *cache = NULL;
+	http_respcache_entry_t *entry = NULL;
+	uint8_t query1[DNS_MESSAGE_HEADER_SIZE] = { 0x00, 0x00, 0x01 };
+	uint8_t query2[DNS_MESSAGE_HEADER_SIZE] = { 0x00, 0x00, 0x02 };
+	uint8_t query3[DNS_MESSAGE_HEADER_SIZE] = { 0x00, 0x00, 0x03 };
+	uint8_t response[DNS_MESSAGE_HEADER_SIZE + 4] = { 0x12, 0x34, 0x81 };
+	uint8_t response_id[DNS_MESSAGE_HEADER_SIZE + 4] = { 0x43, 0x21, 0x81 };
+	isc_stdtime_t now = 1000;
+
+	cache = respcache_new(mctx);
+
+	/* The ETag does not depend on the message ID */
+	assert_int_equal(respcache_etag(response, sizeof(response)),
+			 respcache_etag(response_id, sizeof(response_id)));
+
+	respcache_add(cache, 2, query1, sizeof(query1), response,
+		      sizeof(response), now + 10,
+		      respcache_etag(response, sizeof(response)));
+	entry = respcache_find(cache, query1, sizeof(query1), now);
+	assert_non_null(entry);
+	assert_int_equal(entry->datalen, sizeof(response));
+	/* The stored response has its ID zeroed */
+	assert_int_equal(entry->data[0], 0);
+	assert_int_equal(entry->data[1], 0);
+	assert_int_equal(entry->data[2], response[2]);
+
+	/* Unknown query */
+	assert_null(respcache_find(cache, query2, sizeof(query2), now));
+
+	/* The least recently used entry gets evicted */
+	respcache_add(cache, 2, query2, sizeof(query2), response,
+		      sizeof(response), now + 10, 0);
+	assert_non_null(respcache_find(cache, query1, sizeof(query1), now));
+	respcache_add(cache, 2, query3, sizeof(query3), response,
+		      sizeof(response), now + 10, 0);
+	assert_int_equal(cache->count, 2);
+	assert_null(respcache_find(cache, query2, sizeof(query2), now));
+	assert_non_null(respcache_find(cache, query1, sizeof(query1), now));
+
+	/* Expired entries are removed on lookup */
+	assert_null(respcache_find(cache, query3, sizeof(query3), now + 10));
+	assert_int_equal(cache->count, 1);
+
+	respcache_destroy(&cache);
+	assert_null(cache);
+}
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY_CUSTOM(mock_doh_uv_tcp_bind, setup_test, teardown_test)
@@ -1783,6 +1831,7 @@ ISC_TEST_ENTRY(doh_base64url_to_base64)
 ISC_TEST_ENTRY(doh_base64_to_base64url)
 ISC_TEST_ENTRY(doh_path_validation)
 ISC_TEST_ENTRY(doh_connect_makeuri)
+ISC_TEST_ENTRY(doh_respcache)
 ISC_TEST_ENTRY_CUSTOM(doh_noop_POST, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(doh_noop_GET, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(doh_noresponse_POST, setup_test, teardown_test)
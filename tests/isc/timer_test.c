@@ -520,6 +520,51 @@ ISC_LOOP_TEST_CUSTOM_IMPL(reschedule_ticker, setup_loop_reschedule_ticker,
 	isc_interval_set(&timer_interval, 0, NS_PER_SEC / 4);
 }
 
+/*
+ * The same, for coarse timers that are kept in the loop's timing wheel.
+ */
+
+ISC_LOOP_TEST_CUSTOM_IMPL(coarse_reschedule_up, setup_loop_reschedule_up,
+			  teardown_loop_timer_expect) {
+	isc_timer_create(mainloop, timer_event, NULL, &timer);
+	isc_timer_setcoarse(timer, true);
+
+	/* Schedule the timer to fire on the next tick of the wheel */
+	isc_interval_set(&timer_interval, 0, 0);
+	isc_timer_start(timer, timer_type, &timer_interval);
+
+	/* And then reschedule it to 1 second */
+	isc_interval_set(&timer_interval, 1, 0);
+	isc_timer_start(timer, timer_type, &timer_interval);
+}
+
+ISC_LOOP_TEST_CUSTOM_IMPL(coarse_reschedule_down, setup_loop_reschedule_down,
+			  teardown_loop_timer_expect) {
+	isc_timer_create(mainloop, timer_event, NULL, &timer);
+	isc_timer_setcoarse(timer, true);
+
+	/* Schedule the timer beyond a full turn of the wheel */
+	isc_interval_set(&timer_interval, 30, 0);
+	isc_timer_start(timer, timer_type, &timer_interval);
+
+	/* And then reschedule it to fire on the next tick */
+	isc_interval_set(&timer_interval, 0, 0);
+	isc_timer_start(timer, timer_type, &timer_interval);
+}
+
+ISC_LOOP_TEST_CUSTOM_IMPL(coarse_reschedule_ticker,
+			  setup_loop_reschedule_ticker,
+			  teardown_loop_timer_expect) {
+	isc_timer_create(mainloop, timer_event, NULL, &timer);
+	isc_timer_setcoarse(timer, true);
+
+	isc_interval_set(&timer_interval, 0, 0);
+	isc_timer_start(timer, timer_type, &timer_interval);
+
+	/* Then fire every 1/4 second */
+	isc_interval_set(&timer_interval, 0, NS_PER_SEC / 4);
+}
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY_CUSTOM(ticker, setup_loopmgr, teardown_loopmgr)
@@ -531,6 +576,10 @@ ISC_TEST_ENTRY_CUSTOM(reschedule_down, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(reschedule_from_callback, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(zero, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(reschedule_ticker, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(coarse_reschedule_up, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(coarse_reschedule_down, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(coarse_reschedule_ticker, setup_loopmgr,
+		      teardown_loopmgr)
 
 ISC_TEST_LIST_END
 
@@ -25,6 +25,7 @@
  * redefined malloc in cmocka.h.
  */
 #include <openssl/err.h>
+#include <openssl/ssl.h>
 
 #define UNIT_TESTING
 #include <cmocka.h>
@@ -36,6 +37,7 @@
 #include <isc/refcount.h>
 #include <isc/sockaddr.h>
 #include <isc/thread.h>
+#include <isc/tls.h>
 #include <isc/util.h>
 #include <isc/uv.h>
 
@@ -114,6 +116,143 @@ ISC_LOOP_TEST_IMPL(tls_recv_send_quota_sendback) {
 	stream_recv_send(arg);
 }
 
+/* TLS session ticket keys */
+
+#define TICKETKEYS_FILE "tls_ticketkeys.tmp"
+
+/*
+ * Perform a TLS 1.2 handshake over a BIO pair, optionally trying to
+ * resume 'session'.  Returns whether the session has been resumed and
+ * the (possibly new) session to resume later.
+ */
+static bool
+ticket_handshake(isc_tlsctx_t *cctx, isc_tlsctx_t *sctx,
+		 SSL_SESSION **sessionp) {
+	isc_tls_t *client = isc_tls_create(cctx);
+	isc_tls_t *server = isc_tls_create(sctx);
+	BIO *cbio = NULL, *sbio = NULL;
+	bool client_done = false, server_done = false;
+	bool resumed;
+
+	assert_non_null(client);
+	assert_non_null(server);
+
+	assert_int_equal(BIO_new_bio_pair(&cbio, 0, &sbio, 0), 1);
+	SSL_set_bio(client, cbio, cbio);
+	SSL_set_bio(server, sbio, sbio);
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	if (*sessionp != NULL) {
+		assert_int_equal(SSL_set_session(client, *sessionp), 1);
+		SSL_SESSION_free(*sessionp);
+		*sessionp = NULL;
+	}
+
+	for (size_t i = 0; i < 32 && !(client_done && server_done); i++) {
+		client_done = client_done || SSL_do_handshake(client) == 1;
+		server_done = server_done || SSL_do_handshake(server) == 1;
+	}
+	assert_true(client_done && server_done);
+
+	resumed = SSL_session_reused(client);
+	assert_int_equal(resumed, SSL_session_reused(server));
+	isc_tls_account_handshake(server);
+
+	*sessionp = SSL_get1_session(client);
+	assert_non_null(*sessionp);
+
+	/* Otherwise, OpenSSL marks the session as not resumable */
+	SSL_set_shutdown(client, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_set_shutdown(server, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+
+	isc_tls_free(&client);
+	isc_tls_free(&server);
+
+	return (resumed);
+}
+
+static isc_tlsctx_t *
+ticket_server(isc_tlsctx_ticketkeys_t *keys, const char *name) {
+	isc_tlsctx_t *ctx = NULL;
+
+	assert_int_equal(isc_tlsctx_createserver(NULL, NULL, &ctx),
+			 ISC_R_SUCCESS);
+	if (keys != NULL) {
+		isc_tlsctx_set_ticketkeys(ctx, keys, name);
+	} else {
+		isc_tlsctx_set_random_session_id_context(ctx);
+	}
+
+	return (ctx);
+}
+
+ISC_RUN_TEST_IMPL(tls_ticketkeys) {
+	isc_tlsctx_ticketkeys_t *keys = NULL, *loaded = NULL;
+	isc_tlsctx_t *cctx = NULL, *sctx1 = NULL, *sctx2 = NULL;
+	isc_tlsctx_t *sctx3 = NULL, *other = NULL;
+	SSL_SESSION *session = NULL;
+	uint64_t full, resumed;
+
+	(void)unlink(TICKETKEYS_FILE);
+
+	assert_int_equal(isc_tlsctx_createclient(&cctx), ISC_R_SUCCESS);
+	isc_tlsctx_set_protocols(cctx, ISC_TLS_PROTO_VER_1_2);
+
+	isc_tlsctx_ticketkeys_create(mctx, &keys);
+	sctx1 = ticket_server(keys, "test");
+	sctx2 = ticket_server(keys, "test");
+
+	/* A ticket issued by one context is accepted by another one */
+	assert_false(ticket_handshake(cctx, sctx1, &session));
+	assert_true(ticket_handshake(cctx, sctx2, &session));
+
+	/* ... but not by a context created from another configuration */
+	other = ticket_server(keys, "other");
+	assert_false(ticket_handshake(cctx, other, &session));
+	isc_tlsctx_free(&other);
+
+	/* The tickets survive a rotation and can be stored on disk */
+	assert_false(ticket_handshake(cctx, sctx1, &session));
+	isc_tlsctx_ticketkeys_rotate(keys);
+	assert_int_equal(isc_tlsctx_ticketkeys_save(keys, TICKETKEYS_FILE),
+			 ISC_R_SUCCESS);
+
+	isc_tlsctx_ticketkeys_create(mctx, &loaded);
+	assert_int_equal(isc_tlsctx_ticketkeys_load(loaded, TICKETKEYS_FILE),
+			 ISC_R_SUCCESS);
+	sctx3 = ticket_server(loaded, "test");
+	assert_true(ticket_handshake(cctx, sctx3, &session));
+
+	/* The oldest key falls out of the ring */
+	for (size_t i = 0; i < ISC_TLSCTX_TICKETKEYS_MAX; i++) {
+		isc_tlsctx_ticketkeys_rotate(keys);
+	}
+	assert_false(ticket_handshake(cctx, sctx2, &session));
+
+	/* Contexts without a key ring do not accept the tickets */
+	other = ticket_server(NULL, NULL);
+	assert_false(ticket_handshake(cctx, other, &session));
+	isc_tlsctx_free(&other);
+
+	isc_tlsctx_ticketkeys_getstats(keys, &full, &resumed);
+	assert_int_equal(full, 4);
+	assert_int_equal(resumed, 1);
+	isc_tlsctx_ticketkeys_getstats(loaded, &full, &resumed);
+	assert_int_equal(full, 0);
+	assert_int_equal(resumed, 1);
+
+	SSL_SESSION_free(session);
+	isc_tlsctx_free(&sctx1);
+	isc_tlsctx_free(&sctx2);
+	isc_tlsctx_free(&sctx3);
+	isc_tlsctx_free(&cctx);
+	isc_tlsctx_ticketkeys_detach(&keys);
+	isc_tlsctx_ticketkeys_detach(&loaded);
+
+	(void)unlink(TICKETKEYS_FILE);
+}
+
 ISC_TEST_LIST_START
 
 /* TLS */
@@ -145,6 +284,10 @@ ISC_TEST_ENTRY_CUSTOM(tls_recv_send_quota, stream_recv_send_setup,
 ISC_TEST_ENTRY_CUSTOM(tls_recv_send_quota_sendback, stream_recv_send_setup,
 		      stream_recv_send_teardown)
 
+
+/* TLS session ticket keys */
+ISC_TEST_ENTRY(tls_ticketkeys)
+
 ISC_TEST_LIST_END
 
 static int
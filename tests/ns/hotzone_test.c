@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include <ns/hotzone.h>
+
+#include <tests/ns.h>
+
+#define LIMIT 10
+#define START 1000000
+
+static isc_result_t
+admit(ns_hotzones_t *hz, const char *zone, isc_stdtime_t now) {
+	dns_fixedname_t fixed;
+
+	dns_test_namefromstring(zone, &fixed);
+	return (ns_hotzones_admit(hz, dns_fixedname_name(&fixed), LIMIT, now));
+}
+
+/* a zone recursed into more than the limit is limited the next second */
+ISC_RUN_TEST_IMPL(ns_hotzones_limit) {
+	ns_hotzones_t *hz = NULL;
+	isc_stdtime_t now = START;
+
+	ns_hotzones_create(mctx, &hz);
+
+	for (int i = 0; i < 5 * LIMIT; i++) {
+		assert_int_equal(admit(hz, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+	for (int i = 0; i < LIMIT; i++) {
+		assert_int_equal(admit(hz, "other.example", now),
+				 ISC_R_SUCCESS);
+	}
+
+	now++;
+	for (int i = 0; i < LIMIT; i++) {
+		assert_int_equal(admit(hz, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+	assert_int_equal(admit(hz, "victim.example", now), ISC_R_QUOTA);
+	assert_int_equal(admit(hz, "other.example", now), ISC_R_SUCCESS);
+
+	/* still hot, as the refused recursions were counted too */
+	now++;
+	for (int i = 0; i < LIMIT; i++) {
+		assert_int_equal(admit(hz, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+	assert_int_equal(admit(hz, "victim.example", now), ISC_R_QUOTA);
+
+	/* after a quiet second, the zone has cooled down */
+	now += 2;
+	for (int i = 0; i < 2 * LIMIT; i++) {
+		assert_int_equal(admit(hz, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+
+	ns_hotzones_destroy(&hz);
+}
+
+/* the hot zone is found among many zones recursed into once */
+ISC_RUN_TEST_IMPL(ns_hotzones_heavyhitter) {
+	ns_hotzones_t *hz = NULL;
+	isc_stdtime_t now = START;
+	isc_buffer_t *b = NULL;
+	char name[100];
+
+	ns_hotzones_create(mctx, &hz);
+
+	for (int i = 0; i < 100 * LIMIT; i++) {
+		snprintf(name, sizeof(name), "zone%d.example", i);
+		assert_int_equal(admit(hz, name, now), ISC_R_SUCCESS);
+		if (i % 10 == 0) {
+			assert_int_equal(admit(hz, "victim.example", now),
+					 ISC_R_SUCCESS);
+		}
+	}
+
+	now++;
+	for (int i = 0; i < LIMIT; i++) {
+		assert_int_equal(admit(hz, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+	assert_int_equal(admit(hz, "victim.example", now), ISC_R_QUOTA);
+	assert_int_equal(admit(hz, "zone1.example", now), ISC_R_SUCCESS);
+
+	isc_buffer_allocate(mctx, &b, 1024);
+	assert_int_equal(ns_hotzones_dump(hz, now, &b), ISC_R_SUCCESS);
+	isc_buffer_putuint8(b, 0);
+	assert_string_equal(isc_buffer_base(b),
+			    "\n- victim.example: 100 recursions/s (refused 1)");
+	isc_buffer_free(&b);
+
+	ns_hotzones_destroy(&hz);
+}
+
+static isc_result_t
+admitname(ns_hotzones_t *hz, const char *name, const char *zone,
+	  isc_stdtime_t now) {
+	dns_fixedname_t fname, fzone;
+	dns_name_t *zonename = NULL;
+
+	dns_test_namefromstring(name, &fname);
+	if (zone != NULL) {
+		dns_test_namefromstring(zone, &fzone);
+		zonename = dns_fixedname_name(&fzone);
+	}
+	return (ns_hotzones_admitname(hz, dns_fixedname_name(&fname),
+				      zonename, LIMIT, now));
+}
+
+static void
+assert_nothot(ns_hotzones_t *hz, isc_stdtime_t now) {
+	isc_buffer_t *b = NULL;
+
+	isc_buffer_allocate(mctx, &b, 1024);
+	assert_int_equal(ns_hotzones_dump(hz, now, &b), ISC_R_SUCCESS);
+	assert_int_equal(isc_buffer_usedlength(b), 0);
+	isc_buffer_free(&b);
+}
+
+/* random multi-label subdomains are counted in the zone cut */
+ISC_RUN_TEST_IMPL(ns_hotzones_zonecut) {
+	ns_hotzones_t *hz = NULL;
+	isc_stdtime_t now = START;
+	char name[100];
+
+	ns_hotzones_create(mctx, &hz);
+
+	for (int i = 0; i < 5 * LIMIT; i++) {
+		snprintf(name, sizeof(name), "r%d.r%d.victim.example", i,
+			 i * 7);
+		assert_int_equal(admitname(hz, name, "victim.example", now),
+				 ISC_R_SUCCESS);
+	}
+
+	/* while the zone cut is not cached, the TLD's child is counted */
+	now++;
+	for (int i = 0; i < LIMIT; i++) {
+		snprintf(name, sizeof(name), "r%d.r%d.victim.example", i,
+			 i * 7);
+		assert_int_equal(admitname(hz, name, "example", now),
+				 ISC_R_SUCCESS);
+	}
+	assert_int_equal(admitname(hz, "a.b.victim.example", "example", now),
+			 ISC_R_QUOTA);
+	assert_int_equal(admitname(hz, "a.b.victim.example", NULL, now),
+			 ISC_R_QUOTA);
+	assert_int_equal(
+		admitname(hz, "a.b.victim.example", "victim.example", now),
+		ISC_R_QUOTA);
+	assert_int_equal(
+		admitname(hz, "www.other.example", "other.example", now),
+		ISC_R_SUCCESS);
+
+	ns_hotzones_destroy(&hz);
+}
+
+/* many distinct uncached second level domains do not limit their TLD */
+ISC_RUN_TEST_IMPL(ns_hotzones_tld) {
+	ns_hotzones_t *hz = NULL;
+	isc_stdtime_t now = START;
+	char name[100];
+
+	ns_hotzones_create(mctx, &hz);
+
+	for (int s = 0; s < 3; s++, now++) {
+		for (int i = 0; i < 100 * LIMIT; i++) {
+			snprintf(name, sizeof(name), "sld%d-%d.com", s, i);
+			assert_int_equal(admitname(hz, name, "com", now),
+					 ISC_R_SUCCESS);
+			snprintf(name, sizeof(name), "www.sld%d-%d.com", s, i);
+			assert_int_equal(admitname(hz, name, "com", now),
+					 ISC_R_SUCCESS);
+			assert_int_equal(admitname(hz, "com", ".", now),
+					 ISC_R_SUCCESS);
+			assert_int_equal(admitname(hz, ".", NULL, now),
+					 ISC_R_SUCCESS);
+		}
+	}
+
+	assert_nothot(hz, now);
+
+	ns_hotzones_destroy(&hz);
+}
+
+/* nor under a public suffix such as co.uk, cached or not */
+ISC_RUN_TEST_IMPL(ns_hotzones_publicsuffix) {
+	ns_hotzones_t *hz = NULL;
+	isc_stdtime_t now = START;
+	char name[100];
+
+	ns_hotzones_create(mctx, &hz);
+
+	for (int s = 0; s < 3; s++, now++) {
+		for (int i = 0; i < 100 * LIMIT; i++) {
+			snprintf(name, sizeof(name), "www.sld%d-%d.co.uk", s,
+				 i);
+			assert_int_equal(admitname(hz, name, "co.uk", now),
+					 ISC_R_SUCCESS);
+			snprintf(name, sizeof(name), "sld%d-%d.co.uk", s, i);
+			assert_int_equal(admitname(hz, name, "uk", now),
+					 ISC_R_SUCCESS);
+			snprintf(name, sizeof(name), "sld%d-%d.com.au", s, i);
+			assert_int_equal(admitname(hz, name, NULL, now),
+					 ISC_R_SUCCESS);
+		}
+	}
+
+	assert_nothot(hz, now);
+
+	/* a victim zone under a public suffix is still found */
+	for (int i = 0; i < 5 * LIMIT; i++) {
+		snprintf(name, sizeof(name), "r%d.r%d.victim.co.uk", i, i);
+		assert_int_equal(admitname(hz, name, "co.uk", now),
+				 ISC_R_SUCCESS);
+	}
+
+	now++;
+	for (int i = 0; i < LIMIT; i++) {
+		assert_int_equal(
+			admitname(hz, "www.victim.co.uk", "victim.co.uk", now),
+			ISC_R_SUCCESS);
+	}
+	assert_int_equal(admitname(hz, "www.victim.co.uk", "uk", now),
+			 ISC_R_QUOTA);
+	assert_int_equal(admitname(hz, "www.other.co.uk", "co.uk", now),
+			 ISC_R_SUCCESS);
+
+	ns_hotzones_destroy(&hz);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(ns_hotzones_limit)
+ISC_TEST_ENTRY(ns_hotzones_heavyhitter)
+ISC_TEST_ENTRY(ns_hotzones_zonecut)
+ISC_TEST_ENTRY(ns_hotzones_tld)
+ISC_TEST_ENTRY(ns_hotzones_publicsuffix)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN